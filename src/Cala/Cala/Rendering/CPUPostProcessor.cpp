@@ -0,0 +1,584 @@
+#include "CPUPostProcessor.h"
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include "Cala/Utility/SIMD.h"
+#include "Cala/Utility/ThreadPool.h"
+
+// Rows processed by a thread at once
+#define BAND_ROW_COUNT 16U
+
+// Limits of the GPU passes
+#define MAX_BLOOM_MIPS 6U
+#define MIN_BLOOM_MIP_SIZE 4U
+#define MAX_BLUR_RADIUS 64
+#define MAX_FUSED_OPERATIONS 8U
+
+namespace Cala {
+	void CPUPostProcessor::Image::resize(uint32_t _width, uint32_t _height)
+	{
+		width = _width;
+		height = _height;
+		pixels.resize((size_t)width * height * 4);
+	}
+
+	void CPUPostProcessor::pushEffect(PostProcessingEffect effect, float effectValue)
+	{
+		effects.emplace_back(effect, effectValue);
+	}
+
+	void CPUPostProcessor::process(float* pixels, uint32_t width, uint32_t height)
+	{
+		image.resize(width, height);
+		std::copy(pixels, pixels + image.pixels.size(), image.pixels.begin());
+		processImage(false);
+		std::copy(image.pixels.begin(), image.pixels.end(), pixels);
+	}
+
+	void CPUPostProcessor::process(uint8_t* pixels, uint32_t width, uint32_t height)
+	{
+		image.resize(width, height);
+		for (size_t i = 0; i < image.pixels.size(); ++i)
+			image.pixels[i] = (float)pixels[i] / 255.f;
+
+		processImage(true);
+
+		// Results are already rounded to multiples of 1 / 255
+		for (size_t i = 0; i < image.pixels.size(); ++i)
+			pixels[i] = (uint8_t)std::nearbyint(glm::clamp(image.pixels[i], 0.f, 1.f) * 255.f);
+	}
+
+	bool CPUPostProcessor::isPerPixelEffect(PostProcessingEffect effect)
+	{
+		return effect == PostProcessingEffect::HDR || effect == PostProcessingEffect::Negative;
+	}
+
+	void CPUPostProcessor::planPasses()
+	{
+		// Same plan as fused passes of PostProcessingRenderer, so results are rounded at the same points
+		passes.clear();
+		passes.emplace_back();
+		for (const auto& [effect, value] : effects)
+		{
+			Pass& current = passes.back();
+			const bool perPixel = isPerPixelEffect(effect);
+			if (perPixel && !current.compute && current.operations.size() < MAX_FUSED_OPERATIONS)
+			{
+				current.operations.emplace_back(effect, value);
+				continue;
+			}
+
+			Pass next;
+			next.copy = perPixel;
+			next.effect = effect;
+			next.strength = value;
+			next.compute = computeBlur && (effect == PostProcessingEffect::BoxBlur || effect == PostProcessingEffect::GaussianBlur);
+			if (perPixel)
+				next.operations.emplace_back(effect, value);
+
+			if (current.copy && current.operations.empty())
+				current = std::move(next);
+			else
+				passes.push_back(std::move(next));
+		}
+	}
+
+	void CPUPostProcessor::processImage(bool quantize)
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		statistics.passCount = 0;
+		planPasses();
+		for (const Pass& pass : passes)
+		{
+			if (pass.copy && pass.operations.empty())
+				continue;
+
+			applyPass(pass, quantize);
+			++statistics.passCount;
+		}
+
+		effects.clear();
+		statistics.processingTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	void CPUPostProcessor::applyPass(const Pass& pass, bool quantize)
+	{
+		if (pass.copy)
+		{
+			ThreadPool::getInstance().parallelFor(image.height, BAND_ROW_COUNT, [this, &pass, quantize](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t y = begin; y < end; ++y)
+					finishRow(image.getRow(y), image.width, pass, quantize);
+			});
+
+			return;
+		}
+
+		switch (pass.effect)
+		{
+			case PostProcessingEffect::BoxBlur:
+			case PostProcessingEffect::GaussianBlur:
+				applyBlur(pass, quantize);
+				break;
+			case PostProcessingEffect::EdgeDetection:
+				applyEdgeDetection(pass, quantize);
+				break;
+			case PostProcessingEffect::Bloom:
+				applyBloom(pass, quantize);
+				break;
+			default:
+				return;
+		}
+
+		std::swap(image, result);
+	}
+
+	void CPUPostProcessor::applyBlur(const Pass& pass, bool quantize)
+	{
+		// Fragment blurs sample at a fraction of the image size, so both of them are separable
+		const float offset = 1.f / glm::clamp(900.f - pass.strength, 50.f, 900.f);
+		const bool gaussian = pass.effect == PostProcessingEffect::GaussianBlur;
+		std::vector<Tap> rowTaps;
+		std::vector<Tap> columnTaps;
+		if (pass.compute)
+		{
+			// Compute passes fetch whole texels within a radius, weights are normalized by their sum
+			auto addComputeTaps = [gaussian, offset](std::vector<Tap>& taps, uint32_t size) {
+				const float footprint = glm::max(offset * (float)size, 1.f);
+				const int radius = glm::min((int)std::round(gaussian ? 2.f * footprint : footprint), MAX_BLUR_RADIUS);
+				float weightSum = 0.f;
+				for (int i = -radius; i <= radius; ++i)
+				{
+					const float weight = gaussian ? std::exp(-(float)(i * i) / (footprint * footprint)) : 1.f;
+					taps.push_back({ i, weight });
+					weightSum += weight;
+				}
+
+				for (Tap& tap : taps)
+					tap.weight /= weightSum;
+			};
+
+			addComputeTaps(rowTaps, image.width);
+			addComputeTaps(columnTaps, image.height);
+		}
+		else
+		{
+			const float sideWeight = gaussian ? 0.25f : 1.f / 3.f;
+			const float centerWeight = gaussian ? 0.5f : 1.f / 3.f;
+			for (int i = -1; i <= 1; ++i)
+			{
+				addBilinearTaps(rowTaps, (float)i * offset * (float)image.width, i == 0 ? centerWeight : sideWeight);
+				addBilinearTaps(columnTaps, (float)i * offset * (float)image.height, i == 0 ? centerWeight : sideWeight);
+			}
+		}
+
+		// Horizontal compute pass writes an 8 bit image, fragment blur keeps the intermediate sums
+		convolveRows(image, intermediate, rowTaps, pass.compute && quantize);
+		convolveColumns(intermediate, result, columnTaps, nullptr, 0.f, pass, quantize);
+	}
+
+	void CPUPostProcessor::applyEdgeDetection(const Pass& pass, bool quantize)
+	{
+		// Kernel is the center times its strength minus the other 8 taps, so it's the center minus the separable sum of all 9
+		const float offset = 1.f / pass.strength;
+		const float rowOffset = glm::min(offset * (float)image.width, (float)image.width);
+		const float columnOffset = glm::min(offset * (float)image.height, (float)image.height);
+		std::vector<Tap> rowTaps;
+		std::vector<Tap> columnTaps;
+		for (int i = -1; i <= 1; ++i)
+		{
+			addBilinearTaps(rowTaps, (float)i * rowOffset, 1.f);
+			addBilinearTaps(columnTaps, (float)i * columnOffset, -1.f);
+		}
+
+		convolveRows(image, intermediate, rowTaps, false);
+		convolveColumns(intermediate, result, columnTaps, &image, pass.strength / 50.f + 1.f, pass, quantize);
+	}
+
+	void CPUPostProcessor::applyBloom(const Pass& pass, bool quantize)
+	{
+		// Mip chain of the same sizes as on the GPU
+		const uint32_t mipCount = glm::min((uint32_t)glm::max(pass.strength, 1.f), MAX_BLOOM_MIPS);
+		std::vector<glm::uvec2> mipSizes;
+		glm::uvec2 mipSize(image.width, image.height);
+		for (uint32_t i = 0; i < mipCount; ++i)
+		{
+			mipSize /= 2U;
+			if (mipSize.x < MIN_BLOOM_MIP_SIZE || mipSize.y < MIN_BLOOM_MIP_SIZE)
+				break;
+
+			mipSizes.push_back(mipSize);
+		}
+
+		if (mipSizes.empty())
+			mipSizes.push_back(glm::max(glm::uvec2(image.width, image.height) / 2U, glm::uvec2(1U)));
+
+		bloomMips.resize(mipSizes.size());
+		for (size_t i = 0; i < mipSizes.size(); ++i)
+			bloomMips[i].resize(mipSizes[i].x, mipSizes[i].y);
+
+		// 13 taps of the downsample are a 3x3 grid 2 texels apart plus a 2x2 grid 1 texel apart, upsample is a 3x3 tent
+		const std::vector<Kernel> downsampleKernels = {
+			{ { -2.f, 0.f, 2.f }, { 0.25f, 0.5f, 0.25f }, { 0.125f, 0.25f, 0.125f } },
+			{ { -1.f, 1.f }, { 0.5f, 0.5f }, { 0.25f, 0.25f } }
+		};
+		const std::vector<Kernel> upsampleKernels = {
+			{ { -1.f, 0.f, 1.f }, { 0.25f, 0.5f, 0.25f }, { 0.25f, 0.5f, 0.25f } }
+		};
+
+		// First downsample also keeps only the bright parts of the scene
+		resample(image, mipSizes[0], downsampleKernels, [this](uint32_t y, const float* filtered)
+		{
+			float* row = bloomMips[0].getRow(y);
+			for (uint32_t x = 0; x < bloomMips[0].width; ++x)
+			{
+				const float* texel = filtered + x * 4;
+				const bool bright = 0.2126f * texel[0] + 0.7152f * texel[1] + 0.0722f * texel[2] >= 1.f;
+				for (uint32_t channel = 0; channel < 3; ++channel)
+					row[x * 4 + channel] = bright ? texel[channel] : 0.f;
+
+				row[x * 4 + 3] = 1.f;
+			}
+		});
+
+		for (size_t i = 1; i < bloomMips.size(); ++i)
+		{
+			Image& mip = bloomMips[i];
+			resample(bloomMips[i - 1], mipSizes[i], downsampleKernels, [&mip](uint32_t y, const float* filtered)
+			{
+				std::copy(filtered, filtered + (size_t)mip.width * 4, mip.getRow(y));
+			});
+		}
+
+		// Upsampled smaller mips are added on top of the larger ones
+		for (size_t i = bloomMips.size() - 1; i > 0; --i)
+		{
+			Image& mip = bloomMips[i - 1];
+			resample(bloomMips[i], mipSizes[i - 1], upsampleKernels, [&mip](uint32_t y, const float* filtered)
+			{
+				float* row = mip.getRow(y);
+				for (size_t j = 0; j < (size_t)mip.width * 4; ++j)
+					row[j] += filtered[j];
+			});
+		}
+
+		// Composition divides accumulated mips by their count, scene texels are read at their centers
+		result.resize(image.width, image.height);
+		const float mipWeight = 1.f / (float)bloomMips.size();
+		resample(bloomMips[0], glm::uvec2(image.width, image.height), upsampleKernels,
+			[this, &pass, quantize, mipWeight](uint32_t y, const float* filtered)
+		{
+			const float* sceneRow = image.getRow(y);
+			float* row = result.getRow(y);
+			for (size_t j = 0; j < (size_t)image.width * 4; ++j)
+				row[j] = sceneRow[j] + filtered[j] * mipWeight;
+
+			finishRow(row, image.width, pass, quantize);
+		});
+	}
+
+	void CPUPostProcessor::resample(const Image& source, const glm::uvec2& size, const std::vector<Kernel>& kernels, const RowFunction& writeRow)
+	{
+		// Each kernel tap is a bilinear sample at the destination pixel center, which reads two texels along each axis
+		auto addTaps = [](std::vector<Tap>& taps, uint32_t sourceSize, uint32_t destinationSize, const Kernel& kernel, const std::vector<float>& weights)
+		{
+			for (uint32_t i = 0; i < destinationSize; ++i)
+			{
+				const float center = ((float)i + 0.5f) * (float)sourceSize / (float)destinationSize - 0.5f;
+				for (size_t j = 0; j < kernel.offsets.size(); ++j)
+				{
+					const float position = center + kernel.offsets[j];
+					const float base = std::floor(position);
+					const float fraction = position - base;
+					taps.push_back({ glm::clamp((int)base, 0, (int)sourceSize - 1), weights[j] * (1.f - fraction) });
+					taps.push_back({ glm::clamp((int)base + 1, 0, (int)sourceSize - 1), weights[j] * fraction });
+				}
+			}
+		};
+
+		std::vector<std::vector<Tap>> horizontalTaps(kernels.size());
+		std::vector<std::vector<Tap>> verticalTaps(kernels.size());
+		for (size_t i = 0; i < kernels.size(); ++i)
+		{
+			addTaps(horizontalTaps[i], source.width, size.x, kernels[i], kernels[i].horizontalWeights);
+			addTaps(verticalTaps[i], source.height, size.y, kernels[i], kernels[i].verticalWeights);
+		}
+
+		ThreadPool::getInstance().parallelFor(size.y, BAND_ROW_COUNT, [&](uint32_t begin, uint32_t end)
+		{
+			// Source rows are weighted first, then the sums are resampled along the row
+			std::vector<float> rowSum((size_t)source.width * 4);
+			std::vector<float> filtered((size_t)size.x * 4);
+			std::vector<const float*> rows;
+			std::vector<float> weights;
+			for (uint32_t y = begin; y < end; ++y)
+			{
+				std::fill(filtered.begin(), filtered.end(), 0.f);
+				for (size_t i = 0; i < kernels.size(); ++i)
+				{
+					const size_t tapCount = kernels[i].offsets.size() * 2;
+					rows.clear();
+					weights.clear();
+					for (size_t j = 0; j < tapCount; ++j)
+					{
+						const Tap& tap = verticalTaps[i][y * tapCount + j];
+						rows.push_back(source.getRow((uint32_t)tap.offset));
+						weights.push_back(tap.weight);
+					}
+
+					sumRows(rows.data(), weights.data(), tapCount, rowSum.size(), rowSum.data());
+					for (uint32_t x = 0; x < size.x; ++x)
+					{
+						const Tap* taps = &horizontalTaps[i][x * tapCount];
+						float* out = filtered.data() + x * 4;
+					#if defined (CALA_SIMD_SSE2)
+						__m128 sum = _mm_loadu_ps(out);
+						for (size_t j = 0; j < tapCount; ++j)
+							sum = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(taps[j].weight), _mm_loadu_ps(rowSum.data() + taps[j].offset * 4)), sum);
+
+						_mm_storeu_ps(out, sum);
+					#else
+						for (size_t j = 0; j < tapCount; ++j)
+						{
+							for (int channel = 0; channel < 4; ++channel)
+								out[channel] += taps[j].weight * rowSum[taps[j].offset * 4 + channel];
+						}
+					#endif
+					}
+				}
+
+				writeRow(y, filtered.data());
+			}
+		});
+	}
+
+	void CPUPostProcessor::addBilinearTaps(std::vector<Tap>& taps, float offset, float weight)
+	{
+		const float base = std::floor(offset);
+		const float fraction = offset - base;
+		auto addTap = [&taps](int tapOffset, float tapWeight) {
+			for (Tap& tap : taps)
+			{
+				if (tap.offset == tapOffset)
+				{
+					tap.weight += tapWeight;
+					return;
+				}
+			}
+
+			taps.push_back({ tapOffset, tapWeight });
+		};
+
+		addTap((int)base, weight * (1.f - fraction));
+		if (fraction > 0.f)
+			addTap((int)base + 1, weight * fraction);
+	}
+
+	void CPUPostProcessor::convolveRows(const Image& source, Image& destination, const std::vector<Tap>& taps, bool quantize)
+	{
+		destination.resize(source.width, source.height);
+		int minOffset = 0;
+		int maxOffset = 0;
+		for (const Tap& tap : taps)
+		{
+			minOffset = glm::min(minOffset, tap.offset);
+			maxOffset = glm::max(maxOffset, tap.offset);
+		}
+
+		// Taps of interior pixels stay inside the row, only pixels near the ends are clamped
+		const int width = (int)source.width;
+		const int interiorBegin = glm::min(-minOffset, width);
+		const int interiorEnd = glm::max(width - maxOffset, interiorBegin);
+		ThreadPool::getInstance().parallelFor(source.height, BAND_ROW_COUNT, [&](uint32_t begin, uint32_t end)
+		{
+			const Pass plainPass;
+			for (uint32_t y = begin; y < end; ++y)
+			{
+				const float* in = source.getRow(y);
+				float* out = destination.getRow(y);
+				auto filterClamped = [&](int x) {
+					float sum[4] = {};
+					for (const Tap& tap : taps)
+					{
+						const float* texel = in + glm::clamp(x + tap.offset, 0, width - 1) * 4;
+						for (int channel = 0; channel < 4; ++channel)
+							sum[channel] += texel[channel] * tap.weight;
+					}
+
+					std::copy(sum, sum + 4, out + x * 4);
+				};
+
+				int x = 0;
+				for (; x < interiorBegin; ++x)
+					filterClamped(x);
+
+			#if defined (CALA_SIMD_AVX)
+				// Two RGBA pixels per register
+				for (; x + 2 <= interiorEnd; x += 2)
+				{
+					__m256 sum = _mm256_setzero_ps();
+					for (const Tap& tap : taps)
+					{
+						const __m256 texels = _mm256_loadu_ps(in + (x + tap.offset) * 4);
+					#if defined (CALA_SIMD_AVX2)
+						sum = _mm256_fmadd_ps(_mm256_set1_ps(tap.weight), texels, sum);
+					#else
+						sum = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(tap.weight), texels), sum);
+					#endif
+					}
+
+					_mm256_storeu_ps(out + x * 4, sum);
+				}
+			#elif defined (CALA_SIMD_SSE2)
+				for (; x < interiorEnd; ++x)
+				{
+					__m128 sum = _mm_setzero_ps();
+					for (const Tap& tap : taps)
+						sum = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tap.weight), _mm_loadu_ps(in + (x + tap.offset) * 4)), sum);
+
+					_mm_storeu_ps(out + x * 4, sum);
+				}
+			#endif
+
+				for (; x < width; ++x)
+					filterClamped(x);
+
+				if (quantize)
+					finishRow(out, source.width, plainPass, true);
+			}
+		});
+	}
+
+	void CPUPostProcessor::convolveColumns(const Image& source, Image& destination, const std::vector<Tap>& taps,
+		const Image* center, float centerWeight, const Pass& pass, bool quantize)
+	{
+		destination.resize(source.width, source.height);
+		ThreadPool::getInstance().parallelFor(source.height, BAND_ROW_COUNT, [&](uint32_t begin, uint32_t end)
+		{
+			// Center is one more weighted row
+			std::vector<const float*> rows(taps.size() + 1);
+			std::vector<float> weights(taps.size() + 1, centerWeight);
+			for (size_t i = 0; i < taps.size(); ++i)
+				weights[i] = taps[i].weight;
+
+			const size_t rowCount = center != nullptr ? taps.size() + 1 : taps.size();
+			for (uint32_t y = begin; y < end; ++y)
+			{
+				for (size_t i = 0; i < taps.size(); ++i)
+					rows[i] = source.getRow((uint32_t)glm::clamp((int)y + taps[i].offset, 0, (int)source.height - 1));
+
+				if (center != nullptr)
+					rows[taps.size()] = center->getRow(y);
+
+				float* out = destination.getRow(y);
+				sumRows(rows.data(), weights.data(), rowCount, (size_t)source.width * 4, out);
+				finishRow(out, source.width, pass, quantize);
+			}
+		});
+	}
+
+	void CPUPostProcessor::sumRows(const float* const* rows, const float* weights, size_t rowCount, size_t length, float* destination)
+	{
+		// Rows are contiguous, so they're summed as flat arrays
+		size_t i = 0;
+
+	#if defined (CALA_SIMD_AVX)
+		for (; i + 8 <= length; i += 8)
+		{
+			__m256 sum = _mm256_setzero_ps();
+			for (size_t j = 0; j < rowCount; ++j)
+			{
+			#if defined (CALA_SIMD_AVX2)
+				sum = _mm256_fmadd_ps(_mm256_set1_ps(weights[j]), _mm256_loadu_ps(rows[j] + i), sum);
+			#else
+				sum = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(weights[j]), _mm256_loadu_ps(rows[j] + i)), sum);
+			#endif
+			}
+
+			_mm256_storeu_ps(destination + i, sum);
+		}
+	#elif defined (CALA_SIMD_SSE2)
+		for (; i + 4 <= length; i += 4)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (size_t j = 0; j < rowCount; ++j)
+				sum = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(weights[j]), _mm_loadu_ps(rows[j] + i)), sum);
+
+			_mm_storeu_ps(destination + i, sum);
+		}
+	#endif
+
+		for (; i < length; ++i)
+		{
+			float sum = 0.f;
+			for (size_t j = 0; j < rowCount; ++j)
+				sum += weights[j] * rows[j][i];
+
+			destination[i] = sum;
+		}
+	}
+	void CPUPostProcessor::finishRow(float* row, uint32_t width, const Pass& pass, bool quantize)
+	{
+		const size_t rowLength = (size_t)width * 4;
+		size_t i = 0;
+
+	#if defined (CALA_SIMD_AVX2)
+		// exp(x) = 2^n * 2^f with n rounded x * log2(e), and 2^f of f in [-0.5, 0.5] as a polynomial
+		auto exponential = [](__m256 x) {
+			x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-87.f)), _mm256_set1_ps(88.f));
+			const __m256 scaled = _mm256_mul_ps(x, _mm256_set1_ps(1.44269504f));
+			const __m256 n = _mm256_round_ps(scaled, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+			const __m256 f = _mm256_sub_ps(scaled, n);
+			__m256 polynomial = _mm256_set1_ps(1.3333558e-3f);
+			polynomial = _mm256_fmadd_ps(polynomial, f, _mm256_set1_ps(9.6181291e-3f));
+			polynomial = _mm256_fmadd_ps(polynomial, f, _mm256_set1_ps(5.5504109e-2f));
+			polynomial = _mm256_fmadd_ps(polynomial, f, _mm256_set1_ps(2.4022651e-1f));
+			polynomial = _mm256_fmadd_ps(polynomial, f, _mm256_set1_ps(6.9314718e-1f));
+			polynomial = _mm256_fmadd_ps(polynomial, f, _mm256_set1_ps(1.f));
+			const __m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+			return _mm256_mul_ps(polynomial, _mm256_castsi256_ps(exponent));
+		};
+
+		const __m256 ones = _mm256_set1_ps(1.f);
+		for (; i + 8 <= rowLength; i += 8)
+		{
+			__m256 color = _mm256_loadu_ps(row + i);
+			for (const auto& [effect, strength] : pass.operations)
+			{
+				if (effect == PostProcessingEffect::HDR)
+					color = _mm256_sub_ps(ones, exponential(_mm256_mul_ps(color, _mm256_set1_ps(-strength))));
+				else
+					color = _mm256_sub_ps(ones, color);
+			}
+
+			// Alpha of both pixels
+			color = _mm256_blend_ps(color, ones, 0x88);
+			if (quantize)
+			{
+				color = _mm256_min_ps(_mm256_max_ps(color, _mm256_setzero_ps()), ones);
+				color = _mm256_round_ps(_mm256_mul_ps(color, _mm256_set1_ps(255.f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+				color = _mm256_div_ps(color, _mm256_set1_ps(255.f));
+			}
+
+			_mm256_storeu_ps(row + i, color);
+		}
+	#endif
+
+		for (; i < rowLength; ++i)
+		{
+			float value = 1.f;
+			if (i % 4 != 3)
+			{
+				value = row[i];
+				for (const auto& [effect, strength] : pass.operations)
+					value = effect == PostProcessingEffect::HDR ? 1.f - std::exp(-value * strength) : 1.f - value;
+			}
+
+			if (quantize)
+				value = std::nearbyint(glm::clamp(value, 0.f, 1.f) * 255.f) / 255.f;
+
+			row[i] = value;
+		}
+	}
+}
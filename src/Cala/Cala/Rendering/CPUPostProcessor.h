@@ -0,0 +1,108 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include <functional>
+#include <stdint.h>
+#include <glm/glm.hpp>
+#include "Renderers/PostProcessingRenderer.h"
+
+namespace Cala {
+	/**
+	 * Effects of PostProcessingRenderer computed on the CPU, for images read back from the GPU or rendered without one
+	 * Effects sample the image the way the shaders do, including bilinear filtering and clamping at edges
+	 * CalaPostProcessingTest compares results with PostProcessingRenderer output read back from the GPU, per channel tolerances
+	 * there cover GPU filtering precision and half float bloom mips
+	 * Per pixel effects are fused into preceding passes as on the GPU, 8 bit images are clamped and rounded after every pass
+	 * like 8 bit render targets, float images keep full precision
+	 * Rows are split into bands processed in parallel, filters use AVX2 with CALA_ENABLE_AVX2 CMake option and SSE2 otherwise
+	*/
+	class CPUPostProcessor {
+	public:
+		using PostProcessingEffect = PostProcessingRenderer::PostProcessingEffect;
+
+		struct Statistics {
+			uint32_t passCount = 0; // Passes over the whole image, bloom mips excluded
+			float processingTime = 0.f; // In milliseconds
+		};
+
+		CPUPostProcessor() = default;
+		~CPUPostProcessor() = default;
+
+		// Values have the same meaning as in PostProcessingRenderer
+		void pushEffect(PostProcessingEffect effect, float effectValue);
+
+		// Applies pushed effects in place and clears them, pixels are tightly packed RGBA rows, alpha of results is 1
+		void process(float* pixels, uint32_t width, uint32_t height);
+		void process(uint8_t* pixels, uint32_t width, uint32_t height);
+
+		const Statistics& getStatistics() const { return statistics; }
+
+		// Blurs match separable compute passes of PostProcessingRenderer instead of fragment ones
+		bool computeBlur = false;
+
+	private:
+		struct Image {
+			uint32_t width = 0;
+			uint32_t height = 0;
+			std::vector<float> pixels;
+
+			void resize(uint32_t _width, uint32_t _height);
+			float* getRow(uint32_t y) { return pixels.data() + (size_t)y * width * 4; }
+			const float* getRow(uint32_t y) const { return pixels.data() + (size_t)y * width * 4; }
+		};
+
+		// Texel at an offset along the filtered axis, from the filtered texel or from the start of the line when resampling
+		struct Tap {
+			int offset;
+			float weight;
+		};
+
+		// Effect reading the neighbourhood of pixels, or a copy, followed by per pixel effects
+		struct Pass {
+			bool copy = true;
+			PostProcessingEffect effect = PostProcessingEffect::Negative;
+			float strength = 0.f;
+			std::vector<std::pair<PostProcessingEffect, float>> operations;
+			bool compute = false;
+		};
+
+		// Grid of taps at offsets in source texels along both axes, weight of a tap is the product of its axis weights
+		struct Kernel {
+			std::vector<float> offsets;
+			std::vector<float> horizontalWeights;
+			std::vector<float> verticalWeights;
+		};
+
+		// Receives a filtered row of the destination
+		using RowFunction = std::function<void(uint32_t y, const float* filtered)>;
+
+		static bool isPerPixelEffect(PostProcessingEffect effect);
+		void planPasses();
+		void processImage(bool quantize);
+		void applyPass(const Pass& pass, bool quantize);
+		void applyBlur(const Pass& pass, bool quantize);
+		void applyEdgeDetection(const Pass& pass, bool quantize);
+		void applyBloom(const Pass& pass, bool quantize);
+
+		// Sum of kernels sampled bilinearly at destination pixel centers, as texture() of the shaders, rows are filtered in parallel
+		void resample(const Image& source, const glm::uvec2& size, const std::vector<Kernel>& kernels, const RowFunction& writeRow);
+
+		// Taps of a bilinear sample at an offset in texels, which reads the two texels around it
+		static void addBilinearTaps(std::vector<Tap>& taps, float offset, float weight);
+		void convolveRows(const Image& source, Image& destination, const std::vector<Tap>& taps, bool quantize);
+		// Destination is centerWeight times the center image plus the weighted rows, the center is optional
+		void convolveColumns(const Image& source, Image& destination, const std::vector<Tap>& taps,
+			const Image* center, float centerWeight, const Pass& pass, bool quantize);
+		static void sumRows(const float* const* rows, const float* weights, size_t rowCount, size_t length, float* destination);
+		// Applies operations of the pass, sets alpha and rounds to 8 bits if asked
+		static void finishRow(float* row, uint32_t width, const Pass& pass, bool quantize);
+
+		std::vector<std::pair<PostProcessingEffect, float>> effects;
+		std::vector<Pass> passes;
+		Image image;
+		Image intermediate;
+		Image result;
+		std::vector<Image> bloomMips;
+		Statistics statistics;
+	};
+}
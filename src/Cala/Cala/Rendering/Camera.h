@@ -1,6 +1,7 @@
 #pragma once
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/ext/matrix_float4x4.hpp>
+#include "Frustum.h"
 
 namespace Cala {
 	class Camera {
@@ -40,6 +41,7 @@ namespace Cala {
 		const glm::vec3& getWDirection() const { return wDirection; }
 		const glm::mat4& getView() const { return view; }
 		const glm::mat4& getProjection() const { return *currentProjection; }
+		Frustum getFrustum() const { return Frustum(getProjection() * view); }
 
 	protected:
 		void recalculateEulerAngles();
@@ -1,5 +1,6 @@
 #include "ConstantBuffer.h"
 #include <glad/glad.h>
+#include "Shader.h"
 #include <cstring>
 #include "Cala/Utility/Logger.h"
 
@@ -23,6 +24,10 @@ namespace Cala {
 		bindingPointsCache = other.bindingPointsCache;
 		errorOccured = other.errorOccured;
 		specification = other.specification;
+		sourceShader = other.sourceShader;
+		sourceBlockName = std::move(other.sourceBlockName);
+		sourceDynamic = other.sourceDynamic;
+		other.sourceShader = nullptr;
 		bufferHandle = other.bufferHandle;
 		other.bufferHandle = API_NULL;
 		return *this;
@@ -71,8 +76,33 @@ namespace Cala {
 		}
 	}
 
+	void ConstantBuffer::setSource(const Shader& shader, const std::string& blockName, bool isDynamic)
+	{
+		if (isLoaded() || sourceShader != nullptr)
+		{
+			Logger::getInstance().logErrorToConsole("Buffer is already loaded!");
+			return;
+		}
+
+		sourceShader = &shader;
+		sourceBlockName = blockName;
+		sourceDynamic = isDynamic;
+	}
+
+	void ConstantBuffer::createFromSource() const
+	{
+		if (sourceShader == nullptr)
+			return;
+
+		// First use may come through a const buffer, while creation itself is what setSource asked for
+		const Shader* shader = sourceShader;
+		sourceShader = nullptr;
+		const_cast<ConstantBuffer*>(this)->setData(shader->getConstantBufferInfo(sourceBlockName), sourceDynamic);
+	}
+
 	void ConstantBuffer::updateData(const std::string& variableName, const void* data, uint32_t sizeInBytes) const
 	{
+		createFromSource();
 		Logger& logger = Logger::getInstance();
 		if (bufferHandle == GL_NONE)
 		{
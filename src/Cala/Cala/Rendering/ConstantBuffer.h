@@ -6,6 +6,8 @@
 #include "GPUResource.h"
 
 namespace Cala {
+	class Shader;
+
 	class ConstantBuffer : public GPUResource {
 	public:
 		struct ConstantBufferVariableInfo {
@@ -32,14 +34,25 @@ namespace Cala {
 		void free() override;
 		bool isLoaded() const override;
 		void setData(ConstantBufferInfo&& bufferInfo, bool isDynamic = false);
+		/**
+		 * Block layout is read from the program and the buffer is created on first use instead of right away,
+		 * so renderers can submit all their programs before the driver is waited for to link any of them
+		 * Shader has to outlive the first use
+		*/
+		void setSource(const Shader& shader, const std::string& blockName, bool isDynamic = false);
 
 		// Updates data
 		void updateData(const std::string& variableName, const void* data, uint32_t sizeInBytes) const;
-		uint32_t getBindingPoint() const { return specification.bindingPoint; }
-		const ConstantBufferInfo& getConstantBufferSpecification() const { return specification; }
+		uint32_t getBindingPoint() const { createFromSource(); return specification.bindingPoint; }
+		const ConstantBufferInfo& getConstantBufferSpecification() const { createFromSource(); return specification; }
 
 	private:
+		void createFromSource() const;
+
 		ConstantBufferInfo specification;
+		mutable const Shader* sourceShader = nullptr;
+		std::string sourceBlockName;
+		bool sourceDynamic = false;
 		mutable bool errorOccured = false;
 
 	#ifdef CALA_API_OPENGL
@@ -0,0 +1,53 @@
+#include "DynamicResolution.h"
+#include <cmath>
+#include <glm/common.hpp>
+
+// Weight of the newest measurement in the frame time average
+#define FRAME_TIME_SMOOTHING 0.1f
+
+// Frames measured after a scale change before the next one
+#define SETTLE_FRAMES 15U
+
+// Relative deviation from target frame time tolerated without changing the scale
+#define FRAME_TIME_TOLERANCE 0.1f
+
+#define SCALE_STEP 0.05f
+
+namespace Cala {
+	DynamicResolution::DynamicResolution(float _targetFrameTime, float _minScale, float _maxScale) :
+		targetFrameTime(_targetFrameTime), minScale(_minScale), maxScale(_maxScale), scale(_maxScale) {}
+
+	float DynamicResolution::update(float frameTime)
+	{
+		if (averageFrameTime == 0.f)
+			averageFrameTime = frameTime;
+		else
+			averageFrameTime += (frameTime - averageFrameTime) * FRAME_TIME_SMOOTHING;
+
+		if (++framesSinceChange < SETTLE_FRAMES || averageFrameTime <= 0.f)
+			return scale;
+
+		const float deviation = averageFrameTime / targetFrameTime - 1.f;
+		if (std::abs(deviation) <= FRAME_TIME_TOLERANCE)
+			return scale;
+
+		float newScale = scale * std::sqrt(targetFrameTime / averageFrameTime);
+		newScale = std::round(newScale / SCALE_STEP) * SCALE_STEP;
+		newScale = glm::clamp(newScale, minScale, maxScale);
+		if (newScale == scale)
+			return scale;
+
+		// Average is rescaled to the expected cost at the new scale, so it doesn't trigger another change
+		averageFrameTime *= (newScale * newScale) / (scale * scale);
+		scale = newScale;
+		framesSinceChange = 0;
+		return scale;
+	}
+
+	void DynamicResolution::reset()
+	{
+		scale = maxScale;
+		averageFrameTime = 0.f;
+		framesSinceChange = 0;
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+
+namespace Cala {
+	/**
+	 * Adjusts resolution scale so that measured frame time approaches a target
+	 * Rendering cost is assumed to be proportional to pixel count, which is the square of the scale,
+	 * scale changes in fixed steps and waits a few frames after each change for measurements to settle
+	*/
+	class DynamicResolution {
+	public:
+		// Times in milliseconds
+		DynamicResolution(float targetFrameTime = 16.6f, float minScale = 0.5f, float maxScale = 1.f);
+		~DynamicResolution() = default;
+
+		// Returns scale for the following frames
+		float update(float frameTime);
+		void reset();
+
+		float getScale() const { return scale; }
+		float getAverageFrameTime() const { return averageFrameTime; }
+
+		float targetFrameTime;
+		float minScale;
+		float maxScale;
+
+	private:
+		float scale;
+		float averageFrameTime = 0.f;
+		uint32_t framesSinceChange = 0;
+	};
+}
@@ -0,0 +1,33 @@
+#include "Frustum.h"
+
+namespace Cala {
+	Frustum::Frustum(const glm::mat4& viewProjection)
+	{
+		// Gribb-Hartmann plane extraction, glm matrices are indexed [column][row]
+		auto row = [&viewProjection](int index) 
+		{
+			return glm::vec4(viewProjection[0][index], viewProjection[1][index], viewProjection[2][index], viewProjection[3][index]);
+		};
+
+		planes[Left] = row(3) + row(0);
+		planes[Right] = row(3) - row(0);
+		planes[Bottom] = row(3) + row(1);
+		planes[Top] = row(3) - row(1);
+		planes[Near] = row(3) + row(2);
+		planes[Far] = row(3) - row(2);
+
+		for (auto& plane : planes)
+			plane /= glm::length(glm::vec3(plane));
+	}
+
+	bool Frustum::containsSphere(const glm::vec3& center, float radius) const
+	{
+		for (const auto& plane : planes)
+		{
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+				return false;
+		}
+
+		return true;
+	}
+}
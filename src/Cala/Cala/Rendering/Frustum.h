@@ -0,0 +1,23 @@
+#pragma once
+#include <array>
+#include <glm/glm.hpp>
+
+namespace Cala {
+	/**
+	 * View frustum planes in world space
+	 * Each plane is stored as (normal, distance) with normal pointing inside the frustum
+	*/
+	struct Frustum {
+		enum Plane {
+			Left, Right,
+			Bottom, Top,
+			Near, Far
+		};
+
+		Frustum() = default;
+		Frustum(const glm::mat4& viewProjection);
+		bool containsSphere(const glm::vec3& center, float radius) const;
+
+		std::array<glm::vec4, 6> planes{};
+	};
+}
@@ -0,0 +1,202 @@
+#include "FrustumCuller.h"
+#include <algorithm>
+#include "Mesh.h"
+#include "Cala/Utility/SIMD.h"
+#include "Cala/Utility/ThreadPool.h"
+
+// Bounds large enough to pass every plane test without overflowing when summed
+#define UNBOUNDED_EXTENT 1e30f
+
+// Object count below which culling isn't split between threads
+#define PARALLEL_CULLING_THRESHOLD 4096
+#define PARALLEL_CULLING_CHUNK_SIZE 2048
+
+namespace Cala {
+	void FrustumCuller::clear()
+	{
+		centersX.clear();
+		centersY.clear();
+		centersZ.clear();
+		radii.clear();
+		extentsX.clear();
+		extentsY.clear();
+		extentsZ.clear();
+		visibility.clear();
+		statistics = Statistics();
+	}
+
+	uint32_t FrustumCuller::pushBoundingBox(const glm::vec3& minBound, const glm::vec3& maxBound, const glm::mat4& transform)
+	{
+		const uint32_t index = pushUnbounded();
+		setBoundingBox(index, minBound, maxBound, transform);
+		return index;
+	}
+
+	uint32_t FrustumCuller::pushMesh(const Mesh& mesh, const glm::mat4& transform)
+	{
+		const uint32_t index = pushUnbounded();
+		setMesh(index, mesh, transform);
+		return index;
+	}
+
+	uint32_t FrustumCuller::pushUnbounded()
+	{
+		resize(getObjectCount() + 1);
+		return getObjectCount() - 1;
+	}
+
+	void FrustumCuller::resize(uint32_t objectCount)
+	{
+		centersX.resize(objectCount, 0.f);
+		centersY.resize(objectCount, 0.f);
+		centersZ.resize(objectCount, 0.f);
+		radii.resize(objectCount, UNBOUNDED_EXTENT);
+		extentsX.resize(objectCount, UNBOUNDED_EXTENT);
+		extentsY.resize(objectCount, UNBOUNDED_EXTENT);
+		extentsZ.resize(objectCount, UNBOUNDED_EXTENT);
+		visibility.resize(objectCount, 1);
+	}
+
+	void FrustumCuller::setBoundingBox(uint32_t index, const glm::vec3& minBound, const glm::vec3& maxBound, const glm::mat4& transform)
+	{
+		const glm::vec3 localCenter = (minBound + maxBound) * 0.5f;
+		const glm::vec3 localExtent = (maxBound - minBound) * 0.5f;
+		const glm::vec3 center = glm::vec3(transform * glm::vec4(localCenter, 1.f));
+
+		// World space box enclosing transformed box (Arvo's method)
+		glm::vec3 extent(0.f);
+		for (int row = 0; row < 3; ++row)
+		{
+			for (int column = 0; column < 3; ++column)
+				extent[row] += glm::abs(transform[column][row]) * localExtent[column];
+		}
+
+		const float maxScale = glm::max(glm::length(glm::vec3(transform[0])), 
+			glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+
+		set(index, center, glm::length(localExtent) * maxScale, extent);
+	}
+
+	void FrustumCuller::setMesh(uint32_t index, const Mesh& mesh, const glm::mat4& transform)
+	{
+		if (!mesh.hasBoundingBox())
+			setUnbounded(index);
+		else
+			setBoundingBox(index, mesh.getBoundingBoxMin(), mesh.getBoundingBoxMax(), transform);
+	}
+
+	void FrustumCuller::setUnbounded(uint32_t index)
+	{
+		set(index, glm::vec3(0.f), UNBOUNDED_EXTENT, glm::vec3(UNBOUNDED_EXTENT));
+	}
+
+	void FrustumCuller::set(uint32_t index, const glm::vec3& center, float radius, const glm::vec3& extent)
+	{
+		centersX[index] = center.x;
+		centersY[index] = center.y;
+		centersZ[index] = center.z;
+		radii[index] = radius;
+		extentsX[index] = extent.x;
+		extentsY[index] = extent.y;
+		extentsZ[index] = extent.z;
+	}
+
+	void FrustumCuller::cull(const Frustum& frustum)
+	{
+		const uint32_t objectCount = getObjectCount();
+		if (objectCount < PARALLEL_CULLING_THRESHOLD)
+		{
+			cullRange(frustum, 0, objectCount);
+		}
+		else
+		{
+			ThreadPool::getInstance().parallelFor(objectCount, PARALLEL_CULLING_CHUNK_SIZE, [this, &frustum](uint32_t begin, uint32_t end)
+			{
+				cullRange(frustum, begin, end);
+			});
+		}
+
+		statistics.visibleCount = (uint32_t)std::count(visibility.begin(), visibility.end(), (uint8_t)1);
+		statistics.culledCount = objectCount - statistics.visibleCount;
+	}
+
+	void FrustumCuller::cullRange(const Frustum& frustum, uint32_t begin, uint32_t end)
+	{
+		/**
+		 * Sphere and box share the center, so object is outside of a plane when
+		 * distance + min(sphereRadius, projectedBoxRadius) < 0
+		*/
+		uint32_t i = begin;
+
+	#if defined (CALA_SIMD_AVX)
+		for (; i + 8 <= end; i += 8)
+		{
+			const __m256 centerX = _mm256_loadu_ps(&centersX[i]);
+			const __m256 centerY = _mm256_loadu_ps(&centersY[i]);
+			const __m256 centerZ = _mm256_loadu_ps(&centersZ[i]);
+			const __m256 radius = _mm256_loadu_ps(&radii[i]);
+			const __m256 extentX = _mm256_loadu_ps(&extentsX[i]);
+			const __m256 extentY = _mm256_loadu_ps(&extentsY[i]);
+			const __m256 extentZ = _mm256_loadu_ps(&extentsZ[i]);
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+			for (const auto& plane : frustum.planes)
+			{
+				__m256 distance = _mm256_add_ps(_mm256_mul_ps(centerX, _mm256_set1_ps(plane.x)), _mm256_mul_ps(centerY, _mm256_set1_ps(plane.y)));
+				distance = _mm256_add_ps(distance, _mm256_add_ps(_mm256_mul_ps(centerZ, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+				__m256 boxRadius = _mm256_add_ps(_mm256_mul_ps(extentX, _mm256_set1_ps(glm::abs(plane.x))), _mm256_mul_ps(extentY, _mm256_set1_ps(glm::abs(plane.y))));
+				boxRadius = _mm256_add_ps(boxRadius, _mm256_mul_ps(extentZ, _mm256_set1_ps(glm::abs(plane.z))));
+				const __m256 planeInside = _mm256_cmp_ps(_mm256_add_ps(distance, _mm256_min_ps(radius, boxRadius)), _mm256_setzero_ps(), _CMP_GE_OQ);
+				inside = _mm256_and_ps(inside, planeInside);
+			}
+
+			const int mask = _mm256_movemask_ps(inside);
+			for (uint32_t lane = 0; lane < 8; ++lane)
+				visibility[i + lane] = (mask >> lane) & 1;
+		}
+	#elif defined (CALA_SIMD_SSE2)
+		for (; i + 4 <= end; i += 4)
+		{
+			const __m128 centerX = _mm_loadu_ps(&centersX[i]);
+			const __m128 centerY = _mm_loadu_ps(&centersY[i]);
+			const __m128 centerZ = _mm_loadu_ps(&centersZ[i]);
+			const __m128 radius = _mm_loadu_ps(&radii[i]);
+			const __m128 extentX = _mm_loadu_ps(&extentsX[i]);
+			const __m128 extentY = _mm_loadu_ps(&extentsY[i]);
+			const __m128 extentZ = _mm_loadu_ps(&extentsZ[i]);
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+			for (const auto& plane : frustum.planes)
+			{
+				__m128 distance = _mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(plane.x)), _mm_mul_ps(centerY, _mm_set1_ps(plane.y)));
+				distance = _mm_add_ps(distance, _mm_add_ps(_mm_mul_ps(centerZ, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+				__m128 boxRadius = _mm_add_ps(_mm_mul_ps(extentX, _mm_set1_ps(glm::abs(plane.x))), _mm_mul_ps(extentY, _mm_set1_ps(glm::abs(plane.y))));
+				boxRadius = _mm_add_ps(boxRadius, _mm_mul_ps(extentZ, _mm_set1_ps(glm::abs(plane.z))));
+				const __m128 planeInside = _mm_cmpge_ps(_mm_add_ps(distance, _mm_min_ps(radius, boxRadius)), _mm_setzero_ps());
+				inside = _mm_and_ps(inside, planeInside);
+			}
+
+			const int mask = _mm_movemask_ps(inside);
+			for (uint32_t lane = 0; lane < 4; ++lane)
+				visibility[i + lane] = (mask >> lane) & 1;
+		}
+	#endif
+
+		for (; i < end; ++i)
+		{
+			bool inside = true;
+			for (const auto& plane : frustum.planes)
+			{
+				const float distance = centersX[i] * plane.x + centersY[i] * plane.y + centersZ[i] * plane.z + plane.w;
+				const float boxRadius = extentsX[i] * glm::abs(plane.x) + extentsY[i] * glm::abs(plane.y) + extentsZ[i] * glm::abs(plane.z);
+				if (distance + glm::min(radii[i], boxRadius) < 0.f)
+				{
+					inside = false;
+					break;
+				}
+			}
+
+			visibility[i] = inside ? 1 : 0;
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "Frustum.h"
+
+namespace Cala {
+	class Mesh;
+
+	/**
+	 * Tests world space bounding spheres and boxes against a frustum in batches
+	 * Bounds are stored as structure of arrays so that SIMD lanes process consecutive objects
+	*/
+	class FrustumCuller {
+	public:
+		struct Statistics {
+			uint32_t visibleCount = 0;
+			uint32_t culledCount = 0;
+		};
+
+		FrustumCuller() = default;
+		~FrustumCuller() = default;
+		void clear();
+
+		// Returns index of the pushed object, objects without bounds are never culled
+		uint32_t pushBoundingBox(const glm::vec3& minBound, const glm::vec3& maxBound, const glm::mat4& transform);
+		uint32_t pushMesh(const Mesh& mesh, const glm::mat4& transform);
+		uint32_t pushUnbounded();
+
+		// Objects kept between frames are resized and updated in place, added objects are unbounded
+		void resize(uint32_t objectCount);
+		void setBoundingBox(uint32_t index, const glm::vec3& minBound, const glm::vec3& maxBound, const glm::mat4& transform);
+		void setMesh(uint32_t index, const Mesh& mesh, const glm::mat4& transform);
+		void setUnbounded(uint32_t index);
+		void cull(const Frustum& frustum);
+		bool isVisible(uint32_t index) const { return visibility[index] != 0; }
+		uint32_t getObjectCount() const { return (uint32_t)visibility.size(); }
+		const Statistics& getStatistics() const { return statistics; }
+
+	private:
+		void cullRange(const Frustum& frustum, uint32_t begin, uint32_t end);
+		void set(uint32_t index, const glm::vec3& center, float radius, const glm::vec3& extent);
+
+		// World space box center is shared by the bounding sphere
+		std::vector<float> centersX, centersY, centersZ;
+		std::vector<float> radii;
+		std::vector<float> extentsX, extentsY, extentsZ;
+		std::vector<uint8_t> visibility;
+		Statistics statistics;
+	};
+}
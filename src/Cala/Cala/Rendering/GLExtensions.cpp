@@ -0,0 +1,52 @@
+#include "GLExtensions.h"
+
+namespace Cala {
+	bool GLExtensions::parallelShaderCompile = false;
+	void (APIENTRYP GLExtensions::maxShaderCompilerThreads)(GLuint count) = nullptr;
+	bool GLExtensions::bindlessTexture = false;
+	GLuint64 (APIENTRYP GLExtensions::getTextureHandle)(GLuint texture) = nullptr;
+	void (APIENTRYP GLExtensions::makeTextureHandleResident)(GLuint64 handle) = nullptr;
+	void (APIENTRYP GLExtensions::makeTextureHandleNonResident)(GLuint64 handle) = nullptr;
+	bool GLExtensions::textureCompressionS3TC = false;
+
+	void GLExtensions::load(GetProcAddress getProcAddress)
+	{
+		if (getProcAddress == nullptr)
+			return;
+
+		if (isSupported("GL_KHR_parallel_shader_compile"))
+			maxShaderCompilerThreads = reinterpret_cast<decltype(maxShaderCompilerThreads)>(getProcAddress("glMaxShaderCompilerThreadsKHR"));
+		else if (isSupported("GL_ARB_parallel_shader_compile"))
+			maxShaderCompilerThreads = reinterpret_cast<decltype(maxShaderCompilerThreads)>(getProcAddress("glMaxShaderCompilerThreadsARB"));
+
+		parallelShaderCompile = maxShaderCompilerThreads != nullptr;
+
+		// Lets the driver pick the number of compiler threads
+		if (parallelShaderCompile)
+			maxShaderCompilerThreads(0xFFFFFFFF);
+
+		if (isSupported("GL_ARB_bindless_texture"))
+		{
+			getTextureHandle = reinterpret_cast<decltype(getTextureHandle)>(getProcAddress("glGetTextureHandleARB"));
+			makeTextureHandleResident = reinterpret_cast<decltype(makeTextureHandleResident)>(getProcAddress("glMakeTextureHandleResidentARB"));
+			makeTextureHandleNonResident = reinterpret_cast<decltype(makeTextureHandleNonResident)>(getProcAddress("glMakeTextureHandleNonResidentARB"));
+		}
+
+		bindlessTexture = getTextureHandle != nullptr && makeTextureHandleResident != nullptr && makeTextureHandleNonResident != nullptr;
+		textureCompressionS3TC = isSupported("GL_EXT_texture_compression_s3tc");
+	}
+
+	bool GLExtensions::isSupported(std::string_view extensionName)
+	{
+		GLint extensionCount = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+		for (GLint i = 0; i < extensionCount; ++i)
+		{
+			const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+			if (extension != nullptr && extensionName == extension)
+				return true;
+		}
+
+		return false;
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <string_view>
+
+/**
+ * OpenGL extensions which are not part of the bundled GLAD loader (core profile without extensions)
+ * Entry points are loaded manually in GraphicsAPI::loadAPIFunctions
+*/
+
+#ifdef CALA_API_OPENGL
+#include <glad/glad.h>
+
+// GL_KHR_parallel_shader_compile
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+
+// GL_EXT_texture_compression_s3tc and GL_EXT_texture_sRGB
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+
+namespace Cala {
+	class GLExtensions {
+	public:
+		using GetProcAddress = void* (*)(const char* name);
+
+		static void load(GetProcAddress getProcAddress);
+		static bool isSupported(std::string_view extensionName);
+
+		// GL_KHR_parallel_shader_compile
+		static bool parallelShaderCompile;
+		static void (APIENTRYP maxShaderCompilerThreads)(GLuint count);
+
+		// GL_ARB_bindless_texture
+		static bool bindlessTexture;
+		static GLuint64 (APIENTRYP getTextureHandle)(GLuint texture);
+		static void (APIENTRYP makeTextureHandleResident)(GLuint64 handle);
+		static void (APIENTRYP makeTextureHandleNonResident)(GLuint64 handle);
+
+		// GL_EXT_texture_compression_s3tc, BC1 and BC3 textures
+		static bool textureCompressionS3TC;
+
+	private:
+		GLExtensions() = delete;
+	};
+}
+#else
+	#error API is not supported!
+#endif
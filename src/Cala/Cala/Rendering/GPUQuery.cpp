@@ -0,0 +1,122 @@
+#include "GPUQuery.h"
+#include "Cala/Utility/Logger.h"
+
+namespace Cala {
+#ifdef CALA_API_OPENGL
+#include <glad/glad.h>
+	GPUQuery::GPUQuery(Type type)
+	{
+		load(type);
+	}
+
+	GPUQuery::~GPUQuery()
+	{
+		free();
+	}
+
+	GPUQuery::GPUQuery(GPUQuery&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	GPUQuery& GPUQuery::operator=(GPUQuery&& other) noexcept
+	{
+		type = other.type;
+		active = other.active;
+		pending = other.pending;
+		queryHandle = other.queryHandle;
+		other.queryHandle = API_NULL;
+		other.active = false;
+		other.pending = false;
+		return *this;
+	}
+
+	void GPUQuery::load(Type _type)
+	{
+		if (isLoaded())
+		{
+			Logger::getInstance().logErrorToConsole("Query already loaded!");
+			return;
+		}
+
+		type = _type;
+		glGenQueries(1, &queryHandle);
+	}
+
+	void GPUQuery::free()
+	{
+		if (active)
+			end();
+
+		glDeleteQueries(1, &queryHandle);
+		queryHandle = API_NULL;
+		pending = false;
+	}
+
+	bool GPUQuery::isLoaded() const
+	{
+		return queryHandle != API_NULL;
+	}
+
+	void GPUQuery::begin()
+	{
+		if (!isLoaded() || active || pending || type == Type::Timestamp)
+		{
+			Logger::getInstance().logErrorToConsole("Query can't be started!");
+			return;
+		}
+
+		glBeginQuery(type == Type::SamplesPassed ? GL_SAMPLES_PASSED : GL_TIME_ELAPSED, queryHandle);
+		active = true;
+	}
+
+	void GPUQuery::end()
+	{
+		if (!active)
+			return;
+
+		glEndQuery(type == Type::SamplesPassed ? GL_SAMPLES_PASSED : GL_TIME_ELAPSED);
+		active = false;
+		pending = true;
+	}
+
+	void GPUQuery::recordTimestamp()
+	{
+		if (!isLoaded() || pending || type != Type::Timestamp)
+		{
+			Logger::getInstance().logErrorToConsole("Timestamp can't be recorded!");
+			return;
+		}
+
+		glQueryCounter(queryHandle, GL_TIMESTAMP);
+		pending = true;
+	}
+
+	bool GPUQuery::isResultAvailable() const
+	{
+		if (!pending)
+			return false;
+
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(queryHandle, GL_QUERY_RESULT_AVAILABLE, &available);
+		return available == GL_TRUE;
+	}
+
+	uint64_t GPUQuery::getResult()
+	{
+		if (!pending)
+		{
+			Logger::getInstance().logErrorToConsole("Query has no result!");
+			return 0;
+		}
+
+		// Waits for GPU if result isn't available yet
+		GLuint64 result = 0;
+		glGetQueryObjectui64v(queryHandle, GL_QUERY_RESULT, &result);
+		pending = false;
+		return result;
+	}
+#else
+	#error API is not supported
+#endif
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+#include "NativeAPI.h"
+#include "GPUResource.h"
+
+namespace Cala {
+	/**
+	 * Asynchronous GPU query, result becomes available a few frames after the query ends
+	*/
+	class GPUQuery : public GPUResource {
+	public:
+		enum class Type {
+			SamplesPassed,
+			TimeElapsed, // In nanoseconds
+			Timestamp // GPU time in nanoseconds when commands before the query finished
+		};
+
+		GPUQuery() = default;
+		GPUQuery(Type type);
+		~GPUQuery();
+		GPUQuery(const GPUQuery& other) = delete;
+		GPUQuery(GPUQuery&& other) noexcept;
+		GPUQuery& operator=(const GPUQuery& other) = delete;
+		GPUQuery& operator=(GPUQuery&& other) noexcept;
+
+		void load(Type type);
+		void free() override;
+		bool isLoaded() const override;
+
+		// Only one query of a type can be active at a time, timestamps are recorded instead
+		void begin();
+		void end();
+		void recordTimestamp();
+		bool isActive() const { return active; }
+		bool isPending() const { return pending; }
+
+		// Doesn't wait for GPU, result is read once and query can be started again afterwards
+		bool isResultAvailable() const;
+		uint64_t getResult();
+
+	private:
+		Type type = Type::SamplesPassed;
+		bool active = false;
+		bool pending = false;
+
+	#ifdef CALA_API_OPENGL
+		GLuint queryHandle = API_NULL;
+	#endif
+	};
+}
@@ -4,6 +4,7 @@
 #include "Texture.h"
 #include "ConstantBuffer.h"
 #include "Framebuffer.h"
+#include "GLExtensions.h"
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "Cala/Utility/Logger.h"
@@ -70,6 +71,8 @@ namespace Cala {
 					Logger::getInstance().logErrorToConsole("Failed to load OpenGL!");
 					std::exit(-1);
 				}
+
+				GLExtensions::load((GLExtensions::GetProcAddress)glfwGetProcAddress);
 			}
 			else
 			{
@@ -129,6 +132,17 @@ namespace Cala {
 		glBindFramebuffer(GL_FRAMEBUFFER, framebufferHandle);
     }
 
+	void GraphicsAPI::copyFramebufferDepth(const Framebuffer* source, const Framebuffer* destination, 
+		const glm::ivec4& sourceArea, const glm::ivec4& destinationArea) const
+	{
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, source != nullptr ? source->getNativeFramebufferHandle() : 0);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, destination != nullptr ? destination->getNativeFramebufferHandle() : 0);
+		glBlitFramebuffer(sourceArea.x, sourceArea.y, sourceArea.x + sourceArea.z, sourceArea.y + sourceArea.w, 
+			destinationArea.x, destinationArea.y, destinationArea.x + destinationArea.z, destinationArea.y + destinationArea.w, 
+			GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+		glBindFramebuffer(GL_FRAMEBUFFER, destination != nullptr ? destination->getNativeFramebufferHandle() : 0);
+	}
+
     void GraphicsAPI::enableSetting(Constant setting) const
 	{
 		glEnable(mapConstant(setting));
@@ -151,6 +165,34 @@ namespace Cala {
 		glDepthFunc(mapConstant(function));
 	}
 
+	void GraphicsAPI::setDepthWriting(bool enabled) const
+	{
+		glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+	}
+
+	void GraphicsAPI::setBlendingFunction(Constant sourceFactor, Constant destinationFactor) const
+	{
+		glBlendFunc(mapConstant(sourceFactor), mapConstant(destinationFactor));
+	}
+
+	void GraphicsAPI::setCulledFaces(Constant side) const
+	{
+		glCullFace(mapConstant(side));
+	}
+
+	void GraphicsAPI::setClipDistanceCount(uint32_t count) const
+	{
+		GLint maxClipDistances = 0;
+		glGetIntegerv(GL_MAX_CLIP_DISTANCES, &maxClipDistances);
+		for (GLint i = 0; i < maxClipDistances; ++i)
+		{
+			if ((uint32_t)i < count)
+				glEnable(GL_CLIP_DISTANCE0 + i);
+			else
+				glDisable(GL_CLIP_DISTANCE0 + i);
+		}
+	}
+
 	void GraphicsAPI::setStencilComparisonFunction(Constant function, int compareValue, int mask) const
 	{
 		glStencilFunc(mapConstant(function), compareValue, mask);
@@ -176,28 +218,45 @@ namespace Cala {
 		glLineWidth(lineWidth);
 	}
 
+	void GraphicsAPI::imageWriteBarrier() const
+	{
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+	}
+
 	void GraphicsAPI::clearFramebuffer() const
 	{
 		glClear(bufferClearingBitmask);
 	}
 
-	void GraphicsAPI::render(const Mesh& mesh) const
+	void GraphicsAPI::clearFramebuffer(bool color, bool depth, bool stencil) const
+	{
+		glClear((color ? GL_COLOR_BUFFER_BIT : 0) | (depth ? GL_DEPTH_BUFFER_BIT : 0) | (stencil ? GL_STENCIL_BUFFER_BIT : 0));
+	}
+
+	void GraphicsAPI::render(const Mesh& mesh, bool bindMesh) const
 	{
 		if (mesh.cullingEnabled)
 			enableSetting(FaceCulling);
 		else 
 			disableSetting(FaceCulling);
 
-		mesh.setForRendering();
+		if (bindMesh)
+			mesh.setForRendering();
 		if (mesh.getIndexCount() == 0)
 			draw(mesh.getDrawingMode(), mesh.getVertexCount());
 		else
 			drawIndexed(mesh.getDrawingMode(), mesh.getIndexCount());
 	}
 
-	void GraphicsAPI::renderInstances(const Mesh& mesh, uint32_t drawCount) const
+	void GraphicsAPI::renderInstances(const Mesh& mesh, uint32_t drawCount, bool bindMesh) const
 	{
-		mesh.setForRendering();
+		if (mesh.cullingEnabled)
+			enableSetting(FaceCulling);
+		else 
+			disableSetting(FaceCulling);
+
+		if (bindMesh)
+			mesh.setForRendering();
 		if (mesh.getIndexCount() == 0)
 			drawInstanced(mesh.getDrawingMode(), mesh.getVertexCount(), drawCount);
 		else
@@ -219,6 +278,7 @@ namespace Cala {
 			case Always:				return GL_ALWAYS;
 			case Never:					return GL_NEVER;
 			case Greater:				return GL_GREATER;
+			case Less:					return GL_LESS;
 			case Equal:					return GL_EQUAL;
 			case NotEqual:				return GL_NOTEQUAL;
 			case LessOrEqual:			return GL_LEQUAL;
@@ -235,6 +295,9 @@ namespace Cala {
 			case Lines:					return GL_LINE;
 			case Points:				return GL_POINT;
 			case Fill:					return GL_FILL;
+			case One:					return GL_ONE;
+			case SourceAlpha:			return GL_SRC_ALPHA;
+			case OneMinusSourceAlpha:	return GL_ONE_MINUS_SRC_ALPHA;
 			default:					return GL_NONE;
 		}
 	}
@@ -17,18 +17,24 @@ namespace Cala {
 		~GraphicsAPI();
 		static void _checkForErrors(const std::string& file, int line);
 		static void loadAPIFunctions();
-		void render(const Mesh& mesh) const;
-		void renderInstances(const Mesh& mesh, uint32_t drawCount) const;
+		// Vertex array binding can be skipped when the same mesh was the last one rendered
+		void render(const Mesh& mesh, bool bindMesh = true) const;
+		void renderInstances(const Mesh& mesh, uint32_t drawCount, bool bindMesh = true) const;
 		void setBufferClearingColor(const glm::vec4& color) const;
 		void setBufferClearingBits(bool color, bool depth, bool stencil);
 		void setViewport(const glm::ivec4& viewport);
 		glm::ivec4 getCurrentViewport() const;
 		void setRenderingPointSize(float size) const;
 		void clearFramebuffer() const;
+		// Clears given buffers regardless of clearing bits
+		void clearFramebuffer(bool color, bool depth, bool stencil) const;
 
 		// nullptr activates default framebuffer
 		void activateFramebuffer(const Framebuffer* framebuffer);
 
+		// Copies depth of framebuffers with matching depth formats, nullptr is the default framebuffer
+		void copyFramebufferDepth(const Framebuffer* source, const Framebuffer* destination, const glm::ivec4& sourceArea, const glm::ivec4& destinationArea) const;
+
 		enum Constant {
 			// GraphicsAPI settings
 			Blending, Multisampling, FaceCulling,
@@ -49,17 +55,27 @@ namespace Cala {
 
 			// Sides
 			Front, Back, FrontAndBack,
+
+			// Blending factors, Zero is shared with stencil operations
+			One, SourceAlpha, OneMinusSourceAlpha,
 		};
 
 		void enableSetting(Constant setting) const;
 		void disableSetting(Constant setting) const;
 		bool getSettingState(Constant setting) const;
 		void setDepthComparisonFunction(Constant function) const;
+		void setDepthWriting(bool enabled) const;
+		void setBlendingFunction(Constant sourceFactor, Constant destinationFactor) const;
+		void setCulledFaces(Constant side) const;
+		// Enables first count of gl_ClipDistance outputs, disables the rest
+		void setClipDistanceCount(uint32_t count) const;
 		void setStencilComparisonFunction(Constant function, int compareValue, int mask) const;
 		void setStencilOperation(Constant stencilFailOp, Constant depthFailOp, Constant pass) const;
 		void setStencilMask(int value) const;
 		void setPolygonFillingMode(Constant side, Constant mode) const;
 		void setLineWidth(float lineWidth) const;
+		// Makes image stores of previous dispatches visible to sampling, image loads and rendering
+		void imageWriteBarrier() const;
 
 	protected:
 		GraphicsAPI() = default;
@@ -1,10 +1,16 @@
 #include "ITexture.h"
 #include <cstring>
+#include <atomic>
 #include "Framebuffer.h"
+#include "GLExtensions.h"
+#include "Cala/Utility/Logger.h"
 
 namespace Cala {
 #ifdef CALA_API_OPENGL
     #include <glad/glad.h>
+    // Shared by all textures, generation 0 is never loaded
+    static std::atomic<uint64_t> lastGeneration{ 0 };
+
     ITexture::~ITexture()
     {
        free();
@@ -27,6 +33,8 @@ namespace Cala {
         other.textureHandle = GL_NONE;
         writeOnly = other.writeOnly;
         dimensionality = other.dimensionality;
+        textureFormat = other.textureFormat;
+        generation = other.generation;
         return *this;
     }
 
@@ -39,6 +47,49 @@ namespace Cala {
         glBindTexture(nativeType, textureHandle);
     }
 
+    void ITexture::setForImageAccess(uint32_t bindingIndex, ImageAccess access) const
+    {
+        // Image units need a sized format, unsized RGBA textures are allocated as RGBA8
+        GLenum imageFormat;
+        switch (textureFormat)
+        {
+            case Format::RGBA:          imageFormat = GL_RGBA8; break;
+            case Format::HALF_RGBA:     imageFormat = GL_RGBA16F; break;
+            case Format::FLOAT_RGBA:    imageFormat = GL_RGBA32F; break;
+            default:
+                Logger::getInstance().logErrorToConsole("Texture format can't be bound as an image!");
+                return;
+        }
+
+        if (writeOnly)
+        {
+            Logger::getInstance().logErrorToConsole("Write only texture can't be bound as an image!");
+            return;
+        }
+
+        GLenum nativeAccess = access == ImageAccess::ReadOnly ? GL_READ_ONLY : access == ImageAccess::WriteOnly ? GL_WRITE_ONLY : GL_READ_WRITE;
+        GLboolean layered = dimensionality == Dimensionality::TwoDimensional ? GL_FALSE : GL_TRUE;
+        glBindImageTexture(bindingIndex, textureHandle, 0, layered, 0, nativeAccess, imageFormat);
+    }
+
+    void ITexture::readPixels(void* pixels, uint32_t level) const
+    {
+        if (writeOnly || dimensionality != Dimensionality::TwoDimensional || !isColor() || isCompressed())
+        {
+            Logger::getInstance().logErrorToConsole("Only uncompressed 2D color textures can be read back!");
+            return;
+        }
+
+        // Rows are tightly packed, previous pack alignment is restored afterwards
+        GLint packAlignment = 4;
+        glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D, textureHandle);
+        glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, dataType == GL_FLOAT ? GL_FLOAT : GL_UNSIGNED_BYTE, pixels);
+        glBindTexture(GL_TEXTURE_2D, GL_NONE);
+        glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+    }
+
     void ITexture::free()
     {
         if (writeOnly)
@@ -69,13 +120,20 @@ namespace Cala {
         return format == GL_DEPTH_STENCIL;
     }
 
+    bool ITexture::isCompressed() const
+    {
+        return textureFormat >= Format::BC1_RGBA;
+    }
+
     void ITexture::initializeData(const Specification &specification)
     {
         width = specification.width;
         height = specification.height;
         dimensionality = specification.dimensionality;
         writeOnly = specification.writeOnly;
-        
+        textureFormat = specification.format;
+        generation = ++lastGeneration;
+
         switch (specification.format)
         {
             case Format::RGB:
@@ -90,7 +148,7 @@ namespace Cala {
                 break;
             case Format::GAMMA_RGBA:
                 internalFormat = GL_SRGB_ALPHA;
-                format = GL_SRGB;
+                format = GL_RGBA;
                 dataType = GL_UNSIGNED_BYTE;
                 break;
             case Format::FLOAT_RGBA:
@@ -98,6 +156,11 @@ namespace Cala {
                 format = GL_RGBA;
                 dataType = GL_FLOAT;
                 break;
+            case Format::HALF_RGBA:
+                internalFormat = GL_RGBA16F;
+                format = GL_RGBA;
+                dataType = GL_FLOAT;
+                break;
             case Format::DEPTH16:
                 internalFormat = GL_DEPTH_COMPONENT16;
                 format = GL_DEPTH_COMPONENT;
@@ -113,10 +176,38 @@ namespace Cala {
                 format = GL_DEPTH_STENCIL;
                 dataType = GL_UNSIGNED_INT_24_8;
                 break;
+            case Format::BC1_RGBA:
+                internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+                break;
+            case Format::GAMMA_BC1_RGBA:
+                internalFormat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+                break;
+            case Format::BC3_RGBA:
+                internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+                break;
+            case Format::GAMMA_BC3_RGBA:
+                internalFormat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+                break;
+            case Format::BC5_RG:
+                internalFormat = GL_COMPRESSED_RG_RGTC2;
+                break;
+            case Format::BC7_RGBA:
+                internalFormat = GL_COMPRESSED_RGBA_BPTC_UNORM;
+                break;
+            case Format::GAMMA_BC7_RGBA:
+                internalFormat = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+                break;
+        }
+
+        // Compressed textures are uploaded as blocks, transfer format only describes their decoded texels
+        if (isCompressed())
+        {
+            format = GL_RGBA;
+            dataType = GL_UNSIGNED_BYTE;
         }
     }
 
-    void ITexture::setParameters(const Specification &specification) const
+    void ITexture::setParameters(const Specification &specification, uint32_t mipmapCount) const
     {
         auto translateMethod = [](WrappingMethod method) -> GLuint
         {
@@ -140,7 +231,15 @@ namespace Cala {
         };
 
         glTexParameteri(nativeType, GL_TEXTURE_MAG_FILTER, specification.renderingStyle.magFilter == Filter::Linear ? GL_LINEAR : GL_NEAREST);
-        glTexParameteri(nativeType, GL_TEXTURE_MIN_FILTER, specification.renderingStyle.minFilter == Filter::Linear ? GL_LINEAR : GL_NEAREST);
+        const bool linearMinification = specification.renderingStyle.minFilter == Filter::Linear;
+        if (mipmapCount > 1)
+        {
+            glTexParameteri(nativeType, GL_TEXTURE_MIN_FILTER, linearMinification ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST_MIPMAP_NEAREST);
+            glTexParameteri(nativeType, GL_TEXTURE_MAX_LEVEL, (GLint)mipmapCount - 1);
+        }
+        else
+            glTexParameteri(nativeType, GL_TEXTURE_MIN_FILTER, linearMinification ? GL_LINEAR : GL_NEAREST);
+
         glTexParameterfv(nativeType, GL_TEXTURE_BORDER_COLOR, specification.borderColor);
         glTexParameteri(nativeType, GL_TEXTURE_WRAP_S, translateMethod(specification.renderingStyle.sDimensionWrap));
 
@@ -150,12 +249,28 @@ namespace Cala {
         if (dimensionality == Dimensionality::ThreeDimensional || dimensionality == Dimensionality::Cubemap) 
             glTexParameteri(nativeType, GL_TEXTURE_WRAP_R, translateMethod(specification.renderingStyle.rDimensionWrap));
 
-        if (!isColor())
+        if (!isColor() && specification.depthComparison)
         {
             glTexParameteri(nativeType, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
             glTexParameteri(nativeType, GL_TEXTURE_COMPARE_FUNC, GL_GEQUAL);
         }
     }
+
+    GLenum ITexture::getSizedFormat(GLenum format)
+    {
+        // Base formats are what textures used to be created with, others are sized already
+        switch (format)
+        {
+            case GL_RGB:
+                return GL_RGB8;
+            case GL_RGBA:
+                return GL_RGBA8;
+            case GL_SRGB_ALPHA:
+                return GL_SRGB8_ALPHA8;
+            default:
+                return format;
+        }
+    }
 #else
     #error Api not supported yet!
 #endif
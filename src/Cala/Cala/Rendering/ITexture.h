@@ -25,9 +25,18 @@ namespace Cala {
 			RGBA,
 			GAMMA_RGBA,
 			FLOAT_RGBA,
+			HALF_RGBA,
 			DEPTH16,
 			DEPTH32,
-			DEPTH24_STENCIL8
+			DEPTH24_STENCIL8,
+			// Block compressed, see CompressedImage, BC1 and BC3 need GL_EXT_texture_compression_s3tc
+			BC1_RGBA,
+			GAMMA_BC1_RGBA,
+			BC3_RGBA,
+			GAMMA_BC3_RGBA,
+			BC5_RG,
+			BC7_RGBA,
+			GAMMA_BC7_RGBA
 		};
 
 		enum class Dimensionality {
@@ -55,6 +64,7 @@ namespace Cala {
 			Format format;
 			Dimensionality dimensionality;
 			bool writeOnly = false;
+			bool depthComparison = true; // Depth textures are sampled through shadow samplers, otherwise as plain values
 			float borderColor[4]{1.f, 1.f, 1.f, 1.f};
 		};
 
@@ -67,21 +77,39 @@ namespace Cala {
         // virtual void attachToFramebuffer(Framebuffer& framebuffer) = 0;
 		glm::ivec2 getDimensions() const { return glm::ivec2(width, height); }
 		void setForSampling(uint32_t bindingIndex) const;
+
+		enum class ImageAccess {
+			ReadOnly,
+			WriteOnly,
+			ReadWrite
+		};
+
+		// Binds first mip level for image load and store, only RGBA color formats can be bound
+		void setForImageAccess(uint32_t bindingIndex, ImageAccess access) const;
+		// Copies a level of a 2D color texture as tightly packed RGBA rows, of floats for float formats and of bytes otherwise
+		void readPixels(void* pixels, uint32_t level = 0) const;
 		void free() override;
 		bool isLoaded() const override;
 		bool isWriteOnly() const { return writeOnly; }
 		bool isDepth() const;
 		bool isColor() const;
 		bool isDepthStencil() const;
+		bool isCompressed() const;
 		Dimensionality getDimensionality() const { return dimensionality; }
+		Format getFormat() const { return textureFormat; }
+		// Unique for each load, so contents loaded again at the same address can be told apart
+		uint64_t getGeneration() const { return generation; }
 
 	protected:
 		void initializeData(const Specification& specification);
-		void setParameters(const Specification& specification) const;
+		// Textures with mipmaps are minified through them
+		void setParameters(const Specification& specification, uint32_t mipmapCount = 1) const;
         int width = 0;
         int height = 0;
 		bool writeOnly = false;
 		Dimensionality dimensionality;
+		Format textureFormat = Format::RGBA;
+		uint64_t generation = 0;
 
 	// API specific
 	#ifdef CALA_API_OPENGL
@@ -91,6 +119,9 @@ namespace Cala {
 		GLenum internalFormat;
 		GLenum format;
 		GLenum dataType;
+	protected:
+		// Immutable storage accepts only sized formats
+		static GLenum getSizedFormat(GLenum format);
 	public:
         GLuint getNativeHandle() const { return textureHandle; }
 	#endif
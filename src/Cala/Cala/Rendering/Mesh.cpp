@@ -33,6 +33,9 @@ namespace Cala {
 		vertexCount = other.vertexCount;
 		indexCount = other.indexCount;
 		cullingEnabled = other.cullingEnabled;
+		boundingBoxMin = other.boundingBoxMin;
+		boundingBoxMax = other.boundingBoxMax;
+		boundingBoxSet = other.boundingBoxSet;
 		return *this;
 	}
 
@@ -60,6 +63,27 @@ namespace Cala {
 
 		setDrawingMode(model.getDrawingMode());
 		cullingEnabled = _cullingEnabled;
+
+		const auto& positions = model.getPositions();
+		if (!positions.empty())
+		{
+			glm::vec3 minBound = positions[0];
+			glm::vec3 maxBound = positions[0];
+			for (const auto& position : positions)
+			{
+				minBound = glm::min(minBound, position);
+				maxBound = glm::max(maxBound, position);
+			}
+
+			setBoundingBox(minBound, maxBound);
+		}
+	}
+
+	void Mesh::setBoundingBox(const glm::vec3& minBound, const glm::vec3& maxBound)
+	{
+		boundingBoxMin = minBound;
+		boundingBoxMax = maxBound;
+		boundingBoxSet = true;
 	}
 
 	void Mesh::setVertexBufferData(const float* data, uint32_t arraySize, uint32_t _vertexCount, const std::vector<Model::VertexLayoutSpecification>& layouts, bool isDynamic)
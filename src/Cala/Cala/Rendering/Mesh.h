@@ -33,11 +33,20 @@ namespace Cala {
 		uint32_t getIndexCount() const { return indexCount; }
 		uint32_t getDrawingMode() const { return drawingMode; }
 
+		// Bounding box in model space, computed when loading from model
+		void setBoundingBox(const glm::vec3& minBound, const glm::vec3& maxBound);
+		bool hasBoundingBox() const { return boundingBoxSet; }
+		const glm::vec3& getBoundingBoxMin() const { return boundingBoxMin; }
+		const glm::vec3& getBoundingBoxMax() const { return boundingBoxMax; }
+
 		bool cullingEnabled = false;
 
 	private:
 		uint32_t vertexCount{ 0 };
 		uint32_t indexCount{ 0 };
+		glm::vec3 boundingBoxMin{ 0.f };
+		glm::vec3 boundingBoxMax{ 0.f };
+		bool boundingBoxSet = false;
 	#ifdef CALA_API_OPENGL
 		GLenum drawingMode;
 		GLuint vbo = API_NULL;
@@ -0,0 +1,309 @@
+#include "OcclusionCuller.h"
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include "Mesh.h"
+#include "Cala/Utility/SIMD.h"
+#include "Cala/Utility/ThreadPool.h"
+
+// Rows of depth buffer rasterized by a single task
+#define BAND_ROW_COUNT 16U
+
+// Triangles with smaller doubled screen space area don't cover any pixel center
+#define MIN_TRIANGLE_AREA 1e-6f
+
+namespace Cala {
+	OcclusionCuller::OcclusionCuller(uint32_t _width, uint32_t _height) : width((glm::max(_width, 1U) + 7U) & ~7U), height(glm::max(_height, 1U))
+	{
+		glm::uvec2 size(width, height);
+		while (true)
+		{
+			levelSizes.push_back(size);
+			depthLevels.emplace_back(size.x * size.y, 1.f);
+			if (size.x == 1 && size.y == 1)
+				break;
+
+			size = (size + 1U) / 2U;
+		}
+	}
+
+	void OcclusionCuller::begin(const glm::mat4& _viewProjection)
+	{
+		viewProjection = _viewProjection;
+		triangles.clear();
+		std::fill(depthLevels[0].begin(), depthLevels[0].end(), 1.f);
+		statistics = Statistics();
+	}
+
+	void OcclusionCuller::pushOccluderTriangles(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, const glm::mat4& transform)
+	{
+		const glm::mat4 matrix = viewProjection * transform;
+		++statistics.occluderCount;
+
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			Triangle triangle;
+			bool clipped = false;
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				const glm::vec4 clip = matrix * glm::vec4(vertices[indices[i + corner]], 1.f);
+
+				// Dropping a triangle crossing near plane only makes occlusion weaker, so it isn't clipped
+				if (clip.w <= 0.f || clip.z < -clip.w)
+				{
+					clipped = true;
+					break;
+				}
+
+				const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+				triangle.vertices[corner] = glm::vec3((ndc.x * 0.5f + 0.5f) * (float)width, (ndc.y * 0.5f + 0.5f) * (float)height,
+					ndc.z * 0.5f + 0.5f);
+			}
+
+			if (clipped)
+				continue;
+
+			glm::vec3& v0 = triangle.vertices[0];
+			glm::vec3& v1 = triangle.vertices[1];
+			glm::vec3& v2 = triangle.vertices[2];
+			const float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+			if (glm::abs(area) < MIN_TRIANGLE_AREA)
+				continue;
+
+			// Closed occluders are rasterized from both sides, so winding is only made consistent
+			if (area < 0.f)
+				std::swap(v1, v2);
+
+			const glm::vec2 minCorner = glm::min(glm::vec2(v0), glm::min(glm::vec2(v1), glm::vec2(v2)));
+			const glm::vec2 maxCorner = glm::max(glm::vec2(v0), glm::max(glm::vec2(v1), glm::vec2(v2)));
+			if (maxCorner.x < 0.f || maxCorner.y < 0.f || minCorner.x > (float)width || minCorner.y > (float)height)
+				continue;
+
+			triangles.push_back(triangle);
+		}
+
+		statistics.triangleCount = (uint32_t)triangles.size();
+	}
+
+	void OcclusionCuller::pushOccluderBox(const glm::vec3& minBound, const glm::vec3& maxBound, const glm::mat4& transform)
+	{
+		// Corner i has maximum coordinate on axis k when bit k of i is set
+		std::vector<glm::vec3> corners(8);
+		for (uint32_t i = 0; i < 8; ++i)
+			corners[i] = glm::vec3((i & 1) ? maxBound.x : minBound.x, (i & 2) ? maxBound.y : minBound.y, (i & 4) ? maxBound.z : minBound.z);
+
+		static const std::vector<uint32_t> boxIndices = {
+			0, 2, 1, 1, 2, 3, // -z
+			4, 5, 6, 5, 7, 6, // +z
+			0, 1, 4, 1, 5, 4, // -y
+			2, 6, 3, 3, 6, 7, // +y
+			0, 4, 2, 2, 4, 6, // -x
+			1, 3, 5, 3, 7, 5  // +x
+		};
+
+		pushOccluderTriangles(corners, boxIndices, transform);
+	}
+
+	void OcclusionCuller::pushOccluderMesh(const Mesh& mesh, const glm::mat4& transform)
+	{
+		if (mesh.hasBoundingBox())
+			pushOccluderBox(mesh.getBoundingBoxMin(), mesh.getBoundingBoxMax(), transform);
+	}
+
+	void OcclusionCuller::rasterize()
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		const uint32_t bandCount = (height + BAND_ROW_COUNT - 1) / BAND_ROW_COUNT;
+		ThreadPool::getInstance().parallelFor(bandCount, 1, [this](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t band = begin; band < end; ++band)
+				rasterizeBand(band * BAND_ROW_COUNT, glm::min((band + 1) * BAND_ROW_COUNT, height));
+		});
+
+		buildHierarchy();
+		statistics.rasterizationTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	void OcclusionCuller::rasterizeBand(uint32_t firstRow, uint32_t endRow)
+	{
+		for (const Triangle& triangle : triangles)
+			rasterizeTriangle(triangle, firstRow, endRow);
+	}
+
+	void OcclusionCuller::rasterizeTriangle(const Triangle& triangle, uint32_t firstRow, uint32_t endRow)
+	{
+		const glm::vec3& v0 = triangle.vertices[0];
+		const glm::vec3& v1 = triangle.vertices[1];
+		const glm::vec3& v2 = triangle.vertices[2];
+
+		const float minY = glm::min(v0.y, glm::min(v1.y, v2.y));
+		const float maxY = glm::max(v0.y, glm::max(v1.y, v2.y));
+		const uint32_t beginY = (uint32_t)glm::clamp(glm::floor(minY), (float)firstRow, (float)endRow);
+		const uint32_t endY = (uint32_t)glm::clamp(glm::ceil(maxY), (float)firstRow, (float)endRow);
+		if (beginY >= endY)
+			return;
+
+		// Columns are processed in groups of 8 starting at a multiple of 8, width is padded to it
+		const float minX = glm::min(v0.x, glm::min(v1.x, v2.x));
+		const float maxX = glm::max(v0.x, glm::max(v1.x, v2.x));
+		const uint32_t beginX = (uint32_t)glm::clamp(glm::floor(minX), 0.f, (float)width) & ~7U;
+		const uint32_t endX = (uint32_t)glm::clamp(glm::ceil(maxX), 0.f, (float)width);
+
+		/**
+		 * Edge functions E(x, y) = A * x + B * y + C are positive inside, each one is the weight of the opposite vertex
+		 * Depth is affine in screen space, so it's interpolated the same way
+		*/
+		const glm::vec3 edgeA(v1.y - v2.y, v2.y - v0.y, v0.y - v1.y);
+		const glm::vec3 edgeB(v2.x - v1.x, v0.x - v2.x, v1.x - v0.x);
+		const glm::vec3 edgeC(-(edgeA.x * v1.x + edgeB.x * v1.y), -(edgeA.y * v2.x + edgeB.y * v2.y), -(edgeA.z * v0.x + edgeB.z * v0.y));
+		const glm::vec3 depths(v0.z, v1.z, v2.z);
+		const float inverseArea = 1.f / (edgeC.x + edgeC.y + edgeC.z);
+		const float depthA = glm::dot(edgeA, depths) * inverseArea;
+		const float depthB = glm::dot(edgeB, depths) * inverseArea;
+		const float depthC = glm::dot(edgeC, depths) * inverseArea;
+
+		std::vector<float>& depthBuffer = depthLevels[0];
+		for (uint32_t y = beginY; y < endY; ++y)
+		{
+			const float centerY = (float)y + 0.5f;
+			const glm::vec3 rowEdges = edgeB * centerY + edgeC;
+			const float rowDepth = depthB * centerY + depthC;
+			float* row = &depthBuffer[y * width];
+			uint32_t x = beginX;
+
+		#if defined (CALA_SIMD_AVX)
+			const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+			for (; x < endX; x += 8)
+			{
+				const __m256 centerX = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffsets);
+				const __m256 edge0 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(edgeA.x), centerX), _mm256_set1_ps(rowEdges.x));
+				const __m256 edge1 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(edgeA.y), centerX), _mm256_set1_ps(rowEdges.y));
+				const __m256 edge2 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(edgeA.z), centerX), _mm256_set1_ps(rowEdges.z));
+				const __m256 inside = _mm256_and_ps(_mm256_cmp_ps(edge0, _mm256_setzero_ps(), _CMP_GE_OQ),
+					_mm256_and_ps(_mm256_cmp_ps(edge1, _mm256_setzero_ps(), _CMP_GE_OQ), _mm256_cmp_ps(edge2, _mm256_setzero_ps(), _CMP_GE_OQ)));
+
+				const __m256 depth = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(depthA), centerX), _mm256_set1_ps(rowDepth));
+				const __m256 storedDepth = _mm256_loadu_ps(row + x);
+				_mm256_storeu_ps(row + x, _mm256_blendv_ps(storedDepth, _mm256_min_ps(storedDepth, depth), inside));
+			}
+		#elif defined (CALA_SIMD_SSE2)
+			const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+			for (; x < endX; x += 4)
+			{
+				const __m128 centerX = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+				const __m128 edge0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA.x), centerX), _mm_set1_ps(rowEdges.x));
+				const __m128 edge1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA.y), centerX), _mm_set1_ps(rowEdges.y));
+				const __m128 edge2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA.z), centerX), _mm_set1_ps(rowEdges.z));
+				const __m128 inside = _mm_and_ps(_mm_cmpge_ps(edge0, _mm_setzero_ps()),
+					_mm_and_ps(_mm_cmpge_ps(edge1, _mm_setzero_ps()), _mm_cmpge_ps(edge2, _mm_setzero_ps())));
+
+				const __m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depthA), centerX), _mm_set1_ps(rowDepth));
+				const __m128 storedDepth = _mm_loadu_ps(row + x);
+				const __m128 nearerDepth = _mm_min_ps(storedDepth, depth);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearerDepth), _mm_andnot_ps(inside, storedDepth)));
+			}
+		#endif
+
+			for (; x < endX; ++x)
+			{
+				const float centerX = (float)x + 0.5f;
+				const glm::vec3 edges = edgeA * centerX + rowEdges;
+				if (edges.x >= 0.f && edges.y >= 0.f && edges.z >= 0.f)
+					row[x] = glm::min(row[x], depthA * centerX + rowDepth);
+			}
+		}
+	}
+
+	void OcclusionCuller::buildHierarchy()
+	{
+		for (size_t level = 1; level < depthLevels.size(); ++level)
+		{
+			const std::vector<float>& source = depthLevels[level - 1];
+			const glm::uvec2 sourceSize = levelSizes[level - 1];
+			const glm::uvec2 size = levelSizes[level];
+			std::vector<float>& destination = depthLevels[level];
+
+			// Odd last row or column is covered by the texel before it
+			for (uint32_t y = 0; y < size.y; ++y)
+			{
+				const uint32_t y0 = y * 2;
+				const uint32_t y1 = glm::min(y0 + 1, sourceSize.y - 1);
+				for (uint32_t x = 0; x < size.x; ++x)
+				{
+					const uint32_t x0 = x * 2;
+					const uint32_t x1 = glm::min(x0 + 1, sourceSize.x - 1);
+					destination[y * size.x + x] = glm::max(glm::max(source[y0 * sourceSize.x + x0], source[y0 * sourceSize.x + x1]),
+						glm::max(source[y1 * sourceSize.x + x0], source[y1 * sourceSize.x + x1]));
+				}
+			}
+		}
+	}
+
+	bool OcclusionCuller::testBoundingBox(const glm::vec3& minBound, const glm::vec3& maxBound, const glm::mat4& transform)
+	{
+		++statistics.testedCount;
+		const glm::mat4 matrix = viewProjection * transform;
+
+		// Nearest point of a box is one of its corners, and depth after projection keeps order of distances
+		glm::vec2 minCorner(std::numeric_limits<float>::max());
+		glm::vec2 maxCorner(-std::numeric_limits<float>::max());
+		float minDepth = std::numeric_limits<float>::max();
+		for (uint32_t i = 0; i < 8; ++i)
+		{
+			const glm::vec3 corner((i & 1) ? maxBound.x : minBound.x, (i & 2) ? maxBound.y : minBound.y, (i & 4) ? maxBound.z : minBound.z);
+			const glm::vec4 clip = matrix * glm::vec4(corner, 1.f);
+			if (clip.w <= 0.f || clip.z < -clip.w)
+				return true;
+
+			const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+			const glm::vec2 screen = (glm::vec2(ndc) * 0.5f + 0.5f) * glm::vec2((float)width, (float)height);
+			minCorner = glm::min(minCorner, screen);
+			maxCorner = glm::max(maxCorner, screen);
+			minDepth = glm::min(minDepth, ndc.z * 0.5f + 0.5f);
+		}
+
+		// Objects outside of the screen are left to frustum culling
+		if (maxCorner.x < 0.f || maxCorner.y < 0.f || minCorner.x > (float)width || minCorner.y > (float)height)
+			return true;
+
+		// Coarsest level where bounds cover at most 2x2 texels is tested, unless the hierarchy ends earlier
+		glm::uvec2 begin = glm::uvec2(glm::clamp(minCorner, glm::vec2(0.f), glm::vec2((float)width - 1.f, (float)height - 1.f)));
+		glm::uvec2 end = glm::uvec2(glm::clamp(maxCorner, glm::vec2(0.f), glm::vec2((float)width - 1.f, (float)height - 1.f)));
+		size_t level = 0;
+		while (level + 1 < depthLevels.size() && (end.x - begin.x > 1 || end.y - begin.y > 1))
+		{
+			begin /= 2U;
+			end /= 2U;
+			++level;
+		}
+
+		float maxDepth = 0.f;
+		const std::vector<float>& depths = depthLevels[level];
+		const uint32_t levelWidth = levelSizes[level].x;
+		for (uint32_t y = begin.y; y <= end.y; ++y)
+		{
+			for (uint32_t x = begin.x; x <= end.x; ++x)
+				maxDepth = glm::max(maxDepth, depths[y * levelWidth + x]);
+		}
+
+		if (minDepth > maxDepth)
+		{
+			++statistics.occludedCount;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool OcclusionCuller::testMesh(const Mesh& mesh, const glm::mat4& transform)
+	{
+		if (!mesh.hasBoundingBox())
+		{
+			++statistics.testedCount;
+			return true;
+		}
+
+		return testBoundingBox(mesh.getBoundingBoxMin(), mesh.getBoundingBoxMax(), transform);
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Cala {
+	class Mesh;
+
+	/**
+	 * Software occlusion culling against a low resolution depth buffer rasterized on the CPU
+	 * Occluders are rasterized as triangles, by default as their bounding boxes, so they should fill those boxes
+	 * Rows of the buffer are split into bands rasterized in parallel, each pixel keeps the nearest depth
+	 * regardless of order, so results don't depend on scheduling
+	 * Objects are tested by their screen space bounds against a hierarchy of farthest depths
+	*/
+	class OcclusionCuller {
+	public:
+		struct Statistics {
+			uint32_t occluderCount = 0;
+			uint32_t triangleCount = 0; // Occluder triangles in front of near plane
+			uint32_t testedCount = 0;
+			uint32_t occludedCount = 0;
+			float rasterizationTime = 0.f; // In milliseconds
+		};
+
+		// Width is rounded up to a multiple of 8 pixels
+		OcclusionCuller(uint32_t width = 256U, uint32_t height = 128U);
+		~OcclusionCuller() = default;
+
+		// Clears depth buffer and occluders of the previous frame
+		void begin(const glm::mat4& viewProjection);
+
+		void pushOccluderTriangles(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, const glm::mat4& transform);
+		void pushOccluderBox(const glm::vec3& minBound, const glm::vec3& maxBound, const glm::mat4& transform);
+		// Meshes without bounding box don't occlude
+		void pushOccluderMesh(const Mesh& mesh, const glm::mat4& transform);
+
+		// Rasterizes pushed occluders and builds depth hierarchy, has to be called before tests
+		void rasterize();
+
+		// Objects crossing near plane or without bounds are always visible
+		bool testBoundingBox(const glm::vec3& minBound, const glm::vec3& maxBound, const glm::mat4& transform);
+		bool testMesh(const Mesh& mesh, const glm::mat4& transform);
+
+		// Depth in [0, 1] per pixel, rows from bottom of the screen, cleared to 1
+		const std::vector<float>& getDepthBuffer() const { return depthLevels[0]; }
+		// Level 0 is the depth buffer, each next one keeps farthest depth of 2x2 texels of the previous one, down to 1x1
+		const std::vector<float>& getDepthLevel(uint32_t level) const { return depthLevels[level]; }
+		glm::uvec2 getLevelSize(uint32_t level) const { return levelSizes[level]; }
+		uint32_t getLevelCount() const { return (uint32_t)depthLevels.size(); }
+		glm::uvec2 getResolution() const { return glm::uvec2(width, height); }
+		const Statistics& getStatistics() const { return statistics; }
+
+	private:
+		// Screen space vertices with depth, wound counter clockwise
+		struct Triangle {
+			glm::vec3 vertices[3];
+		};
+
+		void rasterizeBand(uint32_t firstRow, uint32_t endRow);
+		void rasterizeTriangle(const Triangle& triangle, uint32_t firstRow, uint32_t endRow);
+		void buildHierarchy();
+
+		uint32_t width;
+		uint32_t height;
+		glm::mat4 viewProjection{ 1.f };
+		std::vector<Triangle> triangles;
+		// Level 0 is the depth buffer, each next level keeps farthest depth of 2x2 texels
+		std::vector<std::vector<float>> depthLevels;
+		std::vector<glm::uvec2> levelSizes;
+		Statistics statistics;
+	};
+}
@@ -0,0 +1,380 @@
+#include "RenderGraph.h"
+#include <algorithm>
+#include "Cala/Utility/Logger.h"
+
+// Frames a texture may stay unused before it's freed, covers brief changes of size
+#define MAX_UNUSED_FRAMES 3U
+
+namespace Cala {
+	bool RenderGraph::TextureDescription::operator==(const TextureDescription& other) const
+	{
+		return size == other.size && format == other.format;
+	}
+
+	RenderGraph::ResourceHandle RenderGraph::PassBuilder::createTexture(const std::string& name, const TextureDescription& description)
+	{
+		Resource resource;
+		resource.name = name;
+		resource.description = description;
+		graph.resources.push_back(resource);
+		return (ResourceHandle)graph.resources.size() - 1;
+	}
+
+	void RenderGraph::PassBuilder::read(ResourceHandle resource)
+	{
+		graph.passes[passIndex].accesses.push_back({ resource, AccessType::Read, false });
+	}
+
+	void RenderGraph::PassBuilder::writeColor(ResourceHandle resource, bool clear)
+	{
+		graph.passes[passIndex].accesses.push_back({ resource, AccessType::WriteColor, clear });
+	}
+
+	void RenderGraph::PassBuilder::writeDepth(ResourceHandle resource, bool clear)
+	{
+		graph.passes[passIndex].accesses.push_back({ resource, AccessType::WriteDepth, clear });
+	}
+
+	void RenderGraph::PassBuilder::modify(ResourceHandle resource)
+	{
+		graph.passes[passIndex].accesses.push_back({ resource, AccessType::Modify, false });
+	}
+
+	void RenderGraph::PassBuilder::setSideEffects()
+	{
+		graph.passes[passIndex].sideEffects = true;
+	}
+
+	const ITexture& RenderGraph::PassResources::getTexture(ResourceHandle resource) const
+	{
+		const Resource& data = graph.resources[resource];
+		if (data.importedTexture != nullptr)
+			return *data.importedTexture;
+
+		return *data.texture;
+	}
+
+	const Framebuffer* RenderGraph::PassResources::getFramebuffer(ResourceHandle resource) const
+	{
+		return graph.resources[resource].framebuffer;
+	}
+
+	RenderGraph::ResourceHandle RenderGraph::importFramebuffer(const std::string& name, const Framebuffer* framebuffer, const glm::ivec4& viewport)
+	{
+		Resource resource;
+		resource.name = name;
+		resource.importedFramebuffer = true;
+		resource.framebuffer = framebuffer;
+		resource.viewport = viewport;
+		resource.description.size = glm::uvec2(viewport.z, viewport.w);
+		resources.push_back(resource);
+		return (ResourceHandle)resources.size() - 1;
+	}
+
+	RenderGraph::ResourceHandle RenderGraph::importTexture(const std::string& name, const ITexture& texture)
+	{
+		Resource resource;
+		resource.name = name;
+		resource.importedTexture = &texture;
+		resource.description.size = glm::uvec2(texture.getDimensions());
+		resource.description.format = texture.getFormat();
+		resources.push_back(resource);
+		return (ResourceHandle)resources.size() - 1;
+	}
+
+	glm::uvec2 RenderGraph::getSize(ResourceHandle resource) const
+	{
+		return resources[resource].description.size;
+	}
+
+	RenderGraph::PassBuilder RenderGraph::beginPass(const std::string& name, ExecuteFunction execute)
+	{
+		Pass pass;
+		pass.name = name;
+		pass.execute = std::move(execute);
+		passes.push_back(std::move(pass));
+		return PassBuilder(*this, (uint32_t)passes.size() - 1);
+	}
+
+	bool RenderGraph::isTransient(ResourceHandle resource) const
+	{
+		return !resources[resource].importedFramebuffer && resources[resource].importedTexture == nullptr;
+	}
+
+	void RenderGraph::execute(GraphicsAPI* api)
+	{
+		statistics = Statistics();
+		cullPasses();
+		assignTextures();
+
+		// Bindings are tracked across passes, passes with attachments have to leave them as they found them
+		PassResources passResources(*this);
+		const Framebuffer* boundFramebuffer = nullptr;
+		bool framebufferBound = false;
+		glm::ivec4 boundViewport{ -1 };
+		for (Pass& pass : passes)
+		{
+			if (!pass.live)
+				continue;
+
+			std::vector<Texture*> colorTargets;
+			Texture* depthTarget = nullptr;
+			const Resource* importedTarget = nullptr;
+			bool clearColor = false;
+			bool clearDepth = false;
+			bool clearStencil = false;
+			for (const Access& access : pass.accesses)
+			{
+				if (access.type != AccessType::WriteColor && access.type != AccessType::WriteDepth)
+					continue;
+
+				const Resource& resource = resources[access.resource];
+				if (resource.importedTexture != nullptr)
+				{
+					Logger::getInstance().logErrorToConsole("Imported texture " + resource.name + " can't be an attachment of pass " + pass.name + "!");
+					continue;
+				}
+
+				if (resource.importedFramebuffer)
+					importedTarget = &resource;
+				else if (access.type == AccessType::WriteColor)
+					colorTargets.push_back(resource.texture);
+				else
+					depthTarget = resource.texture;
+
+				if (access.type == AccessType::WriteColor)
+					clearColor |= access.clear;
+				else
+				{
+					clearDepth |= access.clear;
+					clearStencil |= access.clear && resource.description.format == ITexture::Format::DEPTH24_STENCIL8;
+				}
+			}
+
+			if (importedTarget != nullptr && (!colorTargets.empty() || depthTarget != nullptr))
+				Logger::getInstance().logErrorToConsole("Pass " + pass.name + " mixes imported and transient attachments!");
+
+			passResources.framebuffer = nullptr;
+			passResources.viewport = glm::ivec4(0);
+			if (importedTarget != nullptr || !colorTargets.empty() || depthTarget != nullptr)
+			{
+				if (importedTarget != nullptr)
+				{
+					passResources.framebuffer = importedTarget->framebuffer;
+					passResources.viewport = importedTarget->viewport;
+				}
+				else
+				{
+					const ITexture& firstTarget = colorTargets.empty() ? *depthTarget : *colorTargets[0];
+					const glm::ivec2 targetSize = firstTarget.getDimensions();
+					passResources.framebuffer = getFramebuffer(colorTargets, depthTarget);
+					passResources.viewport = glm::ivec4(0, 0, targetSize.x, targetSize.y);
+				}
+
+				if (!framebufferBound || passResources.framebuffer != boundFramebuffer)
+				{
+					api->activateFramebuffer(passResources.framebuffer);
+					boundFramebuffer = passResources.framebuffer;
+					framebufferBound = true;
+					++statistics.framebufferBindCount;
+				}
+
+				if (passResources.viewport != boundViewport)
+				{
+					api->setViewport(passResources.viewport);
+					boundViewport = passResources.viewport;
+				}
+
+				if (clearColor || clearDepth)
+				{
+					api->clearFramebuffer(clearColor, clearDepth, clearStencil);
+					++statistics.clearCount;
+				}
+			}
+
+			pass.execute(api, passResources);
+			++statistics.passCount;
+
+			// Passes without attachments may bind their own framebuffers, like shadow rendering does
+			if (importedTarget == nullptr && colorTargets.empty() && depthTarget == nullptr)
+			{
+				framebufferBound = false;
+				boundViewport = glm::ivec4(-1);
+			}
+		}
+
+		releaseUnusedTextures();
+		passes.clear();
+		resources.clear();
+	}
+
+	void RenderGraph::cullPasses()
+	{
+		// Walking backwards, a pass is live if it writes an imported resource or a texture needed by a later live pass
+		std::vector<bool> needed(resources.size(), false);
+		for (uint32_t i = (uint32_t)passes.size(); i-- > 0;)
+		{
+			Pass& pass = passes[i];
+			pass.live = pass.sideEffects;
+			for (const Access& access : pass.accesses)
+			{
+				if (access.type != AccessType::Read && (!isTransient(access.resource) || needed[access.resource]))
+					pass.live = true;
+			}
+
+			if (!pass.live)
+			{
+				++statistics.culledPassCount;
+				continue;
+			}
+
+			// Cleared textures don't depend on earlier writes, kept ones do
+			for (const Access& access : pass.accesses)
+			{
+				if (access.clear)
+					needed[access.resource] = false;
+			}
+
+			for (const Access& access : pass.accesses)
+			{
+				if (!access.clear)
+					needed[access.resource] = true;
+			}
+		}
+	}
+
+	void RenderGraph::assignTextures()
+	{
+		for (uint32_t i = 0; i < (uint32_t)passes.size(); ++i)
+		{
+			if (!passes[i].live)
+				continue;
+
+			for (const Access& access : passes[i].accesses)
+			{
+				Resource& resource = resources[access.resource];
+				if (!isTransient(access.resource))
+					continue;
+
+				if (!resource.used)
+				{
+					if (access.type == AccessType::Read)
+						Logger::getInstance().logErrorToConsole("Pass " + passes[i].name + " reads " + resource.name + " before it's written!");
+
+					resource.firstPass = i;
+					resource.used = true;
+					++statistics.transientTextureCount;
+					statistics.transientMemory += calculateTextureMemory(resource.description);
+				}
+
+				resource.lastPass = i;
+			}
+		}
+
+		// Textures are taken in order of first use, a texture is free once the last pass of its previous resource ran
+		for (PhysicalTexture& physicalTexture : physicalTextures)
+			physicalTexture.busyUntilPass = -1;
+
+		for (uint32_t i = 0; i < (uint32_t)passes.size(); ++i)
+		{
+			for (const Access& access : passes[i].accesses)
+			{
+				Resource& resource = resources[access.resource];
+				if (!resource.used || resource.firstPass != i || resource.texture != nullptr)
+					continue;
+
+				PhysicalTexture* assigned = nullptr;
+				for (PhysicalTexture& physicalTexture : physicalTextures)
+				{
+					if (physicalTexture.description == resource.description && physicalTexture.busyUntilPass < (int)i)
+					{
+						assigned = &physicalTexture;
+						break;
+					}
+				}
+
+				if (assigned == nullptr)
+				{
+					const TextureDescription& description = resource.description;
+					Texture::Specification specification(description.size.x, description.size.y, description.format, Texture::Dimensionality::TwoDimensional);
+					specification.renderingStyle.sDimensionWrap = Texture::WrappingMethod::ClampToEdge;
+					specification.renderingStyle.tDimensionWrap = Texture::WrappingMethod::ClampToEdge;
+					specification.depthComparison = false;
+
+					PhysicalTexture physicalTexture;
+					physicalTexture.description = description;
+					physicalTexture.texture = std::make_unique<Texture>();
+					physicalTexture.texture->load(specification, nullptr);
+					physicalTextures.push_back(std::move(physicalTexture));
+					assigned = &physicalTextures.back();
+				}
+
+				assigned->busyUntilPass = (int)resource.lastPass;
+				assigned->unusedFrames = 0;
+				resource.texture = assigned->texture.get();
+			}
+		}
+	}
+
+	const Framebuffer* RenderGraph::getFramebuffer(const std::vector<Texture*>& colorTargets, Texture* depthTarget)
+	{
+		std::vector<const ITexture*> key(colorTargets.begin(), colorTargets.end());
+		key.push_back(depthTarget);
+
+		auto it = framebuffers.find(key);
+		if (it != framebuffers.end())
+			return it->second.get();
+
+		auto framebuffer = std::make_unique<Framebuffer>();
+		for (Texture* colorTarget : colorTargets)
+			framebuffer->addColorTarget(colorTarget, false);
+
+		if (depthTarget != nullptr)
+			framebuffer->addDepthTarget(depthTarget, false);
+
+		framebuffer->load();
+		return framebuffers.emplace(std::move(key), std::move(framebuffer)).first->second.get();
+	}
+
+	void RenderGraph::releaseUnusedTextures()
+	{
+		for (auto it = physicalTextures.begin(); it != physicalTextures.end();)
+		{
+			if (it->busyUntilPass < 0 && ++it->unusedFrames > MAX_UNUSED_FRAMES)
+			{
+				// Framebuffers don't own graph textures, so those referencing the texture go first
+				const ITexture* texture = it->texture.get();
+				for (auto framebuffer = framebuffers.begin(); framebuffer != framebuffers.end();)
+				{
+					const std::vector<const ITexture*>& targets = framebuffer->first;
+					if (std::find(targets.begin(), targets.end(), texture) != targets.end())
+						framebuffer = framebuffers.erase(framebuffer);
+					else
+						++framebuffer;
+				}
+
+				it = physicalTextures.erase(it);
+				continue;
+			}
+
+			statistics.physicalMemory += calculateTextureMemory(it->description);
+			++it;
+		}
+
+		statistics.physicalTextureCount = (uint32_t)physicalTextures.size();
+	}
+
+	uint64_t RenderGraph::calculateTextureMemory(const TextureDescription& description)
+	{
+		uint64_t texelSize = 4;
+		switch (description.format)
+		{
+			case ITexture::Format::FLOAT_RGBA:	texelSize = 16; break;
+			case ITexture::Format::HALF_RGBA:	texelSize = 8; break;
+			case ITexture::Format::DEPTH16:		texelSize = 2; break;
+			default: break;
+		}
+
+		return texelSize * description.size.x * description.size.y;
+	}
+}
@@ -0,0 +1,172 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include <glm/glm.hpp>
+#include "Framebuffer.h"
+#include "GraphicsAPI.h"
+
+namespace Cala {
+	/**
+	 * Rendering passes of a frame, declaring textures they read and write
+	 * Passes run in the order they were added, those whose outputs aren't used by later passes or imported resources are culled
+	 * Transient textures exist from their first to last use, ones of equal description whose lifetimes don't overlap
+	 * share the same texture. Framebuffers are bound only when they change and cleared only when a pass asks for it
+	 * Passes without attachments are free to bind other framebuffers, the next pass with attachments binds its own again
+	*/
+	class RenderGraph {
+	public:
+		using ResourceHandle = uint32_t;
+
+		struct TextureDescription {
+			glm::uvec2 size{ 1U };
+			ITexture::Format format = ITexture::Format::RGBA;
+
+			bool operator==(const TextureDescription& other) const;
+		};
+
+		struct Statistics {
+			uint32_t passCount = 0;
+			uint32_t culledPassCount = 0;
+			uint32_t transientTextureCount = 0;
+			uint32_t physicalTextureCount = 0; // Textures backing transient ones, including those kept from previous frames
+			uint64_t transientMemory = 0; // In bytes, what transient textures would take without aliasing
+			uint64_t physicalMemory = 0; // In bytes
+			uint32_t framebufferBindCount = 0;
+			uint32_t clearCount = 0;
+		};
+
+		class PassBuilder {
+		public:
+			ResourceHandle createTexture(const std::string& name, const TextureDescription& description);
+			// Sampled by the pass
+			void read(ResourceHandle resource);
+			// Framebuffer attachments of the pass, previous contents are kept unless cleared
+			void writeColor(ResourceHandle resource, bool clear = false);
+			void writeDepth(ResourceHandle resource, bool clear = false);
+			// Written outside of attachments, by image stores or copies, previous contents are kept
+			void modify(ResourceHandle resource);
+			// Pass is executed even if nothing uses its outputs
+			void setSideEffects();
+
+		private:
+			friend class RenderGraph;
+			PassBuilder(RenderGraph& _graph, uint32_t _passIndex) : graph(_graph), passIndex(_passIndex) {}
+
+			RenderGraph& graph;
+			uint32_t passIndex;
+		};
+
+		class PassResources {
+		public:
+			const ITexture& getTexture(ResourceHandle resource) const;
+			// Imported framebuffer, nullptr for the default one
+			const Framebuffer* getFramebuffer(ResourceHandle resource) const;
+			// Framebuffer of pass attachments, nullptr if the pass has none or renders to the default framebuffer
+			const Framebuffer* getPassFramebuffer() const { return framebuffer; }
+			const glm::ivec4& getViewport() const { return viewport; }
+
+		private:
+			friend class RenderGraph;
+			PassResources(const RenderGraph& _graph) : graph(_graph) {}
+
+			const RenderGraph& graph;
+			const Framebuffer* framebuffer = nullptr;
+			glm::ivec4 viewport{ 0 };
+		};
+
+		using ExecuteFunction = std::function<void(GraphicsAPI* api, const PassResources& resources)>;
+
+		RenderGraph() = default;
+		~RenderGraph() = default;
+		RenderGraph(const RenderGraph& other) = delete;
+		RenderGraph& operator=(const RenderGraph& other) = delete;
+
+		// Passes writing imported framebuffer render to the viewport, nullptr is the default framebuffer
+		ResourceHandle importFramebuffer(const std::string& name, const Framebuffer* framebuffer, const glm::ivec4& viewport);
+		ResourceHandle importTexture(const std::string& name, const ITexture& texture);
+
+		/**
+		 * Setup is called right away with a builder and pass data, execute is called with the same data when the graph executes
+		 * Pass data keeps handles created during setup for the execution
+		*/
+		template<typename PassData, typename Setup, typename Execute>
+		const PassData& addPass(const std::string& name, Setup&& setup, Execute&& execute)
+		{
+			auto data = std::make_shared<PassData>();
+			PassBuilder builder = beginPass(name, [data, execute](GraphicsAPI* api, const PassResources& resources) {
+				execute(*data, api, resources);
+			});
+
+			setup(builder, *data);
+			return *data;
+		}
+
+		// Size of created texture or imported texture, or size of imported framebuffer viewport
+		glm::uvec2 getSize(ResourceHandle resource) const;
+		const std::string& getName(ResourceHandle resource) const { return resources[resource].name; }
+
+		// Culls passes, assigns textures and executes remaining passes, afterwards the graph is empty for the next frame
+		void execute(GraphicsAPI* api);
+		const Statistics& getStatistics() const { return statistics; }
+
+	private:
+		enum class AccessType {
+			Read,
+			WriteColor,
+			WriteDepth,
+			Modify
+		};
+
+		struct Access {
+			ResourceHandle resource;
+			AccessType type;
+			bool clear;
+		};
+
+		struct Pass {
+			std::string name;
+			ExecuteFunction execute;
+			std::vector<Access> accesses;
+			bool sideEffects = false;
+			bool live = false;
+		};
+
+		struct Resource {
+			std::string name;
+			TextureDescription description;
+			bool importedFramebuffer = false;
+			const Framebuffer* framebuffer = nullptr;
+			glm::ivec4 viewport{ 0 };
+			const ITexture* importedTexture = nullptr;
+			uint32_t firstPass = 0;
+			uint32_t lastPass = 0;
+			bool used = false;
+			Texture* texture = nullptr; // Physical texture of transient resource
+		};
+
+		struct PhysicalTexture {
+			TextureDescription description;
+			std::unique_ptr<Texture> texture;
+			int busyUntilPass = -1;
+			uint32_t unusedFrames = 0;
+		};
+
+		PassBuilder beginPass(const std::string& name, ExecuteFunction execute);
+		bool isTransient(ResourceHandle resource) const;
+		void cullPasses();
+		void assignTextures();
+		const Framebuffer* getFramebuffer(const std::vector<Texture*>& colorTargets, Texture* depthTarget);
+		void releaseUnusedTextures();
+		static uint64_t calculateTextureMemory(const TextureDescription& description);
+
+		std::vector<Pass> passes;
+		std::vector<Resource> resources;
+		std::vector<PhysicalTexture> physicalTextures;
+		// Keyed by color targets followed by depth target
+		std::map<std::vector<const ITexture*>, std::unique_ptr<Framebuffer>> framebuffers;
+		Statistics statistics;
+	};
+}
@@ -0,0 +1,156 @@
+#include "RenderQueue.h"
+#include <chrono>
+#include <cstring>
+#include "Mesh.h"
+
+#define PASS_BITS 4
+#define PROGRAM_BITS 8
+#define TEXTURE_SET_BITS 16
+#define MESH_BITS 16
+#define DEPTH_BITS 20
+
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+
+namespace Cala {
+	void RenderQueue::clear()
+	{
+		items.clear();
+		meshIds.clear();
+		textureSetIds.clear();
+	}
+
+	void RenderQueue::push(uint64_t key, uint32_t index)
+	{
+		items.push_back({ key, index });
+	}
+
+	void RenderQueue::sort()
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		/**
+		 * Least significant digit radix sort, stable so that equal keys keep push order
+		 * Digits equal across all keys are skipped, which are most of them in small scenes
+		*/
+		const uint32_t itemCount = (uint32_t)items.size();
+		sortBuffer.resize(itemCount);
+		for (uint32_t shift = 0; shift < 64; shift += RADIX_BITS)
+		{
+			uint32_t counts[RADIX_SIZE] = {};
+			for (const Item& item : items)
+				++counts[(item.key >> shift) & (RADIX_SIZE - 1)];
+
+			if (itemCount == 0 || counts[(items[0].key >> shift) & (RADIX_SIZE - 1)] == itemCount)
+				continue;
+
+			uint32_t offset = 0;
+			for (uint32_t& count : counts)
+			{
+				uint32_t digitCount = count;
+				count = offset;
+				offset += digitCount;
+			}
+
+			for (const Item& item : items)
+				sortBuffer[counts[(item.key >> shift) & (RADIX_SIZE - 1)]++] = item;
+
+			items.swap(sortBuffer);
+		}
+
+		batches.clear();
+		for (uint32_t i = 0; i < itemCount; ++i)
+		{
+			if (i != 0 && (items[i].key >> DEPTH_BITS) == (items[i - 1].key >> DEPTH_BITS))
+				++batches.back().itemCount;
+			else
+				batches.push_back({ i, 1 });
+		}
+
+		programBound = false;
+		boundTextures.fill(nullptr);
+		boundMesh = nullptr;
+
+		statistics = Statistics();
+		statistics.drawCount = itemCount;
+		statistics.batchCount = (uint32_t)batches.size();
+		statistics.sortTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	uint32_t RenderQueue::getMeshId(const Mesh& mesh)
+	{
+		return meshIds.emplace(&mesh, (uint32_t)meshIds.size()).first->second;
+	}
+
+	uint32_t RenderQueue::getTextureSetId(const TextureSet& textureSet)
+	{
+		return textureSetIds.emplace(textureSet, (uint32_t)textureSetIds.size()).first->second;
+	}
+
+	bool RenderQueue::changeProgram(uint32_t program)
+	{
+		if (programBound && boundProgram == program)
+		{
+			++statistics.avoidedStateChanges;
+			return false;
+		}
+
+		boundProgram = program;
+		programBound = true;
+		++statistics.programChanges;
+		return true;
+	}
+
+	bool RenderQueue::changeTexture(uint32_t bindingIndex, const ITexture* texture)
+	{
+		if (bindingIndex < boundTextures.size() && boundTextures[bindingIndex] == texture)
+		{
+			++statistics.avoidedStateChanges;
+			return false;
+		}
+
+		if (bindingIndex < boundTextures.size())
+			boundTextures[bindingIndex] = texture;
+		
+		++statistics.textureChanges;
+		return true;
+	}
+
+	bool RenderQueue::changeMesh(const Mesh& mesh)
+	{
+		if (boundMesh == &mesh)
+		{
+			++statistics.avoidedStateChanges;
+			return false;
+		}
+
+		boundMesh = &mesh;
+		++statistics.meshChanges;
+		return true;
+	}
+
+	uint64_t RenderQueue::createKey(uint32_t pass, uint32_t program, uint32_t textureSet, uint32_t mesh, float viewDepth)
+	{
+		// Bits of a non-negative float grow with its value, so their top part is a logarithmic depth quantization
+		uint32_t depthBits;
+		viewDepth = glm::max(viewDepth, 0.f);
+		std::memcpy(&depthBits, &viewDepth, sizeof(float));
+		depthBits >>= 31 - DEPTH_BITS;
+
+		uint64_t key = (uint64_t)(pass & ((1U << PASS_BITS) - 1));
+		key = (key << PROGRAM_BITS) | (program & ((1U << PROGRAM_BITS) - 1));
+		key = (key << TEXTURE_SET_BITS) | (textureSet & ((1U << TEXTURE_SET_BITS) - 1));
+		key = (key << MESH_BITS) | (mesh & ((1U << MESH_BITS) - 1));
+		key = (key << DEPTH_BITS) | (depthBits & ((1U << DEPTH_BITS) - 1));
+		return key;
+	}
+
+	float RenderQueue::calculateViewDepth(const glm::mat4& view, const Mesh& mesh, const glm::mat4& transform)
+	{
+		glm::vec3 center(0.f);
+		if (mesh.hasBoundingBox())
+			center = (mesh.getBoundingBoxMin() + mesh.getBoundingBoxMax()) * 0.5f;
+
+		return -(view * transform * glm::vec4(center, 1.f)).z;
+	}
+}
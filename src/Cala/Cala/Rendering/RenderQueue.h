@@ -0,0 +1,85 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <map>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+namespace Cala {
+	class Mesh;
+	class ITexture;
+
+	/**
+	 * Orders draws of a frame by 64-bit sort keys and tracks bound state while they are issued
+	 * Key layout from the most significant bits: pass (4) | program (8) | texture set (16) | mesh (16) | view depth (20)
+	 * Draws sharing state end up next to each other, with the nearest ones first
+	 * Consecutive draws differing only in depth form batches, which can be issued as a single instanced draw
+	*/
+	class RenderQueue {
+	public:
+		struct Item {
+			uint64_t key;
+			uint32_t index;
+		};
+
+		// Range of sorted items
+		struct Batch {
+			uint32_t firstItem;
+			uint32_t itemCount;
+		};
+
+		struct Statistics {
+			uint32_t drawCount = 0;
+			uint32_t batchCount = 0;
+			uint32_t programChanges = 0;
+			uint32_t textureChanges = 0;
+			uint32_t meshChanges = 0;
+			uint32_t avoidedStateChanges = 0;
+			float sortTime = 0.f; // In milliseconds
+		};
+
+		using TextureSet = std::array<const ITexture*, 4>;
+
+		RenderQueue() = default;
+		~RenderQueue() = default;
+		void clear();
+
+		// Index refers to caller's own list of draws
+		void push(uint64_t key, uint32_t index);
+		void sort();
+		const std::vector<Item>& getItems() const { return items; }
+		const std::vector<Batch>& getBatches() const { return batches; }
+
+		// Dense identifiers of resources seen since last clear, used as key fields
+		uint32_t getMeshId(const Mesh& mesh);
+		uint32_t getTextureSetId(const TextureSet& textureSet);
+
+		/**
+		 * State tracking of sorted draws, each returns true if the state has to be bound
+		*/
+		bool changeProgram(uint32_t program);
+		bool changeTexture(uint32_t bindingIndex, const ITexture* texture);
+		bool changeMesh(const Mesh& mesh);
+
+		const Statistics& getStatistics() const { return statistics; }
+
+		static uint64_t createKey(uint32_t pass, uint32_t program, uint32_t textureSet, uint32_t mesh, float viewDepth);
+
+		// Distance of mesh bounding box center in front of the camera
+		static float calculateViewDepth(const glm::mat4& view, const Mesh& mesh, const glm::mat4& transform);
+
+	private:
+		std::vector<Item> items;
+		std::vector<Item> sortBuffer;
+		std::vector<Batch> batches;
+		std::unordered_map<const Mesh*, uint32_t> meshIds;
+		std::map<TextureSet, uint32_t> textureSetIds;
+
+		// Currently bound state, reset after each sort
+		uint32_t boundProgram = 0;
+		bool programBound = false;
+		std::array<const ITexture*, 8> boundTextures{};
+		const Mesh* boundMesh = nullptr;
+		Statistics statistics;
+	};
+}
@@ -0,0 +1,103 @@
+#include "RenderTargetPool.h"
+#include <algorithm>
+#include "Cala/Utility/Logger.h"
+
+// Frames a target may stay unused before it's freed, covers brief changes of size
+#define MAX_UNUSED_FRAMES 3U
+
+namespace Cala {
+	bool RenderTargetPool::Description::operator==(const Description& other) const
+	{
+		return size == other.size && colorFormat == other.colorFormat && depthStencil == other.depthStencil;
+	}
+
+	const Framebuffer* RenderTargetPool::acquire(const Description& description)
+	{
+		for (Target& target : targets)
+		{
+			if (!target.acquired && target.description == description)
+			{
+				target.acquired = true;
+				target.unusedFrames = 0;
+				return target.framebuffer.get();
+			}
+		}
+
+		Target target;
+		target.description = description;
+		target.framebuffer = createFramebuffer(description);
+		target.acquired = true;
+		targets.push_back(std::move(target));
+
+		statistics.targetCount = (uint32_t)targets.size();
+		++statistics.createdCount;
+		return targets.back().framebuffer.get();
+	}
+
+	void RenderTargetPool::release(const Framebuffer* framebuffer)
+	{
+		for (Target& target : targets)
+		{
+			if (target.framebuffer.get() == framebuffer)
+			{
+				target.acquired = false;
+				return;
+			}
+		}
+
+		Logger::getInstance().logErrorToConsole("Released render target doesn't belong to the pool!");
+	}
+
+	void RenderTargetPool::endFrame()
+	{
+		statistics.createdCount = 0;
+		statistics.freedCount = 0;
+		for (Target& target : targets)
+		{
+			if (target.acquired)
+				target.unusedFrames = 0;
+			else
+				++target.unusedFrames;
+
+			target.acquired = false;
+		}
+
+		auto unused = [](const Target& target) { return target.unusedFrames > MAX_UNUSED_FRAMES; };
+		auto removed = std::remove_if(targets.begin(), targets.end(), unused);
+		statistics.freedCount = (uint32_t)std::distance(removed, targets.end());
+		targets.erase(removed, targets.end());
+		statistics.targetCount = (uint32_t)targets.size();
+	}
+
+	void RenderTargetPool::clear()
+	{
+		targets.clear();
+		statistics = Statistics();
+	}
+
+	std::unique_ptr<Framebuffer> RenderTargetPool::createFramebuffer(const Description& description)
+	{
+		// Filters read outside of the target near its edges, so edge texels are repeated
+		Texture::Specification colorSpecification(description.size.x, description.size.y, description.colorFormat, Texture::Dimensionality::TwoDimensional);
+		colorSpecification.renderingStyle.sDimensionWrap = Texture::WrappingMethod::ClampToEdge;
+		colorSpecification.renderingStyle.tDimensionWrap = Texture::WrappingMethod::ClampToEdge;
+
+		auto framebuffer = std::make_unique<Framebuffer>();
+		Texture* colorTarget = new Texture;
+		colorTarget->load(colorSpecification, nullptr);
+		framebuffer->addColorTarget(colorTarget, true);
+
+		if (description.depthStencil)
+		{
+			Texture::Specification depthSpecification(description.size.x, description.size.y, Texture::Format::DEPTH24_STENCIL8,
+				Texture::Dimensionality::TwoDimensional);
+
+			Texture* depthTarget = new Texture;
+			depthTarget->load(depthSpecification, nullptr);
+			framebuffer->addDepthTarget(depthTarget, true);
+		}
+
+		framebuffer->load();
+		return framebuffer;
+	}
+}
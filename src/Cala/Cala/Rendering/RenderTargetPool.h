@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+#include "Framebuffer.h"
+
+namespace Cala {
+	/**
+	 * Framebuffers with a single color target and optional depth stencil target, reused between frames
+	 * Targets acquired in a frame stay reserved until they are released or the frame ends,
+	 * ones not acquired for a few frames, such as targets of a previous viewport size, are freed
+	*/
+	class RenderTargetPool {
+	public:
+		struct Description {
+			glm::uvec2 size{ 1U };
+			ITexture::Format colorFormat = ITexture::Format::RGBA;
+			bool depthStencil = false;
+
+			bool operator==(const Description& other) const;
+		};
+
+		struct Statistics {
+			uint32_t targetCount = 0;
+			uint32_t createdCount = 0; // Created since last frame end
+			uint32_t freedCount = 0; // Freed by last frame end
+		};
+
+		RenderTargetPool() = default;
+		~RenderTargetPool() = default;
+		RenderTargetPool(const RenderTargetPool& other) = delete;
+		RenderTargetPool& operator=(const RenderTargetPool& other) = delete;
+
+		// Returns a matching framebuffer that isn't reserved, creating it when there is none
+		const Framebuffer* acquire(const Description& description);
+		// Makes framebuffer available to following acquisitions in the same frame
+		void release(const Framebuffer* framebuffer);
+		// Releases all framebuffers and frees those which weren't acquired recently
+		void endFrame();
+		void clear();
+
+		const Statistics& getStatistics() const { return statistics; }
+
+	private:
+		struct Target {
+			Description description;
+			std::unique_ptr<Framebuffer> framebuffer;
+			bool acquired = false;
+			uint32_t unusedFrames = 0;
+		};
+
+		static std::unique_ptr<Framebuffer> createFramebuffer(const Description& description);
+
+		std::vector<Target> targets;
+		Statistics statistics;
+	};
+}
@@ -0,0 +1,386 @@
+#include "DeferredLightRenderer.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+#define BIT(x) (1 << x)
+
+#define DIFFUSE_MAP_BINDING 0
+#define SPECULAR_MAP_BINDING 1
+#define NORMAL_MAP_BINDING 2
+#define SHADOW_MAP_BINDING 3
+#define ALBEDO_BUFFER_BINDING 4
+#define SPECULAR_BUFFER_BINDING 5
+#define NORMAL_BUFFER_BINDING 6
+#define DEPTH_BUFFER_BINDING 7
+
+// Geometry pass permutation key bits, lower bits match texture state bits
+#define OBJECT_STORAGE_PERMUTATION_BIT 3
+#define BINDLESS_TEXTURES_PERMUTATION_BIT 4
+
+// Light pass permutation key bits
+#define SHADOWS_PERMUTATION_BIT 0
+#define CEL_SHADING_PERMUTATION_BIT 1
+
+// Tessellated sphere is inscribed in the exact one, so it's slightly enlarged to cover it
+#define LIGHT_VOLUME_MARGIN 1.1f
+
+namespace Cala {
+	DeferredLightRenderer::DeferredLightRenderer(glm::uvec2 shadowMapDimensions) : 
+		lightVolume(Model().loadSphere(12, 16, 1.f), false, true)
+	{
+		std::filesystem::path shadersDir(SHADERS_DIR);
+		geometryPassShaders.attachShader(Shader::ShaderType::VertexShader, shadersDir / "GeneralVertexShader.glsl");
+		geometryPassShaders.attachShader(Shader::ShaderType::FragmentShader, shadersDir / "GBufferFragmentShader.glsl");
+		geometryPassShaders.setPermutationDefines({ "DIFFUSE_MAP", "SPECULAR_MAP", "NORMAL_MAP", "OBJECT_STORAGE", "BINDLESS_TEXTURES" });
+
+		std::vector<uint32_t> geometryPassPermutations;
+		for (uint32_t state = 0; state < 8; ++state)
+			geometryPassPermutations.push_back(getGeometryPassPermutationKey(state));
+		geometryPassShaders.precompile(geometryPassPermutations);
+
+		lightPassShaders.attachShader(Shader::ShaderType::VertexShader, shadersDir / "DeferredLightVertexShader.glsl");
+		lightPassShaders.attachShader(Shader::ShaderType::FragmentShader, shadersDir / "DeferredLightFragmentShader.glsl");
+		lightPassShaders.setPermutationDefines({ "SHADOWS", "CEL_SHADING" });
+		lightPassShaders.precompile({ getLightPassPermutationKey() });
+
+		// Programs are compiled asynchronously, so shadow map setup overlaps compilation
+		shadowMapRenderer = std::make_unique<ShadowMapRenderer>(shadowMapDimensions.x);
+
+		const Shader& geometryPassShader = geometryPassShaders.getPermutation(getGeometryPassPermutationKey(0));
+		const Shader& lightPassShader = lightPassShaders.getPermutation(getLightPassPermutationKey());
+		// Buffers read their layouts on first update, so construction never waits for a link
+		mvpBuffer.setSource(geometryPassShader, "MVP", true);
+		lightsBuffer.setSource(lightPassShader, "LightsData", true);
+		deferredLightBuffer.setSource(lightPassShader, "DeferredLightData", true);
+		drawDataBuffer.setSource(geometryPassShader, "DrawData", true);
+
+		std::vector<float> screenQuadVertices = {
+			-1.f, 1.f,
+			-1.f, -1.f,
+			1.f, 1.f,
+			1.f, -1.f
+		};
+
+		std::vector<Model::VertexLayoutSpecification> modelLayouts;
+		modelLayouts.push_back({ 0, 2, 2 * sizeof(float), 0, 0 });
+		screenQuad.setVertexBufferData(screenQuadVertices, 4, modelLayouts, false);
+		screenQuad.setDrawingMode(Model::DrawingMode::TriangleStrip);
+	}
+
+	void DeferredLightRenderer::pushRenderable(const Renderable& renderable)
+	{
+		proxies.pushTransient(renderable);
+	}
+
+	void DeferredLightRenderer::pushLight(const Light& light)
+	{
+		if (lights.size() < MAX_LIGHTS_COUNT)
+			lights.push_back(light);
+	}
+
+	void DeferredLightRenderer::setupCamera(const Camera& camera)
+	{
+		mvpBuffer.updateData("eyePosition", &camera.getPosition().x, sizeof(glm::vec4));
+		mvpBuffer.updateData("view", &camera.getView()[0][0], sizeof(glm::mat4));
+		mvpBuffer.updateData("projection", &camera.getProjection()[0][0], sizeof(glm::mat4));
+		cameraFrustum = camera.getFrustum();
+		cameraView = camera.getView();
+		cameraViewProjection = camera.getProjection() * camera.getView();
+		cameraPosition = camera.getPosition();
+		cameraTanHalfAngle = glm::tan(glm::radians(camera.getProjectionViewingAngle()) * 0.5f);
+		inverseViewProjection = glm::inverse(cameraViewProjection);
+	}
+
+	uint32_t DeferredLightRenderer::getGeometryPassPermutationKey(uint32_t texturesState) const
+	{
+		uint32_t key = texturesState | BIT(OBJECT_STORAGE_PERMUTATION_BIT);
+		if (proxies.getTextureResidency().getMode() == TextureResidency::Mode::Bindless)
+			key |= BIT(BINDLESS_TEXTURES_PERMUTATION_BIT);
+
+		return key;
+	}
+
+	uint32_t DeferredLightRenderer::getLightPassPermutationKey() const
+	{
+		uint32_t key = 0;
+		if (shadows)
+			key |= BIT(SHADOWS_PERMUTATION_BIT);
+
+		if (celShadingLevelCount != 0)
+			key |= BIT(CEL_SHADING_PERMUTATION_BIT);
+
+		return key;
+	}
+
+	void DeferredLightRenderer::updateCullingBounds(uint32_t objectIndex)
+	{
+		const Renderable& renderable = proxies.get(objectIndex);
+		if (frustumCulling)
+			culler.setMesh(objectIndex, renderable.mesh, renderable.transformation.getTransformMatrix());
+		else
+			culler.setUnbounded(objectIndex);
+	}
+
+	void DeferredLightRenderer::render(GraphicsAPI* const api, const Framebuffer* renderingTarget)
+	{
+		const RenderGraph::ResourceHandle target = frameGraph.importFramebuffer("Target", renderingTarget, api->getCurrentViewport());
+		addPasses(frameGraph, target, target);
+		frameGraph.execute(api);
+	}
+
+	void DeferredLightRenderer::addPasses(RenderGraph& graph, RenderGraph::ResourceHandle colorTarget, RenderGraph::ResourceHandle depthTarget)
+	{
+		struct GBuffer {
+			RenderGraph::ResourceHandle albedo;
+			RenderGraph::ResourceHandle specular;
+			RenderGraph::ResourceHandle normal;
+			RenderGraph::ResourceHandle depth;
+		};
+
+		// Shadow map renderer binds its own targets, so preparation doesn't declare attachments
+		graph.addPass<int>("DeferredPreparation",
+			[](RenderGraph::PassBuilder& builder, int&) { builder.setSideEffects(); },
+			[this](const int&, GraphicsAPI* api, const RenderGraph::PassResources&) { prepare(api); });
+
+		const glm::uvec2 size = graph.getSize(colorTarget);
+		targetHeight = (float)size.y;
+		const GBuffer gBuffer = graph.addPass<GBuffer>("GBuffer",
+			[size](RenderGraph::PassBuilder& builder, GBuffer& data) {
+				// Albedo with ambient coefficient, specular color with shininess, encoded normal with diffuse coefficient
+				data.albedo = builder.createTexture("Albedo", { size, ITexture::Format::RGBA });
+				data.specular = builder.createTexture("Specular", { size, ITexture::Format::RGBA });
+				data.normal = builder.createTexture("Normal", { size, ITexture::Format::HALF_RGBA });
+				data.depth = builder.createTexture("Depth", { size, ITexture::Format::DEPTH24_STENCIL8 });
+				builder.writeColor(data.albedo, true);
+				builder.writeColor(data.specular, true);
+				builder.writeColor(data.normal, true);
+				builder.writeDepth(data.depth, true);
+			},
+			[this](const GBuffer&, GraphicsAPI* api, const RenderGraph::PassResources& resources) {
+				gBufferFramebuffer = resources.getPassFramebuffer();
+				renderGeometry(api);
+			});
+
+		const bool copyDepth = copyDepthToTarget;
+		graph.addPass<GBuffer>("DeferredLighting",
+			[&](RenderGraph::PassBuilder& builder, GBuffer& data) {
+				data = gBuffer;
+				builder.read(data.albedo);
+				builder.read(data.specular);
+				builder.read(data.normal);
+				builder.read(data.depth);
+				builder.writeColor(colorTarget);
+				if (copyDepth)
+					builder.writeDepth(depthTarget);
+			},
+			[this, copyDepth](const GBuffer& data, GraphicsAPI* api, const RenderGraph::PassResources& resources) {
+				const glm::ivec4& viewport = resources.getViewport();
+				if (copyDepth)
+					api->copyFramebufferDepth(gBufferFramebuffer, resources.getPassFramebuffer(), { 0, 0, viewport.z, viewport.w }, viewport);
+
+				resources.getTexture(data.albedo).setForSampling(ALBEDO_BUFFER_BINDING);
+				resources.getTexture(data.specular).setForSampling(SPECULAR_BUFFER_BINDING);
+				resources.getTexture(data.normal).setForSampling(NORMAL_BUFFER_BINDING);
+				resources.getTexture(data.depth).setForSampling(DEPTH_BUFFER_BINDING);
+				renderLights(api, viewport);
+			});
+	}
+
+	void DeferredLightRenderer::prepare(GraphicsAPI* const api)
+	{
+		// Only objects changed since last frame are uploaded
+		proxies.upload();
+		const uint32_t objectCount = proxies.getCount();
+
+		/**
+		 * Setting up lights, shadow map layers are assigned in the same order as in LightRenderer
+		*/
+		const uint32_t lightsCount = (uint32_t)lights.size();
+		lightsBuffer.updateData("celShadingLevelCount", &celShadingLevelCount, sizeof(uint32_t));
+		lightsBuffer.updateData("lightSourceCount", &lightsCount, sizeof(uint32_t));
+
+		lightPasses.clear();
+		for (uint32_t lightIndex = 0; lightIndex < lightsCount; ++lightIndex)
+		{
+			const Light& light = lights[lightIndex];
+			LightRenderer::LightParameters parameters = LightRenderer::calculateLightParameters(light);
+			LightRenderer::uploadLight(lightsBuffer, lightIndex, light, parameters);
+
+			uint32_t shadowMapIndex = 0;
+			if (shadows)
+			{
+				const float importance = LightRenderer::calculateShadowImportance(light, parameters, cameraPosition, cameraTanHalfAngle, cameraFrustum);
+				shadowMapIndex = LightRenderer::pushShadowLayers(*shadowMapRenderer, light, parameters, importance);
+			}
+
+			lightPasses.push_back({ light.transformation.getTranslation(), LightRenderer::calculateLightRadius(light, parameters), shadowMapIndex });
+		}
+		lights.clear();
+
+		/**
+		 * Rendering to shadow map
+		*/
+		api->enableSetting(GraphicsAPI::DepthTesting);
+		if (shadows)
+		{
+			for (uint32_t i = 0; i < objectCount; ++i)
+			{
+				const Renderable& renderable = proxies.get(i);
+				shadowMapRenderer->pushCaster(renderable.mesh, renderable.transformation.getTransformMatrix(), renderable.staticShadowCaster);
+			}
+
+			shadowMapRenderer->caching = shadowCaching;
+			shadowMapRenderer->staticCaching = staticShadowCaching;
+
+			shadowMapRenderer->render(api);
+			shadowMapRenderer->getShadowMaps().setForSampling(SHADOW_MAP_BINDING);
+		}
+
+		/**
+		 * Culling and sorting, lighting cost doesn't depend on draw order, so only state and front to back order matters
+		*/
+		culler.resize(objectCount);
+		if (frustumCulling != frustumCullingLastFrame)
+		{
+			for (uint32_t i = 0; i < objectCount; ++i)
+				updateCullingBounds(i);
+
+			frustumCullingLastFrame = frustumCulling;
+		}
+		else
+		{
+			for (uint32_t i : proxies.getChangedIndices())
+				updateCullingBounds(i);
+		}
+		culler.cull(cameraFrustum);
+
+		if (occlusionCulling)
+		{
+			occlusionCuller.begin(cameraViewProjection);
+			for (uint32_t i = 0; i < objectCount; ++i)
+			{
+				const Renderable& renderable = proxies.get(i);
+				if (renderable.occluder && culler.isVisible(i))
+					occlusionCuller.pushOccluderMesh(renderable.mesh, renderable.transformation.getTransformMatrix());
+			}
+			occlusionCuller.rasterize();
+		}
+
+		renderQueue.clear();
+		for (uint32_t i = 0; i < objectCount; ++i)
+		{
+			if (!culler.isVisible(i))
+				continue;
+
+			const Renderable& renderable = proxies.get(i);
+			if (occlusionCulling && !occlusionCuller.testMesh(renderable.mesh, renderable.transformation.getTransformMatrix()))
+				continue;
+
+			if (textureStreamer != nullptr)
+			{
+				const float screenSize = LightRenderer::calculateScreenSize(renderable, cameraPosition, cameraTanHalfAngle, targetHeight);
+				for (const Texture* texture : { renderable.diffuseMap, renderable.specularMap, renderable.normalMap })
+					textureStreamer->request(texture, screenSize);
+			}
+
+			uint32_t textureSet = renderQueue.getTextureSetId(LightRenderer::getTextureArrays(proxies.getTextureResidency(), renderable));
+			float viewDepth = RenderQueue::calculateViewDepth(cameraView, renderable.mesh, renderable.transformation.getTransformMatrix());
+			renderQueue.push(RenderQueue::createKey(0, getGeometryPassPermutationKey(LightRenderer::getTexturesState(renderable)), textureSet, 
+				renderQueue.getMeshId(renderable.mesh), viewDepth), i);
+		}
+		renderQueue.sort();
+
+		drawOrder.clear();
+		for (const RenderQueue::Item& item : renderQueue.getItems())
+			drawOrder.push_back(item.index);
+
+		proxies.uploadDrawOrder(drawOrder);
+	}
+
+	void DeferredLightRenderer::renderGeometry(GraphicsAPI* const api)
+	{
+		// Each batch of objects sharing program, mesh and texture arrays is a single instanced draw
+		for (const RenderQueue::Batch& batch : renderQueue.getBatches())
+		{
+			const Renderable& renderable = proxies.get(renderQueue.getItems()[batch.firstItem].index);
+			const uint32_t permutationKey = getGeometryPassPermutationKey(LightRenderer::getTexturesState(renderable));
+			if (renderQueue.changeProgram(permutationKey))
+				geometryPassShaders.getPermutation(permutationKey).activate();
+
+			const RenderQueue::TextureSet textureArrays = LightRenderer::getTextureArrays(proxies.getTextureResidency(), renderable);
+			for (uint32_t binding = DIFFUSE_MAP_BINDING; binding <= NORMAL_MAP_BINDING; ++binding)
+			{
+				if (textureArrays[binding] != nullptr && renderQueue.changeTexture(binding, textureArrays[binding]))
+					textureArrays[binding]->setForSampling(binding);
+			}
+
+			drawDataBuffer.updateData("firstObject", &batch.firstItem, sizeof(uint32_t));
+			api->renderInstances(renderable.mesh, batch.itemCount, renderQueue.changeMesh(renderable.mesh));
+		}
+		proxies.clearTransient();
+	}
+
+	void DeferredLightRenderer::renderLights(GraphicsAPI* const api, const glm::ivec4& viewport)
+	{
+		/**
+		 * Lighting passes, each adding contribution of a light to pixels it can reach
+		*/
+		api->disableSetting(GraphicsAPI::DepthTesting);
+		api->enableSetting(GraphicsAPI::Blending);
+		api->setBlendingFunction(GraphicsAPI::One, GraphicsAPI::One);
+
+		lightPassShaders.getPermutation(getLightPassPermutationKey()).activate();
+		deferredLightBuffer.updateData("inverseViewProjection", &inverseViewProjection[0][0], sizeof(glm::mat4));
+		deferredLightBuffer.updateData("viewport", &viewport.x, sizeof(glm::ivec4));
+
+		int ambientPass = 1;
+		int fullscreen = 1;
+		deferredLightBuffer.updateData("ambientPass", &ambientPass, sizeof(int));
+		deferredLightBuffer.updateData("fullscreen", &fullscreen, sizeof(int));
+		api->render(screenQuad);
+
+		ambientPass = 0;
+		deferredLightBuffer.updateData("ambientPass", &ambientPass, sizeof(int));
+
+		lightingStatistics = LightingStatistics();
+		api->setCulledFaces(GraphicsAPI::Front);
+		for (uint32_t lightIndex = 0; lightIndex < (uint32_t)lightPasses.size(); ++lightIndex)
+		{
+			const LightPass& lightPass = lightPasses[lightIndex];
+			const float volumeRadius = lightPass.radius * LIGHT_VOLUME_MARGIN;
+			if (!cameraFrustum.containsSphere(lightPass.position, volumeRadius))
+			{
+				++lightingStatistics.culledLightCount;
+				continue;
+			}
+
+			// Back faces of volume crossing far plane would be clipped away
+			const glm::vec4& farPlane = cameraFrustum.planes[Frustum::Far];
+			int volumeFullscreen = glm::dot(glm::vec3(farPlane), lightPass.position) + farPlane.w < volumeRadius ? 1 : 0;
+			if (volumeFullscreen != fullscreen)
+			{
+				fullscreen = volumeFullscreen;
+				deferredLightBuffer.updateData("fullscreen", &fullscreen, sizeof(int));
+			}
+
+			deferredLightBuffer.updateData("lightIndex", &lightIndex, sizeof(uint32_t));
+			deferredLightBuffer.updateData("shadowMapIndex", &lightPass.shadowMapIndex, sizeof(uint32_t));
+			if (fullscreen)
+			{
+				api->render(screenQuad);
+				++lightingStatistics.fullscreenLightCount;
+			}
+			else
+			{
+				// Only back faces are drawn, so pixels are lit even with camera inside the volume
+				glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.f), lightPass.position), glm::vec3(volumeRadius));
+				mvpBuffer.updateData("model", &model[0][0], sizeof(glm::mat4));
+				api->render(lightVolume);
+				++lightingStatistics.volumeLightCount;
+			}
+		}
+
+		api->setCulledFaces(GraphicsAPI::Back);
+		api->setBlendingFunction(GraphicsAPI::One, GraphicsAPI::Zero);
+		api->disableSetting(GraphicsAPI::Blending);
+	}
+}
@@ -0,0 +1,122 @@
+#pragma once 
+#include <memory>
+#include "ICameraRenderer.h"
+#include "LightRenderer.h"
+#include "RenderProxies.h"
+#include "ShadowMapRenderer.h"
+#include "Cala/Rendering/Framebuffer.h"
+#include "Cala/Rendering/Shader.h"
+#include "Cala/Rendering/ShaderPermutations.h"
+#include "Cala/Rendering/FrustumCuller.h"
+#include "Cala/Rendering/RenderQueue.h"
+#include "Cala/Rendering/RenderGraph.h"
+#include "Cala/Rendering/TextureStreamer.h"
+
+namespace Cala {
+	/**
+	 * Deferred counterpart of LightRenderer, accepting the same renderables and lights
+	 * Geometry is rendered once into G-buffer, lights are then applied in screen space,
+	 * point lights and spotlights only to pixels covered by their light volume
+	 * G-buffer is a transient texture set of a render graph, so its memory is shared with passes outside of its lifetime
+	*/
+	class DeferredLightRenderer : public ICameraRenderer {
+	public:
+		using Renderable = LightRenderer::Renderable;
+		using Light = LightRenderer::Light;
+		using RenderableHandle = LightRenderer::RenderableHandle;
+
+		struct LightingStatistics {
+			uint32_t volumeLightCount = 0;
+			uint32_t fullscreenLightCount = 0;
+			uint32_t culledLightCount = 0;
+		};
+
+		DeferredLightRenderer(glm::uvec2 shadowMapDimensions = glm::uvec2(1024U));
+		~DeferredLightRenderer() override = default;
+		// Renders through a graph of its own passes
+		void render(GraphicsAPI* const api, const Framebuffer* renderingTarget) override;
+		// Lighting adds to color target, which is sized like the G-buffer, depth target receives scene depth if copied
+		void addPasses(RenderGraph& graph, RenderGraph::ResourceHandle colorTarget, RenderGraph::ResourceHandle depthTarget);
+		void setupCamera(const Camera& camera) override;
+		uint32_t getCelShadingLevelCount() const { return celShadingLevelCount; }
+		void enableCelShading(uint32_t levelCount) { celShadingLevelCount = levelCount; }
+		void disableCelShading() { celShadingLevelCount = 0; }
+
+		void pushRenderable(const Renderable& renderable);
+		void pushLight(const Light& light);
+
+		// Visible renderables request levels of their streamed textures by their size on screen, null stops requesting
+		void setTextureStreamer(TextureStreamer* _textureStreamer) { textureStreamer = _textureStreamer; }
+
+		// Retained renderables, same as in LightRenderer
+		RenderableHandle addRenderable(const Renderable& renderable) { return proxies.add(renderable); }
+		void updateRenderable(RenderableHandle handle, const Renderable& renderable) { proxies.update(handle, renderable); }
+		void setRenderableTransformation(RenderableHandle handle, const Transformation& transformation) { proxies.setTransformation(handle, transformation); }
+		void removeRenderable(RenderableHandle handle) { proxies.remove(handle); }
+		const RenderProxies& getRenderProxies() const { return proxies; }
+		void releaseTexture(const Texture& texture) { proxies.getTextureResidency().release(texture); }
+
+		const FrustumCuller::Statistics& getCullingStatistics() const { return culler.getStatistics(); }
+		const OcclusionCuller::Statistics& getOcclusionStatistics() const { return occlusionCuller.getStatistics(); }
+		const RenderQueue::Statistics& getQueueStatistics() const { return renderQueue.getStatistics(); }
+		const ShadowMapRenderer::Statistics& getShadowStatistics() const { return shadowMapRenderer->getStatistics(); }
+		const LightingStatistics& getLightingStatistics() const { return lightingStatistics; }
+
+		const RenderGraph::Statistics& getGraphStatistics() const { return frameGraph.getStatistics(); }
+
+		bool shadows = true;
+		bool frustumCulling = true;
+		bool occlusionCulling = false;
+		bool shadowCaching = true;
+		bool staticShadowCaching = false;
+
+		// Renderers drawing into the target afterwards are depth tested against the scene, depth formats have to match
+		bool copyDepthToTarget = true;
+
+	private:
+		struct LightPass {
+			glm::vec3 position;
+			float radius;
+			uint32_t shadowMapIndex;
+		};
+
+		uint32_t getGeometryPassPermutationKey(uint32_t texturesState) const;
+		uint32_t getLightPassPermutationKey() const;
+		// Uploads lights and draw order, renders shadow maps
+		void prepare(GraphicsAPI* const api);
+		void renderGeometry(GraphicsAPI* const api);
+		void renderLights(GraphicsAPI* const api, const glm::ivec4& viewport);
+		void updateCullingBounds(uint32_t objectIndex);
+
+	private:
+		uint32_t celShadingLevelCount = 0;
+		RenderProxies proxies;
+		std::vector<Light> lights;
+		std::vector<LightPass> lightPasses;
+		ShaderPermutations geometryPassShaders;
+		ShaderPermutations lightPassShaders;
+		ConstantBuffer mvpBuffer;
+		ConstantBuffer lightsBuffer;
+		ConstantBuffer deferredLightBuffer;
+		ConstantBuffer drawDataBuffer;
+		RenderGraph frameGraph;
+		const Framebuffer* gBufferFramebuffer = nullptr;
+		std::unique_ptr<ShadowMapRenderer> shadowMapRenderer;
+		FrustumCuller culler;
+		OcclusionCuller occlusionCuller;
+		bool frustumCullingLastFrame = false;
+		Frustum cameraFrustum;
+		glm::mat4 cameraView{ 1.f };
+		glm::mat4 cameraViewProjection{ 1.f };
+		glm::vec3 cameraPosition{ 0.f };
+		float cameraTanHalfAngle = 1.f;
+		glm::mat4 inverseViewProjection{ 1.f };
+		TextureStreamer* textureStreamer = nullptr;
+		float targetHeight = 1.f; // Of the color target, in pixels
+		RenderQueue renderQueue;
+		std::vector<uint32_t> drawOrder;
+		Mesh lightVolume;
+		Mesh screenQuad;
+		LightingStatistics lightingStatistics;
+	};
+}
@@ -9,8 +9,8 @@ namespace Cala {
 		shader.attachShader(Shader::ShaderType::FragmentShader, shadersDir / "LightFragmentShader.glsl");
 		shader.createProgram();
 
-		mvpBuffer.setData(shader.getConstantBufferInfo("MVP"), true);
-		meshDataBuffer.setData(shader.getConstantBufferInfo("MeshData"), true);
+		mvpBuffer.setSource(shader, "MVP", true);
+		meshDataBuffer.setSource(shader, "MeshData", true);
 
 		gridMesh.loadFromModel(Model().loadRay(glm::vec3(0.f, 0.f, 1.f), glm::vec3(0.f, 0.f, -1.f), 2.f), false, false);
 
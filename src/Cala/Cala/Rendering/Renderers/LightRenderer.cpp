@@ -1,6 +1,9 @@
 #include "LightRenderer.h"
+#include "RenderProxies.h"
+#include "Cala/Rendering/TextureStreamer.h"
 #include <glad/glad.h>
 #include <iostream>
+#include <limits>
 #include <glm/gtx/string_cast.hpp>
 
 #define BIT(x) (1 << x)
@@ -10,48 +13,82 @@
 #define NORMAL_MAP_BINDING 2
 #define SHADOW_MAP_BINDING 3
 
+// Permutation key bits, first three match texture state bits
+#define SHADOWS_PERMUTATION_BIT 3
+#define CEL_SHADING_PERMUTATION_BIT 4
+#define OBJECT_STORAGE_PERMUTATION_BIT 5
+#define BINDLESS_TEXTURES_PERMUTATION_BIT 6
+
+// Lowest light contribution still considered visible, bounds light volumes and shadowed areas
+#define LIGHT_CUTOFF_INTENSITY (1.f / 256.f)
+
+// Frames between measurements of the depth pre-pass mode not currently chosen by automatic mode
+#define OVERDRAW_PROBE_INTERVAL 120
+
 namespace Cala {
-	LightRenderer::LightRenderer(glm::uvec2 shadowMapDimensions)
+	LightRenderer::LightRenderer(glm::uvec2 shadowMapDimensions) : proxies(std::make_unique<RenderProxies>())
 	{
 		std::filesystem::path shadersDir(SHADERS_DIR);
-		mainShader.attachShader(Shader::ShaderType::VertexShader, shadersDir / "GeneralVertexShader.glsl");
-		mainShader.attachShader(Shader::ShaderType::FragmentShader, shadersDir / "LightFragmentShader.glsl");
-		mainShader.createProgram();
+		mainShaders.attachShader(Shader::ShaderType::VertexShader, shadersDir / "GeneralVertexShader.glsl");
+		mainShaders.attachShader(Shader::ShaderType::FragmentShader, shadersDir / "LightFragmentShader.glsl");
+		mainShaders.setPermutationDefines({ "DIFFUSE_MAP", "SPECULAR_MAP", "NORMAL_MAP", "SHADOWS", "CEL_SHADING", "OBJECT_STORAGE", "BINDLESS_TEXTURES" });
 
-		shadowPassShader.attachShader(Shader::ShaderType::VertexShader, shadersDir / "ShadowPassVertexShader.glsl");
-		shadowPassShader.attachShader(Shader::ShaderType::GeometryShader, shadersDir / "ShadowPassGeometryShader.glsl");
-		shadowPassShader.attachShader(Shader::ShaderType::FragmentShader, shadersDir / "ShadowPassFragmentShader.glsl");
-		shadowPassShader.createProgram();
+		// Texture states with default shadow setup are compiled ahead of time, the rest on first use
+		std::vector<uint32_t> defaultPermutations;
+		for (uint32_t state = 0; state < 8; ++state)
+			defaultPermutations.push_back(getPermutationKey(state));
+		mainShaders.precompile(defaultPermutations);
+		const Shader& mainShader = mainShaders.getPermutation(getPermutationKey(0));
+
+		depthPrePassShader.attachShader(Shader::ShaderType::VertexShader, shadersDir / "DepthPrePassVertexShader.glsl", { "OBJECT_STORAGE" });
+		depthPrePassShader.attachShader(Shader::ShaderType::FragmentShader, shadersDir / "ShadowPassFragmentShader.glsl");
+		depthPrePassShader.createProgram();
+
+		// Programs are compiled asynchronously, so shadow map setup overlaps compilation
+		shadowMapRenderer = std::make_unique<ShadowMapRenderer>(shadowMapDimensions.x);
+
+		// Buffers read their layouts on first update, so construction never waits for a link
+		mvpBuffer.setSource(mainShader, "MVP", true);
+		materialsBuffer.setSource(mainShader, "MeshData", true);
+		lightsBuffer.setSource(mainShader, "LightsData", true);
+		drawDataBuffer.setSource(mainShader, "DrawData", true);
+	}
 
-		mvpBuffer.setData(mainShader.getConstantBufferInfo("MVP"), true);
-		materialsBuffer.setData(mainShader.getConstantBufferInfo("MeshData"), true);
-		lightsBuffer.setData(mainShader.getConstantBufferInfo("LightsData"), true);
+	LightRenderer::~LightRenderer() = default;
 
-		TextureArray* depthTextureArray = new TextureArray;
-		Texture::Specification depthTextureSpecification(
-			shadowMapDimensions.x, shadowMapDimensions.y, ITexture::Format::DEPTH32, 
-			Texture::Dimensionality::TwoDimensional
-		);
+    void LightRenderer::pushRenderable(const Renderable& renderable)
+	{
+		proxies->pushTransient(renderable);
+	}
 
-		depthTextureArray->load(depthTextureSpecification, 0, MAX_LIGHTS_COUNT * 6); // MAX_LIGHTS * 6 faces of a cubemap in case of point lights
-		shadowsFramebuffer.addDepthTarget(depthTextureArray, true, 0);
-		shadowsFramebuffer.load();
+	LightRenderer::RenderableHandle LightRenderer::addRenderable(const Renderable& renderable)
+	{
+		return proxies->add(renderable);
 	}
 
-    void LightRenderer::pushRenderable(const Renderable& renderable)
+	void LightRenderer::updateRenderable(RenderableHandle handle, const Renderable& renderable)
 	{
-		int state = 0;
+		proxies->update(handle, renderable);
+	}
 
-		if (renderable.diffuseMap != nullptr)
-			state |= BIT(0);
+	void LightRenderer::setRenderableTransformation(RenderableHandle handle, const Transformation& transformation)
+	{
+		proxies->setTransformation(handle, transformation);
+	}
 
-		if (renderable.specularMap != nullptr)
-			state |= BIT(1);
+	void LightRenderer::removeRenderable(RenderableHandle handle)
+	{
+		proxies->remove(handle);
+	}
 
-		if (renderable.normalMap != nullptr)
-			state |= BIT(2);
+	const RenderProxies& LightRenderer::getRenderProxies() const
+	{
+		return *proxies;
+	}
 
-		renderables[state].push_back(renderable);
+	void LightRenderer::releaseTexture(const Texture& texture)
+	{
+		proxies->getTextureResidency().release(texture);
 	}
 
 	void LightRenderer::pushLight(const Light& light)
@@ -60,64 +97,236 @@ namespace Cala {
 			lights.push_back(light);
 	}
 
-	void LightRenderer::updateLight(const Light& light, uint32_t lightIndex)
+	LightRenderer::LightParameters LightRenderer::calculateLightParameters(const Light& light)
 	{
-		/** 
-		 * Setting up light uniforms
-		*/
-		glm::vec3 color, direction;
-		float constant, linear, quadratic, cutoff;
-		glm::mat4 projection;
-
+		LightParameters parameters;
 		switch (light.type)
 		{
 			case Light::Type::Point:
 			{
-				color = light.intensity * light.color;
-				direction = glm::vec3(0.f, 0.f, 0.f);
-				constant = 1.1f;
-				linear = 0.024f;
-				quadratic = 0.0021f;
-				cutoff = -2.f;
-				projection = glm::perspective(90.f, 1.f, 1.f, light.intensity * 100.f);
+				parameters.color = light.intensity * light.color;
+				parameters.direction = glm::vec3(0.f, 0.f, 0.f);
+				parameters.constant = 1.1f;
+				parameters.linear = 0.024f;
+				parameters.quadratic = 0.0021f;
+				parameters.cutoff = -2.f;
+				parameters.shadowRange = light.intensity * 100.f;
+				parameters.projection = glm::perspective(90.f, 1.f, 1.f, parameters.shadowRange);
 				break;
 			}
 			case Light::Type::Directional:
 			{
-				color = light.intensity * light.color;
-				direction = glm::vec3(0.f, -1.f, 0.f);
-				constant = 0.f;
-				linear = 0.f;
-				quadratic = 0.f;
-				cutoff = -3.f;
-				projection = glm::ortho(-50.f, 50.f, -50.f, 50.f, 1.f, 100.f);
+				parameters.color = light.intensity * light.color;
+				parameters.direction = glm::vec3(0.f, -1.f, 0.f);
+				parameters.constant = 0.f;
+				parameters.linear = 0.f;
+				parameters.quadratic = 0.f;
+				parameters.cutoff = -3.f;
+				parameters.shadowRange = 100.f;
+				parameters.projection = glm::ortho(-50.f, 50.f, -50.f, 50.f, 1.f, parameters.shadowRange);
 				break;
 			}
 			case Light::Type::Spotlight:
 			{
-				color = light.intensity * light.color;
-				direction = glm::vec3(light.transformation.getRotationMatrix() * glm::vec4(0.f, -1.f, 0.f, 0.f));
-				constant = 1.f;
-				linear = 0.045f;
-				quadratic = 0.0075f;
-				cutoff = glm::cos(glm::radians(light.spotlightCutoff));
-				projection = glm::perspective(light.spotlightCutoff * 2.f, 1.f, 1.f, light.intensity * 100.f);
+				parameters.color = light.intensity * light.color;
+				parameters.direction = glm::vec3(light.transformation.getRotationMatrix() * glm::vec4(0.f, -1.f, 0.f, 0.f));
+				parameters.constant = 1.f;
+				parameters.linear = 0.045f;
+				parameters.quadratic = 0.0075f;
+				parameters.cutoff = glm::cos(glm::radians(light.spotlightCutoff));
+				parameters.shadowRange = light.intensity * 100.f;
+				parameters.projection = glm::perspective(light.spotlightCutoff * 2.f, 1.f, 1.f, parameters.shadowRange);
 				break;
 			}
 		}
 
 		if (!light.shadowCaster)
-			projection = glm::mat4(0.f);
+			parameters.projection = glm::mat4(0.f);
 
+		return parameters;
+	}
+
+	void LightRenderer::uploadLight(const ConstantBuffer& lightsBuffer, uint32_t lightIndex, const Light& light, const LightParameters& parameters)
+	{
 		std::string lightsString = "lights[" + std::to_string(lightIndex) + "].";
 		lightsBuffer.updateData(lightsString + "position", &light.transformation.getTranslation().x, sizeof(glm::vec4));
-		lightsBuffer.updateData(lightsString + "color", &color, sizeof(glm::vec4));
-		lightsBuffer.updateData(lightsString + "direction", &direction, sizeof(glm::vec4));
-		lightsBuffer.updateData(lightsString + "constant", &constant, sizeof(float));
-		lightsBuffer.updateData(lightsString + "linear", &linear, sizeof(float));
-		lightsBuffer.updateData(lightsString + "quadratic", &quadratic, sizeof(float));
-		lightsBuffer.updateData(lightsString + "cutoff", &cutoff, sizeof(float));
-		lightsBuffer.updateData(lightsString + "projection", &projection[0][0], sizeof(glm::mat4));
+		lightsBuffer.updateData(lightsString + "color", &parameters.color, sizeof(glm::vec4));
+		lightsBuffer.updateData(lightsString + "direction", &parameters.direction, sizeof(glm::vec4));
+		lightsBuffer.updateData(lightsString + "constant", &parameters.constant, sizeof(float));
+		lightsBuffer.updateData(lightsString + "linear", &parameters.linear, sizeof(float));
+		lightsBuffer.updateData(lightsString + "quadratic", &parameters.quadratic, sizeof(float));
+		lightsBuffer.updateData(lightsString + "cutoff", &parameters.cutoff, sizeof(float));
+		lightsBuffer.updateData(lightsString + "projection", &parameters.projection[0][0], sizeof(glm::mat4));
+	}
+
+	float LightRenderer::calculateLightRadius(const Light& light, const LightParameters& parameters)
+	{
+		// Attenuation of lighting shaders is 1 / (constant + linear * quadratic * distance^3)
+		const float falloff = parameters.linear * parameters.quadratic;
+		const float brightness = glm::max(parameters.color.x, glm::max(parameters.color.y, parameters.color.z));
+		if (light.type == Light::Type::Directional || falloff <= 0.f)
+			return std::numeric_limits<float>::infinity();
+
+		return glm::pow(glm::max(brightness / LIGHT_CUTOFF_INTENSITY - parameters.constant, 0.f) / falloff, 1.f / 3.f);
+	}
+
+	float LightRenderer::calculateShadowImportance(const Light& light, const LightParameters& parameters,
+		const glm::vec3& cameraPosition, float cameraTanHalfAngle, const Frustum& cameraFrustum)
+	{
+		if (light.type == Light::Type::Directional)
+			return 1.f;
+
+		// Shadows are cast only where the light is both visible and in range of its shadow projection
+		const glm::vec3& position = light.transformation.getTranslation();
+		const float radius = glm::min(calculateLightRadius(light, parameters), parameters.shadowRange);
+		if (!cameraFrustum.containsSphere(position, radius))
+			return 0.f;
+
+		const float distance = glm::length(position - cameraPosition);
+		if (distance <= radius)
+			return 1.f;
+
+		return glm::clamp(radius / (distance * cameraTanHalfAngle), 0.f, 1.f);
+	}
+
+	float LightRenderer::calculateScreenSize(const Renderable& renderable, const glm::vec3& cameraPosition, float cameraTanHalfAngle, float targetHeight)
+	{
+		// Meshes without bounds are assumed to be seen up close
+		if (!renderable.mesh.hasBoundingBox())
+			return targetHeight;
+
+		const glm::vec3 center = (renderable.mesh.getBoundingBoxMin() + renderable.mesh.getBoundingBoxMax()) * 0.5f;
+		const glm::vec3 worldCenter(renderable.transformation.getTransformMatrix() * glm::vec4(center, 1.f));
+		const glm::vec3 scale = glm::abs(renderable.transformation.getScale());
+		const float radius = glm::length(renderable.mesh.getBoundingBoxMax() - center) * glm::max(scale.x, glm::max(scale.y, scale.z));
+
+		const float distance = glm::length(worldCenter - cameraPosition);
+		if (distance <= radius)
+			return targetHeight;
+
+		return targetHeight * radius / (distance * cameraTanHalfAngle);
+	}
+
+	uint32_t LightRenderer::pushShadowLayers(ShadowMapRenderer& shadowMapRenderer, const Light& light, const LightParameters& parameters, float importance)
+	{
+		const uint32_t firstLayer = shadowMapRenderer.getLayerCount();
+		if (!light.shadowCaster)
+			return firstLayer;
+
+		const glm::vec3& position = light.transformation.getTranslation();
+		if (light.type == Light::Type::Point)
+		{
+			static const glm::vec3 faceDirections[6] = {
+				{ 1.f, 0.f, 0.f }, { -1.f, 0.f, 0.f },
+				{ 0.f, 1.f, 0.f }, { 0.f, -1.f, 0.f },
+				{ 0.f, 0.f, 1.f }, { 0.f, 0.f, -1.f }
+			};
+
+			for (const glm::vec3& faceDirection : faceDirections)
+				shadowMapRenderer.pushLayer(parameters.projection * ShadowMapRenderer::calculateLightViewMatrix(position, faceDirection), importance);
+		}
+		else
+		{
+			shadowMapRenderer.pushLayer(parameters.projection * ShadowMapRenderer::calculateLightViewMatrix(position, parameters.direction), importance);
+		}
+
+		return firstLayer;
+	}
+
+	void LightRenderer::updateLight(const Light& light, uint32_t lightIndex)
+	{
+		LightParameters parameters = calculateLightParameters(light);
+		uploadLight(lightsBuffer, lightIndex, light, parameters);
+
+		// Layers are pushed in the same order as lighting shader looks them up
+		if (shadows)
+			pushShadowLayers(*shadowMapRenderer, light, parameters, calculateShadowImportance(light, parameters, cameraPosition, cameraTanHalfAngle, cameraFrustum));
+	}
+
+	uint32_t LightRenderer::getTexturesState(const Renderable& renderable)
+	{
+		uint32_t state = 0;
+
+		if (renderable.diffuseMap != nullptr)
+			state |= BIT(0);
+
+		if (renderable.specularMap != nullptr)
+			state |= BIT(1);
+
+		if (renderable.normalMap != nullptr)
+			state |= BIT(2);
+
+		return state;
+	}
+
+	RenderQueue::TextureSet LightRenderer::getTextureArrays(const TextureResidency& textures, const Renderable& renderable)
+	{
+		return { textures.getTextureArray(renderable.diffuseMap), textures.getTextureArray(renderable.specularMap), 
+			textures.getTextureArray(renderable.normalMap), nullptr };
+	}
+
+	void LightRenderer::updateCullingBounds(uint32_t objectIndex)
+	{
+		const Renderable& renderable = proxies->get(objectIndex);
+		if (frustumCulling)
+			culler.setMesh(objectIndex, renderable.mesh, renderable.transformation.getTransformMatrix());
+		else
+			culler.setUnbounded(objectIndex);
+	}
+
+	uint32_t LightRenderer::getPermutationKey(uint32_t texturesState) const
+	{
+		uint32_t key = texturesState | BIT(OBJECT_STORAGE_PERMUTATION_BIT);
+		if (shadows)
+			key |= BIT(SHADOWS_PERMUTATION_BIT);
+
+		if (celShadingLevelCount != 0)
+			key |= BIT(CEL_SHADING_PERMUTATION_BIT);
+
+		if (proxies->getTextureResidency().getMode() == TextureResidency::Mode::Bindless)
+			key |= BIT(BINDLESS_TEXTURES_PERMUTATION_BIT);
+
+		return key;
+	}
+
+	bool LightRenderer::beginOverdrawMeasurement()
+	{
+		if (!overdrawQuery.isLoaded())
+			overdrawQuery.load(GPUQuery::Type::SamplesPassed);
+
+		// Main pass with depth pre-pass shades only visible fragments, without it every fragment passing depth test
+		if (overdrawQuery.isResultAvailable())
+		{
+			uint64_t samples = overdrawQuery.getResult();
+			if (overdrawQueryWithPrePass)
+				visibleSamples = samples;
+			else
+				shadedSamples = samples;
+
+			if (visibleSamples != 0 && shadedSamples != 0)
+				measuredOverdraw = (float)((double)shadedSamples / (double)visibleSamples);
+		}
+
+		bool usePrePass = measuredOverdraw > depthPrePassOverdrawThreshold;
+		++framesSinceProbe;
+		if (!overdrawQuery.isPending())
+		{
+			// Counts of both modes are needed, so the other one is measured for a single frame now and then
+			if (visibleSamples == 0)
+				usePrePass = true;
+			else if (shadedSamples == 0)
+				usePrePass = false;
+			else if (framesSinceProbe >= OVERDRAW_PROBE_INTERVAL)
+			{
+				usePrePass = !usePrePass;
+				framesSinceProbe = 0;
+			}
+
+			overdrawQueryWithPrePass = usePrePass;
+			overdrawMeasured = true;
+		}
+
+		return usePrePass;
 	}
 
 	void LightRenderer::setupCamera(const Camera &camera)
@@ -125,16 +334,36 @@ namespace Cala {
 		mvpBuffer.updateData("eyePosition", &camera.getPosition().x, sizeof(glm::vec4));
 		mvpBuffer.updateData("view", &camera.getView()[0][0], sizeof(glm::mat4));
 		mvpBuffer.updateData("projection", &camera.getProjection()[0][0], sizeof(glm::mat4));
+		cameraFrustum = camera.getFrustum();
+		cameraView = camera.getView();
+		cameraViewProjection = camera.getProjection() * camera.getView();
+		cameraPosition = camera.getPosition();
+		cameraTanHalfAngle = glm::tan(glm::radians(camera.getProjectionViewingAngle()) * 0.5f);
     }
 
+	void LightRenderer::addPasses(RenderGraph& graph, RenderGraph::ResourceHandle colorTarget, RenderGraph::ResourceHandle depthTarget)
+	{
+		// Shadow map renderer binds its own targets, rendering target is bound again before the main pass
+		graph.addPass<int>("Forward",
+			[&](RenderGraph::PassBuilder& builder, int&) {
+				builder.writeColor(colorTarget);
+				builder.writeDepth(depthTarget);
+			},
+			[this](const int&, GraphicsAPI* api, const RenderGraph::PassResources& resources) {
+				render(api, resources.getPassFramebuffer());
+			});
+	}
+
     void LightRenderer::render(GraphicsAPI* const api, const Framebuffer* renderingTarget)
     {
-		int shadowsInt = shadows;
-		lightsBuffer.updateData("shadows", &shadowsInt, sizeof(shadowsInt));
 		lightsBuffer.updateData("celShadingLevelCount", &celShadingLevelCount, sizeof(uint32_t));
 
 		auto currentViewport = api->getCurrentViewport();
 
+		// Only objects changed since last frame are uploaded
+		proxies->upload();
+		const uint32_t objectCount = proxies->getCount();
+
 		/**
 		 * Setting up shader for light setup
 		*/ 
@@ -153,64 +382,165 @@ namespace Cala {
 		api->enableSetting(GraphicsAPI::DepthTesting);
 		if (shadows)
 		{
-			shadowPassShader.activate();
-			api->setBufferClearingBits(false, true, false);
-			api->activateFramebuffer(&shadowsFramebuffer);
-			glm::ivec2 depthTextureSize = shadowsFramebuffer.getDepthTarget().getDimensions();
-			api->setViewport({ 0, 0, depthTextureSize.x, depthTextureSize.y });
-			api->clearFramebuffer();
-			for (int state = 0; state < 8; state++)
+			// Casters are culled per light face, so each one is drawn only into layers it can affect
+			for (uint32_t i = 0; i < objectCount; ++i)
 			{
-				for (const Renderable& renderable : renderables[state])
-				{
-					mvpBuffer.updateData("model", &renderable.transformation.getTransformMatrix()[0][0], sizeof(glm::mat4));
-					api->render(renderable.mesh);
-				}
+				const Renderable& renderable = proxies->get(i);
+				shadowMapRenderer->pushCaster(renderable.mesh, renderable.transformation.getTransformMatrix(), renderable.staticShadowCaster);
 			}
 
-			shadowsFramebuffer.getDepthTarget().setForSampling(SHADOW_MAP_BINDING);
+			shadowMapRenderer->caching = shadowCaching;
+			shadowMapRenderer->staticCaching = staticShadowCaching;
+
+			shadowMapRenderer->render(api);
+			shadowMapRenderer->getShadowMaps().setForSampling(SHADOW_MAP_BINDING);
 		}
 
 		/**
-		 * Setting up uniforms for normal rendering
+		 * Culling against camera frustum, shadow casters outside of it are still needed for shadow pass above
+		 * Bounds are kept between frames and recomputed only for changed objects
+		*/
+		culler.resize(objectCount);
+		if (frustumCulling != frustumCullingLastFrame)
+		{
+			for (uint32_t i = 0; i < objectCount; ++i)
+				updateCullingBounds(i);
+
+			frustumCullingLastFrame = frustumCulling;
+		}
+		else
+		{
+			for (uint32_t i : proxies->getChangedIndices())
+				updateCullingBounds(i);
+		}
+		culler.cull(cameraFrustum);
+
+		/**
+		 * Occlusion culling, occluders in view are rasterized into a depth buffer on the CPU
+		 * and objects hidden behind them aren't submitted
 		*/
-		mainShader.activate();
-		
+		if (occlusionCulling)
+		{
+			occlusionCuller.begin(cameraViewProjection);
+			for (uint32_t i = 0; i < objectCount; ++i)
+			{
+				const Renderable& renderable = proxies->get(i);
+				if (renderable.occluder && culler.isVisible(i))
+					occlusionCuller.pushOccluderMesh(renderable.mesh, renderable.transformation.getTransformMatrix());
+			}
+			occlusionCuller.rasterize();
+		}
+
+		/**
+		 * Sorting visible renderables by program, texture arrays, mesh and front to back within them
+		 * Textures are read by index, so only arrays holding them split batches, bindless ones none
+		*/
+		renderQueue.clear();
+		for (uint32_t i = 0; i < objectCount; ++i)
+		{
+			if (!culler.isVisible(i))
+				continue;
 
+			const Renderable& renderable = proxies->get(i);
+			if (occlusionCulling && !occlusionCuller.testMesh(renderable.mesh, renderable.transformation.getTransformMatrix()))
+				continue;
+
+			if (textureStreamer != nullptr)
+			{
+				const float screenSize = calculateScreenSize(renderable, cameraPosition, cameraTanHalfAngle, (float)currentViewport.w);
+				for (const Texture* texture : { renderable.diffuseMap, renderable.specularMap, renderable.normalMap })
+					textureStreamer->request(texture, screenSize);
+			}
+
+			uint32_t textureSet = renderQueue.getTextureSetId(getTextureArrays(proxies->getTextureResidency(), renderable));
+			float viewDepth = RenderQueue::calculateViewDepth(cameraView, renderable.mesh, renderable.transformation.getTransformMatrix());
+			renderQueue.push(RenderQueue::createKey(0, getPermutationKey(getTexturesState(renderable)), textureSet, 
+				renderQueue.getMeshId(renderable.mesh), viewDepth), i);
+		}
+		renderQueue.sort();
+
+		// Instances of a batch find their objects through draw order
+		drawOrder.clear();
+		for (const RenderQueue::Item& item : renderQueue.getItems())
+			drawOrder.push_back(item.index);
+
+		proxies->uploadDrawOrder(drawOrder);
+
+		/**
+		 * Setting up uniforms for normal rendering
+		*/
 		api->activateFramebuffer(renderingTarget);			
 		api->setViewport(currentViewport);
 		api->setBufferClearingBits(true, true, true);
 		int lightened = 1;
 		materialsBuffer.updateData("lightened", &lightened, sizeof(int));
 
-		for (uint32_t state = 0; state < 8; ++state)
+		/**
+		 * Depth pre-pass, main pass then shades only fragments that end up visible
+		*/
+		overdrawMeasured = false;
+		switch (depthPrePassMode)
+		{
+			case DepthPrePassMode::Disabled:
+				depthPrePassActive = false;
+				break;
+			case DepthPrePassMode::Enabled:
+				depthPrePassActive = true;
+				break;
+			case DepthPrePassMode::Automatic:
+				depthPrePassActive = beginOverdrawMeasurement();
+				break;
+		}
+
+		if (depthPrePassActive)
 		{
-			if (!renderables[state].empty())
+			depthPrePassShader.activate();
+			for (const RenderQueue::Batch& batch : renderQueue.getBatches())
 			{
-				materialsBuffer.updateData("state", &state, sizeof(int));
+				const Renderable& renderable = proxies->get(renderQueue.getItems()[batch.firstItem].index);
+				drawDataBuffer.updateData("firstObject", &batch.firstItem, sizeof(uint32_t));
+				api->renderInstances(renderable.mesh, batch.itemCount, renderQueue.changeMesh(renderable.mesh));
 			}
 
-			for (const Renderable& renderable : renderables[state])
+			api->setDepthComparisonFunction(GraphicsAPI::LessOrEqual);
+			api->setDepthWriting(false);
+		}
+
+		// Only main pass fragments are counted, pre-pass ones would inflate visible samples
+		if (overdrawMeasured)
+			overdrawQuery.begin();
+
+		for (const RenderQueue::Batch& batch : renderQueue.getBatches())
+		{
+			// Objects of a batch share program, mesh and texture arrays, so first one stands for all of them
+			const Renderable& renderable = proxies->get(renderQueue.getItems()[batch.firstItem].index);
+			const uint32_t state = getTexturesState(renderable);
+
+			// Each texture state binds its own specialized program
+			const uint32_t permutationKey = getPermutationKey(state);
+			if (renderQueue.changeProgram(permutationKey))
+				mainShaders.getPermutation(permutationKey).activate();
+
+			const RenderQueue::TextureSet textureArrays = getTextureArrays(proxies->getTextureResidency(), renderable);
+			for (uint32_t binding = DIFFUSE_MAP_BINDING; binding <= NORMAL_MAP_BINDING; ++binding)
 			{
-				if ((state & BIT(DIFFUSE_MAP_BINDING)) != 0)
-					renderable.diffuseMap->setForSampling(DIFFUSE_MAP_BINDING);
-
-				if ((state & BIT(SPECULAR_MAP_BINDING)) != 0)
-					renderable.specularMap->setForSampling(SPECULAR_MAP_BINDING);
-
-				if ((state & BIT(NORMAL_MAP_BINDING)) != 0)
-					renderable.normalMap->setForSampling(NORMAL_MAP_BINDING);
-
-				mvpBuffer.updateData("model", &renderable.transformation.getTransformMatrix()[0][0], sizeof(glm::mat4));
-				materialsBuffer.updateData("material.color", &renderable.color.x, sizeof(glm::vec4));
-				materialsBuffer.updateData("material.ambientCoefficient", &renderable.ambientCoefficient, sizeof(float));
-				materialsBuffer.updateData("material.diffuseCoefficient", &renderable.diffuseCoefficient, sizeof(float));
-				materialsBuffer.updateData("material.specularCoefficient", &renderable.specularCoefficient, sizeof(float));
-				materialsBuffer.updateData("material.shininess", &renderable.shininess, sizeof(float));
-				api->render(renderable.mesh);
+				if (textureArrays[binding] != nullptr && renderQueue.changeTexture(binding, textureArrays[binding]))
+					textureArrays[binding]->setForSampling(binding);
 			}
 
-			renderables[state].clear();
+			// Transformations, materials and texture indices are read from object storage
+			drawDataBuffer.updateData("firstObject", &batch.firstItem, sizeof(uint32_t));
+			api->renderInstances(renderable.mesh, batch.itemCount, renderQueue.changeMesh(renderable.mesh));
+		}
+		proxies->clearTransient();
+
+		if (overdrawQuery.isActive())
+			overdrawQuery.end();
+
+		if (depthPrePassActive)
+		{
+			api->setDepthComparisonFunction(GraphicsAPI::Less);
+			api->setDepthWriting(true);
 		}
 
 		api->disableSetting(GraphicsAPI::DepthTesting);
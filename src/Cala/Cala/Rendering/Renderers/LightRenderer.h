@@ -4,15 +4,30 @@
 #include "Cala/Utility/Transformation.h"
 #include "Cala/Rendering/Framebuffer.h"
 #include "Cala/Rendering/Shader.h"
+#include "Cala/Rendering/ShaderPermutations.h"
+#include "Cala/Rendering/FrustumCuller.h"
+#include "Cala/Rendering/OcclusionCuller.h"
+#include "Cala/Rendering/RenderQueue.h"
+#include "Cala/Rendering/GPUQuery.h"
+#include "Cala/Rendering/RenderGraph.h"
+#include "ShadowMapRenderer.h"
+#include <memory>
 
 #define MAX_LIGHTS_COUNT 8
 
 namespace Cala {
+	class RenderProxies;
+	class TextureResidency;
+	class TextureStreamer;
+
 	class LightRenderer : public ICameraRenderer {
 	public:
+		// Shadow maps of the most important lights get shadowMapDimensions, less important ones are scaled down
 		LightRenderer(glm::uvec2 shadowMapDimensions = glm::uvec2(1024U));
-		~LightRenderer() override = default;
+		~LightRenderer() override;
 		void render(GraphicsAPI* const api, const Framebuffer* renderingTarget) override;
+		// Renders as a single pass drawing over both targets without clearing them, shadow maps are rendered inside it
+		void addPasses(RenderGraph& graph, RenderGraph::ResourceHandle colorTarget, RenderGraph::ResourceHandle depthTarget);
 		void setupCamera(const Camera& camera) override;
 		uint32_t getCelShadingLevelCount() const { return celShadingLevelCount; }
 		void enableCelShading(uint32_t levelCount) { celShadingLevelCount = levelCount; }
@@ -41,6 +56,10 @@ namespace Cala {
 			float diffuseCoefficient;
 			float specularCoefficient;
 			float shininess;
+			// Static casters are kept in cached shadow maps when static shadow caching is enabled
+			bool staticShadowCaster = false;
+			// Occluders hide objects behind them when occlusion culling is enabled, their bounding box has to be filled by the mesh
+			bool occluder = false;
 		};
 
 		struct Light {
@@ -65,22 +84,120 @@ namespace Cala {
 			bool shadowCaster = true;
 		};
 
+		// Renderable drawn only in the next rendered frame
 		void pushRenderable(const Renderable& renderable);
 		void pushLight(const Light& light);
+
+		/**
+		 * Renderables registered once and drawn every frame until removed
+		 * Only registered, updated, moved and removed ones are uploaded to GPU again
+		 * Handles of removed renderables may be reused by renderables registered later
+		*/
+		using RenderableHandle = uint32_t;
+		RenderableHandle addRenderable(const Renderable& renderable);
+		void updateRenderable(RenderableHandle handle, const Renderable& renderable);
+		void setRenderableTransformation(RenderableHandle handle, const Transformation& transformation);
+		void removeRenderable(RenderableHandle handle);
+		const RenderProxies& getRenderProxies() const;
+		// Drops texture from the texture table, has to be called before a texture drawn by the renderer is freed
+		void releaseTexture(const Texture& texture);
+		// Visible renderables request levels of their streamed textures by their size on screen, null stops requesting
+		void setTextureStreamer(TextureStreamer* _textureStreamer) { textureStreamer = _textureStreamer; }
+
+		// Light as laid out in LightsData block of lighting shaders
+		struct LightParameters {
+			glm::vec3 color{ 0.f };
+			glm::vec3 direction{ 0.f };
+			float constant = 0.f;
+			float linear = 0.f;
+			float quadratic = 0.f;
+			float cutoff = 0.f;
+			glm::mat4 projection{ 0.f };
+			// Far plane of the shadow projection, not part of the block
+			float shadowRange = 0.f;
+		};
+
+		static LightParameters calculateLightParameters(const Light& light);
+		static void uploadLight(const ConstantBuffer& lightsBuffer, uint32_t lightIndex, const Light& light, const LightParameters& parameters);
+		// Distance at which light contribution drops below visible intensity, infinite for directional lights
+		static float calculateLightRadius(const Light& light, const LightParameters& parameters);
+		// Fraction of view height covered by the light's shadowed area, decides size of its shadow atlas tiles
+		static float calculateShadowImportance(const Light& light, const LightParameters& parameters,
+			const glm::vec3& cameraPosition, float cameraTanHalfAngle, const Frustum& cameraFrustum);
+		// Pixels of target height covered by the renderable's bounding sphere, decides streamed mipmap levels of its textures
+		static float calculateScreenSize(const Renderable& renderable, const glm::vec3& cameraPosition, float cameraTanHalfAngle, float targetHeight);
+		// Pushes layers in the order lighting shaders look them up, returns index of the first one
+		static uint32_t pushShadowLayers(ShadowMapRenderer& shadowMapRenderer, const Light& light, const LightParameters& parameters, float importance = 1.f);
+		// Bits of diffuse, specular and normal maps set by a renderable
+		static uint32_t getTexturesState(const Renderable& renderable);
+		// Arrays holding textures of a renderable ordered by texture units, all null when textures are bindless
+		static RenderQueue::TextureSet getTextureArrays(const TextureResidency& textures, const Renderable& renderable);
+
+		// Visible and culled renderable counts of the last rendered frame
+		const FrustumCuller::Statistics& getCullingStatistics() const { return culler.getStatistics(); }
+		// Occluders and objects hidden by them in the last rendered frame with occlusion culling enabled
+		const OcclusionCuller::Statistics& getOcclusionStatistics() const { return occlusionCuller.getStatistics(); }
+		// Draw count, bound and skipped state changes and sort time of the last rendered frame
+		const RenderQueue::Statistics& getQueueStatistics() const { return renderQueue.getStatistics(); }
+		// Shadow casters and their per-layer instances drawn or culled in the last rendered frame
+		const ShadowMapRenderer::Statistics& getShadowStatistics() const { return shadowMapRenderer->getStatistics(); }
         bool shadows = true;
+		bool frustumCulling = true;
+		bool occlusionCulling = false;
+
+		enum class DepthPrePassMode {
+			Disabled,
+			Enabled,
+			Automatic // Enabled while measured overdraw is above threshold
+		};
+
+		DepthPrePassMode depthPrePassMode = DepthPrePassMode::Disabled;
+		float depthPrePassOverdrawThreshold = 1.5f;
+		// Shaded to visible fragments ratio of the main pass, measured only in automatic mode
+		float getMeasuredOverdraw() const { return measuredOverdraw; }
+		bool isDepthPrePassActive() const { return depthPrePassActive; }
+
+		// Shadow maps of lights that didn't move and whose casters didn't move are reused from last frame
+		bool shadowCaching = true;
+		// Additionally caches static casters separately, so moving dynamic casters don't redraw them
+		bool staticShadowCaching = false;
 
     private:
         void updateLight(const Light &light, uint32_t lightIndex);
+		void updateCullingBounds(uint32_t objectIndex);
+		uint32_t getPermutationKey(uint32_t texturesState) const;
+		// Returns whether depth pre-pass should be used for the current frame, sets whether its main pass is measured
+		bool beginOverdrawMeasurement();
 
 	private:
         uint32_t celShadingLevelCount = 0;
-		std::vector<Renderable> renderables[8];
+		std::unique_ptr<RenderProxies> proxies;
 		std::vector<Light> lights;
-		Shader mainShader;
-		Shader shadowPassShader;
+		ShaderPermutations mainShaders;
 		ConstantBuffer mvpBuffer;
 		ConstantBuffer materialsBuffer;
 		ConstantBuffer lightsBuffer;
-		Framebuffer shadowsFramebuffer;
+		ConstantBuffer drawDataBuffer;
+		std::unique_ptr<ShadowMapRenderer> shadowMapRenderer;
+		FrustumCuller culler;
+		OcclusionCuller occlusionCuller;
+		bool frustumCullingLastFrame = false;
+		Frustum cameraFrustum;
+		glm::mat4 cameraView{ 1.f };
+		glm::mat4 cameraViewProjection{ 1.f };
+		glm::vec3 cameraPosition{ 0.f };
+		float cameraTanHalfAngle = 1.f;
+		TextureStreamer* textureStreamer = nullptr;
+		RenderQueue renderQueue;
+		std::vector<uint32_t> drawOrder;
+		Shader depthPrePassShader;
+		bool depthPrePassActive = false;
+		GPUQuery overdrawQuery;
+		bool overdrawQueryWithPrePass = false;
+		bool overdrawMeasured = false; // Query begins right before the main pass of the current frame
+		uint64_t shadedSamples = 0;
+		uint64_t visibleSamples = 0;
+		uint32_t framesSinceProbe = 0;
+		float measuredOverdraw = 0.f;
 	};
 }
\ No newline at end of file
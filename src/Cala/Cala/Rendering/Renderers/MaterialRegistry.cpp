@@ -0,0 +1,119 @@
+#include "MaterialRegistry.h"
+#include <tuple>
+#include <algorithm>
+#include "Cala/Utility/Logger.h"
+
+#define MATERIALS_STORAGE_BINDING 3
+
+// Storage is allocated for at least this many materials and grows by doubling
+#define MIN_MATERIALS_CAPACITY 64U
+
+namespace Cala {
+	bool MaterialRegistry::Material::operator<(const Material& other) const
+	{
+		return std::tie(color.x, color.y, color.z, color.w, ambientCoefficient, diffuseCoefficient, specularCoefficient, shininess,
+			diffuseMap, specularMap, normalMap) <
+			std::tie(other.color.x, other.color.y, other.color.z, other.color.w, other.ambientCoefficient, other.diffuseCoefficient,
+			other.specularCoefficient, other.shininess, other.diffuseMap, other.specularMap, other.normalMap);
+	}
+
+	uint32_t MaterialRegistry::acquire(const Material& material)
+	{
+		auto it = materialIndices.find(material);
+		if (it != materialIndices.end())
+		{
+			++entries[it->second].referenceCount;
+			return it->second;
+		}
+
+		uint32_t index;
+		if (!freeIndices.empty())
+		{
+			index = freeIndices.back();
+			freeIndices.pop_back();
+		}
+		else
+		{
+			index = (uint32_t)entries.size();
+			entries.emplace_back();
+		}
+
+		entries[index].material = materialIndices.emplace(material, index).first;
+		entries[index].referenceCount = 1;
+		pendingIndices.push_back(index);
+		++statistics.materialCount;
+		return index;
+	}
+
+	void MaterialRegistry::release(uint32_t materialIndex)
+	{
+		if (materialIndex >= (uint32_t)entries.size() || entries[materialIndex].referenceCount == 0)
+		{
+			Logger::getInstance().logErrorToConsole("Released material isn't registered!");
+			return;
+		}
+
+		Entry& entry = entries[materialIndex];
+		if (--entry.referenceCount != 0)
+			return;
+
+		materialIndices.erase(entry.material);
+		freeIndices.push_back(materialIndex);
+		--statistics.materialCount;
+	}
+
+	void MaterialRegistry::upload(TextureResidency& textures)
+	{
+		// Materials released since they were created are skipped, their slot was either freed or taken again
+		std::sort(pendingIndices.begin(), pendingIndices.end());
+		pendingIndices.erase(std::unique(pendingIndices.begin(), pendingIndices.end()), pendingIndices.end());
+		statistics.uploadedCount = 0;
+
+		const uint32_t materialCount = (uint32_t)entries.size();
+		materialData.resize(materialCount);
+		for (uint32_t index : pendingIndices)
+		{
+			if (entries[index].referenceCount == 0)
+				continue;
+
+			const Material& material = entries[index].material->first;
+			MaterialData& data = materialData[index];
+			data.color = material.color;
+			data.ambientCoefficient = material.ambientCoefficient;
+			data.diffuseCoefficient = material.diffuseCoefficient;
+			data.specularCoefficient = material.specularCoefficient;
+			data.shininess = material.shininess;
+			data.textures = glm::uvec4(textures.getTextureIndex(material.diffuseMap), textures.getTextureIndex(material.specularMap),
+				textures.getTextureIndex(material.normalMap), 0);
+		}
+
+		const uint32_t capacity = storage.getSize() / sizeof(MaterialData);
+		if (materialCount > capacity)
+		{
+			// Reallocated storage starts empty, so every material is written into it
+			uint32_t newCapacity = glm::max(capacity * 2, MIN_MATERIALS_CAPACITY);
+			while (newCapacity < materialCount)
+				newCapacity *= 2;
+
+			storage.free();
+			storage.load(newCapacity * sizeof(MaterialData), MATERIALS_STORAGE_BINDING, true);
+			storage.updateData(0, materialData.data(), materialCount * sizeof(MaterialData));
+			statistics.uploadedCount = materialCount;
+		}
+		else
+		{
+			for (uint32_t index : pendingIndices)
+			{
+				if (entries[index].referenceCount == 0)
+					continue;
+
+				storage.updateData(index * sizeof(MaterialData), &materialData[index], sizeof(MaterialData));
+				++statistics.uploadedCount;
+			}
+		}
+		pendingIndices.clear();
+
+		if (storage.isLoaded())
+			storage.bind();
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <glm/glm.hpp>
+#include "Cala/Rendering/Texture.h"
+#include "Cala/Rendering/StorageBuffer.h"
+#include "Cala/Rendering/TextureResidency.h"
+
+namespace Cala {
+	/**
+	 * Deduplicated materials mirrored in GPU storage read by shaders compiled with OBJECT_STORAGE
+	 * Objects sharing a material share its entry, which is kept while any of them holds a reference
+	 * and written to storage only when it's created
+	*/
+	class MaterialRegistry {
+	public:
+		struct Material {
+			glm::vec4 color{ 1.f };
+			float ambientCoefficient = 0.f;
+			float diffuseCoefficient = 0.f;
+			float specularCoefficient = 0.f;
+			float shininess = 0.f;
+			const Texture* diffuseMap = nullptr;
+			const Texture* specularMap = nullptr;
+			const Texture* normalMap = nullptr;
+
+			bool operator<(const Material& other) const;
+		};
+
+		struct Statistics {
+			uint32_t materialCount = 0;
+			uint32_t uploadedCount = 0; // Entries written by last upload
+		};
+
+		MaterialRegistry() = default;
+		~MaterialRegistry() = default;
+		MaterialRegistry(const MaterialRegistry& other) = delete;
+		MaterialRegistry& operator=(const MaterialRegistry& other) = delete;
+
+		// Returns index of the material in storage, adding it if no equal one is registered
+		uint32_t acquire(const Material& material);
+		void release(uint32_t materialIndex);
+
+		// Writes materials created since last call and binds the storage, textures are registered with residency on first upload
+		void upload(TextureResidency& textures);
+
+		uint32_t getCount() const { return statistics.materialCount; }
+		const Statistics& getStatistics() const { return statistics; }
+
+	private:
+		// Laid out as MaterialData in Materials.glsl (std430)
+		struct MaterialData {
+			glm::vec4 color;
+			float ambientCoefficient;
+			float diffuseCoefficient;
+			float specularCoefficient;
+			float shininess;
+			glm::uvec4 textures; // Indices of diffuse, specular and normal map
+		};
+
+		struct Entry {
+			std::map<Material, uint32_t>::iterator material;
+			uint32_t referenceCount = 0;
+		};
+
+		std::map<Material, uint32_t> materialIndices;
+		std::vector<Entry> entries;
+		std::vector<uint32_t> freeIndices;
+		std::vector<uint32_t> pendingIndices;
+		std::vector<MaterialData> materialData;
+		StorageBuffer storage;
+		Statistics statistics;
+	};
+}
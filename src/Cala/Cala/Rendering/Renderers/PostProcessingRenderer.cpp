@@ -2,6 +2,15 @@
 #include <algorithm>
 #include "Cala/Utility/Logger.h"
 
+#define MAX_BLOOM_MIPS 6U
+#define MIN_BLOOM_MIP_SIZE 4U
+
+// Has to match TILE_SIZE of the blur compute shader
+#define BLUR_TILE_SIZE 256U
+
+// Has to fit in operationStrengths of EffectValues block, four per element
+#define MAX_FUSED_OPERATIONS 8U
+
 namespace Cala {
 	PostProcessingRenderer::PostProcessingRenderer()
 	{
@@ -10,33 +19,13 @@ namespace Cala {
 		shader.attachShader(Shader::ShaderType::FragmentShader, shadersDir / "PostProcessingFragmentShader.glsl");
 		shader.createProgram();
 
-		Texture::Specification colorTextureSpecification(
-			framebufferTargetsSize.x, framebufferTargetsSize.y, 
-			ITexture::Format::RGBA, Texture::Dimensionality::TwoDimensional
-		);
-
-		for (int i = 0; i < 3; ++i)
-		{
-			Texture* colorTarget = new Texture;
-			colorTarget->load(colorTextureSpecification, nullptr);
-			helperFramebuffers[i].addColorTarget(colorTarget, true);
-
-			if (i == 0)
-			{
-				Texture* depthTarget = new Texture;
-				Texture::Specification depthTextureSpecification(
-					framebufferTargetsSize.x, framebufferTargetsSize.y, 
-					Texture::Format::DEPTH24_STENCIL8, Texture::Dimensionality::TwoDimensional
-				);
-
-				depthTarget->load(depthTextureSpecification, nullptr);
-				helperFramebuffers[i].addDepthTarget(depthTarget, true);
-			}
-
-			helperFramebuffers[i].load();
-		}	
+		const std::filesystem::path blurShaderPath = shadersDir / "PostProcessingBlurComputeShader.glsl";
+		horizontalBlurShader.attachShader(Shader::ShaderType::ComputeShader, blurShaderPath);
+		horizontalBlurShader.createProgram();
+		verticalBlurShader.attachShader(Shader::ShaderType::ComputeShader, blurShaderPath, { "VERTICAL_PASS" });
+		verticalBlurShader.createProgram();
 
-		effectsBuffer.setData(shader.getConstantBufferInfo("EffectValues"), true);
+		effectsBuffer.setSource(shader, "EffectValues", true);
 
 		std::vector<float> renderingQuadVertices = {
 			-1.f, 1.f, 0.f, 1.f,
@@ -53,6 +42,9 @@ namespace Cala {
 		renderingQuad.setDrawingMode(Model::DrawingMode::TriangleStrip);
 
 		effects.reserve(5);
+		frameTimeQuery.load(GPUQuery::Type::TimeElapsed);
+		effectsStartQuery.load(GPUQuery::Type::Timestamp);
+		effectsEndQuery.load(GPUQuery::Type::Timestamp);
 	}
 
 	void PostProcessingRenderer::begin(GraphicsAPI* api)
@@ -63,11 +55,17 @@ namespace Cala {
 			return;
 		}
 
-		// Setup offscreen framebuffer
 		sceneViewport = api->getCurrentViewport();
-		api->activateFramebuffer(&helperFramebuffers[0]);
+		updateTargetsSize(glm::uvec2(sceneViewport.z, sceneViewport.w));
+
+		// Scene framebuffer outlives rendering between begin and render, so it comes from the pool instead of the graph
+		sceneFramebuffer = targetPool.acquire({ targetsSize, ITexture::Format::RGBA, true });
+		api->activateFramebuffer(sceneFramebuffer);
 		api->clearFramebuffer();
-		api->setViewport({ 0, 0, framebufferTargetsSize.x, framebufferTargetsSize.y });
+		api->setViewport({ 0, 0, (int)targetsSize.x, (int)targetsSize.y });
+
+		if (dynamicResolution && !frameTimeQuery.isPending())
+			frameTimeQuery.begin();
 
 		beginCalled = true;
 	}
@@ -80,6 +78,43 @@ namespace Cala {
 			return;
 		}
 
+		const RenderGraph::ResourceHandle scene = frameGraph.importTexture("Scene", sceneFramebuffer->getColorTarget(0));
+		const RenderGraph::ResourceHandle target = frameGraph.importFramebuffer("Target", renderingTarget, sceneViewport);
+		addPasses(frameGraph, scene, target);
+		frameGraph.execute(api);
+		targetPool.endFrame();
+	}
+
+	glm::uvec2 PostProcessingRenderer::beginPasses(RenderGraph& graph, RenderGraph::ResourceHandle renderingTarget)
+	{
+		if (beginCalled)
+		{
+			Logger::getInstance().logErrorToConsole("Begin already called!");
+			return targetsSize;
+		}
+
+		updateTargetsSize(graph.getSize(renderingTarget));
+
+		// Frame time covers scene passes added after this one
+		graph.addPass<int>("PostProcessingBegin",
+			[](RenderGraph::PassBuilder& builder, int&) { builder.setSideEffects(); },
+			[this](const int&, GraphicsAPI*, const RenderGraph::PassResources&) {
+				if (dynamicResolution && !frameTimeQuery.isPending())
+					frameTimeQuery.begin();
+			});
+
+		beginCalled = true;
+		return targetsSize;
+	}
+
+	void PostProcessingRenderer::addPasses(RenderGraph& graph, RenderGraph::ResourceHandle sceneColor, RenderGraph::ResourceHandle renderingTarget)
+	{
+		if (!beginCalled)
+		{
+			Logger::getInstance().logErrorToConsole("Begin not called!");
+			return;
+		}
+
 		using EffectPair = std::pair<PostProcessingEffect, float>;
 
 		auto comparator = [](const EffectPair& p) {
@@ -94,22 +129,100 @@ namespace Cala {
 			effects[0] = tmp;
 		}
 
-		shader.activate();
-		api->disableSetting(GraphicsAPI::DepthTesting);
-		api->setPolygonFillingMode(GraphicsAPI::FrontAndBack, GraphicsAPI::Fill);
+		updateStatistics();
 
-		for (const auto& [effect, value] : effects)
-			applyEffect(api, effect, value);
+		// Plan is made while adding passes, so programs of a new sequence are checked before the graph executes
+		const bool scaled = targetsSize != graph.getSize(renderingTarget);
+		if (fuseEffects)
+			planFusedPasses(scaled);
+
+		if (!fuseEffects || !submitFusedShaders())
+			planSeparatePasses(scaled);
 
 		effects.clear();
-		api->activateFramebuffer(renderingTarget);
-		api->setViewport(sceneViewport);
-		uint32_t effect = Copy;
-		effectsBuffer.updateData("effect", &effect, sizeof(uint32_t));
-		helperFramebuffers[currentFB].getColorTarget(0).setForSampling(0);
-		api->render(renderingQuad);
-		currentFB = 0;
 		beginCalled = false;
+
+		graph.addPass<int>("PostProcessingSetup",
+			[](RenderGraph::PassBuilder& builder, int&) { builder.setSideEffects(); },
+			[this](const int&, GraphicsAPI* api, const RenderGraph::PassResources&) {
+				effectsMeasured = !effectsStartQuery.isPending() && !effectsEndQuery.isPending();
+				if (effectsMeasured)
+					effectsStartQuery.recordTimestamp();
+
+				api->disableSetting(GraphicsAPI::DepthTesting);
+				api->setPolygonFillingMode(GraphicsAPI::FrontAndBack, GraphicsAPI::Fill);
+			});
+
+		struct EffectPass {
+			RenderGraph::ResourceHandle source;
+			RenderGraph::ResourceHandle bloom;
+			RenderGraph::ResourceHandle destination;
+		};
+
+		statistics.passCount = 0;
+		RenderGraph::ResourceHandle current = sceneColor;
+		for (size_t i = 0; i < passPlan.size(); ++i)
+		{
+			const FusedPass& pass = passPlan[i];
+			if (pass.compute)
+			{
+				current = addComputeBlurPasses(graph, current, (PostProcessingEffect)pass.source, pass.sourceStrength);
+				statistics.passCount += 2;
+				continue;
+			}
+
+			// Bloom mips are rendered by the common program, before the composition divides them by their count
+			float sourceStrength = pass.sourceStrength;
+			RenderGraph::ResourceHandle bloom = 0;
+			if (pass.source == Bloom)
+			{
+				uint32_t mipCount = (uint32_t)glm::max(sourceStrength, 1.f);
+				bloom = addBloomPasses(graph, current, mipCount);
+				sourceStrength = (float)mipCount;
+			}
+
+			// Last pass writes the rendering target, ending the measurements
+			const bool last = i + 1 == passPlan.size();
+			current = graph.addPass<EffectPass>("PostProcessingEffect",
+				[&](RenderGraph::PassBuilder& builder, EffectPass& data) {
+					data.source = current;
+					data.bloom = bloom;
+					data.destination = last ? renderingTarget : builder.createTexture("EffectColor", { targetsSize, ITexture::Format::RGBA });
+					builder.read(data.source);
+					if (pass.source == Bloom)
+						builder.read(data.bloom);
+
+					builder.writeColor(data.destination);
+				},
+				[this, pass, sourceStrength, last](const EffectPass& data, GraphicsAPI* api, const RenderGraph::PassResources& resources) {
+					const Shader& program = pass.operations.empty() ? shader : getFusedShader(pass);
+					program.activate();
+
+					glm::vec4 operationStrengths[MAX_FUSED_OPERATIONS / 4]{};
+					for (size_t j = 0; j < pass.operations.size(); ++j)
+						operationStrengths[j / 4][j % 4] = pass.operations[j].second;
+
+					effectsBuffer.updateData("effect", &pass.source, sizeof(uint32_t));
+					effectsBuffer.updateData("effectStrength", &sourceStrength, sizeof(float));
+					effectsBuffer.updateData("operationStrengths[0]", operationStrengths, sizeof(operationStrengths));
+
+					resources.getTexture(data.source).setForSampling(0);
+					if (pass.source == Bloom)
+						resources.getTexture(data.bloom).setForSampling(1);
+
+					api->render(renderingQuad);
+					if (!last)
+						return;
+
+					if (effectsMeasured)
+						effectsEndQuery.recordTimestamp();
+
+					if (frameTimeQuery.isActive())
+						frameTimeQuery.end();
+				}).destination;
+
+			++statistics.passCount;
+		}
 	}
 
     void PostProcessingRenderer::pushEffect(PostProcessingEffect effect, float effectValue)
@@ -117,65 +230,259 @@ namespace Cala {
 		effects.emplace_back(effect, effectValue);
     }
 
-    void PostProcessingRenderer::applyEffect(GraphicsAPI *const api, PostProcessingEffect effect, float effectValue)
-    {
-		const Framebuffer& fb0 = helperFramebuffers[0];
-		const Framebuffer& fb1 = helperFramebuffers[1];
-		const Framebuffer& fb2 = helperFramebuffers[2];
+	bool PostProcessingRenderer::isPerPixelEffect(PostProcessingEffect effect)
+	{
+		return effect == PostProcessingEffect::HDR || effect == PostProcessingEffect::Negative;
+	}
 
-		switch (currentFB)
+	void PostProcessingRenderer::planFusedPasses(bool scaled)
+	{
+		// First pass starts as a plain copy of the scene, it's dropped if nothing is fused into it
+		passPlan.clear();
+		passPlan.emplace_back();
+		for (const auto& [effect, value] : effects)
 		{
-			case 0:
-				if (effect == PostProcessingEffect::Bloom)
-					applyBloom(api, (int)effectValue);
+			FusedPass& current = passPlan.back();
+			const bool perPixel = isPerPixelEffect(effect);
+			if (perPixel && !current.compute && current.operations.size() < MAX_FUSED_OPERATIONS)
+			{
+				current.operations.emplace_back(effect, value);
+				continue;
+			}
 
-				api->activateFramebuffer(&fb1);
-				fb0.getColorTarget(0).setForSampling(0);
-				currentFB = 1;
-				break;
-			case 1:
-				api->activateFramebuffer(&fb0);
-				fb1.getColorTarget(0).setForSampling(0);
-				currentFB = 0;
-				break;
-			case 2:
-				api->activateFramebuffer(&fb0);
-				fb2.getColorTarget(0).setForSampling(0);
-				currentFB = 0;
-				break;
+			FusedPass next;
+			next.source = perPixel ? (uint32_t)Copy : (uint32_t)effect;
+			next.sourceStrength = value;
+			next.compute = computeBlur && (effect == PostProcessingEffect::BoxBlur || effect == PostProcessingEffect::GaussianBlur);
+			if (perPixel)
+				next.operations.emplace_back(effect, value);
+
+			if (current.source == Copy && current.operations.empty())
+				current = std::move(next);
+			else
+				passPlan.push_back(std::move(next));
 		}
 
-		effectsBuffer.updateData("effect", (int*)&effect, sizeof(int));
-		effectsBuffer.updateData("effectStrength", &effectValue, sizeof(float));
-		api->render(renderingQuad);
+		// Last pass writes the rendering target, only copy can be replaced by upscaling when sizes differ
+		const FusedPass& last = passPlan.back();
+		if (last.compute || (scaled && last.source != Copy))
+			passPlan.emplace_back();
+
+		if (scaled)
+			passPlan.back().source = Upscale;
 	}
 
-	void PostProcessingRenderer::applyBloom(GraphicsAPI* const api, int bloomIntensity)
+	void PostProcessingRenderer::planSeparatePasses(bool scaled)
 	{
-		const Framebuffer& fb1 = helperFramebuffers[1];
-		const Framebuffer& fb2 = helperFramebuffers[2];
+		passPlan.clear();
+		for (const auto& [effect, value] : effects)
+		{
+			FusedPass& pass = passPlan.emplace_back();
+			pass.source = effect;
+			pass.sourceStrength = value;
+			pass.compute = computeBlur && (effect == PostProcessingEffect::BoxBlur || effect == PostProcessingEffect::GaussianBlur);
+		}
+
+		passPlan.emplace_back();
+		if (scaled)
+			passPlan.back().source = Upscale;
+	}
+
+	bool PostProcessingRenderer::submitFusedShaders()
+	{
+		// All missing programs are submitted before any is checked, so the driver can compile them in parallel
+		for (const FusedPass& pass : passPlan)
+		{
+			if (!pass.operations.empty())
+				getFusedShader(pass);
+		}
+
+		for (const FusedPass& pass : passPlan)
+		{
+			if (!pass.operations.empty() && !getFusedShader(pass).isReady())
+				return false;
+		}
+
+		return true;
+	}
+
+	Shader& PostProcessingRenderer::getFusedShader(const FusedPass& pass)
+	{
+		uint64_t key = pass.source;
+		for (size_t i = 0; i < pass.operations.size(); ++i)
+			key |= (uint64_t)(pass.operations[i].first + 1) << (4 * (i + 1));
+
+		auto it = fusedShaders.find(key);
+		if (it != fusedShaders.end())
+			return it->second;
+
+		// Operations are generated as statements modifying color of the source effect
+		std::string operationsCode;
+		for (size_t i = 0; i < pass.operations.size(); ++i)
+		{
+			const std::string strength = "operationStrengths[" + std::to_string(i / 4) + "]." + "xyzw"[i % 4];
+			if (pass.operations[i].first == PostProcessingEffect::HDR)
+				operationsCode += "color = hdr(color, " + strength + "); ";
+			else
+				operationsCode += "color = negative(color); ";
+		}
+
+		std::filesystem::path shadersDir(SHADERS_DIR);
+		Shader& fusedShader = fusedShaders[key];
+		fusedShader.attachShader(Shader::ShaderType::VertexShader, shadersDir / "PostProcessingVertexShader.glsl");
+		fusedShader.attachShader(Shader::ShaderType::FragmentShader, shadersDir / "PostProcessingFragmentShader.glsl",
+			{ "FUSED_PASS", "FUSED_SOURCE " + std::to_string(pass.source), "APPLY_OPERATIONS " + operationsCode });
+		fusedShader.createProgram();
+		statistics.fusedProgramCount = (uint32_t)fusedShaders.size();
+		return fusedShader;
+	}
+
+	RenderGraph::ResourceHandle PostProcessingRenderer::addBloomPasses(RenderGraph& graph, RenderGraph::ResourceHandle source, uint32_t& mipCount)
+	{
+		// Each mip halves the previous one, chain ends before mips get smaller than a few texels
+		std::vector<glm::uvec2> mipSizes;
+		glm::uvec2 mipSize = targetsSize;
+		for (uint32_t i = 0; i < glm::min(mipCount, MAX_BLOOM_MIPS); ++i)
+		{
+			mipSize /= 2U;
+			if (mipSize.x < MIN_BLOOM_MIP_SIZE || mipSize.y < MIN_BLOOM_MIP_SIZE)
+				break;
+
+			mipSizes.push_back(mipSize);
+		}
+
+		if (mipSizes.empty())
+			mipSizes.push_back(glm::max(targetsSize / 2U, glm::uvec2(1U)));
 
-		api->activateFramebuffer(&fb2);
-		helperFramebuffers[currentFB].getColorTarget(0).setForSampling(0);
+		struct MipPass {
+			RenderGraph::ResourceHandle source;
+			RenderGraph::ResourceHandle destination;
+		};
+
+		// First downsample also keeps only the bright parts of the scene
+		std::vector<RenderGraph::ResourceHandle> mips;
+		RenderGraph::ResourceHandle previous = source;
 		uint32_t effect = HelperPostProcessingEffect::Extract;
+		for (const glm::uvec2& size : mipSizes)
+		{
+			previous = graph.addPass<MipPass>("BloomDownsample",
+				[&](RenderGraph::PassBuilder& builder, MipPass& data) {
+					data.source = previous;
+					data.destination = builder.createTexture("BloomMip", { size, ITexture::Format::HALF_RGBA });
+					builder.read(data.source);
+					builder.writeColor(data.destination);
+				},
+				[this, effect](const MipPass& data, GraphicsAPI* api, const RenderGraph::PassResources& resources) {
+					renderBloomMip(api, resources.getTexture(data.source), effect);
+				}).destination;
+
+			mips.push_back(previous);
+			effect = HelperPostProcessingEffect::Downsample;
+		}
+
+		// Upsampled smaller mips are added on top of the larger ones, widening the bloom with each level
+		for (size_t i = mips.size() - 1; i > 0; --i)
+		{
+			graph.addPass<MipPass>("BloomUpsample",
+				[&](RenderGraph::PassBuilder& builder, MipPass& data) {
+					data.source = mips[i];
+					data.destination = mips[i - 1];
+					builder.read(data.source);
+					builder.writeColor(data.destination);
+				},
+				[this](const MipPass& data, GraphicsAPI* api, const RenderGraph::PassResources& resources) {
+					api->enableSetting(GraphicsAPI::Blending);
+					api->setBlendingFunction(GraphicsAPI::One, GraphicsAPI::One);
+					renderBloomMip(api, resources.getTexture(data.source), HelperPostProcessingEffect::Upsample);
+					api->setBlendingFunction(GraphicsAPI::One, GraphicsAPI::Zero);
+					api->disableSetting(GraphicsAPI::Blending);
+				});
+		}
+
+		mipCount = (uint32_t)mips.size();
+		return mips[0];
+	}
+
+	RenderGraph::ResourceHandle PostProcessingRenderer::addComputeBlurPasses(RenderGraph& graph, RenderGraph::ResourceHandle source, 
+		PostProcessingEffect effect, float effectValue)
+	{
+		struct BlurPass {
+			RenderGraph::ResourceHandle source;
+			RenderGraph::ResourceHandle destination;
+		};
+
+		// Each workgroup blurs a segment of one row, then of one column
+		const glm::uvec2 size = targetsSize;
+		const RenderGraph::ResourceHandle intermediate = graph.addPass<BlurPass>("HorizontalBlur",
+			[&](RenderGraph::PassBuilder& builder, BlurPass& data) {
+				data.source = source;
+				data.destination = builder.createTexture("BlurIntermediate", { size, ITexture::Format::RGBA });
+				builder.read(data.source);
+				builder.modify(data.destination);
+			},
+			[this, effect, effectValue, size](const BlurPass& data, GraphicsAPI* api, const RenderGraph::PassResources& resources) {
+				effectsBuffer.updateData("effect", (int*)&effect, sizeof(int));
+				effectsBuffer.updateData("effectStrength", &effectValue, sizeof(float));
+
+				horizontalBlurShader.activate();
+				resources.getTexture(data.source).setForSampling(0);
+				resources.getTexture(data.destination).setForImageAccess(0, ITexture::ImageAccess::WriteOnly);
+				horizontalBlurShader.dispatchComputeShader((size.x + BLUR_TILE_SIZE - 1) / BLUR_TILE_SIZE, size.y);
+				api->imageWriteBarrier();
+			}).destination;
+
+		return graph.addPass<BlurPass>("VerticalBlur",
+			[&](RenderGraph::PassBuilder& builder, BlurPass& data) {
+				data.source = intermediate;
+				data.destination = builder.createTexture("BlurColor", { size, ITexture::Format::RGBA });
+				builder.read(data.source);
+				builder.modify(data.destination);
+			},
+			[this, size](const BlurPass& data, GraphicsAPI* api, const RenderGraph::PassResources& resources) {
+				verticalBlurShader.activate();
+				resources.getTexture(data.source).setForSampling(0);
+				resources.getTexture(data.destination).setForImageAccess(0, ITexture::ImageAccess::WriteOnly);
+				verticalBlurShader.dispatchComputeShader((size.y + BLUR_TILE_SIZE - 1) / BLUR_TILE_SIZE, size.x);
+				api->imageWriteBarrier();
+			}).destination;
+	}
+
+	void PostProcessingRenderer::renderBloomMip(GraphicsAPI* const api, const ITexture& source, uint32_t effect)
+	{
+		shader.activate();
+		source.setForSampling(0);
 		effectsBuffer.updateData("effect", &effect, sizeof(uint32_t));
 		api->render(renderingQuad);
+	}
+
+	void PostProcessingRenderer::updateTargetsSize(const glm::uvec2& viewportSize)
+	{
+		if (dynamicResolution)
+			updateResolutionScale();
+
+		const glm::vec2 scaledSize = glm::round(glm::vec2(viewportSize) * resolutionScale);
+		targetsSize = glm::max(glm::uvec2(scaledSize), glm::uvec2(1U));
+	}
+
+	void PostProcessingRenderer::updateStatistics()
+	{
+		if (!effectsEndQuery.isResultAvailable())
+			return;
 
-		for (int i = 0; i < bloomIntensity; ++i)
+		const uint64_t end = effectsEndQuery.getResult();
+		const uint64_t start = effectsStartQuery.getResult();
+		statistics.effectsTime = (float)(end - start) / 1000000.f;
+	}
+
+	void PostProcessingRenderer::updateResolutionScale()
+	{
+		// Query result arrives a few frames late, scale is kept until then
+		if (frameTimeQuery.isPending() && frameTimeQuery.isResultAvailable())
 		{
-			api->activateFramebuffer(&fb1);
-			fb2.getColorTarget(0).setForSampling(0);
-			effect = HelperPostProcessingEffect::HorizontalGaussianBlur;
-			effectsBuffer.updateData("effect", &effect, sizeof(uint32_t));
-			api->render(renderingQuad);
-
-			api->activateFramebuffer(&fb2);
-			fb1.getColorTarget(0).setForSampling(0);
-			effect = HelperPostProcessingEffect::VerticalGaussianBlur;
-			effectsBuffer.updateData("effect", &effect, sizeof(uint32_t));
-			api->render(renderingQuad);
+			const float frameTime = (float)frameTimeQuery.getResult() / 1000000.f;
+			resolutionScale = resolutionController.update(frameTime);
 		}
-
-	fb2.getColorTarget(0).setForSampling(1);
+		else
+			resolutionScale = resolutionController.getScale();
 	}
 }
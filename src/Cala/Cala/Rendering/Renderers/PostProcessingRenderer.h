@@ -1,18 +1,51 @@
 #pragma once
+#include <unordered_map>
 #include "IRenderer.h"
 #include "Cala/Rendering/Framebuffer.h"
 #include "Cala/Rendering/GraphicsAPI.h"
 #include "Cala/Rendering/Shader.h"
 #include "Cala/Rendering/ConstantBuffer.h"
+#include "Cala/Rendering/GPUQuery.h"
+#include "Cala/Rendering/RenderTargetPool.h"
+#include "Cala/Rendering/RenderGraph.h"
+#include "Cala/Rendering/DynamicResolution.h"
 
 namespace Cala {
+	/**
+	 * Scene is rendered to targets of the viewport size times resolution scale, and upscaled in the final pass
+	 * With dynamic resolution, scale is adjusted from GPU time measured from the beginning to the final pass
+	 * Effect targets and bloom mips are transient textures of a render graph, so their memory is shared with passes
+	 * of other renderers added to the same graph
+	 * Box and Gaussian blurs can run as separable compute passes, which fetch each texel once per workgroup
+	 * Per pixel effects are fused into the preceding pass through programs generated for the exact effect sequence
+	*/
 	class PostProcessingRenderer : IRenderer {
 	public:
 		PostProcessingRenderer();
 		~PostProcessingRenderer() = default;
+		// Scene is rendered between begin and render into getRenderingTarget, effects then run through a graph of the renderer
 		void begin(GraphicsAPI* api);
         void render(GraphicsAPI *api, const Framebuffer *renderingTarget);
-		const Framebuffer* getRenderingTarget() const { return &helperFramebuffers[0]; }
+		/**
+		 * Called before scene passes are added, returns size of scene color they have to render for the rendering target
+		 * Effect passes are then added reading scene color and writing the rendering target
+		*/
+		glm::uvec2 beginPasses(RenderGraph& graph, RenderGraph::ResourceHandle renderingTarget);
+		void addPasses(RenderGraph& graph, RenderGraph::ResourceHandle sceneColor, RenderGraph::ResourceHandle renderingTarget);
+		const Framebuffer* getRenderingTarget() const { return sceneFramebuffer; }
+		glm::uvec2 getRenderingTargetSize() const { return targetsSize; }
+		DynamicResolution& getDynamicResolution() { return resolutionController; }
+		// Scene framebuffer of begin and render
+		const RenderTargetPool::Statistics& getTargetStatistics() const { return targetPool.getStatistics(); }
+		const RenderGraph::Statistics& getGraphStatistics() const { return frameGraph.getStatistics(); }
+
+		struct Statistics {
+			float effectsTime = 0.f; // GPU time of effects and final pass in milliseconds, a few frames old
+			uint32_t passCount = 0; // Full screen passes of effects and final pass, bloom mips excluded
+			uint32_t fusedProgramCount = 0;
+		};
+
+		const Statistics& getStatistics() const { return statistics; }
 
         enum PostProcessingEffect {
 			Bloom = 0,
@@ -23,27 +56,71 @@ namespace Cala {
 			Negative = 5
 		};
 
+		// Bloom value is the number of mip levels spreading the bloom, up to 6
 		void pushEffect(PostProcessingEffect effect, float effectValue);
+		// Without effects the scene can be rendered straight into the rendering target instead
+		bool hasEffects() const { return !effects.empty(); }
+
+		// Ignored with dynamic resolution, which overwrites it
+		float resolutionScale = 1.f;
+		bool dynamicResolution = false;
+		bool computeBlur = false;
+		// Effects run as separate passes while programs of a new sequence are compiling
+		bool fuseEffects = true;
 
 	private:
 		enum HelperPostProcessingEffect {
-			HorizontalGaussianBlur = 6,
-			VerticalGaussianBlur = 7,
+			Downsample = 6,
+			Upsample = 7,
 			Extract = 8,
-			Copy = 9
+			Copy = 9,
+			Upscale = 10
 		};
 
-		void applyEffect(GraphicsAPI* const api, PostProcessingEffect effect, float effectValue);
-		void applyBloom(GraphicsAPI* const api, int bloomValue);
+		// Effect reading only the pixel it writes, or effect reading its neighbourhood first and then applying them
+		struct FusedPass {
+			uint32_t source = Copy;
+			float sourceStrength = 0.f;
+			std::vector<std::pair<PostProcessingEffect, float>> operations;
+			bool compute = false;
+		};
+
+		static bool isPerPixelEffect(PostProcessingEffect effect);
+		void planFusedPasses(bool scaled);
+		// Each effect in a pass of its own, used while fused programs are compiling
+		void planSeparatePasses(bool scaled);
+		// Returns false if some fused program of the plan isn't ready yet
+		bool submitFusedShaders();
+		Shader& getFusedShader(const FusedPass& pass);
+		// Returns first mip of the bloom chain, mip count is replaced by the number of mips in the chain
+		RenderGraph::ResourceHandle addBloomPasses(RenderGraph& graph, RenderGraph::ResourceHandle source, uint32_t& mipCount);
+		// Returns blurred copy of the source
+		RenderGraph::ResourceHandle addComputeBlurPasses(RenderGraph& graph, RenderGraph::ResourceHandle source, PostProcessingEffect effect, float effectValue);
+		void renderBloomMip(GraphicsAPI* const api, const ITexture& source, uint32_t effect);
+		void updateTargetsSize(const glm::uvec2& viewportSize);
+		void updateStatistics();
 
 		std::vector<std::pair<PostProcessingEffect, float>> effects;
 		bool beginCalled = false;
-		Framebuffer helperFramebuffers[3];
+		void updateResolutionScale();
+
+		RenderTargetPool targetPool;
+		const Framebuffer* sceneFramebuffer = nullptr;
+		RenderGraph frameGraph;
 		Mesh renderingQuad;
-		uint8_t currentFB = 0;
 		Shader shader;
+		Shader horizontalBlurShader;
+		Shader verticalBlurShader;
+		std::unordered_map<uint64_t, Shader> fusedShaders;
+		std::vector<FusedPass> passPlan;
 		ConstantBuffer effectsBuffer;
 		glm::uvec4 sceneViewport;
-		const glm::uvec2 framebufferTargetsSize{ 1920, 1080 };
+		glm::uvec2 targetsSize{ 1U };
+		DynamicResolution resolutionController;
+		GPUQuery frameTimeQuery;
+		GPUQuery effectsStartQuery;
+		GPUQuery effectsEndQuery;
+		bool effectsMeasured = false;
+		Statistics statistics;
 	};
 }
\ No newline at end of file
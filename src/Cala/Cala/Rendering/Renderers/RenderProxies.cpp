@@ -0,0 +1,256 @@
+#include "RenderProxies.h"
+#include <algorithm>
+#include "Cala/Utility/Logger.h"
+
+#define OBJECTS_STORAGE_BINDING 0
+#define DRAW_ORDER_STORAGE_BINDING 1
+
+// Storage is allocated for at least this many objects and grows by doubling
+#define MIN_OBJECTS_CAPACITY 64U
+
+#define INVALID_INDEX 0xFFFFFFFFU
+
+namespace Cala {
+	RenderProxies::Handle RenderProxies::add(const Renderable& renderable)
+	{
+		Handle handle;
+		if (!freeHandles.empty())
+		{
+			handle = freeHandles.back();
+			freeHandles.pop_back();
+		}
+		else
+		{
+			handle = (Handle)handleIndices.size();
+			handleIndices.push_back(INVALID_INDEX);
+		}
+
+		const uint32_t index = (uint32_t)objects.size();
+		objects.emplace_back(renderable);
+		objectMaterials.push_back(materials.acquire(getMaterial(renderable)));
+		objectHandles.push_back(handle);
+		changeFlags.push_back(0);
+		handleIndices[handle] = index;
+		markChanged(index);
+		return handle;
+	}
+
+	void RenderProxies::update(Handle handle, const Renderable& renderable)
+	{
+		if (!contains(handle))
+		{
+			Logger::getInstance().logErrorToConsole("Updated renderable isn't registered!");
+			return;
+		}
+
+		// New material is acquired first, so an unchanged one keeps its entry
+		const uint32_t index = handleIndices[handle];
+		const uint32_t materialIndex = materials.acquire(getMaterial(renderable));
+		materials.release(objectMaterials[index]);
+		objectMaterials[index] = materialIndex;
+		objects[index].emplace(renderable);
+		markChanged(index);
+	}
+
+	void RenderProxies::setTransformation(Handle handle, const Transformation& transformation)
+	{
+		if (!contains(handle))
+		{
+			Logger::getInstance().logErrorToConsole("Moved renderable isn't registered!");
+			return;
+		}
+
+		const uint32_t index = handleIndices[handle];
+		objects[index]->transformation = transformation;
+		markChanged(index);
+	}
+
+	void RenderProxies::remove(Handle handle)
+	{
+		if (!contains(handle))
+		{
+			Logger::getInstance().logErrorToConsole("Removed renderable isn't registered!");
+			return;
+		}
+
+		// Last object fills the gap, so storage stays dense and only the moved object is uploaded again
+		const uint32_t index = handleIndices[handle];
+		const uint32_t lastIndex = (uint32_t)objects.size() - 1;
+		materials.release(objectMaterials[index]);
+		if (index != lastIndex)
+		{
+			objects[index].emplace(*objects[lastIndex]);
+			objectMaterials[index] = objectMaterials[lastIndex];
+			objectHandles[index] = objectHandles[lastIndex];
+			handleIndices[objectHandles[index]] = index;
+			markChanged(index);
+		}
+
+		objects.pop_back();
+		objectMaterials.pop_back();
+		objectHandles.pop_back();
+		changeFlags.pop_back();
+		handleIndices[handle] = INVALID_INDEX;
+		freeHandles.push_back(handle);
+	}
+
+	bool RenderProxies::contains(Handle handle) const
+	{
+		return handle < handleIndices.size() && handleIndices[handle] != INVALID_INDEX;
+	}
+
+	void RenderProxies::pushTransient(const Renderable& renderable)
+	{
+		transients.push_back(renderable);
+		transientMaterials.push_back(materials.acquire(getMaterial(renderable)));
+	}
+
+	void RenderProxies::upload()
+	{
+		const uint32_t registeredCount = (uint32_t)objects.size();
+		const uint32_t objectCount = getCount();
+		statistics = Statistics();
+		statistics.registeredCount = registeredCount;
+		statistics.transientCount = (uint32_t)transients.size();
+
+		// Objects removed since they were marked are skipped, their slot was either dropped or marked again
+		std::sort(pendingIndices.begin(), pendingIndices.end());
+		pendingIndices.erase(std::unique(pendingIndices.begin(), pendingIndices.end()), pendingIndices.end());
+		changedIndices.clear();
+		for (uint32_t index : pendingIndices)
+		{
+			if (index >= registeredCount)
+				continue;
+
+			changeFlags[index] = 0;
+			changedIndices.push_back(index);
+		}
+		pendingIndices.clear();
+
+		for (uint32_t index = registeredCount; index < objectCount; ++index)
+			changedIndices.push_back(index);
+
+		statistics.changedCount = (uint32_t)changedIndices.size();
+		objectData.resize(objectCount);
+		for (uint32_t index : changedIndices)
+		{
+			const uint32_t materialIndex = index < registeredCount ? objectMaterials[index] : transientMaterials[index - registeredCount];
+			objectData[index] = createObjectData(get(index), materialIndex);
+		}
+
+		const uint32_t capacity = storage.getSize() / sizeof(ObjectData);
+		if (objectCount > capacity)
+		{
+			// Reallocated storage starts empty, so every object is uploaded into it
+			uint32_t newCapacity = glm::max(capacity * 2, MIN_OBJECTS_CAPACITY);
+			while (newCapacity < objectCount)
+				newCapacity *= 2;
+
+			storage.free();
+			storage.load(newCapacity * sizeof(ObjectData), OBJECTS_STORAGE_BINDING, true);
+			uploadRange(0, objectCount);
+		}
+		else
+		{
+			// Changed indices are sorted, so consecutive objects are uploaded with a single call
+			uint32_t rangeBegin = 0;
+			for (uint32_t i = 1; i <= (uint32_t)changedIndices.size(); ++i)
+			{
+				if (i < (uint32_t)changedIndices.size() && changedIndices[i] == changedIndices[i - 1] + 1)
+					continue;
+
+				uploadRange(changedIndices[rangeBegin], changedIndices[i - 1] + 1);
+				rangeBegin = i;
+			}
+		}
+
+		if (storage.isLoaded())
+			storage.bind();
+
+		// Materials register their textures, so table of textures is uploaded after them
+		materials.upload(textures);
+		textures.upload();
+	}
+
+	void RenderProxies::uploadDrawOrder(const std::vector<uint32_t>& objectIndices)
+	{
+		const uint32_t capacity = drawOrder.getSize() / sizeof(uint32_t);
+		if ((uint32_t)objectIndices.size() > capacity)
+		{
+			uint32_t newCapacity = glm::max(capacity * 2, MIN_OBJECTS_CAPACITY);
+			while (newCapacity < (uint32_t)objectIndices.size())
+				newCapacity *= 2;
+
+			drawOrder.free();
+			drawOrder.load(newCapacity * sizeof(uint32_t), DRAW_ORDER_STORAGE_BINDING, true);
+		}
+
+		if (!objectIndices.empty())
+			drawOrder.updateData(0, objectIndices.data(), (uint32_t)(objectIndices.size() * sizeof(uint32_t)));
+
+		if (drawOrder.isLoaded())
+			drawOrder.bind();
+	}
+
+	void RenderProxies::clearTransient()
+	{
+		for (uint32_t materialIndex : transientMaterials)
+			materials.release(materialIndex);
+
+		transients.clear();
+		transientMaterials.clear();
+	}
+
+	const RenderProxies::Renderable& RenderProxies::get(uint32_t index) const
+	{
+		if (index < (uint32_t)objects.size())
+			return *objects[index];
+
+		return transients[index - (uint32_t)objects.size()];
+	}
+
+	void RenderProxies::markChanged(uint32_t index)
+	{
+		if (changeFlags[index] != 0)
+			return;
+
+		changeFlags[index] = 1;
+		pendingIndices.push_back(index);
+	}
+
+	void RenderProxies::uploadRange(uint32_t begin, uint32_t end)
+	{
+		if (begin >= end)
+			return;
+
+		storage.updateData(begin * sizeof(ObjectData), &objectData[begin], (end - begin) * sizeof(ObjectData));
+		statistics.uploadedCount += end - begin;
+		++statistics.uploadCallCount;
+	}
+
+	RenderProxies::ObjectData RenderProxies::createObjectData(const Renderable& renderable, uint32_t materialIndex)
+	{
+		const glm::mat4& model = renderable.transformation.getTransformMatrix();
+
+		// Normal matrix is computed once per change instead of once per vertex
+		ObjectData data{};
+		data.model = model;
+		data.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+		data.materialIndex = materialIndex;
+		return data;
+	}
+
+	MaterialRegistry::Material RenderProxies::getMaterial(const Renderable& renderable)
+	{
+		MaterialRegistry::Material material;
+		material.color = renderable.color;
+		material.ambientCoefficient = renderable.ambientCoefficient;
+		material.diffuseCoefficient = renderable.diffuseCoefficient;
+		material.specularCoefficient = renderable.specularCoefficient;
+		material.shininess = renderable.shininess;
+		material.diffuseMap = renderable.diffuseMap;
+		material.specularMap = renderable.specularMap;
+		material.normalMap = renderable.normalMap;
+		return material;
+	}
+}
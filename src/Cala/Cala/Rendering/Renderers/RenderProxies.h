@@ -0,0 +1,96 @@
+#pragma once
+#include <vector>
+#include <optional>
+#include "LightRenderer.h"
+#include "Cala/Rendering/StorageBuffer.h"
+#include "Cala/Rendering/TextureResidency.h"
+#include "MaterialRegistry.h"
+
+namespace Cala {
+	/**
+	 * Renderables kept between frames, mirrored in GPU storage read by shaders compiled with OBJECT_STORAGE
+	 * Registered objects are packed densely and only marked when they change,
+	 * so upload cost of a frame follows number of changes instead of number of objects
+	 * Transient renderables live for a single frame and are stored after registered ones
+	 * Materials are deduplicated in their own storage and textures are referenced by index,
+	 * so objects differing only in materials can share an instanced draw
+	*/
+	class RenderProxies {
+	public:
+		using Renderable = LightRenderer::Renderable;
+		using Handle = LightRenderer::RenderableHandle;
+
+		struct Statistics {
+			uint32_t registeredCount = 0;
+			uint32_t transientCount = 0;
+			uint32_t changedCount = 0;
+			uint32_t uploadedCount = 0;
+			uint32_t uploadCallCount = 0;
+		};
+
+		RenderProxies() = default;
+		~RenderProxies() = default;
+		RenderProxies(const RenderProxies& other) = delete;
+		RenderProxies& operator=(const RenderProxies& other) = delete;
+
+		Handle add(const Renderable& renderable);
+		void update(Handle handle, const Renderable& renderable);
+		void setTransformation(Handle handle, const Transformation& transformation);
+		void remove(Handle handle);
+		bool contains(Handle handle) const;
+		void pushTransient(const Renderable& renderable);
+
+		// Uploads objects changed since last call together with transient ones and binds the storage
+		void upload();
+		// Drops transient renderables once they were rendered
+		void clearTransient();
+
+		/**
+		 * Uploads object indices in order of drawing and binds them, instance i of a draw
+		 * starting at position p of the list reads object stored at position p + i
+		*/
+		void uploadDrawOrder(const std::vector<uint32_t>& objectIndices);
+
+		// Registered objects come first, indices match positions in GPU storage
+		uint32_t getCount() const { return (uint32_t)(objects.size() + transients.size()); }
+		const Renderable& get(uint32_t index) const;
+		// Objects which were added, changed or moved by last upload, transient ones included
+		const std::vector<uint32_t>& getChangedIndices() const { return changedIndices; }
+		const Statistics& getStatistics() const { return statistics; }
+		TextureResidency& getTextureResidency() { return textures; }
+		const TextureResidency& getTextureResidency() const { return textures; }
+		const MaterialRegistry& getMaterials() const { return materials; }
+
+	private:
+		// Laid out as ObjectData in Objects.glsl (std430)
+		struct ObjectData {
+			glm::mat4 model;
+			glm::mat4 normalMatrix;
+			uint32_t materialIndex;
+			uint32_t padding[3];
+		};
+
+		void markChanged(uint32_t index);
+		void uploadRange(uint32_t begin, uint32_t end);
+		static ObjectData createObjectData(const Renderable& renderable, uint32_t materialIndex);
+		static MaterialRegistry::Material getMaterial(const Renderable& renderable);
+
+		std::vector<std::optional<Renderable>> objects;
+		std::vector<Renderable> transients;
+		// Material of each registered and transient object, in the same order
+		std::vector<uint32_t> objectMaterials;
+		std::vector<uint32_t> transientMaterials;
+		std::vector<Handle> objectHandles;
+		std::vector<uint32_t> handleIndices;
+		std::vector<Handle> freeHandles;
+		std::vector<uint8_t> changeFlags;
+		std::vector<uint32_t> pendingIndices;
+		std::vector<uint32_t> changedIndices;
+		std::vector<ObjectData> objectData;
+		StorageBuffer storage;
+		StorageBuffer drawOrder;
+		TextureResidency textures;
+		MaterialRegistry materials;
+		Statistics statistics;
+	};
+}
@@ -0,0 +1,384 @@
+#include "ShadowMapRenderer.h"
+#include <algorithm>
+#include <numeric>
+#include "Cala/Utility/Logger.h"
+
+#define SIGNATURE_SEED 14695981039346656037ULL
+#define SIGNATURE_PRIME 1099511628211ULL
+
+// Smallest tile, also the cell in which tiles are placed within the atlas
+#define MIN_SHADOW_TILE_SIZE 128U
+#define MAX_SHADOW_ATLAS_SIZE 8192U
+
+// Frames the atlas has to stay larger than needed before it's shrunk, so lights coming and going don't reallocate it
+#define ATLAS_SHRINK_DELAY 60
+
+namespace Cala {
+	ShadowMapRenderer::ShadowMapRenderer(uint32_t _maxTileSize)
+	{
+		std::filesystem::path shadersDir(SHADERS_DIR);
+		shader.attachShader(Shader::ShaderType::VertexShader, shadersDir / "ShadowPassVertexShader.glsl");
+		shader.attachShader(Shader::ShaderType::FragmentShader, shadersDir / "ShadowPassFragmentShader.glsl");
+		shader.createProgram();
+
+		maxTileSize = MIN_SHADOW_TILE_SIZE;
+		while (maxTileSize * 2 <= _maxTileSize && maxTileSize * 2 <= MAX_SHADOW_ATLAS_SIZE)
+			maxTileSize *= 2;
+
+		// Atlas starts with room for a single full size tile and is fitted to pushed layers on render
+		resizeAtlas(maxTileSize);
+
+		layersBuffer.setSource(shader, "ShadowLayers", true);
+		layerMatrices.reserve(MAX_SHADOW_MAP_LAYERS);
+		layerImportances.reserve(MAX_SHADOW_MAP_LAYERS);
+		layerCaches.resize(MAX_SHADOW_MAP_LAYERS);
+	}
+
+	uint32_t ShadowMapRenderer::pushLayer(const glm::mat4& lightViewProjection, float importance)
+	{
+		if (layerMatrices.size() == MAX_SHADOW_MAP_LAYERS)
+		{
+			Logger::getInstance().logErrorToConsole("Shadow map layers limit reached!");
+			return MAX_SHADOW_MAP_LAYERS - 1;
+		}
+
+		layerMatrices.push_back(lightViewProjection);
+		layerImportances.push_back(importance);
+		return (uint32_t)layerMatrices.size() - 1;
+	}
+
+	void ShadowMapRenderer::pushCaster(const Mesh& mesh, const glm::mat4& transform, bool isStatic)
+	{
+		casters.push_back({ &mesh, &transform, isStatic });
+	}
+
+	void ShadowMapRenderer::render(GraphicsAPI* const api)
+	{
+		const uint32_t layerCount = getLayerCount();
+		const uint32_t casterCount = (uint32_t)casters.size();
+		statistics = Statistics();
+		statistics.casterCount = casterCount;
+		statistics.layerCount = layerCount;
+
+		/**
+		 * Tiles are repacked every frame, atlas grows right away but shrinks only after it was too large for a while
+		*/
+		const uint32_t requiredAtlasSize = packTiles();
+		if (requiredAtlasSize > atlasSize)
+			resizeAtlas(requiredAtlasSize);
+		else if (requiredAtlasSize == atlasSize)
+			framesAboveRequiredSize = 0;
+		else if (++framesAboveRequiredSize >= ATLAS_SHRINK_DELAY)
+			resizeAtlas(requiredAtlasSize);
+
+		statistics.atlasSize = atlasSize;
+		layerTileCoordinates.resize(layerCount);
+		for (uint32_t layer = 0; layer < layerCount; ++layer)
+			layerTileCoordinates[layer] = glm::vec4(layerTiles[layer]) / (float)atlasSize;
+
+		/**
+		 * Culling every caster against frustum of every layer, 
+		 * visible casters make up signature used to detect changes since last frame
+		*/
+		culler.clear();
+		casterSignatures.resize(casterCount);
+		for (uint32_t casterIndex = 0; casterIndex < casterCount; ++casterIndex)
+		{
+			const Caster& caster = casters[casterIndex];
+			culler.pushMesh(*caster.mesh, *caster.transform);
+			uint64_t signature = combineSignature(SIGNATURE_SEED, &caster.mesh, sizeof(const Mesh*));
+			casterSignatures[casterIndex] = combineSignature(signature, &(*caster.transform)[0][0], sizeof(glm::mat4));
+		}
+
+		casterLayers.resize(casterCount);
+		for (auto& layers : casterLayers)
+			layers.clear();
+
+		uint32_t visibleInstanceCount = 0;
+		currentLayers.assign(layerCount, LayerCache());
+		for (uint32_t layer = 0; layer < layerCount; ++layer)
+		{
+			LayerCache& currentLayer = currentLayers[layer];
+			currentLayer.matrix = layerMatrices[layer];
+			currentLayer.tile = layerTiles[layer];
+			currentLayer.staticSignature = SIGNATURE_SEED;
+			currentLayer.dynamicSignature = SIGNATURE_SEED;
+			currentLayer.valid = true;
+
+			culler.cull(Frustum(layerMatrices[layer]));
+			for (uint32_t casterIndex = 0; casterIndex < casterCount; ++casterIndex)
+			{
+				if (!culler.isVisible(casterIndex))
+					continue;
+
+				casterLayers[casterIndex].push_back((int)layer);
+				uint64_t& signature = casters[casterIndex].isStatic ? currentLayer.staticSignature : currentLayer.dynamicSignature;
+				signature = combineSignature(signature, &casterSignatures[casterIndex], sizeof(uint64_t));
+				++visibleInstanceCount;
+			}
+		}
+
+		statistics.culledInstanceCount = casterCount * layerCount - visibleInstanceCount;
+		updateLayerCaches();
+
+		// Lighting shaders read layers from the same binding, so they are uploaded even when no layer is redrawn
+		if (layerCount != 0)
+		{
+			layersBuffer.updateData("layerMatrices[0]", &layerMatrices[0][0][0], layerCount * sizeof(glm::mat4));
+			layersBuffer.updateData("layerTiles[0]", &layerTileCoordinates[0].x, layerCount * sizeof(glm::vec4));
+		}
+
+		/**
+		 * Rendering each caster once, instanced for each of its layers which have to be updated,
+		 * viewport covers the whole atlas and vertex shader moves each instance into its tile
+		*/
+		if (statistics.updatedLayerCount != 0)
+		{
+			shader.activate();
+			api->setClipDistanceCount(4);
+
+			if (staticCaching)
+			{
+				// Static casters are redrawn only into their own atlas, which is then copied under dynamic ones
+				api->activateFramebuffer(staticShadowsFramebuffer.get());
+				api->setViewport({ 0, 0, (int)atlasSize, (int)atlasSize });
+				for (uint32_t layer = 0; layer < layerCount; ++layer)
+				{
+					if (layerUpdates[layer] == LayerUpdate::Full)
+						staticShadowAtlas->clearRegion(layerTiles[layer]);
+				}
+
+				renderCasters(api, CasterFilter::Static, LayerUpdate::Full);
+				for (uint32_t layer = 0; layer < layerCount; ++layer)
+				{
+					if (layerUpdates[layer] != LayerUpdate::None)
+						shadowAtlas->copyRegion(*staticShadowAtlas, layerTiles[layer]);
+				}
+
+				api->activateFramebuffer(shadowsFramebuffer.get());
+				renderCasters(api, CasterFilter::Dynamic, LayerUpdate::Dynamic);
+			}
+			else
+			{
+				api->activateFramebuffer(shadowsFramebuffer.get());
+				api->setViewport({ 0, 0, (int)atlasSize, (int)atlasSize });
+				for (uint32_t layer = 0; layer < layerCount; ++layer)
+				{
+					if (layerUpdates[layer] == LayerUpdate::Full)
+						shadowAtlas->clearRegion(layerTiles[layer]);
+				}
+
+				renderCasters(api, CasterFilter::All, LayerUpdate::Full);
+			}
+
+			api->setClipDistanceCount(0);
+		}
+
+		layerMatrices.clear();
+		layerImportances.clear();
+		casters.clear();
+	}
+
+	uint32_t ShadowMapRenderer::packTiles()
+	{
+		const uint32_t layerCount = getLayerCount();
+		layerTiles.resize(layerCount);
+
+		/**
+		 * Tiles are power of two squares, so the atlas has to cover only their total area and the largest tile,
+		 * all tiles are halved when that would exceed maximum atlas size
+		*/
+		uint32_t requiredSize = MIN_SHADOW_TILE_SIZE;
+		for (uint32_t levelBias = 0; ; ++levelBias)
+		{
+			uint64_t totalArea = 0;
+			uint32_t largestTileSize = MIN_SHADOW_TILE_SIZE;
+			for (uint32_t layer = 0; layer < layerCount; ++layer)
+			{
+				const uint32_t tileSize = calculateTileSize(layerImportances[layer], levelBias);
+				layerTiles[layer] = glm::uvec4(0U, 0U, tileSize, tileSize);
+				totalArea += (uint64_t)tileSize * tileSize;
+				largestTileSize = glm::max(largestTileSize, tileSize);
+			}
+
+			requiredSize = largestTileSize;
+			while ((uint64_t)requiredSize * requiredSize < totalArea)
+				requiredSize *= 2;
+
+			if (requiredSize <= MAX_SHADOW_ATLAS_SIZE || largestTileSize == MIN_SHADOW_TILE_SIZE)
+				break;
+		}
+
+		/**
+		 * Placing tiles from the largest along Z-order curve of smallest tile cells, 
+		 * every tile then starts at a multiple of its own area and stays aligned without leaving gaps
+		*/
+		tileOrder.resize(layerCount);
+		std::iota(tileOrder.begin(), tileOrder.end(), 0U);
+		std::stable_sort(tileOrder.begin(), tileOrder.end(), [this](uint32_t first, uint32_t second) {
+			return layerTiles[first].z > layerTiles[second].z;
+		});
+
+		uint32_t cellIndex = 0;
+		for (uint32_t layer : tileOrder)
+		{
+			glm::uvec4& tile = layerTiles[layer];
+			const glm::uvec2 offset = decodeMortonIndex(cellIndex) * MIN_SHADOW_TILE_SIZE;
+			tile.x = offset.x;
+			tile.y = offset.y;
+
+			const uint32_t tileCells = tile.z / MIN_SHADOW_TILE_SIZE;
+			cellIndex += tileCells * tileCells;
+		}
+
+		return requiredSize;
+	}
+
+	uint32_t ShadowMapRenderer::calculateTileSize(float importance, uint32_t levelBias) const
+	{
+		// Number of halvings of importance, layers without any get the smallest tile
+		float level = 31.f;
+		if (importance > 0.f)
+			level = glm::clamp(glm::floor(-glm::log2(importance)), 0.f, 31.f);
+
+		const uint32_t shift = glm::min((uint32_t)level + levelBias, 31U);
+		return glm::max(maxTileSize >> shift, MIN_SHADOW_TILE_SIZE);
+	}
+
+	void ShadowMapRenderer::resizeAtlas(uint32_t size)
+	{
+		shadowsFramebuffer = createAtlas(size, shadowAtlas);
+		if (staticShadowsFramebuffer)
+			staticShadowsFramebuffer = createAtlas(size, staticShadowAtlas);
+
+		atlasSize = size;
+		framesAboveRequiredSize = 0;
+		for (auto& layerCache : layerCaches)
+			layerCache.valid = false;
+	}
+
+	std::unique_ptr<Framebuffer> ShadowMapRenderer::createAtlas(uint32_t size, Texture*& atlas)
+	{
+		atlas = new Texture;
+		Texture::Specification depthTextureSpecification(size, size, ITexture::Format::DEPTH32, Texture::Dimensionality::TwoDimensional);
+		atlas->load(depthTextureSpecification, nullptr);
+
+		auto framebuffer = std::make_unique<Framebuffer>();
+		framebuffer->addDepthTarget(atlas, true);
+		framebuffer->load();
+		return framebuffer;
+	}
+
+	void ShadowMapRenderer::updateLayerCaches()
+	{
+		// Static depth atlas has to be redrawn from scratch whenever it's (re)enabled
+		if (staticCaching != staticCachingEnabledLastFrame)
+		{
+			for (auto& layerCache : layerCaches)
+				layerCache.valid = false;
+
+			if (staticCaching)
+			{
+				staticShadowsFramebuffer = createAtlas(atlasSize, staticShadowAtlas);
+			}
+			else
+			{
+				staticShadowsFramebuffer.reset();
+				staticShadowAtlas = nullptr;
+			}
+
+			staticCachingEnabledLastFrame = staticCaching;
+		}
+
+		const uint32_t layerCount = getLayerCount();
+		layerUpdates.assign(layerCount, LayerUpdate::None);
+		for (uint32_t layer = 0; layer < layerCount; ++layer)
+		{
+			const LayerCache& cachedLayer = layerCaches[layer];
+			const LayerCache& currentLayer = currentLayers[layer];
+
+			// Moved light, tile or static caster invalidates whole layer, moved dynamic caster only its dynamic part
+			if (!caching || !cachedLayer.valid || cachedLayer.matrix != currentLayer.matrix || cachedLayer.tile != currentLayer.tile ||
+				cachedLayer.staticSignature != currentLayer.staticSignature)
+				layerUpdates[layer] = LayerUpdate::Full;
+			else if (cachedLayer.dynamicSignature != currentLayer.dynamicSignature)
+				layerUpdates[layer] = staticCaching ? LayerUpdate::Dynamic : LayerUpdate::Full;
+
+			if (layerUpdates[layer] != LayerUpdate::None)
+				++statistics.updatedLayerCount;
+
+			layerCaches[layer] = currentLayer;
+		}
+
+		for (uint32_t layer = layerCount; layer < MAX_SHADOW_MAP_LAYERS; ++layer)
+			layerCaches[layer].valid = false;
+	}
+
+	void ShadowMapRenderer::renderCasters(GraphicsAPI* const api, CasterFilter filter, LayerUpdate minimumUpdate)
+	{
+		for (uint32_t casterIndex = 0; casterIndex < (uint32_t)casters.size(); ++casterIndex)
+		{
+			const Caster& caster = casters[casterIndex];
+			if ((filter == CasterFilter::Static && !caster.isStatic) || (filter == CasterFilter::Dynamic && caster.isStatic))
+				continue;
+
+			instanceLayers.clear();
+			for (int layer : casterLayers[casterIndex])
+			{
+				if (layerUpdates[layer] >= minimumUpdate)
+					instanceLayers.push_back(layer);
+			}
+
+			if (instanceLayers.empty())
+				continue;
+
+			layersBuffer.updateData("instanceLayers[0]", instanceLayers.data(), (uint32_t)instanceLayers.size() * sizeof(int));
+			layersBuffer.updateData("model", &(*caster.transform)[0][0], sizeof(glm::mat4));
+			api->renderInstances(*caster.mesh, (uint32_t)instanceLayers.size());
+			statistics.renderedInstanceCount += (uint32_t)instanceLayers.size();
+		}
+	}
+
+	glm::uvec2 ShadowMapRenderer::decodeMortonIndex(uint32_t index)
+	{
+		// Even bits of the index make up x coordinate, odd bits y coordinate
+		glm::uvec2 position(0U);
+		for (uint32_t bit = 0; bit < 16; ++bit)
+		{
+			position.x |= ((index >> (2 * bit)) & 1U) << bit;
+			position.y |= ((index >> (2 * bit + 1)) & 1U) << bit;
+		}
+
+		return position;
+	}
+
+	uint64_t ShadowMapRenderer::combineSignature(uint64_t signature, const void* data, size_t sizeInBytes)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < sizeInBytes; ++i)
+			signature = (signature ^ bytes[i]) * SIGNATURE_PRIME;
+
+		return signature;
+	}
+
+	glm::mat4 ShadowMapRenderer::calculateLightViewMatrix(const glm::vec3& lightPosition, const glm::vec3& direction)
+	{
+		glm::vec3 up(0.f, 1.f, 0.f);
+		if (glm::abs(direction.x) < 1e-7f && glm::abs(direction.z) < 1e-7f) 
+			up.x = 0.001f;
+
+		glm::vec3 right = glm::normalize(glm::cross(up, direction)); // Get first perpendicular vector from random up and direction
+		up = glm::cross(direction, right); // Get third perpendicular vector from direction, and right
+
+		glm::mat4 view = glm::transpose(glm::mat4(
+			glm::vec4(right, 0.f), // Right
+			glm::vec4(up, 0.f), // Up
+			glm::vec4(-direction, 0.f), // Direction (inverse)
+			glm::vec4(0.f, 0.f, 0.f, 1.f)
+		));
+
+		glm::mat4 translation(1.f);
+		translation[3] = glm::vec4(-lightPosition, 1.f);
+		return view * translation;
+	}
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include "Cala/Rendering/GraphicsAPI.h"
+#include "Cala/Rendering/Framebuffer.h"
+#include "Cala/Rendering/Texture.h"
+#include "Cala/Rendering/Shader.h"
+#include "Cala/Rendering/ConstantBuffer.h"
+#include "Cala/Rendering/FrustumCuller.h"
+
+// MAX_LIGHTS_COUNT point lights * 6 cubemap faces
+#define MAX_SHADOW_MAP_LAYERS 48
+
+namespace Cala {
+	/**
+	 * Renders depth of shadow casters into tiles of a single shadow atlas, one tile per layer
+	 * Tile size follows importance of the layer and tiles are repacked every frame, 
+	 * so the atlas only grows as large as the pushed layers need
+	 * Casters are culled on CPU against frustum of each layer and drawn once per frame,
+	 * instanced once for every layer they are visible in
+	 * Layers whose matrix, tile and visible casters didn't change since last frame are kept from previous frame
+	*/
+	class ShadowMapRenderer {
+	public:
+		struct Statistics {
+			uint32_t casterCount = 0;
+			uint32_t layerCount = 0;
+			uint32_t updatedLayerCount = 0;
+			uint32_t renderedInstanceCount = 0;
+			uint32_t culledInstanceCount = 0;
+			uint32_t atlasSize = 0;
+		};
+
+		// Tile size of layers with full importance, rounded down to power of two
+		ShadowMapRenderer(uint32_t maxTileSize = 1024U);
+		~ShadowMapRenderer() = default;
+
+		/**
+		 * Returns index of the layer, order of pushed layers has to match layer lookup in lighting shaders
+		 * Importance in range [0, 1] halves tile size with every halving of importance
+		*/
+		uint32_t pushLayer(const glm::mat4& lightViewProjection, float importance = 1.f);
+		// Static casters are cached separately when static caching is enabled and redrawn only when they move
+		void pushCaster(const Mesh& mesh, const glm::mat4& transform, bool isStatic = false);
+		void render(GraphicsAPI* const api);
+		const ITexture& getShadowMaps() const { return shadowsFramebuffer->getDepthTarget(); }
+		const Statistics& getStatistics() const { return statistics; }
+		uint32_t getLayerCount() const { return (uint32_t)layerMatrices.size(); }
+
+		// View matrix of a light looking along direction, point lights use one per cubemap face
+		static glm::mat4 calculateLightViewMatrix(const glm::vec3& lightPosition, const glm::vec3& direction);
+
+		// Reuses layers of last frame which weren't affected by any change
+		bool caching = true;
+		// Keeps depth of static casters in a separate atlas, so moving dynamic casters don't redraw static ones
+		bool staticCaching = false;
+
+	private:
+		struct Caster {
+			const Mesh* mesh;
+			const glm::mat4* transform;
+			bool isStatic;
+		};
+
+		// Ordered by amount of work needed to bring a layer up to date
+		enum class LayerUpdate {
+			None,
+			Dynamic,
+			Full
+		};
+
+		struct LayerCache {
+			glm::mat4 matrix{ 0.f };
+			glm::uvec4 tile{ 0U };
+			uint64_t staticSignature = 0;
+			uint64_t dynamicSignature = 0;
+			bool valid = false;
+		};
+
+		enum class CasterFilter {
+			All,
+			Static,
+			Dynamic
+		};
+
+		// Returns atlas size needed to fit tiles of all layers
+		uint32_t packTiles();
+		void resizeAtlas(uint32_t size);
+		void updateLayerCaches();
+		void renderCasters(GraphicsAPI* const api, CasterFilter filter, LayerUpdate minimumUpdate);
+		uint32_t calculateTileSize(float importance, uint32_t levelBias) const;
+		static std::unique_ptr<Framebuffer> createAtlas(uint32_t size, Texture*& atlas);
+		static glm::uvec2 decodeMortonIndex(uint32_t index);
+		static uint64_t combineSignature(uint64_t signature, const void* data, size_t sizeInBytes);
+
+		Shader shader;
+		ConstantBuffer layersBuffer;
+		std::unique_ptr<Framebuffer> shadowsFramebuffer;
+		std::unique_ptr<Framebuffer> staticShadowsFramebuffer;
+		Texture* shadowAtlas = nullptr;
+		Texture* staticShadowAtlas = nullptr;
+		uint32_t maxTileSize;
+		uint32_t atlasSize = 0;
+		uint32_t framesAboveRequiredSize = 0;
+		FrustumCuller culler;
+		std::vector<glm::mat4> layerMatrices;
+		std::vector<float> layerImportances;
+		std::vector<glm::uvec4> layerTiles;
+		std::vector<glm::vec4> layerTileCoordinates;
+		std::vector<uint32_t> tileOrder;
+		std::vector<Caster> casters;
+		std::vector<std::vector<int>> casterLayers;
+		std::vector<uint64_t> casterSignatures;
+		std::vector<LayerCache> layerCaches;
+		std::vector<LayerCache> currentLayers;
+		std::vector<LayerUpdate> layerUpdates;
+		std::vector<int> instanceLayers;
+		bool staticCachingEnabledLastFrame = false;
+		Statistics statistics;
+	};
+}
@@ -8,16 +8,16 @@ namespace Cala {
 		shader.attachShader(Shader::ShaderType::FragmentShader, shadersDir / "LightFragmentShader.glsl");
 		shader.createProgram();
 
-		mvpBuffer.setData(shader.getConstantBufferInfo("MVP"), true);
-		materialsBuffer.setData(shader.getConstantBufferInfo("MeshData"), true);
-		uint32_t lightened = 0;
-		materialsBuffer.updateData("lightened", &lightened, sizeof(uint32_t));
+		mvpBuffer.setSource(shader, "MVP", true);
+		materialsBuffer.setSource(shader, "MeshData", true);
 	}
 
     void SimpleRenderer::setupCamera(const Camera &camera)
     {
 		mvpBuffer.updateData("projection", &camera.getProjection()[0][0], sizeof(glm::mat4));
 		mvpBuffer.updateData("view", &camera.getView()[0][0], sizeof(glm::mat4));
+		cameraFrustum = camera.getFrustum();
+		cameraView = camera.getView();
     }
 
     void SimpleRenderer::render(GraphicsAPI* const api, const Framebuffer* renderingTarget)
@@ -28,21 +28,45 @@ namespace Cala {
 		int lightened = 0;
 		materialsBuffer.updateData("lightened", &lightened, sizeof(int));
 
+		culler.clear();
+		for (const auto& renderable : renderables)
+		{
+			if (frustumCulling)
+				culler.pushMesh(renderable.mesh, renderable.transformation.getTransformMatrix());
+			else
+				culler.pushUnbounded();
+		}
+		culler.cull(cameraFrustum);
+
+		// Single program and no textures, so renderables are grouped by mesh and drawn front to back
+		renderQueue.clear();
+		for (uint32_t i = 0; i < (uint32_t)renderables.size(); ++i)
+		{
+			if (!culler.isVisible(i))
+				continue;
+
+			const auto& renderable = renderables[i];
+			float viewDepth = RenderQueue::calculateViewDepth(cameraView, renderable.mesh, renderable.transformation.getTransformMatrix());
+			renderQueue.push(RenderQueue::createKey(0, 0, 0, renderQueue.getMeshId(renderable.mesh), viewDepth), i);
+		}
+		renderQueue.sort();
+
 		api->enableSetting(GraphicsAPI::DepthTesting);
-		while (!renderablesStack.empty())
+
+		for (const RenderQueue::Item& item : renderQueue.getItems())
 		{
-			const auto& renderable = renderablesStack.top();
+			const auto& renderable = renderables[item.index];
 			materialsBuffer.updateData("material.color", &renderable.color.x, sizeof(glm::vec4));
 			mvpBuffer.updateData("model", &renderable.transformation.getTransformMatrix()[0][0], sizeof(glm::mat4));
-			api->render(renderable.mesh);
-			renderablesStack.pop();
+			api->render(renderable.mesh, renderQueue.changeMesh(renderable.mesh));
 		}
+		renderables.clear();
 
 		api->disableSetting(GraphicsAPI::DepthTesting);
 	}
 
 	void SimpleRenderer::pushRenderable(const Renderable& renderable)
 	{
-		renderablesStack.push(renderable);
+		renderables.push_back(renderable);
 	}
 }
@@ -1,8 +1,10 @@
 #pragma once 
 #include "ICameraRenderer.h"
-#include <stack>
+#include <vector>
 #include "Cala/Utility/Transformation.h"
 #include "Cala/Rendering/Shader.h"
+#include "Cala/Rendering/FrustumCuller.h"
+#include "Cala/Rendering/RenderQueue.h"
 
 namespace Cala {
 	class SimpleRenderer : public ICameraRenderer {
@@ -23,10 +25,20 @@ namespace Cala {
 
 		void pushRenderable(const Renderable& renderable);
 
+		// Visible and culled renderable counts of the last rendered frame
+		const FrustumCuller::Statistics& getCullingStatistics() const { return culler.getStatistics(); }
+		// Draw count, bound and skipped state changes and sort time of the last rendered frame
+		const RenderQueue::Statistics& getQueueStatistics() const { return renderQueue.getStatistics(); }
+		bool frustumCulling = true;
+
 	private:
 		Shader shader;
 		ConstantBuffer mvpBuffer;
 		ConstantBuffer materialsBuffer;
-		std::stack<Renderable> renderablesStack;
+		std::vector<Renderable> renderables;
+		FrustumCuller culler;
+		Frustum cameraFrustum;
+		glm::mat4 cameraView{ 1.f };
+		RenderQueue renderQueue;
 	};
 }
\ No newline at end of file
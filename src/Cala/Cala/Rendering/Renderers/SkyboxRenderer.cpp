@@ -10,10 +10,9 @@ namespace Cala {
 		shader.attachShader(Shader::ShaderType::FragmentShader, shadersDir / "SkyboxFragmentShader.glsl");
 		shader.createProgram();
 
-		mvpBuffer.setData(shader.getConstantBufferInfo("MVP"), false);
-		skyboxBlurBuffer.setData(shader.getConstantBufferInfo("SkyboxBlur"), false);
-		uint32_t blurLevel = 100;
-		setBlurLevel(blurLevel);
+		mvpBuffer.setSource(shader, "MVP", false);
+		skyboxBlurBuffer.setSource(shader, "SkyboxBlur", false);
+		setBlurLevel(100);
 
 		setTexture(_texture);
 	}
@@ -27,6 +26,13 @@ namespace Cala {
 		api->activateFramebuffer(renderingTarget);
 		api->enableSetting(GraphicsAPI::DepthTesting);
 		api->setDepthComparisonFunction(GraphicsAPI::LessOrEqual);
+		// Uploaded on render, so construction doesn't wait for the program to link
+		if (blurLevelChanged)
+		{
+			skyboxBlurBuffer.updateData("blurValue", &blurLevel, sizeof(uint32_t));
+			blurLevelChanged = false;
+		}
+
 		shader.activate();
 		texture->setForSampling(0);
 		api->render(mesh);
@@ -54,7 +60,7 @@ namespace Cala {
 
     void SkyboxRenderer::setBlurLevel(uint32_t blur)
     {
-		blur = glm::clamp(blur, 10U, 705U);
-		skyboxBlurBuffer.updateData("blurValue", &blur, sizeof(uint32_t));
+		blurLevel = glm::clamp(blur, 10U, 705U);
+		blurLevelChanged = true;
     }
 }
\ No newline at end of file
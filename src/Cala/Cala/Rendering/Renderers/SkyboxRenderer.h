@@ -19,5 +19,7 @@ namespace Cala {
 		ConstantBuffer mvpBuffer;
 		ConstantBuffer skyboxBlurBuffer;
 		const Texture* texture = nullptr;
+		uint32_t blurLevel = 0;
+		bool blurLevelChanged = false;
 	};
 }
\ No newline at end of file
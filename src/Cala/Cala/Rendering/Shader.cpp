@@ -5,11 +5,16 @@
 #include <iostream>
 #include "Shader.h"
 #include <cstring>
+#include <algorithm>
 #include "Cala/Utility/Logger.h"
+#include "GLExtensions.h"
 
 #define BIT(x) (1 << x)
+#define MAX_INCLUDE_DEPTH 8
 
 namespace Cala {
+	Shader::CompilationMode Shader::compilationMode = Shader::CompilationMode::Asynchronous;
+
 #ifdef CALA_API_OPENGL
 #include <glad/glad.h>
 	Shader::Shader(Shader&& other) noexcept
@@ -22,7 +27,16 @@ namespace Cala {
 		programHandle = other.programHandle;
 		other.programHandle = GL_NONE;
 		attachedShaders = other.attachedShaders;
-		shaderHandlesBuffer = other.shaderHandlesBuffer;
+		other.attachedShaders = 0;
+		computeProgram = other.computeProgram;
+		other.computeProgram = false;
+		statusCheckPending = other.statusCheckPending;
+		other.statusCheckPending = false;
+		compiledAsynchronously = other.compiledAsynchronously;
+		shaderHandlesBuffer = std::move(other.shaderHandlesBuffer);
+		other.shaderHandlesBuffer.clear();
+		shaderPathsBuffer = std::move(other.shaderPathsBuffer);
+		other.shaderPathsBuffer.clear();
 		return *this;
 	}
 
@@ -33,16 +47,21 @@ namespace Cala {
 
     void Shader::free()
     {
-		if (attachedShaders != 0)
+		// Stages are kept until the status check when compiling asynchronously
+		for (const auto& shader : shaderHandlesBuffer)
 		{
-			for (const auto& shader : shaderHandlesBuffer)
-			{
+			if (programHandle != API_NULL)
 				glDetachShader(programHandle, shader);
-				glDeleteShader(shader);
-			}
+			glDeleteShader(shader);
 		}
 
+		shaderHandlesBuffer.clear();
+		shaderPathsBuffer.clear();
+		attachedShaders = 0;
+		computeProgram = false;
+		statusCheckPending = false;
 		glDeleteProgram(programHandle);
+		programHandle = API_NULL;
     }
 
     bool Shader::isLoaded() const
@@ -50,7 +69,7 @@ namespace Cala {
         return programHandle != API_NULL;
     }
 
-    void Shader::attachShader(ShaderType shaderStage, const std::filesystem::path& filePath)
+    void Shader::attachShader(ShaderType shaderStage, const std::filesystem::path& filePath, const std::vector<std::string>& defines)
 	{
 		Logger& logger = Logger::getInstance();
 
@@ -74,21 +93,11 @@ namespace Cala {
 		}
 
 		std::string shaderCode;
-		std::ifstream shaderFile;
+		if (readShaderFile(filePath, shaderCode))
+			resolveIncludes(shaderCode, filePath.parent_path());
 
-		shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-		try {
-			shaderFile.open(filePath);
-			std::stringstream shaderStream;
-			shaderStream << shaderFile.rdbuf();
-			shaderCode = shaderStream.str();
-			shaderFile.close();
-		}
-		catch (std::ifstream::failure& e) {
-			std::cout << e.what() << std::endl;
-			std::cout << "Error: Cannot find shader file(" << filePath.string() << ")!" << std::endl;
-		}
+		if (!defines.empty())
+			injectDefines(shaderCode, defines);
 
 		GLint success;
 		char infoLog[512];
@@ -106,14 +115,19 @@ namespace Cala {
 		GLuint shaderID = glCreateShader(shaderType);
 		glShaderSource(shaderID, 1, &shaderCodeStringLiteral, nullptr);
 		glCompileShader(shaderID);
-		glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
-		if (!success) {
-			glGetShaderInfoLog(shaderID, 512, nullptr, infoLog);
-			std::cout << "Failed to compile shader: " << filePath << " " << infoLog << std::endl;
+		compiledAsynchronously = compilationMode == CompilationMode::Asynchronous;
+		if (!compiledAsynchronously)
+		{
+			glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
+			if (!success) {
+				glGetShaderInfoLog(shaderID, 512, nullptr, infoLog);
+				std::cout << "Failed to compile shader: " << filePath << " " << infoLog << std::endl;
+			}
 		}
 
 		attachedShaders |= BIT((uint32_t)shaderStage);
 		shaderHandlesBuffer.push_back(shaderID);
+		shaderPathsBuffer.push_back(filePath.string());
 	}
 
 	void Shader::createProgram()
@@ -124,8 +138,6 @@ namespace Cala {
 			return;
 		}
 
-		char infoLog[512];
-		GLint success;
 		programHandle = glCreateProgram();
 		for (const auto& shader : shaderHandlesBuffer)
 		{
@@ -133,8 +145,37 @@ namespace Cala {
 		}
 
 		glLinkProgram(programHandle);
+
+		// Stages are cleared for the next program, dispatches still need to know this one is a compute program
+		computeProgram = attachedShaders & BIT((uint32_t)ShaderType::ComputeShader);
+		attachedShaders = 0;
+		statusCheckPending = true;
+
+		// Querying link status waits for the driver, so asynchronously compiled programs are checked on first use
+		if (!compiledAsynchronously)
+			checkProgramStatus();
+	}
+
+	void Shader::checkProgramStatus() const
+	{
+		if (!statusCheckPending)
+			return;
+
+		statusCheckPending = false;
+		char infoLog[512];
+		GLint success;
 		glGetProgramiv(programHandle, GL_LINK_STATUS, &success);
 		if (!success) {
+			// Stage compile status wasn't checked yet, its log tells which file failed
+			for (size_t i = 0; compiledAsynchronously && i < shaderHandlesBuffer.size(); ++i)
+			{
+				glGetShaderiv(shaderHandlesBuffer[i], GL_COMPILE_STATUS, &success);
+				if (!success) {
+					glGetShaderInfoLog(shaderHandlesBuffer[i], 512, nullptr, infoLog);
+					Logger::getInstance().logErrorToConsole("Failed to compile shader: " + shaderPathsBuffer[i] + " " + infoLog);
+				}
+			}
+
 			glGetProgramInfoLog(programHandle, 512, nullptr, infoLog);
 			Logger::getInstance().logErrorToConsole(std::string("Failed to link program: ") + infoLog);
 		}
@@ -145,19 +186,126 @@ namespace Cala {
 			glDeleteShader(shader);
 		}
 
-		attachedShaders = 0;
 		shaderHandlesBuffer.clear();
+		shaderPathsBuffer.clear();
+	}
+
+	bool Shader::isReady() const
+	{
+		if (programHandle == API_NULL)
+			return false;
+
+		// Without the extension completion can't be polled, the first use waits for it instead
+		if (!statusCheckPending || !GLExtensions::parallelShaderCompile)
+			return true;
+
+		GLint completed = GL_FALSE;
+		glGetProgramiv(programHandle, GL_COMPLETION_STATUS_KHR, &completed);
+		return completed == GL_TRUE;
+	}
+
+	bool Shader::readShaderFile(const std::filesystem::path& filePath, std::string& shaderCode)
+	{
+		std::ifstream shaderFile;
+		shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+		try {
+			shaderFile.open(filePath);
+			std::stringstream shaderStream;
+			shaderStream << shaderFile.rdbuf();
+			shaderCode = shaderStream.str();
+			shaderFile.close();
+		}
+		catch (std::ifstream::failure& e) {
+			std::cout << e.what() << std::endl;
+			std::cout << "Error: Cannot find shader file(" << filePath.string() << ")!" << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool Shader::resolveIncludes(std::string& shaderCode, const std::filesystem::path& directory, uint32_t depth)
+	{
+		if (depth > MAX_INCLUDE_DEPTH)
+		{
+			Logger::getInstance().logErrorToConsole("Shader includes nested too deep, possibly recursive!");
+			return false;
+		}
+
+		size_t lineStart = 0;
+		uint32_t line = 0; // Line of the file being processed, included code is skipped
+		while (lineStart < shaderCode.size())
+		{
+			++line;
+			size_t lineEnd = shaderCode.find('\n', lineStart);
+			if (lineEnd == std::string::npos)
+				lineEnd = shaderCode.size();
+
+			size_t directiveStart = shaderCode.find_first_not_of(" \t", lineStart);
+			if (directiveStart >= lineEnd || shaderCode.compare(directiveStart, 8, "#include") != 0)
+			{
+				lineStart = lineEnd + 1;
+				continue;
+			}
+
+			size_t nameStart = shaderCode.find('"', directiveStart);
+			size_t nameEnd = nameStart == std::string::npos ? std::string::npos : shaderCode.find('"', nameStart + 1);
+			if (nameEnd == std::string::npos || nameEnd > lineEnd)
+			{
+				Logger::getInstance().logErrorToConsole("Malformed shader #include directive!");
+				return false;
+			}
+
+			std::filesystem::path includePath = directory / shaderCode.substr(nameStart + 1, nameEnd - nameStart - 1);
+			std::string includedCode;
+			if (!readShaderFile(includePath, includedCode) || !resolveIncludes(includedCode, includePath.parent_path(), depth + 1))
+				return false;
+
+			// Keeps line numbers in compilation errors matching the including file after the included code
+			includedCode = "#line 1\n" + includedCode + "\n#line " + std::to_string(line + 1) + "\n";
+			shaderCode.replace(lineStart, lineEnd - lineStart + (lineEnd < shaderCode.size() ? 1 : 0), includedCode);
+			lineStart += includedCode.size();
+		}
+
+		return true;
+	}
+
+	void Shader::injectDefines(std::string& shaderCode, const std::vector<std::string>& defines)
+	{
+		// Defines must come after #version directive, which has to be the first statement in a shader
+		size_t insertPosition = 0;
+		size_t versionPosition = shaderCode.find("#version");
+		uint32_t versionLine = 0;
+		if (versionPosition != std::string::npos)
+		{
+			insertPosition = shaderCode.find('\n', versionPosition);
+			insertPosition = insertPosition == std::string::npos ? shaderCode.size() : insertPosition + 1;
+			versionLine = (uint32_t)std::count(shaderCode.begin(), shaderCode.begin() + insertPosition, '\n');
+		}
+
+		std::string definesCode;
+		for (const auto& define : defines)
+			definesCode += "#define " + define + "\n";
+
+		// Keeps line numbers in compilation errors matching the shader file
+		definesCode += "#line " + std::to_string(versionLine + 1) + "\n";
+		shaderCode.insert(insertPosition, definesCode);
 	}
 
 	void Shader::activate() const
 	{
+		checkProgramStatus();
 		glUseProgram(programHandle);
 	}
 
 	void Shader::dispatchComputeShader(uint32_t workGroupX, uint32_t workGroupY, uint32_t workGroupZ) const
 	{
-		if (!(attachedShaders & BIT((uint32_t)ShaderType::ComputeShader)))
+		if (!computeProgram)
+		{
+			Logger::getInstance().logErrorToConsole("Program has no compute shader!");
 			return;
+		}
 
 		glDispatchCompute(workGroupX, workGroupY, workGroupZ);
 	}
@@ -167,6 +315,7 @@ namespace Cala {
 		if (programHandle == GL_NONE)
 			return;
 
+		checkProgramStatus();
 		uint32_t blockIndex = glGetUniformBlockIndex(programHandle, bufferName.c_str());
 
 		if (blockIndex == GL_INVALID_INDEX)
@@ -181,6 +330,7 @@ namespace Cala {
 	ConstantBuffer::ConstantBufferInfo Shader::getConstantBufferInfo(const std::string& bufferName) const
 	{
 		ConstantBuffer::ConstantBufferInfo bufferInfo;
+		checkProgramStatus();
 		GLint blockIndex = glGetUniformBlockIndex(programHandle, bufferName.c_str());
 		if (blockIndex == -1)
 			return bufferInfo;
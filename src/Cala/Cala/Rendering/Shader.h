@@ -17,6 +17,13 @@ namespace Cala {
 			ComputeShader = 3,
 		};
 
+		enum class CompilationMode {
+			// Compile and link status is checked right away
+			Synchronous,
+			// Status is checked when the program is first used, letting the driver compile in parallel
+			Asynchronous
+		};
+
 	public:
 		Shader() = default;
 		~Shader();
@@ -26,21 +33,45 @@ namespace Cala {
 		Shader& operator=(Shader&& other) noexcept;
 		void free() override;
 		bool isLoaded() const override;
+
+		// True if compilation and linking finished, never blocks
+		bool isReady() const;
 		void activate() const;
-		void attachShader(ShaderType type, const std::filesystem::path& filePath);
+		/**
+		 * Compiles shader stage from file
+		 * Every define is injected as "#define <define>" right after the #version directive
+		 * #include "file" directives are resolved relative to the shader file
+		*/
+		void attachShader(ShaderType type, const std::filesystem::path& filePath, const std::vector<std::string>& defines = {});
 		void createProgram();
+		// Program has to be active
 		void dispatchComputeShader(uint32_t workGroupX = 1, uint32_t workGroupY = 1, uint32_t workGroupZ = 1) const;
 		ConstantBuffer::ConstantBufferInfo getConstantBufferInfo(const std::string& bufferName) const;
 
 		// Only neccessary when block binding point isn't explicitly defined in the shader code
 		void attachConstantBuffer(ConstantBuffer* buffer, const std::string& bufferName) const;
 
+		// Applies to shaders attached after the call
+		static void setCompilationMode(CompilationMode mode) { compilationMode = mode; }
+		static CompilationMode getCompilationMode() { return compilationMode; }
+
 	private:
+		static void injectDefines(std::string& shaderCode, const std::vector<std::string>& defines);
+
+		// Replaces #include "file" lines with contents of the file, relative to including file
+		static bool resolveIncludes(std::string& shaderCode, const std::filesystem::path& directory, uint32_t depth = 0);
+		static bool readShaderFile(const std::filesystem::path& filePath, std::string& shaderCode);
+		void checkProgramStatus() const;
 		uint32_t attachedShaders = 0;
+		bool computeProgram = false;
+		mutable bool statusCheckPending = false;
+		bool compiledAsynchronously = false;
+		static CompilationMode compilationMode;
 
 	#ifdef CALA_API_OPENGL
 		GLuint programHandle = API_NULL;
-		std::vector<GLuint> shaderHandlesBuffer;
+		mutable std::vector<GLuint> shaderHandlesBuffer;
+		mutable std::vector<std::string> shaderPathsBuffer;
 	#endif
 	};
 }
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "ShaderPermutations.h"
+#include "Cala/Utility/Logger.h"
+
+namespace Cala {
+	void ShaderPermutations::attachShader(Shader::ShaderType type, const std::filesystem::path& filePath)
+	{
+		if (!permutations.empty())
+		{
+			Logger::getInstance().logErrorToConsole("Can't attach shader stage after permutations are compiled!");
+			return;
+		}
+
+		stages.emplace_back(type, filePath);
+	}
+
+	void ShaderPermutations::setPermutationDefines(const std::vector<std::string>& defines)
+	{
+		if (!permutations.empty())
+		{
+			Logger::getInstance().logErrorToConsole("Can't change permutation defines after permutations are compiled!");
+			return;
+		}
+
+		if (defines.size() > 32)
+		{
+			Logger::getInstance().logErrorToConsole("Permutation key supports at most 32 defines!");
+			return;
+		}
+
+		permutationDefines = defines;
+	}
+
+	const Shader& ShaderPermutations::getPermutation(uint32_t permutationKey)
+	{
+		auto it = permutations.find(permutationKey);
+		if (it != permutations.end())
+			return it->second;
+
+		// Shader is compiled in place since its move operations don't transfer attached stages
+		Shader& shader = permutations[permutationKey];
+		compilePermutation(shader, permutationKey);
+		return shader;
+	}
+
+	void ShaderPermutations::precompile(const std::vector<uint32_t>& permutationKeys)
+	{
+		for (uint32_t key : permutationKeys)
+			getPermutation(key);
+	}
+
+	bool ShaderPermutations::isPermutationLoaded(uint32_t permutationKey) const
+	{
+		return permutations.find(permutationKey) != permutations.end();
+	}
+
+	void ShaderPermutations::free()
+	{
+		permutations.clear();
+	}
+
+	void ShaderPermutations::compilePermutation(Shader& shader, uint32_t permutationKey) const
+	{
+		std::vector<std::string> defines;
+		for (uint32_t i = 0; i < (uint32_t)permutationDefines.size(); ++i)
+		{
+			if (permutationKey & (1U << i))
+				defines.push_back(permutationDefines[i]);
+		}
+
+		for (const auto& [type, path] : stages)
+			shader.attachShader(type, path, defines);
+
+		shader.createProgram();
+	}
+}
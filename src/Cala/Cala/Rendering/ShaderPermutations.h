@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <filesystem>
+#include "Shader.h"
+
+namespace Cala {
+	/**
+	 * Set of shader programs compiled from the same source files with different sets of defines
+	 * Bit i of a permutation key enables i-th permutation define
+	*/
+	class ShaderPermutations {
+	public:
+		ShaderPermutations() = default;
+		~ShaderPermutations() = default;
+		ShaderPermutations(const ShaderPermutations& other) = delete;
+		ShaderPermutations& operator=(const ShaderPermutations& other) = delete;
+		void attachShader(Shader::ShaderType type, const std::filesystem::path& filePath);
+		void setPermutationDefines(const std::vector<std::string>& defines);
+
+		// Compiles permutation on first request
+		const Shader& getPermutation(uint32_t permutationKey);
+		void precompile(const std::vector<uint32_t>& permutationKeys);
+		bool isPermutationLoaded(uint32_t permutationKey) const;
+		uint32_t getLoadedPermutationCount() const { return (uint32_t)permutations.size(); }
+		void free();
+
+	private:
+		void compilePermutation(Shader& shader, uint32_t permutationKey) const;
+
+		std::vector<std::pair<Shader::ShaderType, std::filesystem::path>> stages;
+		std::vector<std::string> permutationDefines;
+		std::unordered_map<uint32_t, Shader> permutations;
+	};
+}
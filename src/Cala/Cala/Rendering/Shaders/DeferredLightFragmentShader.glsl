@@ -0,0 +1,72 @@
+#version 440 core
+
+// Shininess is stored normalized to this range
+#define MAX_SHININESS 256.f
+
+// Permutation defines (injected by DeferredLightRenderer): SHADOWS, CEL_SHADING
+
+#include "Lighting.glsl"
+
+layout (binding = 0) uniform MVP 
+{
+	mat4 model;
+	mat4 view;
+	mat4 projection;
+	vec3 eyePosition;
+};
+
+layout (binding = 7) uniform DeferredLightData
+{
+	mat4 inverseViewProjection;
+	ivec4 viewport;
+	uint lightIndex;
+	uint shadowMapIndex; // First shadow map layer of the light
+	bool ambientPass;
+	bool fullscreen; // Screen quad instead of light volume
+};
+
+layout (binding = 4) uniform sampler2D albedoBuffer;
+layout (binding = 5) uniform sampler2D specularBuffer;
+layout (binding = 6) uniform sampler2D normalBuffer;
+layout (binding = 7) uniform sampler2D depthBuffer;
+
+out vec4 outColor;
+
+vec3 decodeNormal(vec2 encoded)
+{
+	vec3 normal = vec3(encoded, 1.f - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-normal.z, 0.f);
+	normal.x += normal.x >= 0.f ? -fold : fold;
+	normal.y += normal.y >= 0.f ? -fold : fold;
+	return normalize(normal);
+}
+
+void main() 
+{
+	const ivec2 texel = ivec2(gl_FragCoord.xy) - viewport.xy;
+	const float depth = texelFetch(depthBuffer, texel, 0).r;
+	if (depth >= 1.f)
+		discard;
+
+	const vec4 albedoSample = texelFetch(albedoBuffer, texel, 0);
+
+	// Ambient term doesn't depend on lights, so it's added once for all of them
+	if (ambientPass)
+	{
+		outColor = vec4(albedoSample.rgb * albedoSample.a * lightSourceCount, 1.f);
+		return;
+	}
+
+	const vec4 specularSample = texelFetch(specularBuffer, texel, 0);
+	const vec4 normalSample = texelFetch(normalBuffer, texel, 0);
+
+	const vec2 screenPosition = (vec2(texel) + 0.5f) / vec2(viewport.zw);
+	vec4 fragPosition = inverseViewProjection * vec4(vec3(screenPosition, depth) * 2.f - 1.f, 1.f);
+	fragPosition /= fragPosition.w;
+
+	const vec3 normal = decodeNormal(normalSample.xy);
+	const vec3 eyeDirection = normalize(eyePosition - fragPosition.xyz);
+	const vec3 colorDiffuse = albedoSample.rgb * normalSample.z;
+	outColor = vec4(calculateLight(lights[lightIndex], fragPosition.xyz, normal, eyeDirection, colorDiffuse, 
+		specularSample.rgb, specularSample.a * MAX_SHININESS, shadowMapIndex), 0.f);
+}
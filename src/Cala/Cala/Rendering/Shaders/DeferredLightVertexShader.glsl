@@ -0,0 +1,29 @@
+#version 440 core
+
+layout (location = 0) in vec3 in_position;
+
+layout (binding = 0) uniform MVP 
+{
+	mat4 model;
+	mat4 view;
+	mat4 projection;
+	vec3 eyePosition;
+};
+
+layout (binding = 7) uniform DeferredLightData
+{
+	mat4 inverseViewProjection;
+	ivec4 viewport;
+	uint lightIndex;
+	uint shadowMapIndex; // First shadow map layer of the light
+	bool ambientPass;
+	bool fullscreen; // Screen quad instead of light volume
+};
+
+void main() 
+{
+	if (fullscreen)
+		gl_Position = vec4(in_position.xy, 0.f, 1.f);
+	else
+		gl_Position = projection * view * model * vec4(in_position, 1.f);
+}
@@ -0,0 +1,27 @@
+#version 440 core
+
+layout (location = 0) in vec3 in_position;
+
+layout (binding = 0) uniform MVP 
+{
+	mat4 model;
+	mat4 view;
+	mat4 projection;
+	vec3 eyePosition;
+};
+
+#ifdef OBJECT_STORAGE
+#include "Objects.glsl"
+#endif
+
+// Has to match position computed by GeneralVertexShader
+invariant gl_Position;
+
+void main() 
+{
+#ifdef OBJECT_STORAGE
+	const mat4 model = objects[drawOrder[firstObject + gl_InstanceID]].model;
+#endif
+	const vec3 fragPosition = vec3(model * vec4(in_position, 1.0));
+	gl_Position = projection * view * vec4(fragPosition, 1.f);
+}
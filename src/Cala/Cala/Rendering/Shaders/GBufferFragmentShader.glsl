@@ -0,0 +1,115 @@
+#version 440 core
+
+#ifdef BINDLESS_TEXTURES
+#extension GL_ARB_bindless_texture : require
+#endif
+
+#define DIFFUSE 0 
+#define SPECULAR 1
+#define NORMAL 2
+
+// Shininess is stored normalized to this range
+#define MAX_SHININESS 256.f
+
+// Permutation defines (injected by DeferredLightRenderer): DIFFUSE_MAP, SPECULAR_MAP, NORMAL_MAP, OBJECT_STORAGE, BINDLESS_TEXTURES
+
+struct Material {
+	vec4 color;
+	float ambientCoefficient;
+	float diffuseCoefficient;
+	float specularCoefficient;
+	float shininess;
+};
+
+in Attributes {
+	vec3 fragPosition;
+	mat3 TBN;
+	vec2 texCoords;
+#ifdef OBJECT_STORAGE
+	flat uint materialIndex;
+#endif
+} inAttributes;
+
+#ifndef OBJECT_STORAGE
+layout (binding = 2) uniform MeshData
+{
+	Material material;
+	bool lightened;
+};
+#endif
+
+#ifdef OBJECT_STORAGE
+#include "Materials.glsl"
+#include "Textures.glsl"
+#else
+layout (binding = DIFFUSE) uniform sampler2D diffuseMap;
+layout (binding = SPECULAR) uniform sampler2D specularMap;
+layout (binding = NORMAL) uniform sampler2D normalMap;
+#endif
+
+layout (location = 0) out vec4 outAlbedo; // rgb - albedo, a - ambient coefficient
+layout (location = 1) out vec4 outSpecular; // rgb - specular color, a - normalized shininess
+layout (location = 2) out vec4 outNormal; // rg - octahedron encoded normal, b - diffuse coefficient
+
+// Maps unit sphere onto octahedron unfolded into a square
+vec2 encodeNormal(vec3 normal)
+{
+	normal /= abs(normal.x) + abs(normal.y) + abs(normal.z);
+	if (normal.z >= 0.f)
+		return normal.xy;
+
+	return (1.f - abs(normal.yx)) * vec2(normal.x >= 0.f ? 1.f : -1.f, normal.y >= 0.f ? 1.f : -1.f);
+}
+
+// Material texture of the shaded object bound to given unit
+vec4 sampleMap(uint unit)
+{
+#ifdef OBJECT_STORAGE
+	return sampleMaterialTexture(unit, materials[inAttributes.materialIndex].textures[unit], inAttributes.texCoords);
+#else
+	if (unit == DIFFUSE)
+		return texture(diffuseMap, inAttributes.texCoords);
+	else if (unit == SPECULAR)
+		return texture(specularMap, inAttributes.texCoords);
+
+	return texture(normalMap, inAttributes.texCoords);
+#endif
+}
+
+void main() 
+{
+#ifdef OBJECT_STORAGE
+	const MaterialData materialData = materials[inAttributes.materialIndex];
+	const Material material = Material(materialData.color, materialData.ambientCoefficient, materialData.diffuseCoefficient, 
+		materialData.specularCoefficient, materialData.shininess);
+#endif
+
+	vec3 albedo;
+	vec3 colorSpecular;
+
+#ifdef DIFFUSE_MAP
+	albedo = sampleMap(DIFFUSE).rgb;
+#else
+	albedo = material.color.rgb;
+#endif
+
+#ifdef SPECULAR_MAP
+	colorSpecular = sampleMap(SPECULAR).rgb;
+#else
+	colorSpecular = albedo * material.specularCoefficient;
+#endif
+
+	vec3 normal;
+#ifdef NORMAL_MAP
+	// Z is rebuilt from XY, so two channel BC5 maps work as well as RGB ones, tangent space normals never point inwards
+	normal.xy = sampleMap(NORMAL).xy * 2.0 - 1.0;
+	normal.z = sqrt(max(0.0, 1.0 - dot(normal.xy, normal.xy)));
+	normal = normalize(inAttributes.TBN * normal);
+#else
+	normal = inAttributes.TBN[2];
+#endif
+
+	outAlbedo = vec4(albedo, material.ambientCoefficient);
+	outSpecular = vec4(colorSpecular, material.shininess / MAX_SHININESS);
+	outNormal = vec4(encodeNormal(normal), material.diffuseCoefficient, 0.f);
+}
@@ -9,6 +9,9 @@ out Attributes {
 	vec3 fragPosition;
 	mat3 TBN;
 	vec2 texCoords;
+#ifdef OBJECT_STORAGE
+	flat uint materialIndex;
+#endif
 } outAttributes;
 
 layout (binding = 0) uniform MVP 
@@ -19,9 +22,23 @@ layout (binding = 0) uniform MVP
 	vec3 eyePosition;
 };
 
+#ifdef OBJECT_STORAGE
+#include "Objects.glsl"
+#endif
+
+// Depth pre-pass computes the same position, so depths of both passes have to match exactly
+invariant gl_Position;
+
 void main() 
 {
+#ifdef OBJECT_STORAGE
+	const uint objectIndex = drawOrder[firstObject + gl_InstanceID];
+	const mat4 model = objects[objectIndex].model;
+	const mat3 normalMatrix = mat3(objects[objectIndex].normalMatrix);
+	outAttributes.materialIndex = objects[objectIndex].materialIndex;
+#else
 	const mat3 normalMatrix = mat3(transpose(inverse(model)));
+#endif
 	const vec3 normal = normalize(normalMatrix * in_normal);
 	const vec3 tangent = normalize(normalMatrix * in_tangent);
 	const vec3 bitangent = normalize(cross(normal, tangent));
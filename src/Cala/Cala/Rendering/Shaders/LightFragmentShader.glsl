@@ -1,12 +1,16 @@
 #version 440 core
 
+#ifdef BINDLESS_TEXTURES
+#extension GL_ARB_bindless_texture : require
+#endif
+
 #define DIFFUSE 0 
 #define SPECULAR 1
 #define NORMAL 2
 
-#define MAX_LIGHTS_COUNT 8
+// Permutation defines (injected by LightRenderer): DIFFUSE_MAP, SPECULAR_MAP, NORMAL_MAP, SHADOWS, CEL_SHADING, OBJECT_STORAGE, BINDLESS_TEXTURES
 
-#define BIT(x) (1 << x)
+#include "Lighting.glsl"
 
 struct Material {
 	vec4 color;
@@ -16,35 +20,18 @@ struct Material {
 	float shininess;
 };
 
-struct Light {
-	vec3 position;
-	vec3 color;
-	vec3 direction;
-	float constant;
-	float linear;
-	float quadratic;
-	float cutoff;
-	mat4 projection;
-};
-
 in Attributes {
 	vec3 fragPosition;
 	mat3 TBN;
 	vec2 texCoords;
+#ifdef OBJECT_STORAGE
+	flat uint materialIndex;
+#endif
 } inAttributes;
 
-layout (binding = 4) uniform LightsData 
-{
-	Light lights[MAX_LIGHTS_COUNT];
-	uint lightSourceCount;
-	bool shadows;
-	uint celShadingLevelCount;
-};
-
 layout (binding = 2) uniform MeshData
 {
 	Material material;
-	uint state;
 	bool lightened;
 };
 
@@ -56,245 +43,40 @@ layout (binding = 0) uniform MVP
 	vec3 eyePosition;
 };
 
+#ifdef OBJECT_STORAGE
+#include "Materials.glsl"
+#include "Textures.glsl"
+#else
 layout (binding = DIFFUSE) uniform sampler2D diffuseMap;
 layout (binding = SPECULAR) uniform sampler2D specularMap;
 layout (binding = NORMAL) uniform sampler2D normalMap;
-layout (binding = 3) uniform sampler2DArrayShadow shadowMaps;
+#endif
 
 out vec4 outColor;
-vec3 normal;
-vec3 lightViewPosition;
-
-float attenuation(const Light light) 
-{
-	float distance = length(light.position - inAttributes.fragPosition);
-	float attenuation = 1.0 / (light.constant + light.linear * distance * light.quadratic * distance * distance);
-	return attenuation;
-}
-
-bool isPoint(const Light light)
-{
-	return light.cutoff < -1.5f;
-}
-
-bool isDirectional(const Light light)
-{
-	return light.constant < 0.9f;
-}
-
-bool isSpotlight(const Light light)
-{
-	return !isPoint(light) && !isDirectional(light);
-}
-
-mat4 calculateLightViewMatrix(const Light light, const vec3 direction)
-{
-	vec3 up = vec3(0.f, 1.f, 0.f);
-	if (abs(direction.x) < 1e-7 && abs(direction.z) < 1e-7) 
-		up.x = 0.001f;
-
-	vec3 right = normalize(cross(up, direction)); // Get first perpendicular vector from random up and direction
-	up = cross(direction, right); // Get third perpendicular vector from direction, and right
-
-	mat4 view = transpose(mat4(
-		vec4(right, 0.f), // Right
-		vec4(up, 0.f), // Up
-		vec4(-direction, 0.f), // Direction (inverse)
-		vec4(0.f, 0.f, 0.f, 1.f)
-	));
-
-	mat4 translation = mat4(1.f);
-	translation[3] = vec4(-light.position, 1.f);
-	view = view * translation;
-
-	return view;
-}
-
-float shadowFactor(const Light light, out uint shadowMapCounter)
-{
-	if (!shadows || light.projection == mat4(0.f))
-		return 0.f;
-
-	mat4 view;
-	uint shadowMapIndex = shadowMapCounter;
-	if (!isPoint(light))
-	{
-		view = calculateLightViewMatrix(light, light.direction);
-		shadowMapCounter++;
-	}
-	else
-	{
-		vec3 direction = normalize(inAttributes.fragPosition - light.position);
-		vec3 lightDirection = vec3(0.f);
-		if (abs(direction.x) > abs(direction.y) && abs(direction.x) > abs(direction.z))
-			if (direction.x > 0)
-			{
-				shadowMapIndex += 0;
-				lightDirection.x = 1.f;
-			}
-			else
-			{
-				shadowMapIndex += 1;
-				lightDirection.x = -1.f;
-			} 
-		else if (abs(direction.y) > abs(direction.z))
-			if (direction.y > 0)
-			{
-				shadowMapIndex += 2;
-				lightDirection.y = 1.f;
-			}
-			else
-			{
-				shadowMapIndex += 3;
-				lightDirection.y = -1.f;
-			} 
-		else
-			if (direction.z > 0)
-			{
-				shadowMapIndex += 4;
-				lightDirection.z = 1.f;
-			}
-			else
-			{
-				shadowMapIndex += 5;
-				lightDirection.z = -1.f;
-			} 
-
-		view = calculateLightViewMatrix(light, lightDirection);
-		shadowMapCounter += 6;
-	}
-
-	vec4 lightViewPositionClip = light.projection * view * vec4(inAttributes.fragPosition, 1.f);
-	lightViewPosition = lightViewPositionClip.xyz / lightViewPositionClip.w;
-	lightViewPosition = lightViewPosition * 0.5f + 0.5f;
-
-    const float currentDepth = lightViewPosition.z;
-	if (currentDepth >= 1.f)
-        return 0.f;
-
-	const float bias = 1e-3;
-    float shadow = texture(shadowMaps, vec4(lightViewPosition.xy, shadowMapIndex, currentDepth - bias));
-
-	// PCF
-	/* vec2 texelSize = 1.f / textureSize(shadowMaps, 0).xy;
-	for (int x = -1; x <= 1; ++x)
-	{
-		for(int y = -1; y <= 1; ++y)
-		{
-			float pcfDepth = texture(shadowMaps, vec3(lightViewPosition.xy + vec2(x, y) * texelSize, shadowMapIndex)).r; 
-			shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;        
-		}    
-	} 
-
-	shadow /= 9.f; */
-
-    return shadow;
-}
-
-float getCelShadingFactor(float factor)
-{
-	const float threshold = 1.f / (celShadingLevelCount - 1);
-	for (uint i = 0; i <= celShadingLevelCount; ++i)
-	{
-		if (abs(factor - threshold * i) <= threshold / 2)
-			return i * threshold;
-	}
-}
-
-vec3 calculatePointLight(inout vec3 colorAmbient, inout vec3 colorDiffuse, inout vec3 colorSpecular, inout vec3 eyeDirection, const Light light, out uint shadowMapCounter) 
-{
-	// ambient
-	vec3 ambientComponent = colorAmbient; 
-
-	// diffuse
-	vec3 lightDirection = normalize(light.position - inAttributes.fragPosition);
-	float lightAngle = max(dot(lightDirection, normal), 0.0f);
-
-	// specular
-	// vec3 reflectedLight = reflect(-lightDirection, normal);
-	vec3 halfwayVector = normalize(lightDirection + eyeDirection);
-	float eyeAngle = pow(max(dot(halfwayVector, normal), 0.0), material.shininess);
-
-	if (celShadingLevelCount != 0)
-	{
-		lightAngle = getCelShadingFactor(lightAngle);
-		eyeAngle = getCelShadingFactor(eyeAngle);
-	}
-
-	vec3 diffuseComponent = colorDiffuse * light.color * lightAngle;
-	vec3 specularComponent = colorSpecular * light.color * eyeAngle;
-		
-	vec3 result = ambientComponent + ((diffuseComponent + specularComponent) * attenuation(light) * (1.f - shadowFactor(light, shadowMapCounter)));
-	return result;
-}
-
-
-vec3 calculateDirectionalLight(inout vec3 colorAmbient, inout vec3 colorDiffuse, inout vec3 colorSpecular, inout vec3 eyeDirection, const Light light, out uint shadowMapCounter)
-{
-	// ambient
-	vec3 ambientComponent = colorAmbient;
-
-	// diffuse
-	vec3 lightDirection = normalize(-light.direction);
-	float lightAngle = max(dot(lightDirection, normal), 0.0f);
-
-	// specular
-	// vec3 reflectedLight = reflect(-lightDirection, normal);
-	vec3 halfwayVector = normalize(lightDirection + eyeDirection);
-	float eyeAngle = pow(max(dot(halfwayVector, normal), 0.0f), material.shininess);
-
-	if (celShadingLevelCount != 0)
-	{
-		lightAngle = getCelShadingFactor(lightAngle);
-		eyeAngle = getCelShadingFactor(eyeAngle);
-	}
-
-	vec3 diffuseComponent = colorDiffuse * light.color * lightAngle;
-	vec3 specularComponent = colorSpecular * light.color * eyeAngle;
-		
-	vec3 result = ambientComponent + (diffuseComponent + specularComponent) * (1.f - shadowFactor(light, shadowMapCounter));
-
-	return result;
-}
-
 
-vec3 calculateSpotlightLight(inout vec3 colorAmbient, inout vec3 colorDiffuse, inout vec3 colorSpecular, inout vec3 eyeDirection, const Light light, out uint shadowMapCounter)
+// Material texture of the shaded object bound to given unit
+vec4 sampleMap(uint unit)
 {
-	// ambient
-	vec3 ambientComponent = colorAmbient; 
-
-	// diffuse
-	vec3 lightDirection = normalize(light.position - inAttributes.fragPosition);
-	float theta = dot(normalize(-light.direction), lightDirection);
-	float epsilon = 0.12;
-	float outerCutOff = light.cutoff - epsilon;
-	if (theta < outerCutOff) 
-		return ambientComponent;
-
-	float lightAngle = max(dot(lightDirection, normal), 0.f);
-
-	// specular
-	// vec3 reflectedLight = reflect(-lightDirection,inAttributes. normal);
-	vec3 halfwayVector = normalize(lightDirection + eyeDirection);
-	float eyeAngle = pow(max(dot(halfwayVector, normal), 0.0), material.shininess);
-
-	if (celShadingLevelCount != 0)
-	{
-		lightAngle = getCelShadingFactor(lightAngle);
-		eyeAngle = getCelShadingFactor(eyeAngle);
-	}
-
-	vec3 diffuseComponent = colorDiffuse * light.color * lightAngle;
-	vec3 specularComponent = colorSpecular * light.color * eyeAngle;
-	float intensity = clamp((theta - outerCutOff) / epsilon, 0.0, 1.0);
-	vec3 result = ambientComponent + ((diffuseComponent + specularComponent) * intensity * attenuation(light) * (1.f - shadowFactor(light, shadowMapCounter)));
-
-	return result;
+#ifdef OBJECT_STORAGE
+	return sampleMaterialTexture(unit, materials[inAttributes.materialIndex].textures[unit], inAttributes.texCoords);
+#else
+	if (unit == DIFFUSE)
+		return texture(diffuseMap, inAttributes.texCoords);
+	else if (unit == SPECULAR)
+		return texture(specularMap, inAttributes.texCoords);
+
+	return texture(normalMap, inAttributes.texCoords);
+#endif
 }
 
-
 void main() 
 {
+#ifdef OBJECT_STORAGE
+	const MaterialData materialData = materials[inAttributes.materialIndex];
+	const Material material = Material(materialData.color, materialData.ambientCoefficient, materialData.diffuseCoefficient, 
+		materialData.specularCoefficient, materialData.shininess);
+#endif
+
 	if (!lightened)
 	{
 		outColor = material.color;
@@ -306,56 +88,44 @@ void main()
 	vec3 colorAmbient;
 	float alpha;
 
-	if ((state & BIT(DIFFUSE)) != 0)
-	{
-		vec4 diffuseMapSample = texture(diffuseMap, inAttributes.texCoords);
-		colorAmbient = diffuseMapSample.rgb * material.ambientCoefficient;
-		colorDiffuse = diffuseMapSample.rgb * material.diffuseCoefficient;
-		colorSpecular = diffuseMapSample.rgb * material.specularCoefficient;
-		alpha = diffuseMapSample.a > 0.f ? diffuseMapSample.a : material.color.a;
-	} 
-	else 
-	{
-		colorAmbient = material.color.rgb * material.ambientCoefficient;
-		colorDiffuse = material.color.rgb * material.diffuseCoefficient;
-		colorSpecular = material.color.rgb * material.specularCoefficient;
-		alpha = material.color.a;
-	}
-
-	if ((state & BIT(SPECULAR)) != 0) 
-	{
-		colorSpecular = texture(specularMap, inAttributes.texCoords).rgb;
-	}
-
-	if ((state & BIT(NORMAL)) != 0)
-	{
-		normal = texture(normalMap, inAttributes.texCoords).xyz;
-		normal = normalize(inAttributes.TBN * (normal * 2.0 - 1.0));
-	}
-	else
-	{
-		normal = inAttributes.TBN[2];
-	}
-
+#ifdef DIFFUSE_MAP
+	vec4 diffuseMapSample = sampleMap(DIFFUSE);
+	colorAmbient = diffuseMapSample.rgb * material.ambientCoefficient;
+	colorDiffuse = diffuseMapSample.rgb * material.diffuseCoefficient;
+	colorSpecular = diffuseMapSample.rgb * material.specularCoefficient;
+	alpha = diffuseMapSample.a > 0.f ? diffuseMapSample.a : material.color.a;
+#else
+	colorAmbient = material.color.rgb * material.ambientCoefficient;
+	colorDiffuse = material.color.rgb * material.diffuseCoefficient;
+	colorSpecular = material.color.rgb * material.specularCoefficient;
+	alpha = material.color.a;
+#endif
+
+#ifdef SPECULAR_MAP
+	colorSpecular = sampleMap(SPECULAR).rgb;
+#endif
+
+	vec3 normal;
+#ifdef NORMAL_MAP
+	// Z is rebuilt from XY, so two channel BC5 maps work as well as RGB ones, tangent space normals never point inwards
+	normal.xy = sampleMap(NORMAL).xy * 2.0 - 1.0;
+	normal.z = sqrt(max(0.0, 1.0 - dot(normal.xy, normal.xy)));
+	normal = normalize(inAttributes.TBN * normal);
+#else
+	normal = inAttributes.TBN[2];
+#endif
+
+	// Shadow casting lights use consecutive shadow map layers in order of lights
 	uint shadowMapCounter = 0;
-	vec4 color = vec4(0.f, 0.f, 0.f, alpha);
+	vec3 eyeDirection = normalize(eyePosition - inAttributes.fragPosition);
+	vec4 color = vec4(colorAmbient * lightSourceCount, alpha);
 	for (uint lightCounter = 0; lightCounter < lightSourceCount; ++lightCounter)
 	{
-		vec3 eyeDirection = normalize(eyePosition - inAttributes.fragPosition);
 		const Light light = lights[lightCounter];
-		if (isDirectional(light)) 
-		{
-			color.rgb += calculateDirectionalLight(colorAmbient, colorDiffuse, colorSpecular, eyeDirection, light, shadowMapCounter);
-		}
-		else if (isPoint(light))
-		{
-			color.rgb += calculatePointLight(colorAmbient, colorDiffuse, colorSpecular, eyeDirection, light, shadowMapCounter);
-		}
-		else
-		{
-			color.rgb += calculateSpotlightLight(colorAmbient, colorDiffuse, colorSpecular, eyeDirection, light, shadowMapCounter);
-		}
+		color.rgb += calculateLight(light, inAttributes.fragPosition, normal, eyeDirection, colorDiffuse, colorSpecular, 
+			material.shininess, shadowMapCounter);
+		shadowMapCounter += getShadowMapLayerCount(light);
 	}
 
 	outColor = color;
-}
\ No newline at end of file
+}
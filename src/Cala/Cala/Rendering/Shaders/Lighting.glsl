@@ -0,0 +1,155 @@
+// Lights setup and lighting functions shared by forward and deferred lighting shaders
+// Optional defines: SHADOWS, CEL_SHADING
+
+#define MAX_LIGHTS_COUNT 8
+
+struct Light {
+	vec3 position;
+	vec3 color;
+	vec3 direction;
+	float constant;
+	float linear;
+	float quadratic;
+	float cutoff;
+	mat4 projection;
+};
+
+layout (binding = 4) uniform LightsData 
+{
+	Light lights[MAX_LIGHTS_COUNT];
+	uint lightSourceCount;
+	bool shadows;
+	uint celShadingLevelCount;
+};
+
+#include "ShadowLayers.glsl"
+
+layout (binding = 3) uniform sampler2DShadow shadowAtlas;
+
+float attenuation(const Light light, const vec3 fragPosition) 
+{
+	float distance = length(light.position - fragPosition);
+	float attenuation = 1.0 / (light.constant + light.linear * distance * light.quadratic * distance * distance);
+	return attenuation;
+}
+
+bool isPoint(const Light light)
+{
+	return light.cutoff < -1.5f;
+}
+
+bool isDirectional(const Light light)
+{
+	return light.constant < 0.9f;
+}
+
+bool isSpotlight(const Light light)
+{
+	return !isPoint(light) && !isDirectional(light);
+}
+
+bool isShadowCaster(const Light light)
+{
+	return light.projection != mat4(0.f);
+}
+
+// Number of shadow map layers used by a light
+uint getShadowMapLayerCount(const Light light)
+{
+	if (!isShadowCaster(light))
+		return 0;
+
+	return isPoint(light) ? 6 : 1;
+}
+
+// First layer of the light is passed in, point lights pick one of their six faces
+float shadowFactor(const Light light, const vec3 fragPosition, uint shadowMapIndex)
+{
+#ifndef SHADOWS
+	return 0.f;
+#else
+	if (!isShadowCaster(light))
+		return 0.f;
+
+	if (isPoint(light))
+	{
+		vec3 direction = fragPosition - light.position;
+		if (abs(direction.x) > abs(direction.y) && abs(direction.x) > abs(direction.z))
+			shadowMapIndex += direction.x > 0 ? 0u : 1u;
+		else if (abs(direction.y) > abs(direction.z))
+			shadowMapIndex += direction.y > 0 ? 2u : 3u;
+		else
+			shadowMapIndex += direction.z > 0 ? 4u : 5u;
+	}
+
+	vec4 lightViewPositionClip = layerMatrices[shadowMapIndex] * vec4(fragPosition, 1.f);
+	vec3 lightViewPosition = lightViewPositionClip.xyz / lightViewPositionClip.w;
+	lightViewPosition = lightViewPosition * 0.5f + 0.5f;
+
+	const float currentDepth = lightViewPosition.z;
+	if (currentDepth >= 1.f || any(lessThan(lightViewPosition.xy, vec2(0.f))) || any(greaterThan(lightViewPosition.xy, vec2(1.f))))
+		return 0.f;
+
+	// Filtered lookups are kept half a texel inside the tile, so they don't blend with neighbouring tiles
+	const vec4 tile = layerTiles[shadowMapIndex];
+	const vec2 halfTexel = 0.5f / vec2(textureSize(shadowAtlas, 0));
+	vec2 atlasPosition = clamp(tile.xy + lightViewPosition.xy * tile.zw, tile.xy + halfTexel, tile.xy + tile.zw - halfTexel);
+
+	const float bias = 1e-3;
+	return texture(shadowAtlas, vec3(atlasPosition, currentDepth - bias));
+#endif
+}
+
+float getCelShadingFactor(float factor)
+{
+	const float threshold = 1.f / (celShadingLevelCount - 1);
+	for (uint i = 0; i <= celShadingLevelCount; ++i)
+	{
+		if (abs(factor - threshold * i) <= threshold / 2)
+			return i * threshold;
+	}
+}
+
+// Diffuse and specular contribution of a light, ambient term doesn't depend on the light and is added by the caller
+vec3 calculateLight(const Light light, const vec3 fragPosition, const vec3 normal, const vec3 eyeDirection, 
+	const vec3 colorDiffuse, const vec3 colorSpecular, float shininess, uint shadowMapIndex)
+{
+	// diffuse
+	vec3 lightDirection;
+	float intensity = 1.f;
+	if (isDirectional(light))
+	{
+		lightDirection = normalize(-light.direction);
+	}
+	else
+	{
+		lightDirection = normalize(light.position - fragPosition);
+		intensity = attenuation(light, fragPosition);
+		if (isSpotlight(light))
+		{
+			float theta = dot(normalize(-light.direction), lightDirection);
+			float epsilon = 0.12;
+			float outerCutOff = light.cutoff - epsilon;
+			if (theta < outerCutOff) 
+				return vec3(0.f);
+
+			intensity *= clamp((theta - outerCutOff) / epsilon, 0.0, 1.0);
+		}
+	}
+
+	float lightAngle = max(dot(lightDirection, normal), 0.f);
+
+	// specular
+	// vec3 reflectedLight = reflect(-lightDirection, normal);
+	vec3 halfwayVector = normalize(lightDirection + eyeDirection);
+	float eyeAngle = pow(max(dot(halfwayVector, normal), 0.0), shininess);
+
+#ifdef CEL_SHADING
+	lightAngle = getCelShadingFactor(lightAngle);
+	eyeAngle = getCelShadingFactor(eyeAngle);
+#endif
+
+	vec3 diffuseComponent = colorDiffuse * light.color * lightAngle;
+	vec3 specularComponent = colorSpecular * light.color * eyeAngle;
+	return (diffuseComponent + specularComponent) * intensity * (1.f - shadowFactor(light, fragPosition, shadowMapIndex));
+}
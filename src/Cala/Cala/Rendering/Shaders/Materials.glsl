@@ -0,0 +1,15 @@
+// Deduplicated materials registered with MaterialRegistry, read by shaders compiled with OBJECT_STORAGE
+
+struct MaterialData {
+	vec4 color;
+	float ambientCoefficient;
+	float diffuseCoefficient;
+	float specularCoefficient;
+	float shininess;
+	uvec4 textures; // Indices into TextureTable of diffuse, specular and normal map
+};
+
+layout (std430, binding = 3) readonly buffer Materials
+{
+	MaterialData materials[];
+};
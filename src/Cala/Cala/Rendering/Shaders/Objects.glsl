@@ -0,0 +1,24 @@
+// Per-object data of renderables registered with RenderProxies, read by shaders compiled with OBJECT_STORAGE
+
+struct ObjectData {
+	mat4 model;
+	mat4 normalMatrix;
+	uint materialIndex; // Index into Materials
+};
+
+layout (std430, binding = 0) readonly buffer Objects
+{
+	ObjectData objects[];
+};
+
+// Objects in order of drawing, instances of a draw read consecutive entries
+layout (std430, binding = 1) readonly buffer DrawOrder
+{
+	uint drawOrder[];
+};
+
+// Position of first instance of the draw in draw order, the only value uploaded per draw
+layout (binding = 8) uniform DrawData
+{
+	uint firstObject;
+};
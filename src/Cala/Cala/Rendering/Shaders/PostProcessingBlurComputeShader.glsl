@@ -0,0 +1,74 @@
+#version 440 core
+
+#define BOX_BLUR 2
+#define GAUSSIAN_BLUR 4
+
+// Pixels blurred by a workgroup along the pass axis, taps reach at most MAX_RADIUS pixels to each side
+#define TILE_SIZE 256
+#define MAX_RADIUS 64
+
+layout (local_size_x = TILE_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+layout (binding = 6) uniform EffectValues {
+	uint effect;
+	float effectStrength;
+};
+
+layout (binding = 0) uniform sampler2D scene;
+layout (binding = 0, rgba8) uniform writeonly image2D blurredScene;
+
+shared vec3 tile[TILE_SIZE + 2 * MAX_RADIUS];
+shared float weights[MAX_RADIUS + 1];
+
+// Positions are processed as (position along pass axis, line), vertical pass swaps them
+ivec2 toImage(in ivec2 position)
+{
+#ifdef VERTICAL_PASS
+	return position.yx;
+#else
+	return position;
+#endif
+}
+
+void main()
+{
+	const ivec2 size = toImage(textureSize(scene, 0));
+	const int line = int(gl_WorkGroupID.y);
+	const int tileStart = int(gl_WorkGroupID.x) * TILE_SIZE;
+	const int localIndex = int(gl_LocalInvocationID.x);
+
+	// Footprint matches fragment blurs, whose taps are offset by a fraction of the scene size
+	const float offset = 1.f / clamp(900.f - effectStrength, 50.f, 900.f);
+	const float footprint = max(offset * float(size.x), 1.f);
+
+	// Gaussian of fragment blur's 1-2-1 kernel has sigma of footprint / sqrt(2), it's cut off at 2 footprints
+	const bool gaussian = effect == GAUSSIAN_BLUR;
+	const int radius = min(int(round(gaussian ? 2.f * footprint : footprint)), MAX_RADIUS);
+
+	// Tile and its apron are fetched once, every tap reads shared memory afterwards
+	for (int i = localIndex; i < TILE_SIZE + 2 * radius; i += TILE_SIZE)
+	{
+		const int position = clamp(tileStart - radius + i, 0, size.x - 1);
+		tile[i] = texelFetch(scene, toImage(ivec2(position, line)), 0).rgb;
+	}
+
+	if (localIndex <= radius)
+		weights[localIndex] = gaussian ? exp(-float(localIndex * localIndex) / (footprint * footprint)) : 1.f;
+
+	memoryBarrierShared();
+	barrier();
+
+	const int position = tileStart + localIndex;
+	if (position >= size.x)
+		return;
+
+	vec3 result = tile[localIndex + radius] * weights[0];
+	float weightSum = weights[0];
+	for (int i = 1; i <= radius; ++i)
+	{
+		result += (tile[localIndex + radius - i] + tile[localIndex + radius + i]) * weights[i];
+		weightSum += 2.f * weights[i];
+	}
+
+	imageStore(blurredScene, toImage(ivec2(position, line)), vec4(result / weightSum, 1.f));
+}
@@ -6,10 +6,11 @@
 #define EDGE_DETECTION 3
 #define GAUSSIAN_BLUR 4
 #define NEGATIVE 5
-#define HORIZONTAL_PASS_GAUSSIAN_BLUR 6
-#define VERTICAL_PASS_GAUSSIAN_BLUR 7
+#define DOWNSAMPLE 6
+#define UPSAMPLE 7
 #define EXTRACT 8
 #define COPY 9
+#define UPSCALE 10
 
 in vec2 texCoords;
 out vec4 outColor;
@@ -17,6 +18,8 @@ out vec4 outColor;
 layout (binding = 6) uniform EffectValues {
 	uint effect;
 	float effectStrength;
+	// Strengths of per pixel effects applied after the effect in fused passes
+	vec4 operationStrengths[2];
 };
 
 layout (binding = 0) uniform sampler2D scene;
@@ -104,44 +107,60 @@ vec3 boxBlur()
 	return col;
 }
 
-vec3 negative()
+vec3 negative(in vec3 color)
 {
-	vec3 texSample = texture(scene, texCoords).rgb;
-	return vec3(1.f - texSample);
+	return vec3(1.f) - color;
 }
 
-vec3 twoPassGaussianBlur(in bool horizontal)
+vec3 hdr(in vec3 color, in float exposure)
 {
-	float weights[10] = float[](
-		0.227027, 0.1945946, 0.1216216, 0.054054, 0.016216,
-		0.0124057, 0.01005246, 0.0092616, 0.007454, 0.0042616
-	);
+	return vec3(1.f) - exp(-color * exposure);
+}
 
-	vec2 texelSize = 1.f / textureSize(scene, 0);
-	vec3 result = texture(scene, texCoords).rgb * weights[0];
-	if (horizontal)
-	{
-		for (int i = 1; i < 10; ++i)
-		{
-			result += texture(scene, texCoords + vec2(texelSize.x * i, 0.0)).rgb * weights[i];
-			result += texture(scene, texCoords - vec2(texelSize.x * i, 0.0)).rgb * weights[i];
-		}
-	}
-	else 
-	{
-		for (int i = 1; i < 10; ++i) 
-		{
-			result += texture(scene, texCoords + vec2(0.0, texelSize.y * i)).rgb * weights[i];
-			result += texture(scene, texCoords - vec2(0.0, texelSize.y * i)).rgb * weights[i];
-		}
-	}
-	
+// 13 taps of source at twice the resolution, as overlapping 4x4 boxes, averages without aliasing of small highlights
+vec3 downsample()
+{
+	const vec2 texelSize = 1.f / vec2(textureSize(scene, 0));
+	const vec3 a = texture(scene, texCoords + texelSize * vec2(-2.f, 2.f)).rgb;
+	const vec3 b = texture(scene, texCoords + texelSize * vec2(0.f, 2.f)).rgb;
+	const vec3 c = texture(scene, texCoords + texelSize * vec2(2.f, 2.f)).rgb;
+	const vec3 d = texture(scene, texCoords + texelSize * vec2(-2.f, 0.f)).rgb;
+	const vec3 e = texture(scene, texCoords).rgb;
+	const vec3 f = texture(scene, texCoords + texelSize * vec2(2.f, 0.f)).rgb;
+	const vec3 g = texture(scene, texCoords + texelSize * vec2(-2.f, -2.f)).rgb;
+	const vec3 h = texture(scene, texCoords + texelSize * vec2(0.f, -2.f)).rgb;
+	const vec3 i = texture(scene, texCoords + texelSize * vec2(2.f, -2.f)).rgb;
+	const vec3 j = texture(scene, texCoords + texelSize * vec2(-1.f, 1.f)).rgb;
+	const vec3 k = texture(scene, texCoords + texelSize * vec2(1.f, 1.f)).rgb;
+	const vec3 l = texture(scene, texCoords + texelSize * vec2(-1.f, -1.f)).rgb;
+	const vec3 m = texture(scene, texCoords + texelSize * vec2(1.f, -1.f)).rgb;
+
+	vec3 result = e * 0.125f;
+	result += (a + c + g + i) * 0.03125f;
+	result += (b + d + f + h) * 0.0625f;
+	result += (j + k + l + m) * 0.125f;
 	return result;
 }
 
+// 3x3 tent filter of source at half the resolution
+vec3 upsample(in sampler2D source)
+{
+	const vec2 texelSize = 1.f / vec2(textureSize(source, 0));
+	vec3 result = texture(source, texCoords).rgb * 4.f;
+	result += texture(source, texCoords + vec2(-texelSize.x, 0.f)).rgb * 2.f;
+	result += texture(source, texCoords + vec2(texelSize.x, 0.f)).rgb * 2.f;
+	result += texture(source, texCoords + vec2(0.f, -texelSize.y)).rgb * 2.f;
+	result += texture(source, texCoords + vec2(0.f, texelSize.y)).rgb * 2.f;
+	result += texture(source, texCoords + vec2(-texelSize.x, -texelSize.y)).rgb;
+	result += texture(source, texCoords + vec2(texelSize.x, -texelSize.y)).rgb;
+	result += texture(source, texCoords + vec2(-texelSize.x, texelSize.y)).rgb;
+	result += texture(source, texCoords + vec2(texelSize.x, texelSize.y)).rgb;
+	return result / 16.f;
+}
+
 vec4 extract()
 {
-	const vec3 texSample = texture(scene, texCoords).rgb;
+	const vec3 texSample = downsample();
 	const vec3 intensityWeights = vec3(0.2126f, 0.7152f, 0.0722f);
 
 	if (dot(intensityWeights, texSample) >= 1.f) 
@@ -150,12 +169,73 @@ vec4 extract()
 		return vec4(0.f, 0.f, 0.f, 1.f);
 }
 
+// Catmull-Rom filter of 4x4 texels through 9 bilinear samples, keeps upscaled scene sharper than bilinear filtering
+vec3 upscale()
+{
+	const vec2 sceneSize = vec2(textureSize(scene, 0));
+	const vec2 samplePosition = texCoords * sceneSize;
+	const vec2 texelCenter = floor(samplePosition - 0.5f) + 0.5f;
+	const vec2 f = samplePosition - texelCenter;
+
+	const vec2 w0 = f * (-0.5f + f * (1.f - 0.5f * f));
+	const vec2 w1 = 1.f + f * f * (-2.5f + 1.5f * f);
+	const vec2 w2 = f * (0.5f + f * (2.f - 1.5f * f));
+	const vec2 w3 = f * f * (-0.5f + 0.5f * f);
+
+	// Two middle texels are read by one bilinear sample placed between them by their weights
+	const vec2 w12 = w1 + w2;
+	const vec2 coords0 = (texelCenter - 1.f) / sceneSize;
+	const vec2 coords12 = (texelCenter + w2 / w12) / sceneSize;
+	const vec2 coords3 = (texelCenter + 2.f) / sceneSize;
+
+	vec3 result = texture(scene, vec2(coords0.x, coords0.y)).rgb * w0.x * w0.y;
+	result += texture(scene, vec2(coords12.x, coords0.y)).rgb * w12.x * w0.y;
+	result += texture(scene, vec2(coords3.x, coords0.y)).rgb * w3.x * w0.y;
+
+	result += texture(scene, vec2(coords0.x, coords12.y)).rgb * w0.x * w12.y;
+	result += texture(scene, vec2(coords12.x, coords12.y)).rgb * w12.x * w12.y;
+	result += texture(scene, vec2(coords3.x, coords12.y)).rgb * w3.x * w12.y;
+
+	result += texture(scene, vec2(coords0.x, coords3.y)).rgb * w0.x * w3.y;
+	result += texture(scene, vec2(coords12.x, coords3.y)).rgb * w12.x * w3.y;
+	result += texture(scene, vec2(coords3.x, coords3.y)).rgb * w3.x * w3.y;
+
+	// Negative lobes may overshoot around sharp edges
+	return max(result, vec3(0.f));
+}
+
+#ifdef FUSED_PASS
+vec3 fusedSource()
+{
+#if FUSED_SOURCE == BLOOM
+	return texture(scene, texCoords).rgb + upsample(bloomedScene) / effectStrength;
+#elif FUSED_SOURCE == BOX_BLUR
+	return boxBlur();
+#elif FUSED_SOURCE == EDGE_DETECTION
+	return edgeDetection();
+#elif FUSED_SOURCE == GAUSSIAN_BLUR
+	return gaussianBlurKernel();
+#elif FUSED_SOURCE == UPSCALE
+	return upscale();
+#else
+	return texture(scene, texCoords).rgb;
+#endif
+}
+
+// Source effect followed by per pixel effects, APPLY_OPERATIONS is generated by the renderer
+void main()
+{
+	vec3 color = fusedSource();
+	APPLY_OPERATIONS
+	outColor = vec4(color, 1.f);
+}
+#else
 void main()
 {
 	switch (effect)
 	{ 
 		case NEGATIVE:
-			outColor = vec4(negative(), 1.f);
+			outColor = vec4(negative(texture(scene, texCoords).rgb), 1.f);
 			break;
 		case BOX_BLUR:
 			outColor = vec4(boxBlur(), 1.f);
@@ -167,22 +247,27 @@ void main()
 			outColor = vec4(gaussianBlurKernel(), 1.f);
 			break;
 		case HDR:
-			outColor = vec4(vec3(1.f) - exp(-texture(scene, texCoords).rgb * effectStrength), 1.f);
+			outColor = vec4(hdr(texture(scene, texCoords).rgb, effectStrength), 1.f);
 			break;
-		case HORIZONTAL_PASS_GAUSSIAN_BLUR:
-			outColor = vec4(twoPassGaussianBlur(true), 1.f);
+		case DOWNSAMPLE:
+			outColor = vec4(downsample(), 1.f);
 			break;
-		case VERTICAL_PASS_GAUSSIAN_BLUR:
-			outColor = vec4(twoPassGaussianBlur(false), 1.f);
+		case UPSAMPLE:
+			outColor = vec4(upsample(scene), 1.f);
 			break;
 		case EXTRACT:
 			outColor = extract();
 			break;
 		case BLOOM:
-			outColor = vec4(texture(scene, texCoords).rgb + texture(bloomedScene, texCoords).rgb, 1.f);
+			// Strength holds number of accumulated bloom mips
+			outColor = vec4(texture(scene, texCoords).rgb + upsample(bloomedScene) / effectStrength, 1.f);
 			break;
 		case COPY:
 			outColor = vec4(texture(scene, texCoords).rgb, 1.f);
 			break;
+		case UPSCALE:
+			outColor = vec4(upscale(), 1.f);
+			break;
 	}
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,12 @@
+// Shadow atlas layers shared by shadow pass and lighting shaders, binding is kept up to date by ShadowMapRenderer
+
+// MAX_LIGHTS_COUNT point lights * 6 cubemap faces
+#define MAX_SHADOW_MAP_LAYERS 48
+
+layout (binding = 5) uniform ShadowLayers
+{
+	mat4 layerMatrices[MAX_SHADOW_MAP_LAYERS];
+	vec4 layerTiles[MAX_SHADOW_MAP_LAYERS]; // Offset and size of layer's tile in atlas texture coordinates
+	ivec4 instanceLayers[MAX_SHADOW_MAP_LAYERS / 4]; // Layer of each instance, packed four per element
+	mat4 model;
+};
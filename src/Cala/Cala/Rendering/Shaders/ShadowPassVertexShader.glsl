@@ -1,16 +1,21 @@
 #version 440 core
+#include "ShadowLayers.glsl"
 
 layout (location = 0) in vec3 in_position;
 
-layout (binding = 0) uniform MVP 
-{
-	mat4 model;
-	mat4 view;
-	mat4 projection;
-	vec3 eyePosition;
-};
-
 void main()
 {
-    gl_Position = model * vec4(in_position, 1.f);
-}
\ No newline at end of file
+	const int layer = instanceLayers[gl_InstanceID / 4][gl_InstanceID % 4];
+	vec4 position = layerMatrices[layer] * model * vec4(in_position, 1.f);
+
+	// Clipping to light frustum sides, as the viewport covers the whole atlas and not only the tile
+	gl_ClipDistance[0] = position.w - position.x;
+	gl_ClipDistance[1] = position.w + position.x;
+	gl_ClipDistance[2] = position.w - position.y;
+	gl_ClipDistance[3] = position.w + position.y;
+
+	// Remapping [-w, w] to the tile, linear in clip space so interpolation stays perspective correct
+	const vec4 tile = layerTiles[layer];
+	position.xy = ((position.xy + position.w) * 0.5f * tile.zw + tile.xy * position.w) * 2.f - position.w;
+	gl_Position = position;
+}
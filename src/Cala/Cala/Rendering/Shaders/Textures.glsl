@@ -0,0 +1,33 @@
+// Material textures referenced by index through TextureResidency, included by fragment shaders compiled with OBJECT_STORAGE
+// With BINDLESS_TEXTURES the including shader has to enable GL_ARB_bindless_texture before any declaration
+// Expects DIFFUSE, SPECULAR and NORMAL texture unit defines
+
+// Bindless texture handle, or array index and layer in array bound to unit of the material texture
+layout (std430, binding = 2) readonly buffer TextureTable
+{
+	uvec2 textureEntries[];
+};
+
+#ifndef BINDLESS_TEXTURES
+layout (binding = DIFFUSE) uniform sampler2DArray diffuseMaps;
+layout (binding = SPECULAR) uniform sampler2DArray specularMaps;
+layout (binding = NORMAL) uniform sampler2DArray normalMaps;
+#endif
+
+vec4 sampleMaterialTexture(uint unit, uint textureIndex, vec2 coords)
+{
+	const uvec2 entry = textureEntries[textureIndex];
+#ifdef BINDLESS_TEXTURES
+	// Handle is constant within a primitive, but may differ between instances of one draw
+	return texture(sampler2D(entry), coords);
+#else
+	// Unit is constant at each call, so only one branch remains
+	const vec3 layerCoords = vec3(coords, float(entry.y));
+	if (unit == DIFFUSE)
+		return texture(diffuseMaps, layerCoords);
+	else if (unit == SPECULAR)
+		return texture(specularMaps, layerCoords);
+	
+	return texture(normalMaps, layerCoords);
+#endif
+}
@@ -0,0 +1,75 @@
+#include "StorageBuffer.h"
+#include "Cala/Utility/Logger.h"
+
+namespace Cala {
+#ifdef CALA_API_OPENGL
+#include <glad/glad.h>
+	StorageBuffer::~StorageBuffer()
+	{
+		free();
+	}
+
+	StorageBuffer::StorageBuffer(StorageBuffer&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	StorageBuffer& StorageBuffer::operator=(StorageBuffer&& other) noexcept
+	{
+		size = other.size;
+		bindingPoint = other.bindingPoint;
+		bufferHandle = other.bufferHandle;
+		other.bufferHandle = API_NULL;
+		other.size = 0;
+		return *this;
+	}
+
+	void StorageBuffer::load(uint32_t sizeInBytes, uint32_t _bindingPoint, bool isDynamic)
+	{
+		if (isLoaded())
+		{
+			Logger::getInstance().logErrorToConsole("Storage buffer already loaded!");
+			return;
+		}
+
+		size = sizeInBytes;
+		bindingPoint = _bindingPoint;
+		glGenBuffers(1, &bufferHandle);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufferHandle);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, isDynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
+	}
+
+	void StorageBuffer::free()
+	{
+		glDeleteBuffers(1, &bufferHandle);
+		bufferHandle = API_NULL;
+		size = 0;
+	}
+
+	bool StorageBuffer::isLoaded() const
+	{
+		return bufferHandle != API_NULL;
+	}
+
+	void StorageBuffer::updateData(uint32_t offsetInBytes, const void* data, uint32_t sizeInBytes) const
+	{
+		if (offsetInBytes + sizeInBytes > size)
+		{
+			Logger::getInstance().logErrorToConsole("Storage buffer update out of range!");
+			return;
+		}
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufferHandle);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, offsetInBytes, sizeInBytes, data);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, GL_NONE);
+	}
+
+	void StorageBuffer::bind() const
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingPoint, bufferHandle);
+	}
+#else
+	#error API is not supported
+#endif
+}
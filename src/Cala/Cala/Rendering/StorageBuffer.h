@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+#include "NativeAPI.h"
+#include "GPUResource.h"
+
+namespace Cala {
+	/**
+	 * Shader storage buffer, laid out by the user to match std430 block it's read through
+	*/
+	class StorageBuffer : public GPUResource {
+	public:
+		StorageBuffer() = default;
+		~StorageBuffer();
+		StorageBuffer(const StorageBuffer& other) = delete;
+		StorageBuffer(StorageBuffer&& other) noexcept;
+		StorageBuffer& operator=(const StorageBuffer& other) = delete;
+		StorageBuffer& operator=(StorageBuffer&& other) noexcept;
+
+		void load(uint32_t sizeInBytes, uint32_t bindingPoint, bool isDynamic = false);
+		void free() override;
+		bool isLoaded() const override;
+
+		void updateData(uint32_t offsetInBytes, const void* data, uint32_t sizeInBytes) const;
+		// Storage binding points aren't shared per block like constant buffers, so buffers are bound before use
+		void bind() const;
+		uint32_t getSize() const { return size; }
+		uint32_t getBindingPoint() const { return bindingPoint; }
+
+	private:
+		uint32_t size = 0;
+		uint32_t bindingPoint = 0;
+
+	#ifdef CALA_API_OPENGL
+		GLuint bufferHandle = API_NULL;
+	#endif
+	};
+}
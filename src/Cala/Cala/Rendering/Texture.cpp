@@ -1,7 +1,9 @@
 #include "Texture.h"
 #include <cstring>
+#include <algorithm>
 #include "Framebuffer.h"
 #include "GraphicsAPI.h"
+#include "GLExtensions.h"
 #include "Cala/Utility/Logger.h"
 
 namespace Cala {
@@ -17,13 +19,14 @@ namespace Cala {
         loadCubemapFromImages(images, renderingStyle);
     }
 
-    Texture::Texture(Texture&& other) noexcept : ITexture(std::move(other))
+    Texture::Texture(Texture&& other) noexcept : ITexture(std::move(other)), mipmapCount(other.mipmapCount)
     {
     }
 
     Texture& Texture::operator=(Texture&& other) noexcept
     {
         ITexture::operator=(std::move(other));
+        mipmapCount = other.mipmapCount;
         return *this;
     }
 
@@ -41,12 +44,86 @@ namespace Cala {
         load(spec, texData);
     }
 
+    void Texture::loadCubemapFromFiles(const std::array<std::filesystem::path, 6>& paths, const RenderingStyle& renderingStyle)
+    {
+        std::vector<Image> faces = Image::loadBatch(std::vector<std::filesystem::path>(paths.begin(), paths.end()));
+        std::array<Image, 6> images;
+        for (uint32_t i = 0; i < 6; ++i)
+        {
+            if (faces[i].getData() == nullptr)
+            {
+                Logger::getInstance().logErrorToConsole("Cubemap face " + paths[i].string() + " not loaded!");
+                return;
+            }
+
+            images[i] = std::move(faces[i]);
+        }
+
+        loadCubemapFromImages(images, renderingStyle);
+    }
+
+    std::vector<Texture> Texture::load2DTexturesFromFiles(const std::vector<std::filesystem::path>& paths,
+        const RenderingStyle& renderingStyle, const std::vector<bool>& sRGB)
+    {
+        // Decoding and filtering run on worker threads, uploads stay on the thread of the context
+        std::vector<Image> images = Image::loadBatch(paths);
+        std::vector<Texture> textures(images.size());
+        for (size_t i = 0; i < images.size(); ++i)
+        {
+            if (images[i].getData() == nullptr)
+                continue;
+
+            images[i].generateMipmaps(Image::MipmapFilter::Box, i < sRGB.size() ? sRGB[i] : true);
+            textures[i].load2DTextureFromImage(images[i], renderingStyle);
+        }
+
+        return textures;
+    }
+
     void Texture::load2DTextureFromImage(const Image& image, const RenderingStyle& renderingStyle)
     {
         bool alpha = image.getChannelCount() == 4 ? true : false;
         Specification spec(image.getDimensions().x, image.getDimensions().y,  alpha ? Format::RGBA : Format::RGB, Dimensionality::TwoDimensional);
         spec.renderingStyle = renderingStyle;
-        load(spec, (void*)image.getData());
+
+        std::vector<const void*> levels;
+        for (uint32_t level = 0; level < image.getMipmapCount(); ++level)
+            levels.push_back(image.getMipmapData(level));
+
+        loadMipmaps(spec, levels);
+    }
+
+    void Texture::loadCompressed(const CompressedImage& image, const RenderingStyle& renderingStyle)
+    {
+        if (image.getMipmapCount() == 0)
+        {
+            Logger::getInstance().logErrorToConsole("Compressed image " + image.getPath() + " without data can't be loaded!");
+            return;
+        }
+
+        Specification spec(image.getDimensions().x, image.getDimensions().y, getCompressedFormat(image.getFormat(), image.isSRGB()),
+            Dimensionality::TwoDimensional);
+        spec.renderingStyle = renderingStyle;
+        loadStorage(spec, image.getMipmapCount());
+        if (!isLoaded())
+            return;
+
+        for (uint32_t level = 0; level < mipmapCount; ++level)
+        {
+            const glm::uvec2 dimensions(image.getMipmapDimensions(level));
+            uploadRegion(level, glm::uvec4(0U, 0U, dimensions.x, dimensions.y), image.getMipmapData(level), image.getMipmapSize(level));
+        }
+    }
+
+    ITexture::Format Texture::getCompressedFormat(CompressedImage::Format imageFormat, bool sRGB)
+    {
+        switch (imageFormat)
+        {
+            case CompressedImage::Format::BC1: return sRGB ? Format::GAMMA_BC1_RGBA : Format::BC1_RGBA;
+            case CompressedImage::Format::BC3: return sRGB ? Format::GAMMA_BC3_RGBA : Format::BC3_RGBA;
+            case CompressedImage::Format::BC5: return Format::BC5_RG;
+            default: return sRGB ? Format::GAMMA_BC7_RGBA : Format::BC7_RGBA;
+        }
     }
 
     void Texture::load(const Specification& specification, void* data)
@@ -58,6 +135,11 @@ namespace Cala {
         }
 
         initializeData(specification);
+        if (isCompressed() && data != nullptr)
+        {
+            Logger::getInstance().logErrorToConsole("Compressed texture data has to be loaded from compressed image!");
+            return;
+        }
 
         if (writeOnly)
         {
@@ -80,7 +162,14 @@ namespace Cala {
                 {
                     nativeType = GL_TEXTURE_2D;
                     glBindTexture(nativeType, textureHandle);
-                    glTexImage2D(nativeType, 0, internalFormat, width, height, 0, format, dataType, data);
+                    glTexStorage2D(nativeType, 1, getSizedFormat(internalFormat), width, height);
+                    if (data != nullptr)
+                    {
+                        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                        glTexSubImage2D(nativeType, 0, 0, 0, width, height, format, dataType, data);
+                        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                    }
+
                     setParameters(specification);
                     break;
                 }
@@ -93,10 +182,16 @@ namespace Cala {
                 {
                     nativeType = GL_TEXTURE_CUBE_MAP;
                     glBindTexture(nativeType, textureHandle);
+                    glTexStorage2D(nativeType, 1, getSizedFormat(internalFormat), width, height);
                     const void** texData = reinterpret_cast<const void**>(data);
+                    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
                     for (int i = 0; i < 6; i++)
-                        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, internalFormat, width, height, 0, format, dataType, texData[i]);
+                    {
+                        if (texData != nullptr && texData[i] != nullptr)
+                            glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, 0, 0, width, height, format, dataType, texData[i]);
+                    }
 
+                    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
                     setParameters(specification);
                     break;
                 }
@@ -106,6 +201,135 @@ namespace Cala {
         }
     }
 
+    void Texture::loadMipmaps(const Specification& specification, const std::vector<const void*>& levels)
+    {
+        if (levels.empty())
+        {
+            Logger::getInstance().logErrorToConsole("Texture can't be loaded without mipmaps!");
+            return;
+        }
+
+        loadStorage(specification, (uint32_t)levels.size());
+        if (!isLoaded())
+            return;
+
+        for (uint32_t level = 0; level < mipmapCount; ++level)
+        {
+            if (levels[level] != nullptr)
+                uploadRegion(level, glm::uvec4(0U, 0U, std::max(width >> level, 1), std::max(height >> level, 1)), levels[level], 0);
+        }
+    }
+
+    void Texture::loadStorage(const Specification& specification, uint32_t _mipmapCount)
+    {
+        if (isLoaded())
+        {
+            Logger::getInstance().logErrorToConsole("Texture already loaded!");
+            return;
+        }
+
+        if (specification.dimensionality != Dimensionality::TwoDimensional || specification.writeOnly || _mipmapCount == 0)
+        {
+            Logger::getInstance().logErrorToConsole("Only 2D textures can be loaded with mipmaps!");
+            return;
+        }
+
+        GLint maxSize = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+        const uint32_t maxDimension = std::max(specification.width, specification.height);
+        if (specification.width == 0 || specification.height == 0 || maxDimension > (uint32_t)maxSize ||
+            _mipmapCount > 32 || (maxDimension >> (_mipmapCount - 1)) == 0)
+        {
+            Logger::getInstance().logErrorToConsole("Texture dimensions or mipmap count out of range!");
+            return;
+        }
+
+        const bool s3tc = specification.format == Format::BC1_RGBA || specification.format == Format::GAMMA_BC1_RGBA ||
+            specification.format == Format::BC3_RGBA || specification.format == Format::GAMMA_BC3_RGBA;
+        if (s3tc && !GLExtensions::textureCompressionS3TC)
+        {
+            Logger::getInstance().logErrorToConsole("BC1 and BC3 textures need GL_EXT_texture_compression_s3tc!");
+            return;
+        }
+
+        initializeData(specification);
+        mipmapCount = _mipmapCount;
+        glGenTextures(1, &textureHandle);
+        nativeType = GL_TEXTURE_2D;
+        glBindTexture(nativeType, textureHandle);
+        glTexStorage2D(nativeType, (GLsizei)mipmapCount, isCompressed() ? internalFormat : getSizedFormat(internalFormat), width, height);
+        setParameters(specification, mipmapCount);
+        glBindTexture(nativeType, GL_NONE);
+    }
+
+    void Texture::clearRegion(const glm::uvec4& region) const
+    {
+        if (writeOnly || dimensionality != Dimensionality::TwoDimensional || 
+            region.x + region.z > (uint32_t)width || region.y + region.w > (uint32_t)height)
+        {
+            Logger::getInstance().logErrorToConsole("Cleared texture region out of range!");
+            return;
+        }
+
+        const float depthClearValue = 1.f;
+        glClearTexSubImage(textureHandle, 0, (GLint)region.x, (GLint)region.y, 0, (GLsizei)region.z, (GLsizei)region.w, 1, 
+            format, dataType, isDepth() ? &depthClearValue : nullptr);
+    }
+
+    void Texture::uploadRegion(uint32_t level, const glm::uvec4& region, const void* data, size_t size) const
+    {
+        const glm::uvec2 levelSize(std::max(width >> level, 1), std::max(height >> level, 1));
+        if (writeOnly || dimensionality != Dimensionality::TwoDimensional || level >= mipmapCount ||
+            region.x + region.z > levelSize.x || region.y + region.w > levelSize.y)
+        {
+            Logger::getInstance().logErrorToConsole("Uploaded texture region out of range!");
+            return;
+        }
+
+        glBindTexture(nativeType, textureHandle);
+        if (isCompressed())
+        {
+            glCompressedTexSubImage2D(nativeType, (GLint)level, (GLint)region.x, (GLint)region.y, (GLsizei)region.z, (GLsizei)region.w,
+                internalFormat, (GLsizei)size, data);
+        }
+        else
+        {
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexSubImage2D(nativeType, (GLint)level, (GLint)region.x, (GLint)region.y, (GLsizei)region.z, (GLsizei)region.w,
+                format, dataType, data);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        }
+
+        glBindTexture(nativeType, GL_NONE);
+    }
+
+    void Texture::copyLevel(const Texture& source, uint32_t sourceLevel, uint32_t level) const
+    {
+        const glm::ivec2 sourceSize(std::max(source.width >> sourceLevel, 1), std::max(source.height >> sourceLevel, 1));
+        const glm::ivec2 levelSize(std::max(width >> level, 1), std::max(height >> level, 1));
+        if (sourceSize != levelSize || source.internalFormat != internalFormat || sourceLevel >= source.mipmapCount || level >= mipmapCount)
+        {
+            Logger::getInstance().logErrorToConsole("Incompatible texture level copy!");
+            return;
+        }
+
+        glCopyImageSubData(source.textureHandle, source.nativeType, (GLint)sourceLevel, 0, 0, 0,
+            textureHandle, nativeType, (GLint)level, 0, 0, 0, levelSize.x, levelSize.y, 1);
+    }
+
+    void Texture::copyRegion(const Texture& source, const glm::uvec4& region) const
+    {
+        if (source.getDimensions() != getDimensions() || source.internalFormat != internalFormat || 
+            region.x + region.z > (uint32_t)width || region.y + region.w > (uint32_t)height)
+        {
+            Logger::getInstance().logErrorToConsole("Incompatible texture region copy!");
+            return;
+        }
+
+        glCopyImageSubData(source.textureHandle, source.nativeType, 0, (GLint)region.x, (GLint)region.y, 0,
+            textureHandle, nativeType, 0, (GLint)region.x, (GLint)region.y, 0, (GLsizei)region.z, (GLsizei)region.w, 1);
+    }
+
 #else
 #error Api not supported yet!
 #endif
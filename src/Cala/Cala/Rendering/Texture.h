@@ -5,6 +5,7 @@
 #include <array>
 #include <vector>
 #include "Cala/Utility/Image.h"
+#include "Cala/Utility/CompressedImage.h"
 
 namespace Cala {
 	class Texture : public ITexture {
@@ -19,7 +20,49 @@ namespace Cala {
 		~Texture() override = default;
 		void load2DTextureFromImage(const Image& image, const RenderingStyle& renderingStyle = RenderingStyle());
         void loadCubemapFromImages(const std::array<Image, 6> &images, const RenderingStyle& renderingStyle = RenderingStyle());
+        // Faces are decoded in parallel, in order +x, -x, +y, -y, +z, -z
+        void loadCubemapFromFiles(const std::array<std::filesystem::path, 6>& paths, const RenderingStyle& renderingStyle = RenderingStyle());
+        /**
+         * Images are decoded in parallel and uploaded in order, like maps of a material
+         * Full mipmap chains are generated for the images, color of those flagged as sRGB is filtered in linear space
+         * All images are treated as sRGB without flags, normal and specular maps should be flagged false
+        */
+        static std::vector<Texture> load2DTexturesFromFiles(const std::vector<std::filesystem::path>& paths,
+            const RenderingStyle& renderingStyle = RenderingStyle(), const std::vector<bool>& sRGB = {});
+        // Uploads blocks of all levels as they are, BC1 and BC3 need GL_EXT_texture_compression_s3tc
+        void loadCompressed(const CompressedImage& image, const RenderingStyle& renderingStyle = RenderingStyle());
+        // Compressed textures can be created only without data
         void load(const Specification &specification, void *data);
+        // 2D texture in immutable storage with all levels, each halving the previous one rounded down
+        void loadMipmaps(const Specification& specification, const std::vector<const void*>& levels);
+        // Same storage as loadMipmaps without data, levels are filled later by uploadRegion or copyLevel
+        void loadStorage(const Specification& specification, uint32_t _mipmapCount);
+        static Format getCompressedFormat(CompressedImage::Format imageFormat, bool sRGB);
+        uint32_t getMipmapCount() const { return mipmapCount; }
+
+        /**
+         * Clears a region (offset, size) of first mipmap level of a 2D texture, depth to 1 and color to 0
+        */
+        void clearRegion(const glm::uvec4& region) const;
+
+        /**
+         * Replaces a region (offset, size) of a mipmap level of a 2D texture with texels in its format, or blocks of size
+         * bytes if it's compressed. While a pixel unpack buffer is bound, data is an offset into it
+        */
+        void uploadRegion(uint32_t level, const glm::uvec4& region, const void* data, size_t size) const;
+
+        /**
+         * Copies a region (offset, size) of first mipmap level of other 2D texture with matching format and dimensions
+        */
+        void copyRegion(const Texture& source, const glm::uvec4& region) const;
+
+        /**
+         * Copies a whole mipmap level of other 2D texture with matching format into a level of the same size
+        */
+        void copyLevel(const Texture& source, uint32_t sourceLevel, uint32_t level) const;
+
+    private:
+        uint32_t mipmapCount = 1;
 	};
 }
 
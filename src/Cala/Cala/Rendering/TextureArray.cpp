@@ -1,4 +1,6 @@
 #include "TextureArray.h"
+#include <algorithm>
+#include "Texture.h"
 #include "GraphicsAPI.h"
 #include "Cala/Utility/Logger.h"
 
@@ -17,6 +19,34 @@ namespace Cala {
         spec.writeOnly = false;
         spec.renderingStyle = renderingStyle;
         load(spec, _mipmapCount, (uint32_t)images.size());
+        if (!isLoaded())
+            return;
+
+        // Levels come from mipmaps generated on the images, rows of small levels aren't 4 byte aligned
+        glBindTexture(nativeType, textureHandle);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (uint32_t layer = 0; layer < layerCount; ++layer)
+        {
+            const Image& image = images[layer];
+            if (image.getDimensions() != getDimensions() || image.getChannelCount() != images[0].getChannelCount())
+            {
+                Logger::getInstance().logErrorToConsole("Image " + image.getPath() + " doesn't match the texture array!");
+                continue;
+            }
+
+            if (image.getMipmapCount() < mipmapCount)
+                Logger::getInstance().logErrorToConsole("Image " + image.getPath() + " has fewer mipmaps than the texture array!");
+
+            for (uint32_t level = 0; level < std::min(mipmapCount, image.getMipmapCount()); ++level)
+            {
+                const glm::ivec2 levelDimensions = image.getMipmapDimensions(level);
+                glTexSubImage3D(nativeType, (GLint)level, 0, 0, (GLint)layer, levelDimensions.x, levelDimensions.y, 1,
+                    format, dataType, image.getMipmapData(level));
+            }
+        }
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(nativeType, GL_NONE);
     }
 
     void TextureArray::load(const Specification &specification, uint32_t _mipmapCount, uint32_t _layerCount)
@@ -45,8 +75,8 @@ namespace Cala {
             case Dimensionality::TwoDimensional:
                 nativeType = GL_TEXTURE_2D_ARRAY;
                 glBindTexture(nativeType, textureHandle);
-                glTexStorage3D(nativeType, mipmapCount, internalFormat, width, height, layerCount);
-                setParameters(specification);
+                glTexStorage3D(nativeType, mipmapCount, getSizedFormat(internalFormat), width, height, layerCount);
+                setParameters(specification, mipmapCount);
                 break;
 
             case Dimensionality::ThreeDimensional:
@@ -60,5 +90,38 @@ namespace Cala {
 
         glBindTexture(nativeType, GL_NONE);
     }
+
+    void TextureArray::copyTexture(const Texture& source, uint32_t layer) const
+    {
+        if (source.getDimensions() != getDimensions() || source.getFormat() != textureFormat || source.getMipmapCount() != mipmapCount ||
+            source.getDimensionality() != Dimensionality::TwoDimensional || layer >= layerCount)
+        {
+            Logger::getInstance().logErrorToConsole("Incompatible texture copy into array layer!");
+            return;
+        }
+
+        for (uint32_t level = 0; level < mipmapCount; ++level)
+        {
+            glCopyImageSubData(source.getNativeHandle(), GL_TEXTURE_2D, (GLint)level, 0, 0, 0, textureHandle, nativeType, (GLint)level, 0, 0, (GLint)layer,
+                std::max(width >> level, 1), std::max(height >> level, 1), 1);
+        }
+    }
+
+    void TextureArray::copyLayers(const TextureArray& source, uint32_t count) const
+    {
+        if (source.getDimensions() != getDimensions() || source.textureFormat != textureFormat || source.mipmapCount != mipmapCount ||
+            count > source.layerCount || count > layerCount)
+        {
+            Logger::getInstance().logErrorToConsole("Incompatible texture array layers copy!");
+            return;
+        }
+
+        for (uint32_t level = 0; level < mipmapCount && count != 0; ++level)
+        {
+            glCopyImageSubData(source.textureHandle, source.nativeType, (GLint)level, 0, 0, 0, textureHandle, nativeType, (GLint)level, 0, 0, 0,
+                std::max(width >> level, 1), std::max(height >> level, 1), (GLsizei)count);
+        }
+    }
+
 #endif
 }
\ No newline at end of file
@@ -4,16 +4,29 @@
 #include "Cala/Utility/Image.h"
 
 namespace Cala {
+    class Texture;
+
     class TextureArray : public ITexture {
     public:
         TextureArray() = default;
         TextureArray(const std::vector<Image> &images, const RenderingStyle &renderingStyle, uint32_t _mipmapCount);
         ~TextureArray() override = default;
+        // Images become layers with their first mipmapCount levels, see Image::generateMipmaps
         void loadFromImages(const std::vector<Image> &images, const RenderingStyle &renderingStyle, uint32_t _mipmapCount);
         void load(const Specification &specification, uint32_t mipmapCount = 1, uint32_t layerCount = 2);
         uint32_t getLayerCount() const { return layerCount; }
         uint32_t getMipmapCount() const { return mipmapCount; }
 
+        /**
+         * Copies all mipmap levels of a 2D texture with matching format, dimensions and mipmap count into a layer
+        */
+        void copyTexture(const Texture& source, uint32_t layer) const;
+
+        /**
+         * Copies all mipmap levels of first layers of other array with matching format, dimensions and mipmap count
+        */
+        void copyLayers(const TextureArray& source, uint32_t count) const;
+
     private:
         uint32_t mipmapCount = 0;
         uint32_t layerCount = 0;
@@ -0,0 +1,229 @@
+#include "TextureCache.h"
+#include <algorithm>
+#include "TextureResidency.h"
+#include "Cala/Utility/Logger.h"
+#include "Cala/Utility/CompressedImage.h"
+
+namespace Cala {
+	TextureCache::TextureCache(uint64_t _memoryBudget) : memoryBudget(_memoryBudget)
+	{
+	}
+
+	TextureCache::~TextureCache()
+	{
+		for (const auto& [key, entry] : entries)
+			TextureResidency::releaseEverywhere(*entry.texture);
+	}
+
+	const Texture* TextureCache::acquire(const Request& request)
+	{
+		const Key key = createKey(request);
+		auto it = entries.find(key);
+		if (it != entries.end())
+		{
+			++statistics.hitCount;
+			return reference(it->second);
+		}
+
+		Image image;
+		if (request.path.extension() != ".dds")
+			image.load(request.path);
+
+		return insert(key, loadTexture(request, image));
+	}
+
+	std::vector<const Texture*> TextureCache::acquire(const std::vector<Request>& requests)
+	{
+		// Requests of files missing from the cache, first of each key is the one loaded
+		std::vector<Key> keys;
+		std::map<Key, size_t> missingKeys;
+		std::vector<size_t> missingRequests;
+		std::vector<std::filesystem::path> decodedPaths;
+		for (size_t i = 0; i < requests.size(); ++i)
+		{
+			keys.push_back(createKey(requests[i]));
+			if (entries.find(keys[i]) == entries.end() && missingKeys.emplace(keys[i], missingRequests.size()).second)
+			{
+				missingRequests.push_back(i);
+				decodedPaths.push_back(requests[i].path.extension() != ".dds" ? requests[i].path : std::filesystem::path());
+			}
+		}
+
+		// Compressed files are read while loading their textures, so they're left empty here
+		std::vector<Image> images(decodedPaths.size());
+		std::vector<std::filesystem::path> imagePaths;
+		std::vector<size_t> imageIndices;
+		for (size_t i = 0; i < decodedPaths.size(); ++i)
+		{
+			if (!decodedPaths[i].empty())
+			{
+				imagePaths.push_back(decodedPaths[i]);
+				imageIndices.push_back(i);
+			}
+		}
+
+		std::vector<Image> decodedImages = Image::loadBatch(imagePaths);
+		for (size_t i = 0; i < imageIndices.size(); ++i)
+			images[imageIndices[i]] = std::move(decodedImages[i]);
+
+		std::vector<const Texture*> textures(requests.size(), nullptr);
+		for (size_t i = 0; i < missingRequests.size(); ++i)
+		{
+			const size_t requestIndex = missingRequests[i];
+			textures[requestIndex] = insert(keys[requestIndex], loadTexture(requests[requestIndex], images[i]));
+			images[i].freeData();
+		}
+
+		for (size_t i = 0; i < requests.size(); ++i)
+		{
+			if (textures[i] != nullptr)
+				continue;
+
+			auto it = entries.find(keys[i]);
+			if (it != entries.end())
+			{
+				++statistics.hitCount;
+				textures[i] = reference(it->second);
+			}
+		}
+
+		return textures;
+	}
+
+	void TextureCache::release(const Texture* texture)
+	{
+		auto key = textureKeys.find(texture);
+		if (key == textureKeys.end())
+		{
+			Logger::getInstance().logErrorToConsole("Released texture isn't from the cache!");
+			return;
+		}
+
+		Entry& entry = entries.at(key->second);
+		if (entry.referenceCount == 0)
+		{
+			Logger::getInstance().logErrorToConsole("Texture " + std::get<0>(key->second) + " released more times than acquired!");
+			return;
+		}
+
+		if (--entry.referenceCount == 0)
+		{
+			entry.unusedPosition = unusedTextures.insert(unusedTextures.end(), key->second);
+			++statistics.unusedTextureCount;
+			evict();
+		}
+	}
+
+	void TextureCache::setMemoryBudget(uint64_t _memoryBudget)
+	{
+		memoryBudget = _memoryBudget;
+		evict();
+	}
+
+	TextureCache::Key TextureCache::createKey(const Request& request)
+	{
+		// Different spellings of a path lead to the same file, paths of missing files are only normalized
+		std::error_code error;
+		std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(request.path, error);
+		if (error)
+			canonicalPath = request.path.lexically_normal();
+
+		const Texture::RenderingStyle& style = request.renderingStyle;
+		return Key(canonicalPath.string(), style.sDimensionWrap, style.tDimensionWrap, style.rDimensionWrap,
+			style.magFilter, style.minFilter, request.sRGB);
+	}
+
+	std::unique_ptr<Texture> TextureCache::loadTexture(const Request& request, Image& image)
+	{
+		auto texture = std::make_unique<Texture>();
+		if (request.path.extension() == ".dds")
+		{
+			CompressedImage compressedImage;
+			if (compressedImage.load(request.path))
+				texture->loadCompressed(compressedImage, request.renderingStyle);
+		}
+		else if (image.getData() != nullptr)
+		{
+			image.generateMipmaps(Image::MipmapFilter::Box, request.sRGB);
+			texture->load2DTextureFromImage(image, request.renderingStyle);
+		}
+
+		if (!texture->isLoaded())
+			return nullptr;
+
+		return texture;
+	}
+
+	const Texture* TextureCache::insert(const Key& key, std::unique_ptr<Texture> texture)
+	{
+		if (texture == nullptr)
+			return nullptr;
+
+		++statistics.missCount;
+		Entry& entry = entries[key];
+		entry.texture = std::move(texture);
+		entry.memory = calculateTextureMemory(*entry.texture);
+		entry.referenceCount = 1;
+		textureKeys.emplace(entry.texture.get(), key);
+		++statistics.textureCount;
+		statistics.memory += entry.memory;
+
+		// New texture may push released ones over the budget
+		evict();
+		return entry.texture.get();
+	}
+
+	const Texture* TextureCache::reference(Entry& entry)
+	{
+		if (entry.referenceCount++ == 0)
+		{
+			unusedTextures.erase(entry.unusedPosition);
+			--statistics.unusedTextureCount;
+		}
+
+		return entry.texture.get();
+	}
+
+	void TextureCache::evict()
+	{
+		while (statistics.memory > memoryBudget && !unusedTextures.empty())
+		{
+			auto it = entries.find(unusedTextures.front());
+			unusedTextures.pop_front();
+			statistics.memory -= it->second.memory;
+			--statistics.textureCount;
+			--statistics.unusedTextureCount;
+			++statistics.evictionCount;
+			TextureResidency::releaseEverywhere(*it->second.texture);
+			textureKeys.erase(it->second.texture.get());
+			entries.erase(it);
+		}
+	}
+
+	uint64_t TextureCache::calculateTextureMemory(const Texture& texture)
+	{
+		// Drivers pad RGB texels to 4 bytes
+		uint64_t texelSize = 4;
+		switch (texture.getFormat())
+		{
+			case ITexture::Format::FLOAT_RGBA:	texelSize = 16; break;
+			case ITexture::Format::HALF_RGBA:	texelSize = 8; break;
+			case ITexture::Format::DEPTH16:		texelSize = 2; break;
+			default: break;
+		}
+
+		const bool halfBlocks = texture.getFormat() == ITexture::Format::BC1_RGBA || texture.getFormat() == ITexture::Format::GAMMA_BC1_RGBA;
+		uint64_t memory = 0;
+		for (uint32_t level = 0; level < texture.getMipmapCount(); ++level)
+		{
+			const uint64_t width = (uint64_t)std::max(texture.getDimensions().x >> level, 1);
+			const uint64_t height = (uint64_t)std::max(texture.getDimensions().y >> level, 1);
+			if (texture.isCompressed())
+				memory += ((width + 3) / 4) * ((height + 3) / 4) * (halfBlocks ? 8 : 16);
+			else
+				memory += width * height * texelSize;
+		}
+
+		return memory;
+	}
+}
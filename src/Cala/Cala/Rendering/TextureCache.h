@@ -0,0 +1,81 @@
+#pragma once
+#include <map>
+#include <list>
+#include <tuple>
+#include <memory>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <unordered_map>
+#include "Texture.h"
+
+namespace Cala {
+	/**
+	 * Textures loaded from files, shared by everything referencing the same file with the same rendering style
+	 * Each acquire of a texture has to be matched by a release, released textures stay loaded and are freed
+	 * in least recently used order once textures take more memory than the budget. Textures in use are never freed,
+	 * so the budget may be exceeded, freed ones are released from every TextureResidency
+	 * DDS files are loaded as compressed textures, other images get generated mipmaps
+	*/
+	class TextureCache {
+	public:
+		struct Statistics {
+			uint32_t textureCount = 0;
+			uint32_t unusedTextureCount = 0; // Released textures kept loaded
+			uint64_t memory = 0; // In bytes, estimated from formats and mipmaps
+			uint32_t hitCount = 0;
+			uint32_t missCount = 0;
+			uint32_t evictionCount = 0;
+		};
+
+		struct Request {
+			std::filesystem::path path;
+			Texture::RenderingStyle renderingStyle = Texture::RenderingStyle();
+			// Color is filtered in linear space when generating mipmaps, normal and specular maps should be false
+			bool sRGB = true;
+		};
+
+		TextureCache(uint64_t _memoryBudget = 512ULL << 20);
+		~TextureCache();
+		TextureCache(const TextureCache& other) = delete;
+		TextureCache& operator=(const TextureCache& other) = delete;
+
+		// Returns nullptr if the file can't be loaded
+		const Texture* acquire(const Request& request);
+		// Files missing from the cache are decoded in parallel, each once even if requested several times
+		std::vector<const Texture*> acquire(const std::vector<Request>& requests);
+		void release(const Texture* texture);
+
+		// Frees released textures over the new budget right away
+		void setMemoryBudget(uint64_t _memoryBudget);
+		uint64_t getMemoryBudget() const { return memoryBudget; }
+		const Statistics& getStatistics() const { return statistics; }
+
+	private:
+		// Canonical path followed by rendering style and sRGB flag
+		using Key = std::tuple<std::string, Texture::WrappingMethod, Texture::WrappingMethod, Texture::WrappingMethod,
+			Texture::Filter, Texture::Filter, bool>;
+
+		struct Entry {
+			std::unique_ptr<Texture> texture;
+			uint64_t memory = 0;
+			uint32_t referenceCount = 0;
+			std::list<Key>::iterator unusedPosition; // Valid only while reference count is 0
+		};
+
+		static Key createKey(const Request& request);
+		// Image is decoded already unless the file is compressed, returns nullptr if loading failed
+		static std::unique_ptr<Texture> loadTexture(const Request& request, Image& image);
+		const Texture* insert(const Key& key, std::unique_ptr<Texture> texture);
+		const Texture* reference(Entry& entry);
+		void evict();
+		static uint64_t calculateTextureMemory(const Texture& texture);
+
+		std::map<Key, Entry> entries;
+		std::unordered_map<const Texture*, Key> textureKeys;
+		// Released textures, least recently used first
+		std::list<Key> unusedTextures;
+		uint64_t memoryBudget;
+		Statistics statistics;
+	};
+}
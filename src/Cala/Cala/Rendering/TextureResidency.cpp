@@ -0,0 +1,266 @@
+#include "TextureResidency.h"
+#include <algorithm>
+#include "GLExtensions.h"
+#include "Cala/Utility/Logger.h"
+
+#define TEXTURE_TABLE_BINDING 2
+
+// Table is allocated for at least this many textures and grows by doubling
+#define MIN_TABLE_CAPACITY 64U
+
+// Arrays start small and double up to the maximum, further textures of the same kind open a new array
+#define INITIAL_ARRAY_LAYERS 4U
+#define MAX_ARRAY_LAYERS 256U
+
+#define INVALID_INDEX 0xFFFFFFFFU
+
+namespace Cala {
+	std::unordered_map<uint64_t, uint32_t> TextureResidency::residentHandles;
+	std::vector<TextureResidency*> TextureResidency::instances;
+
+	TextureResidency::TextureResidency() : mode(GLExtensions::bindlessTexture ? Mode::Bindless : Mode::TextureArrays)
+	{
+		instances.push_back(this);
+	}
+
+	TextureResidency::~TextureResidency()
+	{
+		instances.erase(std::find(instances.begin(), instances.end(), this));
+		std::vector<const Texture*> textures;
+		textures.reserve(textureIndices.size());
+		for (const auto& [texture, index] : textureIndices)
+			textures.push_back(texture);
+
+		for (const Texture* texture : textures)
+			release(*texture);
+	}
+
+	uint32_t TextureResidency::getTextureIndex(const Texture* texture)
+	{
+		if (texture == nullptr)
+			return INVALID_INDEX;
+
+		auto it = textureIndices.find(texture);
+		if (it != textureIndices.end())
+			return it->second;
+
+		if (!texture->isLoaded() || texture->isWriteOnly() || texture->getDimensionality() != ITexture::Dimensionality::TwoDimensional)
+		{
+			Logger::getInstance().logErrorToConsole("Only loaded 2D textures can be referenced by index!");
+			return INVALID_INDEX;
+		}
+
+		uint32_t index;
+		if (!freeIndices.empty())
+		{
+			index = freeIndices.back();
+			freeIndices.pop_back();
+		}
+		else
+		{
+			index = (uint32_t)entries.size();
+			entries.emplace_back(INVALID_INDEX);
+			generations.push_back(0);
+		}
+
+		place(*texture, index);
+		textureIndices.emplace(texture, index);
+		tableChanged = true;
+		++statistics.textureCount;
+		return index;
+	}
+
+	void TextureResidency::release(const Texture& texture)
+	{
+		auto it = textureIndices.find(&texture);
+		if (it == textureIndices.end())
+			return;
+
+		const uint32_t index = it->second;
+		displace(index, true);
+		entries[index] = glm::uvec2(INVALID_INDEX);
+		freeIndices.push_back(index);
+		textureIndices.erase(it);
+		tableChanged = true;
+		--statistics.textureCount;
+	}
+
+	void TextureResidency::releaseEverywhere(const Texture& texture)
+	{
+		for (TextureResidency* residency : instances)
+			residency->release(texture);
+	}
+
+	void TextureResidency::refresh(const Texture& texture)
+	{
+		auto it = textureIndices.find(&texture);
+		if (it == textureIndices.end())
+			return;
+
+		if (!texture.isLoaded())
+		{
+			Logger::getInstance().logErrorToConsole("Refreshed texture isn't loaded!");
+			return;
+		}
+
+		// Texture refreshed again without being loaded again keeps its entry, handle values may be reused by new textures
+		if (generations[it->second] == texture.getGeneration())
+			return;
+
+		// Handle of the replaced texture was deleted along with it
+		displace(it->second, false);
+		place(texture, it->second);
+		tableChanged = true;
+	}
+
+	void TextureResidency::upload()
+	{
+		// Textures loaded again in place, like promoted streamed ones, are found by their generation
+		for (const auto& [texture, index] : textureIndices)
+		{
+			if (texture->getGeneration() != generations[index])
+				refresh(*texture);
+		}
+
+		if (tableChanged && !entries.empty())
+		{
+			const uint32_t capacity = table.getSize() / sizeof(glm::uvec2);
+			if ((uint32_t)entries.size() > capacity)
+			{
+				uint32_t newCapacity = glm::max(capacity * 2, MIN_TABLE_CAPACITY);
+				while (newCapacity < (uint32_t)entries.size())
+					newCapacity *= 2;
+
+				table.free();
+				table.load(newCapacity * sizeof(glm::uvec2), TEXTURE_TABLE_BINDING, true);
+			}
+
+			table.updateData(0, entries.data(), (uint32_t)(entries.size() * sizeof(glm::uvec2)));
+			tableChanged = false;
+		}
+
+		if (table.isLoaded())
+			table.bind();
+	}
+
+	const TextureArray* TextureResidency::getTextureArray(const Texture* texture) const
+	{
+		auto it = textureIndices.find(texture);
+		if (mode == Mode::Bindless || it == textureIndices.end())
+			return nullptr;
+
+		return buckets[entries[it->second].x].array.get();
+	}
+
+	void TextureResidency::place(const Texture& texture, uint32_t textureIndex)
+	{
+		generations[textureIndex] = texture.getGeneration();
+		if (mode == Mode::Bindless)
+		{
+			const uint64_t handle = GLExtensions::getTextureHandle(texture.getNativeHandle());
+			if (residentHandles[handle]++ == 0)
+				GLExtensions::makeTextureHandleResident(handle);
+
+			entries[textureIndex] = glm::uvec2((uint32_t)handle, (uint32_t)(handle >> 32));
+		}
+		else
+			placeIntoArray(texture, textureIndex);
+	}
+
+	void TextureResidency::displace(uint32_t textureIndex, bool handleAlive)
+	{
+		const glm::uvec2 entry = entries[textureIndex];
+		if (mode == Mode::Bindless)
+		{
+			const uint64_t handle = (uint64_t)entry.x | ((uint64_t)entry.y << 32);
+			auto handleIt = residentHandles.find(handle);
+			if (handleIt != residentHandles.end() && --handleIt->second == 0)
+			{
+				if (handleAlive)
+					GLExtensions::makeTextureHandleNonResident(handle);
+
+				residentHandles.erase(handleIt);
+			}
+		}
+		else
+		{
+			ArrayBucket& bucket = buckets[entry.x];
+			bucket.layers[entry.y] = nullptr;
+			bucket.freeLayers.push_back(entry.y);
+		}
+	}
+
+	void TextureResidency::placeIntoArray(const Texture& texture, uint32_t textureIndex)
+	{
+		const BucketKey key(texture.getDimensions().x, texture.getDimensions().y, texture.getFormat(), texture.getMipmapCount());
+		std::vector<uint32_t>& keyBuckets = bucketsByKey[key];
+
+		// Layers freed in any array of the key are reused before an array grows or a new one is created
+		auto it = std::find_if(keyBuckets.begin(), keyBuckets.end(), [this](uint32_t index) { return !buckets[index].freeLayers.empty(); });
+		uint32_t bucketIndex = 0;
+		if (it != keyBuckets.end())
+			bucketIndex = *it;
+		else if (!keyBuckets.empty() && buckets[keyBuckets.back()].layers.size() < MAX_ARRAY_LAYERS)
+		{
+			bucketIndex = keyBuckets.back();
+			growBucket(buckets[bucketIndex]);
+		}
+		else
+		{
+			bucketIndex = createBucket(texture, INITIAL_ARRAY_LAYERS);
+			keyBuckets.push_back(bucketIndex);
+		}
+
+		ArrayBucket& bucket = buckets[bucketIndex];
+		const uint32_t layer = bucket.freeLayers.back();
+		bucket.freeLayers.pop_back();
+		bucket.layers[layer] = &texture;
+		bucket.array->copyTexture(texture, layer);
+		entries[textureIndex] = glm::uvec2(bucketIndex, layer);
+	}
+
+	uint32_t TextureResidency::createBucket(const Texture& texture, uint32_t layerCount)
+	{
+		ArrayBucket bucket;
+		bucket.array = createArray(texture.getDimensions(), texture.getFormat(), texture.getMipmapCount(), layerCount);
+		bucket.layers.resize(layerCount, nullptr);
+
+		// Free layers are taken from the back, so lowest ones are used first
+		for (uint32_t layer = layerCount; layer > 0; --layer)
+			bucket.freeLayers.push_back(layer - 1);
+
+		buckets.push_back(std::move(bucket));
+		++statistics.arrayCount;
+		statistics.arrayLayerCount += layerCount;
+		return (uint32_t)buckets.size() - 1;
+	}
+
+	void TextureResidency::growBucket(ArrayBucket& bucket)
+	{
+		const uint32_t layerCount = (uint32_t)bucket.layers.size();
+		const uint32_t newLayerCount = glm::min(layerCount * 2, MAX_ARRAY_LAYERS);
+
+		// Layers already in use are copied on the GPU, textures don't have to be uploaded again
+		auto array = createArray(bucket.array->getDimensions(), bucket.array->getFormat(), bucket.array->getMipmapCount(), newLayerCount);
+		array->copyLayers(*bucket.array, layerCount);
+		bucket.array = std::move(array);
+
+		bucket.layers.resize(newLayerCount, nullptr);
+		for (uint32_t layer = newLayerCount; layer > layerCount; --layer)
+			bucket.freeLayers.push_back(layer - 1);
+
+		statistics.arrayLayerCount += newLayerCount - layerCount;
+	}
+
+	std::unique_ptr<TextureArray> TextureResidency::createArray(glm::ivec2 dimensions, ITexture::Format format, uint32_t mipmapCount, uint32_t layerCount)
+	{
+		// Material textures are mostly tiled, so arrays repeat them
+		ITexture::Specification spec(dimensions.x, dimensions.y, format, ITexture::Dimensionality::TwoDimensional);
+		spec.renderingStyle.sDimensionWrap = ITexture::WrappingMethod::Repeat;
+		spec.renderingStyle.tDimensionWrap = ITexture::WrappingMethod::Repeat;
+
+		auto array = std::make_unique<TextureArray>();
+		array->load(spec, mipmapCount, layerCount);
+		return array;
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "Texture.h"
+#include "TextureArray.h"
+#include "StorageBuffer.h"
+
+namespace Cala {
+	/**
+	 * Makes 2D textures addressable by index from shaders including Textures.glsl,
+	 * so objects with different textures can be drawn by a single instanced call
+	 * With GL_ARB_bindless_texture an index refers to a resident texture handle,
+	 * otherwise textures are copied into layers of arrays shared by all textures of the same size and format
+	 * Textures have to be released before they are freed, copies in arrays don't follow later changes of them
+	 * Textures owned by TextureCache and TextureStreamer are released from every residency when they're freed
+	*/
+	class TextureResidency {
+	public:
+		enum class Mode {
+			Bindless,
+			TextureArrays
+		};
+
+		struct Statistics {
+			uint32_t textureCount = 0;
+			uint32_t arrayCount = 0;
+			uint32_t arrayLayerCount = 0; // Allocated layers of all arrays
+		};
+
+		TextureResidency();
+		~TextureResidency();
+		TextureResidency(const TextureResidency& other) = delete;
+		TextureResidency& operator=(const TextureResidency& other) = delete;
+
+		// Registers texture on first use, null texture gets an index no shader reads
+		uint32_t getTextureIndex(const Texture* texture);
+		void release(const Texture& texture);
+		// Releases texture from all existing residencies, for owners of textures which don't know who draws them
+		static void releaseEverywhere(const Texture& texture);
+		/**
+		 * Registers new contents of a texture freed and loaded again in place under the same index, like streamed textures
+		 * Upload does it for all such textures, in bindless mode their old handles are assumed to be deleted
+		*/
+		void refresh(const Texture& texture);
+
+		// Refreshes textures loaded again since last call, uploads index table if it changed and binds it
+		void upload();
+
+		/**
+		 * Array holding registered texture, which has to be bound to its material texture unit when drawing with it
+		 * Returns nullptr in bindless mode or for textures which aren't registered
+		*/
+		const TextureArray* getTextureArray(const Texture* texture) const;
+		Mode getMode() const { return mode; }
+		const Statistics& getStatistics() const { return statistics; }
+
+	private:
+		// Textures of the same size, format and mipmap count, layer list holds nullptr for free layers
+		struct ArrayBucket {
+			std::unique_ptr<TextureArray> array;
+			std::vector<const Texture*> layers;
+			std::vector<uint32_t> freeLayers;
+		};
+
+		// Dimensions, format and mipmap count, arrays keep whole mipmap chains of their textures
+		using BucketKey = std::tuple<int, int, ITexture::Format, uint32_t>;
+
+		// Fill and empty entry of a texture index, handle of displaced texture is made non-resident only if it still exists
+		void place(const Texture& texture, uint32_t textureIndex);
+		void displace(uint32_t textureIndex, bool handleAlive);
+		void placeIntoArray(const Texture& texture, uint32_t textureIndex);
+		uint32_t createBucket(const Texture& texture, uint32_t layerCount);
+		void growBucket(ArrayBucket& bucket);
+		static std::unique_ptr<TextureArray> createArray(glm::ivec2 dimensions, ITexture::Format format, uint32_t mipmapCount, uint32_t layerCount);
+
+		Mode mode;
+		std::unordered_map<const Texture*, uint32_t> textureIndices;
+		// Laid out as entries of TextureTable in Textures.glsl, bindless handle or array bucket and layer
+		std::vector<glm::uvec2> entries;
+		// Generation of each entry's texture when it was placed
+		std::vector<uint64_t> generations;
+		std::vector<uint32_t> freeIndices;
+		std::vector<ArrayBucket> buckets;
+		// Buckets of each key in order of creation, only the last one may have fewer layers than the maximum
+		std::map<BucketKey, std::vector<uint32_t>> bucketsByKey;
+		StorageBuffer table;
+		// Handles are resident per context, so renderers sharing a texture keep it resident until all of them release it
+		static std::unordered_map<uint64_t, uint32_t> residentHandles;
+		static std::vector<TextureResidency*> instances;
+		bool tableChanged = false;
+		Statistics statistics;
+	};
+}
@@ -0,0 +1,326 @@
+#include "TextureStreamer.h"
+#include <cmath>
+#include <algorithm>
+#include "TextureResidency.h"
+#include "Cala/Utility/Logger.h"
+#include "Cala/Utility/ThreadPool.h"
+
+// Levels up to this size are loaded when a texture is added and never dropped
+#define TAIL_LEVEL_SIZE 64
+
+// Staged regions are bands of whole block rows up to this size, at least one row
+#define STREAMING_BAND_SIZE (256U << 10)
+
+// Limits of GPU work started by a single update, so streaming doesn't cause hitches
+#define MAX_PROMOTIONS_PER_UPDATE 4
+#define UPLOAD_BUDGET_PER_UPDATE (8ULL << 20)
+
+namespace Cala {
+	TextureStreamer::TextureStreamer(uint64_t _memoryBudget, uint32_t ringSize) : memoryBudget(_memoryBudget)
+	{
+		uploader.load(ringSize);
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		// Workers may still be staging from the mapped files
+		for (auto& [texture, streamed] : textures)
+		{
+			if (streamed->staging.valid())
+				streamed->staging.wait();
+
+			TextureResidency::releaseEverywhere(*streamed->texture);
+		}
+	}
+
+	const Texture* TextureStreamer::add(const std::filesystem::path& path, const Texture::RenderingStyle& renderingStyle)
+	{
+		auto streamed = std::make_unique<StreamedTexture>();
+		if (!streamed->file.open(path))
+		{
+			Logger::getInstance().logErrorToConsole("Streamed texture " + path.string() + " can't be opened!");
+			return nullptr;
+		}
+
+		if (!CompressedImage::readLayout(streamed->file.getData(), streamed->file.getSize(), path.string(), streamed->layout))
+			return nullptr;
+
+		const uint32_t levelCount = (uint32_t)streamed->layout.levelOffsets.size();
+		const int maxDimension = std::max(streamed->layout.dimensions.x, streamed->layout.dimensions.y);
+		while (streamed->tailLevel + 1 < levelCount && (maxDimension >> streamed->tailLevel) > TAIL_LEVEL_SIZE)
+			++streamed->tailLevel;
+
+		streamed->renderingStyle = renderingStyle;
+		streamed->texture = createTexture(*streamed, streamed->tailLevel);
+		if (streamed->texture == nullptr)
+			return nullptr;
+
+		// Tail is small enough to be uploaded right away
+		for (uint32_t level = streamed->tailLevel; level < levelCount; ++level)
+		{
+			const glm::uvec2 dimensions(std::max(streamed->layout.dimensions.x >> level, 1), std::max(streamed->layout.dimensions.y >> level, 1));
+			streamed->texture->uploadRegion(level - streamed->tailLevel, glm::uvec4(0U, 0U, dimensions.x, dimensions.y),
+				streamed->file.getData() + streamed->layout.levelOffsets[level], streamed->layout.levelSizes[level]);
+		}
+
+		streamed->residentLevel = streamed->tailLevel;
+		streamed->requestFrames.assign(levelCount, 0);
+		statistics.memory += calculateMemory(*streamed, streamed->residentLevel);
+		++statistics.textureCount;
+
+		const Texture* texture = streamed->texture.get();
+		textures.emplace(texture, std::move(streamed));
+		return texture;
+	}
+
+	void TextureStreamer::remove(const Texture* texture)
+	{
+		auto it = textures.find(texture);
+		if (it == textures.end())
+			return;
+
+		StreamedTexture& streamed = *it->second;
+		if (streamed.staging.valid())
+			streamed.staging.wait();
+
+		statistics.memory -= calculateMemory(streamed, streamed.residentLevel);
+		if (streamed.pendingTexture != nullptr)
+		{
+			uploader.cancel(*streamed.pendingTexture);
+			statistics.memory -= calculateMemory(streamed, streamed.pendingLevel);
+		}
+
+		TextureResidency::releaseEverywhere(*streamed.texture);
+		--statistics.textureCount;
+		textures.erase(it);
+	}
+
+	void TextureStreamer::request(const Texture* texture, float screenSize)
+	{
+		auto it = textures.find(texture);
+		if (it == textures.end() || screenSize <= 0.f)
+			return;
+
+		// Level whose texels are closest to pixels without being coarser than them
+		StreamedTexture& streamed = *it->second;
+		const float maxDimension = (float)std::max(streamed.layout.dimensions.x, streamed.layout.dimensions.y);
+		const float level = std::floor(std::log2(maxDimension / screenSize));
+		const uint32_t requestedLevel = level <= 0.f ? 0U : std::min((uint32_t)level, streamed.tailLevel);
+		for (uint32_t i = requestedLevel; i < (uint32_t)streamed.requestFrames.size(); ++i)
+			streamed.requestFrames[i] = frame;
+	}
+
+	void TextureStreamer::update()
+	{
+		// Stagings cut short by a full ring continue where they stopped
+		for (auto& [texture, streamed] : textures)
+		{
+			if (streamed->pendingTexture == nullptr)
+				continue;
+
+			if (streamed->staging.valid())
+			{
+				if (streamed->staging.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+					continue;
+
+				if (!streamed->staging.get())
+				{
+					StreamedTexture* restaged = streamed.get();
+					streamed->staging = ThreadPool::getInstance().submit([this, restaged]() { return stage(*restaged); });
+					continue;
+				}
+			}
+
+			finishPromotion(*streamed);
+		}
+
+		evict();
+
+		// Textures missing the most levels are promoted first
+		std::vector<StreamedTexture*> promoted;
+		for (auto& [texture, streamed] : textures)
+		{
+			if (streamed->pendingTexture == nullptr && getRequestedLevel(*streamed) < streamed->residentLevel)
+				promoted.push_back(streamed.get());
+		}
+
+		std::sort(promoted.begin(), promoted.end(), [this](const StreamedTexture* a, const StreamedTexture* b) {
+			return a->residentLevel - getRequestedLevel(*a) > b->residentLevel - getRequestedLevel(*b);
+		});
+
+		uint32_t promotionCount = 0;
+		for (StreamedTexture* streamed : promoted)
+		{
+			if (promotionCount == MAX_PROMOTIONS_PER_UPDATE)
+				break;
+
+			// Finest level fitting into the budget, storage of the old chain stays allocated until the swap
+			uint32_t level = getRequestedLevel(*streamed);
+			while (level < streamed->residentLevel && statistics.memory + calculateMemory(*streamed, level) > memoryBudget)
+				++level;
+
+			if (level < streamed->residentLevel)
+			{
+				startPromotion(*streamed, level);
+				++promotionCount;
+			}
+		}
+
+		uploader.update(UPLOAD_BUDGET_PER_UPDATE);
+		statistics.uploadedBytes = uploader.getStatistics().uploadedBytes;
+		statistics.streamingCount = 0;
+		for (const auto& [texture, streamed] : textures)
+		{
+			if (streamed->pendingTexture != nullptr)
+				++statistics.streamingCount;
+		}
+
+		++frame;
+	}
+
+	std::unique_ptr<Texture> TextureStreamer::createTexture(const StreamedTexture& streamed, uint32_t firstLevel)
+	{
+		const CompressedImage::Layout& layout = streamed.layout;
+		Texture::Specification spec(std::max(layout.dimensions.x >> firstLevel, 1), std::max(layout.dimensions.y >> firstLevel, 1),
+			Texture::getCompressedFormat(layout.format, layout.sRGB), Texture::Dimensionality::TwoDimensional);
+		spec.renderingStyle = streamed.renderingStyle;
+
+		auto texture = std::make_unique<Texture>();
+		texture->loadStorage(spec, (uint32_t)layout.levelOffsets.size() - firstLevel);
+		if (!texture->isLoaded())
+			return nullptr;
+
+		return texture;
+	}
+
+	bool TextureStreamer::stage(StreamedTexture& streamed)
+	{
+		const CompressedImage::Layout& layout = streamed.layout;
+		const size_t blockSize = CompressedImage::getBlockSize(layout.format);
+		while (streamed.stagingLevel < streamed.residentLevel)
+		{
+			const uint32_t level = streamed.stagingLevel;
+			const glm::uvec2 dimensions(std::max(layout.dimensions.x >> level, 1), std::max(layout.dimensions.y >> level, 1));
+			const uint32_t blockRowCount = (dimensions.y + 3) / 4;
+			const size_t rowSize = (size_t)((dimensions.x + 3) / 4) * blockSize;
+			const uint32_t rowCount = std::min(std::max((uint32_t)(STREAMING_BAND_SIZE / rowSize), 1U), blockRowCount - streamed.stagedBlockRows);
+
+			const uint32_t y = streamed.stagedBlockRows * 4;
+			const glm::uvec4 region(0U, y, dimensions.x, std::min(rowCount * 4, dimensions.y - y));
+			const unsigned char* data = streamed.file.getData() + layout.levelOffsets[level] + streamed.stagedBlockRows * rowSize;
+			if (!uploader.stage(*streamed.pendingTexture, level - streamed.pendingLevel, region, data, rowCount * rowSize))
+				return false;
+
+			streamed.stagedBlockRows += rowCount;
+			if (streamed.stagedBlockRows == blockRowCount)
+			{
+				++streamed.stagingLevel;
+				streamed.stagedBlockRows = 0;
+			}
+		}
+
+		return true;
+	}
+
+	void TextureStreamer::startPromotion(StreamedTexture& streamed, uint32_t level)
+	{
+		streamed.pendingTexture = createTexture(streamed, level);
+		if (streamed.pendingTexture == nullptr)
+			return;
+
+		streamed.pendingLevel = level;
+		streamed.stagingLevel = level;
+		streamed.stagedBlockRows = 0;
+		statistics.memory += calculateMemory(streamed, level);
+
+		// Reading the file may fault pages in from disk, so it's kept off the thread of the context
+		StreamedTexture* staged = &streamed;
+		streamed.staging = ThreadPool::getInstance().submit([this, staged]() { return stage(*staged); });
+	}
+
+	bool TextureStreamer::finishPromotion(StreamedTexture& streamed)
+	{
+		// Commands after the swap are ordered after issued uploads, so they don't have to be finished
+		if (uploader.isPending(*streamed.pendingTexture))
+			return false;
+
+		std::unique_ptr<Texture> texture = std::move(streamed.pendingTexture);
+		const uint32_t levelCount = (uint32_t)streamed.layout.levelOffsets.size();
+		for (uint32_t level = streamed.residentLevel; level < levelCount; ++level)
+			texture->copyLevel(*streamed.texture, level - streamed.residentLevel, level - streamed.pendingLevel);
+
+		swap(streamed, std::move(texture), streamed.pendingLevel);
+		++statistics.promotionCount;
+		return true;
+	}
+
+	void TextureStreamer::demote(StreamedTexture& streamed, uint32_t level)
+	{
+		std::unique_ptr<Texture> texture = createTexture(streamed, level);
+		if (texture == nullptr)
+			return;
+
+		const uint32_t levelCount = (uint32_t)streamed.layout.levelOffsets.size();
+		for (uint32_t i = level; i < levelCount; ++i)
+			texture->copyLevel(*streamed.texture, i - streamed.residentLevel, i - level);
+
+		statistics.memory += calculateMemory(streamed, level);
+		swap(streamed, std::move(texture), level);
+		++statistics.demotionCount;
+	}
+
+	void TextureStreamer::swap(StreamedTexture& streamed, std::unique_ptr<Texture> texture, uint32_t level)
+	{
+		// Texture keeps its address, so renderables referencing it don't change
+		statistics.memory -= calculateMemory(streamed, streamed.residentLevel);
+		streamed.texture->free();
+		*streamed.texture = std::move(*texture);
+		streamed.residentLevel = level;
+	}
+
+	void TextureStreamer::evict()
+	{
+		if (statistics.memory <= memoryBudget)
+			return;
+
+		// Least recently requested finest levels are dropped first
+		std::vector<StreamedTexture*> candidates;
+		for (auto& [texture, streamed] : textures)
+		{
+			if (streamed->pendingTexture == nullptr && getRequestedLevel(*streamed) > streamed->residentLevel)
+				candidates.push_back(streamed.get());
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](const StreamedTexture* a, const StreamedTexture* b) {
+			return a->requestFrames[a->residentLevel] < b->requestFrames[b->residentLevel];
+		});
+
+		for (StreamedTexture* streamed : candidates)
+		{
+			if (statistics.memory <= memoryBudget)
+				break;
+
+			demote(*streamed, getRequestedLevel(*streamed));
+		}
+	}
+
+	uint32_t TextureStreamer::getRequestedLevel(const StreamedTexture& streamed) const
+	{
+		for (uint32_t level = 0; level < streamed.tailLevel; ++level)
+		{
+			if (streamed.requestFrames[level] == frame)
+				return level;
+		}
+
+		return streamed.tailLevel;
+	}
+
+	uint64_t TextureStreamer::calculateMemory(const StreamedTexture& streamed, uint32_t firstLevel)
+	{
+		uint64_t memory = 0;
+		for (size_t level = firstLevel; level < streamed.layout.levelSizes.size(); ++level)
+			memory += streamed.layout.levelSizes[level];
+
+		return memory;
+	}
+}
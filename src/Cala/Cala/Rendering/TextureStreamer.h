@@ -0,0 +1,100 @@
+#pragma once
+#include <memory>
+#include <future>
+#include <vector>
+#include <filesystem>
+#include <unordered_map>
+#include "Texture.h"
+#include "TextureUploader.h"
+#include "Cala/Utility/MappedFile.h"
+#include "Cala/Utility/CompressedImage.h"
+
+namespace Cala {
+	/**
+	 * Keeps only mipmap levels of DDS textures which are seen at their resolution resident, streaming finer ones in on demand
+	 * Small tail levels are loaded when a texture is added, renderers request finer levels each frame by the size textures
+	 * are drawn at on screen. Levels are read by worker threads from the file mapped to memory and staged into a TextureUploader
+	 * Textures are promoted by loading storage of the finer chain, copying resident levels into it and swapping it into
+	 * the same Texture object once all its uploads are issued, so pointers to textures stay valid while their handles change
+	 * Once textures take more memory than the budget, levels not requested for the longest time are dropped the same way,
+	 * levels requested in the current frame are never dropped, so the budget may be exceeded
+	*/
+	class TextureStreamer {
+	public:
+		struct Statistics {
+			uint32_t textureCount = 0;
+			uint32_t streamingCount = 0; // Textures with finer levels being staged
+			uint64_t memory = 0; // In bytes, of resident levels and storage being streamed into
+			uint64_t uploadedBytes = 0; // Issued during last update
+			uint32_t promotionCount = 0; // Since creation
+			uint32_t demotionCount = 0; // Since creation
+		};
+
+		// Ring of the uploader has to fit a band of block rows of the widest level
+		TextureStreamer(uint64_t _memoryBudget = 256ULL << 20, uint32_t ringSize = 32U << 20);
+		~TextureStreamer();
+		TextureStreamer(const TextureStreamer& other) = delete;
+		TextureStreamer& operator=(const TextureStreamer& other) = delete;
+
+		// Returns nullptr if the file isn't a block compressed DDS file, loads only its tail levels
+		const Texture* add(const std::filesystem::path& path, const Texture::RenderingStyle& renderingStyle = Texture::RenderingStyle());
+		// Texture is released from every TextureResidency as well
+		void remove(const Texture* texture);
+
+		/**
+		 * Requests levels needed to draw the texture covering screenSize pixels along its larger dimension in the current frame
+		 * Called on the thread of the context, textures not from this streamer are ignored
+		*/
+		void request(const Texture* texture, float screenSize);
+
+		/**
+		 * Called once per frame on the thread of the context before renderers draw, starts promotions of requested textures,
+		 * swaps in finished ones, drops levels over the budget and issues staged uploads
+		 * Swapped textures get a new generation, which TextureResidency picks up when uploading its table
+		*/
+		void update();
+
+		void setMemoryBudget(uint64_t _memoryBudget) { memoryBudget = _memoryBudget; }
+		uint64_t getMemoryBudget() const { return memoryBudget; }
+		const Statistics& getStatistics() const { return statistics; }
+
+	private:
+		struct StreamedTexture {
+			std::unique_ptr<Texture> texture;
+			MappedFile file;
+			CompressedImage::Layout layout;
+			Texture::RenderingStyle renderingStyle;
+			uint32_t residentLevel = 0; // Finest level in the texture
+			uint32_t tailLevel = 0; // Finest of the levels which are never dropped
+			// Frame in which each level was last requested, requests of a level request all coarser ones too
+			std::vector<uint64_t> requestFrames;
+
+			// Storage of the finer chain being staged, swapped in once finished
+			std::unique_ptr<Texture> pendingTexture;
+			uint32_t pendingLevel = 0;
+			uint32_t stagingLevel = 0;
+			uint32_t stagedBlockRows = 0; // Of the staging level
+			std::future<bool> staging; // Returns true once all levels are staged
+		};
+
+		// Loads storage of levels from the first one to the end of the chain
+		static std::unique_ptr<Texture> createTexture(const StreamedTexture& streamed, uint32_t firstLevel);
+		// Stages levels of the pending texture until the ring is full, returns true once all of them are staged
+		bool stage(StreamedTexture& streamed);
+		void startPromotion(StreamedTexture& streamed, uint32_t level);
+		// Returns true if the pending texture was swapped in
+		bool finishPromotion(StreamedTexture& streamed);
+		void demote(StreamedTexture& streamed, uint32_t level);
+		void swap(StreamedTexture& streamed, std::unique_ptr<Texture> texture, uint32_t level);
+		void evict();
+		// Finest level requested in the current frame, tail level if there wasn't any request
+		uint32_t getRequestedLevel(const StreamedTexture& streamed) const;
+		static uint64_t calculateMemory(const StreamedTexture& streamed, uint32_t firstLevel);
+
+		std::unordered_map<const Texture*, std::unique_ptr<StreamedTexture>> textures;
+		TextureUploader uploader;
+		uint64_t frame = 1;
+		uint64_t memoryBudget;
+		Statistics statistics;
+	};
+}
@@ -0,0 +1,256 @@
+#include "TextureUploader.h"
+#include <cstring>
+#include "Cala/Utility/Logger.h"
+
+// Offsets into the buffer have to be multiples of texel size, which is at most 16 bytes
+#define STAGING_ALIGNMENT 16U
+
+namespace Cala {
+#ifdef CALA_API_OPENGL
+#include <glad/glad.h>
+	TextureUploader::~TextureUploader()
+	{
+		free();
+	}
+
+	void TextureUploader::load(uint32_t _ringSize)
+	{
+		if (isLoaded())
+		{
+			Logger::getInstance().logErrorToConsole("Texture uploader already loaded!");
+			return;
+		}
+
+		ringSize = _ringSize;
+		head = 0;
+		statistics = Statistics();
+		persistent = GLAD_GL_VERSION_4_4 && glBufferStorage != nullptr;
+		if (persistent)
+		{
+			// Coherent mapping makes copies visible to uploads issued after them without explicit flushes
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glGenBuffers(1, &bufferHandle);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, bufferHandle);
+			glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)ringSize, nullptr, flags);
+			ring = reinterpret_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)ringSize, flags));
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GL_NONE);
+			if (ring == nullptr)
+			{
+				glDeleteBuffers(1, &bufferHandle);
+				bufferHandle = API_NULL;
+				persistent = false;
+			}
+		}
+
+		if (!persistent)
+		{
+			clientRing.resize(ringSize);
+			ring = clientRing.data();
+		}
+	}
+
+	void TextureUploader::free()
+	{
+		for (const Fence& fence : fences)
+			glDeleteSync(reinterpret_cast<GLsync>(fence.sync));
+
+		fences.clear();
+		if (bufferHandle != API_NULL)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, bufferHandle);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GL_NONE);
+			glDeleteBuffers(1, &bufferHandle);
+			bufferHandle = API_NULL;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		uploads.clear();
+		clientRing = std::vector<unsigned char>();
+		ring = nullptr;
+		ringSize = 0;
+		head = 0;
+	}
+
+	bool TextureUploader::isLoaded() const
+	{
+		return ring != nullptr;
+	}
+
+	bool TextureUploader::stage(const Texture& texture, uint32_t level, const glm::uvec4& region, const void* data, size_t size)
+	{
+		if (!isLoaded() || size == 0 || size > ringSize)
+		{
+			Logger::getInstance().logErrorToConsole("Staged texture region doesn't fit into the upload ring!");
+			return false;
+		}
+
+		Upload* upload;
+		size_t offset;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			size_t start;
+			if (!allocate(size, start, offset))
+			{
+				++statistics.rejectedCount;
+				return false;
+			}
+
+			uploads.push_back({ &texture, level, region, start, offset, size });
+			upload = &uploads.back();
+		}
+
+		// Stagings copy concurrently, elements of the deque stay in place until they're issued and reclaimed
+		std::memcpy(ring + offset, data, size);
+		std::lock_guard<std::mutex> lock(mutex);
+		upload->copied = true;
+		return true;
+	}
+
+	void TextureUploader::cancel(const Texture& texture)
+	{
+		// Cancelled uploads keep their place in the ring until those before them are reclaimed
+		std::lock_guard<std::mutex> lock(mutex);
+		for (Upload& upload : uploads)
+		{
+			if (!upload.issued && upload.texture == &texture)
+				upload.texture = nullptr;
+		}
+	}
+
+	bool TextureUploader::isPending(const Texture& texture) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (const Upload& upload : uploads)
+		{
+			if (!upload.issued && upload.texture == &texture)
+				return true;
+		}
+
+		return false;
+	}
+
+	void TextureUploader::update(uint64_t byteBudget)
+	{
+		if (!isLoaded())
+			return;
+
+		reclaim();
+
+		// At least one upload is issued, so regions over the budget aren't stuck
+		std::vector<Upload> issued;
+		uint64_t issuedBytes = 0;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (Upload& upload : uploads)
+			{
+				if (upload.issued)
+					continue;
+
+				if (!upload.copied || (!issued.empty() && issuedBytes + upload.size > byteBudget))
+					break;
+
+				upload.issued = true;
+				issuedBytes += upload.size;
+				issued.push_back(upload);
+			}
+		}
+
+		if (persistent)
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, bufferHandle);
+
+		for (const Upload& upload : issued)
+		{
+			if (upload.texture == nullptr)
+				continue;
+
+			// Bound unpack buffer turns the pointer into an offset into it
+			const void* data = persistent ? reinterpret_cast<const void*>(upload.offset) : clientRing.data() + upload.offset;
+			upload.texture->uploadRegion(upload.level, upload.region, data, upload.size);
+		}
+
+		if (persistent)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, GL_NONE);
+			if (!issued.empty())
+				fences.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), (uint32_t)issued.size() });
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		statistics.uploadedBytes = issuedBytes;
+		statistics.uploadCount = (uint32_t)issued.size();
+
+		// Client memory is copied by the driver before the upload call returns
+		if (!persistent)
+		{
+			for (size_t i = 0; i < issued.size(); ++i)
+				uploads.pop_front();
+		}
+	}
+
+	TextureUploader::Statistics TextureUploader::getStatistics() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Statistics current = statistics;
+		current.pendingUploadCount = 0;
+		for (const Upload& upload : uploads)
+			current.pendingUploadCount += upload.issued ? 0 : 1;
+
+		current.usedBytes = 0;
+		if (!uploads.empty())
+		{
+			const size_t tail = uploads.front().start;
+			current.usedBytes = head > tail ? head - tail : ringSize - tail + head;
+		}
+
+		return current;
+	}
+
+	bool TextureUploader::allocate(size_t size, size_t& start, size_t& offset)
+	{
+		// Head never catches up with the tail while uploads are live, so equal positions mean an empty ring
+		const size_t alignedSize = (size + STAGING_ALIGNMENT - 1) & ~(size_t)(STAGING_ALIGNMENT - 1);
+		if (uploads.empty())
+			head = 0;
+
+		const size_t tail = uploads.empty() ? 0 : uploads.front().start;
+		start = head;
+		if (uploads.empty() || head > tail)
+		{
+			if (head + alignedSize <= ringSize)
+				offset = head;
+			else if (alignedSize < tail)
+				offset = 0; // Rest of the ring is skipped
+			else
+				return false;
+		}
+		else if (head + alignedSize < tail)
+			offset = head;
+		else
+			return false;
+
+		head = offset + alignedSize;
+		return true;
+	}
+
+	void TextureUploader::reclaim()
+	{
+		while (!fences.empty())
+		{
+			GLsync sync = reinterpret_cast<GLsync>(fences.front().sync);
+			const GLenum status = glClientWaitSync(sync, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+				break;
+
+			glDeleteSync(sync);
+			std::lock_guard<std::mutex> lock(mutex);
+			for (uint32_t i = 0; i < fences.front().uploadCount; ++i)
+				uploads.pop_front();
+
+			fences.pop_front();
+		}
+	}
+#else
+	#error Api not supported yet!
+#endif
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+#include <glm/glm.hpp>
+#include "NativeAPI.h"
+#include "GPUResource.h"
+#include "Texture.h"
+
+namespace Cala {
+	/**
+	 * Streams texture data through a ring of staging memory in a persistently mapped pixel unpack buffer
+	 * Any thread may stage data, which copies it into the ring right away, uploads are issued from the ring on the thread
+	 * of the context by update and their memory is reused once the GPU signals the fence issued after them
+	 * Without OpenGL 4.4 buffer storage the ring lives in client memory and uploads are copied by the driver when issued
+	 * Uploads are issued in the order they were staged, one still being copied holds back those staged after it
+	*/
+	class TextureUploader : public GPUResource {
+	public:
+		struct Statistics {
+			uint64_t uploadedBytes = 0; // Issued during last update
+			uint32_t uploadCount = 0; // Issued during last update
+			uint32_t pendingUploadCount = 0; // Staged and not issued yet
+			uint64_t usedBytes = 0; // Of the ring, including uploads waiting for fences
+			uint32_t rejectedCount = 0; // Stagings which didn't fit in the ring since load
+		};
+
+		TextureUploader() = default;
+		~TextureUploader();
+		TextureUploader(const TextureUploader& other) = delete;
+		TextureUploader& operator=(const TextureUploader& other) = delete;
+
+		// Ring has to fit the largest staged region
+		void load(uint32_t ringSize);
+		void free() override;
+		bool isLoaded() const override;
+		bool isPersistent() const { return persistent; }
+
+		/**
+		 * Copies data of a region (offset, size) of a mipmap level into the ring, see Texture::uploadRegion
+		 * Returns false if the ring is full, so the caller can try again after next update
+		 * Texture has to stay loaded until the upload is issued or cancelled
+		*/
+		bool stage(const Texture& texture, uint32_t level, const glm::uvec4& region, const void* data, size_t size);
+		// Drops uploads of the texture which weren't issued yet, has to be called before a texture with staged uploads is freed
+		void cancel(const Texture& texture);
+		// Whether the texture has staged uploads which weren't issued yet, commands after update see issued ones
+		bool isPending(const Texture& texture) const;
+
+		// Issues staged uploads up to the byte budget and reclaims memory of finished ones
+		void update(uint64_t byteBudget = UINT64_MAX);
+		Statistics getStatistics() const;
+
+	private:
+		struct Upload {
+			const Texture* texture;
+			uint32_t level;
+			glm::uvec4 region;
+			size_t start; // Of the allocation, before the offset if space at the end of the ring was skipped
+			size_t offset;
+			size_t size;
+			bool copied = false;
+			bool issued = false;
+		};
+
+		// Returns false if there's no contiguous space for the size, called with the mutex locked
+		bool allocate(size_t size, size_t& start, size_t& offset);
+		// Frees memory of uploads whose fences were signaled
+		void reclaim();
+
+		size_t ringSize = 0;
+		size_t head = 0; // Where the next allocation starts
+		bool persistent = false;
+		unsigned char* ring = nullptr; // Mapped buffer or client ring
+		std::vector<unsigned char> clientRing;
+		// In order of staging, issued ones form a prefix
+		std::deque<Upload> uploads;
+		mutable std::mutex mutex;
+		Statistics statistics;
+
+	#ifdef CALA_API_OPENGL
+		struct Fence {
+			void* sync; // GLsync
+			uint32_t uploadCount;
+		};
+
+		GLuint bufferHandle = API_NULL;
+		std::deque<Fence> fences;
+	#endif
+	};
+}
@@ -1,4 +1,5 @@
 #include "BaseApplication.h"
+#include "Logger.h"
 
 #define MOVE_SPEED 5.f * time.getDeltaTime()
 
@@ -70,9 +71,17 @@ namespace Cala {
 
 	void BaseApplication::run()
 	{
+		bool firstFrame = true;
 		while (!window->exitTriggered()) {
 			loop();
 			update();
+
+			// Time since window creation, includes compilation of shaders which renderers first use in this frame
+			if (firstFrame)
+			{
+				Logger::getInstance().logInfoToConsole("First frame presented after " + std::to_string((uint32_t)(time.getRunningTime() * 1000.0)) + " ms");
+				firstFrame = false;
+			}
 		}
 	}
-}
+}
\ No newline at end of file
@@ -0,0 +1,453 @@
+#include "BlockEncoder.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+// Power iterations finding the principal axis of block texels
+#define AXIS_ITERATION_COUNT 8
+
+// Least squares refinements of endpoints, a refinement is kept only if it lowers the error
+#define REFINEMENT_COUNT 2
+
+namespace Cala {
+	void BlockEncoder::encodeBC1(const uint8_t* texels, uint8_t* block, bool alpha)
+	{
+		bool opaque[16];
+		bool transparent = false;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			opaque[i] = !alpha || texels[i * 4 + 3] >= 128;
+			transparent |= !opaque[i];
+		}
+
+		std::memset(block, 0, 8);
+		Line line;
+		if (!fitLine(texels, opaque, 3, line))
+		{
+			// Equal colors select 3 color mode, where index 3 is transparent black
+			std::memset(block + 4, 0xFF, 4);
+			return;
+		}
+
+		uint16_t bestColors[2]{};
+		uint32_t bestIndices = 0;
+		float bestError = INFINITY;
+		for (uint32_t iteration = 0; iteration <= REFINEMENT_COUNT; ++iteration)
+		{
+			// First color is greater in 4 color mode and not greater in 3 color mode with transparent texels
+			uint16_t colors[2] = { packColor(line.start), packColor(line.end) };
+			if (transparent ? colors[0] > colors[1] : colors[0] < colors[1])
+			{
+				std::swap(colors[0], colors[1]);
+				std::swap(line.start, line.end);
+			}
+
+			int palette[4][3];
+			unpackColor(colors[0], palette[0]);
+			unpackColor(colors[1], palette[1]);
+			float paletteWeights[4] = { 0.f, 1.f, 1.f / 3.f, 2.f / 3.f };
+			const bool threeColors = colors[0] <= colors[1];
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				if (threeColors)
+				{
+					palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+					paletteWeights[2] = 0.5f;
+				}
+				else
+				{
+					palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+					palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+				}
+			}
+
+			uint32_t indices = 0;
+			float error = 0.f;
+			float weights[16];
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				weights[i] = 0.f;
+				if (!opaque[i])
+				{
+					indices |= 3U << (2 * i);
+					continue;
+				}
+
+				uint32_t bestIndex = 0;
+				int bestDistance = INT32_MAX;
+				for (uint32_t j = 0; j < (threeColors ? 3U : 4U); ++j)
+				{
+					int distance = 0;
+					for (uint32_t c = 0; c < 3; ++c)
+					{
+						const int difference = palette[j][c] - texels[i * 4 + c];
+						distance += difference * difference;
+					}
+
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						bestIndex = j;
+					}
+				}
+
+				indices |= bestIndex << (2 * i);
+				weights[i] = paletteWeights[bestIndex];
+				error += (float)bestDistance;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				bestColors[0] = colors[0];
+				bestColors[1] = colors[1];
+				bestIndices = indices;
+			}
+
+			if (error == 0.f || !refineLine(texels, opaque, weights, 3, line))
+				break;
+		}
+
+		block[0] = (uint8_t)(bestColors[0] & 0xFF);
+		block[1] = (uint8_t)(bestColors[0] >> 8);
+		block[2] = (uint8_t)(bestColors[1] & 0xFF);
+		block[3] = (uint8_t)(bestColors[1] >> 8);
+		for (uint32_t i = 0; i < 4; ++i)
+			block[4 + i] = (uint8_t)(bestIndices >> (8 * i));
+	}
+
+	void BlockEncoder::encodeBC3(const uint8_t* texels, uint8_t* block)
+	{
+		encodeBC4(texels, 3, block);
+		encodeBC1(texels, block + 8, false);
+	}
+
+	void BlockEncoder::encodeBC5(const uint8_t* texels, uint8_t* block)
+	{
+		encodeBC4(texels, 0, block);
+		encodeBC4(texels, 1, block + 8);
+	}
+
+	void BlockEncoder::encodeBC7(const uint8_t* texels, uint8_t* block)
+	{
+		static const int indexWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		Line line;
+		fitLine(texels, nullptr, 4, line);
+
+		uint8_t bestEndpoints[2][4]{};
+		uint32_t bestPBits[2]{};
+		uint32_t bestIndices[16]{};
+		float bestError = INFINITY;
+		for (uint32_t iteration = 0; iteration <= REFINEMENT_COUNT; ++iteration)
+		{
+			uint8_t endpoints[2][4];
+			uint32_t pBits[2];
+			quantizeBC7Endpoint(line.start, endpoints[0], pBits[0]);
+			quantizeBC7Endpoint(line.end, endpoints[1], pBits[1]);
+
+			int palette[16][4];
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				const int start = endpoints[0][c] << 1 | (int)pBits[0];
+				const int end = endpoints[1][c] << 1 | (int)pBits[1];
+				for (uint32_t j = 0; j < 16; ++j)
+					palette[j][c] = ((64 - indexWeights[j]) * start + indexWeights[j] * end + 32) >> 6;
+			}
+
+			uint32_t indices[16];
+			float error = 0.f;
+			float weights[16];
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				uint32_t bestIndex = 0;
+				int bestDistance = INT32_MAX;
+				for (uint32_t j = 0; j < 16; ++j)
+				{
+					int distance = 0;
+					for (uint32_t c = 0; c < 4; ++c)
+					{
+						const int difference = palette[j][c] - texels[i * 4 + c];
+						distance += difference * difference;
+					}
+
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						bestIndex = j;
+					}
+				}
+
+				indices[i] = bestIndex;
+				weights[i] = (float)indexWeights[bestIndex] / 64.f;
+				error += (float)bestDistance;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				std::memcpy(bestEndpoints, endpoints, sizeof(endpoints));
+				bestPBits[0] = pBits[0];
+				bestPBits[1] = pBits[1];
+				std::memcpy(bestIndices, indices, sizeof(indices));
+			}
+
+			if (error == 0.f || !refineLine(texels, nullptr, weights, 4, line))
+				break;
+		}
+
+		// Highest bit of the first index is implied to be zero, swapping endpoints inverts indices
+		if (bestIndices[0] >= 8)
+		{
+			for (uint32_t c = 0; c < 4; ++c)
+				std::swap(bestEndpoints[0][c], bestEndpoints[1][c]);
+
+			std::swap(bestPBits[0], bestPBits[1]);
+			for (uint32_t i = 0; i < 16; ++i)
+				bestIndices[i] = 15 - bestIndices[i];
+		}
+
+		std::memset(block, 0, 16);
+		uint32_t offset = 0;
+		writeBits(block, offset, 1U << 6, 7);
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			writeBits(block, offset, bestEndpoints[0][c], 7);
+			writeBits(block, offset, bestEndpoints[1][c], 7);
+		}
+
+		writeBits(block, offset, bestPBits[0], 1);
+		writeBits(block, offset, bestPBits[1], 1);
+		writeBits(block, offset, bestIndices[0], 3);
+		for (uint32_t i = 1; i < 16; ++i)
+			writeBits(block, offset, bestIndices[i], 4);
+	}
+
+	void BlockEncoder::encodeBC4(const uint8_t* texels, uint32_t channel, uint8_t* block)
+	{
+		uint8_t minimum = 255;
+		uint8_t maximum = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			minimum = std::min(minimum, texels[i * 4 + channel]);
+			maximum = std::max(maximum, texels[i * 4 + channel]);
+		}
+
+		// Greater first value selects 8 values interpolated between the two, equal ones need only index 0
+		block[0] = maximum;
+		block[1] = minimum;
+		uint64_t indices = 0;
+		if (maximum > minimum)
+		{
+			int palette[8] = { maximum, minimum };
+			for (int j = 1; j < 7; ++j)
+				palette[j + 1] = ((7 - j) * maximum + j * minimum + 3) / 7;
+
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				uint64_t bestIndex = 0;
+				int bestDistance = INT32_MAX;
+				for (uint32_t j = 0; j < 8; ++j)
+				{
+					const int distance = std::abs(palette[j] - texels[i * 4 + channel]);
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						bestIndex = j;
+					}
+				}
+
+				indices |= bestIndex << (3 * i);
+			}
+		}
+
+		for (uint32_t i = 0; i < 6; ++i)
+			block[2 + i] = (uint8_t)(indices >> (8 * i));
+	}
+
+	bool BlockEncoder::fitLine(const uint8_t* texels, const bool* mask, uint32_t channelCount, Line& line)
+	{
+		float mean[4]{};
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			if (mask != nullptr && !mask[i])
+				continue;
+
+			for (uint32_t c = 0; c < channelCount; ++c)
+				mean[c] += texels[i * 4 + c];
+
+			++count;
+		}
+
+		if (count == 0)
+			return false;
+
+		for (uint32_t c = 0; c < channelCount; ++c)
+			mean[c] /= (float)count;
+
+		float covariance[4][4]{};
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			if (mask != nullptr && !mask[i])
+				continue;
+
+			for (uint32_t a = 0; a < channelCount; ++a)
+			{
+				for (uint32_t b = 0; b < channelCount; ++b)
+					covariance[a][b] += (texels[i * 4 + a] - mean[a]) * (texels[i * 4 + b] - mean[b]);
+			}
+		}
+
+		// Power method starting from the row of the channel varying the most
+		uint32_t largest = 0;
+		for (uint32_t c = 1; c < channelCount; ++c)
+		{
+			if (covariance[c][c] > covariance[largest][largest])
+				largest = c;
+		}
+
+		float axis[4]{};
+		for (uint32_t c = 0; c < channelCount; ++c)
+			axis[c] = covariance[largest][c];
+
+		float length = 0.f;
+		for (uint32_t iteration = 0; iteration < AXIS_ITERATION_COUNT; ++iteration)
+		{
+			float next[4]{};
+			for (uint32_t a = 0; a < channelCount; ++a)
+			{
+				for (uint32_t b = 0; b < channelCount; ++b)
+					next[a] += covariance[a][b] * axis[b];
+			}
+
+			length = 0.f;
+			for (uint32_t c = 0; c < channelCount; ++c)
+				length += next[c] * next[c];
+
+			length = std::sqrt(length);
+			if (length < 1e-6f)
+				break;
+
+			for (uint32_t c = 0; c < channelCount; ++c)
+				axis[c] = next[c] / length;
+		}
+
+		float minimum = 0.f;
+		float maximum = 0.f;
+		if (length >= 1e-6f)
+		{
+			minimum = INFINITY;
+			maximum = -INFINITY;
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				if (mask != nullptr && !mask[i])
+					continue;
+
+				float projection = 0.f;
+				for (uint32_t c = 0; c < channelCount; ++c)
+					projection += (texels[i * 4 + c] - mean[c]) * axis[c];
+
+				minimum = std::min(minimum, projection);
+				maximum = std::max(maximum, projection);
+			}
+		}
+
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			line.start[c] = c < channelCount ? std::clamp(mean[c] + minimum * axis[c], 0.f, 255.f) : 255.f;
+			line.end[c] = c < channelCount ? std::clamp(mean[c] + maximum * axis[c], 0.f, 255.f) : 255.f;
+		}
+
+		return true;
+	}
+
+	bool BlockEncoder::refineLine(const uint8_t* texels, const bool* mask, const float* weights, uint32_t channelCount, Line& line)
+	{
+		// Normal equations of texel = (1 - weight) * start + weight * end, shared by all channels
+		float startStart = 0.f;
+		float startEnd = 0.f;
+		float endEnd = 0.f;
+		float startTexel[4]{};
+		float endTexel[4]{};
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			if (mask != nullptr && !mask[i])
+				continue;
+
+			const float startWeight = 1.f - weights[i];
+			startStart += startWeight * startWeight;
+			startEnd += startWeight * weights[i];
+			endEnd += weights[i] * weights[i];
+			for (uint32_t c = 0; c < channelCount; ++c)
+			{
+				startTexel[c] += startWeight * texels[i * 4 + c];
+				endTexel[c] += weights[i] * texels[i * 4 + c];
+			}
+		}
+
+		const float determinant = startStart * endEnd - startEnd * startEnd;
+		if (std::fabs(determinant) < 1e-6f)
+			return false;
+
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			line.start[c] = std::clamp((endEnd * startTexel[c] - startEnd * endTexel[c]) / determinant, 0.f, 255.f);
+			line.end[c] = std::clamp((startStart * endTexel[c] - startEnd * startTexel[c]) / determinant, 0.f, 255.f);
+		}
+
+		return true;
+	}
+
+	uint16_t BlockEncoder::packColor(const float* color)
+	{
+		const uint32_t red = (uint32_t)std::lround(color[0] * 31.f / 255.f);
+		const uint32_t green = (uint32_t)std::lround(color[1] * 63.f / 255.f);
+		const uint32_t blue = (uint32_t)std::lround(color[2] * 31.f / 255.f);
+		return (uint16_t)(red << 11 | green << 5 | blue);
+	}
+
+	void BlockEncoder::unpackColor(uint16_t packed, int* color)
+	{
+		const int red = packed >> 11;
+		const int green = (packed >> 5) & 0x3F;
+		const int blue = packed & 0x1F;
+		color[0] = red << 3 | red >> 2;
+		color[1] = green << 2 | green >> 4;
+		color[2] = blue << 3 | blue >> 2;
+	}
+
+	float BlockEncoder::quantizeBC7Endpoint(const float* endpoint, uint8_t* quantized, uint32_t& pBit)
+	{
+		float bestError = INFINITY;
+		for (uint32_t bit = 0; bit < 2; ++bit)
+		{
+			uint8_t candidate[4];
+			float error = 0.f;
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				candidate[c] = (uint8_t)std::clamp(std::lround((endpoint[c] - (float)bit) / 2.f), 0L, 127L);
+				const float difference = (float)(candidate[c] << 1 | bit) - endpoint[c];
+				error += difference * difference;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				pBit = bit;
+				std::memcpy(quantized, candidate, 4);
+			}
+		}
+
+		return bestError;
+	}
+
+	void BlockEncoder::writeBits(uint8_t* block, uint32_t& offset, uint32_t value, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; ++i, ++offset)
+		{
+			if ((value >> i) & 1U)
+				block[offset >> 3] |= (uint8_t)(1U << (offset & 7U));
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <stdint.h>
+
+namespace Cala {
+	/**
+	 * Encodes 4x4 blocks of RGBA8 texels, given row by row, into block compressed formats
+	 * Endpoints are the extremes of block texels along their principal axis, refined by least squares once indices are chosen
+	 * Values are encoded as they are, so sRGB texels are fitted in sRGB space like sRGB formats decode them
+	*/
+	class BlockEncoder {
+	public:
+		// 8 bytes, texels with alpha below 128 become transparent black if alpha is kept, otherwise alpha is ignored
+		static void encodeBC1(const uint8_t* texels, uint8_t* block, bool alpha);
+		// 16 bytes, alpha as BC4 followed by opaque BC1 color
+		static void encodeBC3(const uint8_t* texels, uint8_t* block);
+		// 16 bytes, red and green as two BC4 blocks, for normal maps
+		static void encodeBC5(const uint8_t* texels, uint8_t* block);
+		// 16 bytes, mode 6 with a single RGBA line of 16 levels, which is the most precise mode for smooth blocks
+		static void encodeBC7(const uint8_t* texels, uint8_t* block);
+
+	private:
+		// Endpoints of a line through texels of a block, in 0 to 255
+		struct Line {
+			float start[4];
+			float end[4];
+		};
+
+		static void encodeBC4(const uint8_t* texels, uint32_t channel, uint8_t* block);
+
+		// Texels with mask of false are left out, mask may be nullptr
+		static bool fitLine(const uint8_t* texels, const bool* mask, uint32_t channelCount, Line& line);
+		// Least squares endpoints for given weights of the second endpoint, returns false if they're degenerate
+		static bool refineLine(const uint8_t* texels, const bool* mask, const float* weights, uint32_t channelCount, Line& line);
+
+		static uint16_t packColor(const float* color);
+		static void unpackColor(uint16_t packed, int* color);
+		// Endpoint of 7 bits per channel with shared lowest bit, returns squared error
+		static float quantizeBC7Endpoint(const float* endpoint, uint8_t* quantized, uint32_t& pBit);
+		static void writeBits(uint8_t* block, uint32_t& offset, uint32_t value, uint32_t count);
+	};
+}
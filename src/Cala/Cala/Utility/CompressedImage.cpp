@@ -0,0 +1,301 @@
+#include "CompressedImage.h"
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include "BlockEncoder.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+// Rows of blocks encoded by a thread at once
+#define ENCODING_BAND_BLOCK_ROW_COUNT 4U
+
+#define DDS_MAGIC 0x20534444U // "DDS "
+#define DDS_FLAGS 0xA1007U // Caps, height, width, pixel format, mipmap count and linear size
+#define DDS_PIXEL_FORMAT_FOURCC 0x4U
+#define DDS_FLAG_MIPMAP_COUNT 0x20000U
+#define DDS_CAPS 0x401008U // Texture, complex and mipmap
+#define DDS_FOURCC_DXT1 0x31545844U
+#define DDS_FOURCC_DXT5 0x35545844U
+#define DDS_FOURCC_ATI2 0x32495441U
+#define DDS_FOURCC_BC5U 0x55354342U
+#define DDS_FOURCC_DX10 0x30315844U
+#define DDS_DIMENSION_TEXTURE2D 3U
+#define DDS_MISC_TEXTURECUBE 0x4U
+#define DDS_MAX_DIMENSION 16384U // Largest 2D texture of Direct3D, which DDS files come from
+
+#define DXGI_FORMAT_BC1_UNORM 71U
+#define DXGI_FORMAT_BC1_UNORM_SRGB 72U
+#define DXGI_FORMAT_BC3_UNORM 77U
+#define DXGI_FORMAT_BC3_UNORM_SRGB 78U
+#define DXGI_FORMAT_BC5_UNORM 83U
+#define DXGI_FORMAT_BC7_UNORM 98U
+#define DXGI_FORMAT_BC7_UNORM_SRGB 99U
+
+namespace Cala {
+	CompressedImage::CompressedImage(const std::filesystem::path& pathToImage)
+	{
+		load(pathToImage);
+	}
+
+	void CompressedImage::encode(const Image& image, Format _format, bool _sRGB)
+	{
+		freeData();
+		if (image.getData() == nullptr)
+		{
+			Logger::getInstance().logErrorToConsole("Image " + image.getPath() + " without data can't be compressed!");
+			return;
+		}
+
+		width = image.getDimensions().x;
+		height = image.getDimensions().y;
+		format = _format;
+		sRGB = _sRGB && format != Format::BC5;
+		path = image.getPath();
+
+		// Block rows of all levels are encoded together, so threads aren't left idle by small levels
+		std::vector<uint32_t> firstBlockRows;
+		uint32_t blockRowCount = 0;
+		for (uint32_t level = 0; level < image.getMipmapCount(); ++level)
+		{
+			const glm::ivec2 dimensions = image.getMipmapDimensions(level);
+			mipmaps.emplace_back(getLevelSize(format, dimensions));
+			firstBlockRows.push_back(blockRowCount);
+			blockRowCount += (uint32_t)(dimensions.y + 3) / 4;
+		}
+
+		const uint32_t channelCount = (uint32_t)image.getChannelCount();
+		const uint32_t blockSize = getBlockSize(format);
+		ThreadPool::getInstance().parallelFor(blockRowCount, ENCODING_BAND_BLOCK_ROW_COUNT, [&](uint32_t begin, uint32_t end)
+		{
+			uint8_t texels[64];
+			for (uint32_t blockRow = begin; blockRow < end; ++blockRow)
+			{
+				const uint32_t level = (uint32_t)(std::upper_bound(firstBlockRows.begin(), firstBlockRows.end(), blockRow) - firstBlockRows.begin()) - 1;
+				const glm::ivec2 dimensions = image.getMipmapDimensions(level);
+				const unsigned char* source = image.getMipmapData(level);
+				const uint32_t blockY = blockRow - firstBlockRows[level];
+				const uint32_t blockCountX = (uint32_t)(dimensions.x + 3) / 4;
+				uint8_t* destination = mipmaps[level].data() + (size_t)blockY * blockCountX * blockSize;
+				for (uint32_t blockX = 0; blockX < blockCountX; ++blockX, destination += blockSize)
+				{
+					// Gray and gray alpha images are expanded to RGBA
+					for (uint32_t i = 0; i < 16; ++i)
+					{
+						const uint32_t x = std::min(blockX * 4 + i % 4, (uint32_t)dimensions.x - 1);
+						const uint32_t y = std::min(blockY * 4 + i / 4, (uint32_t)dimensions.y - 1);
+						const unsigned char* texel = source + ((size_t)y * dimensions.x + x) * channelCount;
+						uint8_t* rgba = texels + i * 4;
+						rgba[0] = texel[0];
+						rgba[1] = channelCount >= 3 ? texel[1] : texel[0];
+						rgba[2] = channelCount >= 3 ? texel[2] : texel[0];
+						rgba[3] = channelCount == 4 ? texel[3] : channelCount == 2 ? texel[1] : 255;
+					}
+
+					switch (format)
+					{
+						case Format::BC1: BlockEncoder::encodeBC1(texels, destination, channelCount == 2 || channelCount == 4); break;
+						case Format::BC3: BlockEncoder::encodeBC3(texels, destination); break;
+						case Format::BC5: BlockEncoder::encodeBC5(texels, destination); break;
+						case Format::BC7: BlockEncoder::encodeBC7(texels, destination); break;
+					}
+				}
+			}
+		});
+	}
+
+	bool CompressedImage::load(const std::filesystem::path& pathToImage)
+	{
+		freeData();
+		MappedFile file;
+		if (!file.open(pathToImage))
+		{
+			Logger::getInstance().logErrorToConsole("Compressed image " + pathToImage.string() + " can't be opened!");
+			return false;
+		}
+
+		Layout layout;
+		if (!readLayout(file.getData(), file.getSize(), pathToImage.string(), layout))
+			return false;
+
+		width = layout.dimensions.x;
+		height = layout.dimensions.y;
+		format = layout.format;
+		sRGB = layout.sRGB;
+		for (size_t level = 0; level < layout.levelOffsets.size(); ++level)
+		{
+			const unsigned char* levelData = file.getData() + layout.levelOffsets[level];
+			mipmaps.emplace_back(levelData, levelData + layout.levelSizes[level]);
+		}
+
+		path = pathToImage.string();
+		return true;
+	}
+
+	bool CompressedImage::readLayout(const unsigned char* bytes, size_t size, const std::string& name, Layout& layout)
+	{
+		uint32_t magic = 0;
+		DDSHeader header;
+		if (size < sizeof(magic) + sizeof(header))
+		{
+			Logger::getInstance().logErrorToConsole("Compressed image " + name + " isn't a DDS file!");
+			return false;
+		}
+
+		std::memcpy(&magic, bytes, sizeof(magic));
+		std::memcpy(&header, bytes + sizeof(magic), sizeof(header));
+		size_t offset = sizeof(magic) + sizeof(header);
+		if (magic != DDS_MAGIC || header.size != sizeof(header) || (header.pixelFormat.flags & DDS_PIXEL_FORMAT_FOURCC) == 0)
+		{
+			Logger::getInstance().logErrorToConsole("Compressed image " + name + " isn't a block compressed DDS file!");
+			return false;
+		}
+
+		bool supported = true;
+		layout.sRGB = false;
+		switch (header.pixelFormat.fourCC)
+		{
+			case DDS_FOURCC_DXT1: layout.format = Format::BC1; break;
+			case DDS_FOURCC_DXT5: layout.format = Format::BC3; break;
+			case DDS_FOURCC_ATI2:
+			case DDS_FOURCC_BC5U: layout.format = Format::BC5; break;
+			case DDS_FOURCC_DX10:
+			{
+				DDSHeaderDX10 headerDX10;
+				if (size < offset + sizeof(headerDX10))
+				{
+					supported = false;
+					break;
+				}
+
+				std::memcpy(&headerDX10, bytes + offset, sizeof(headerDX10));
+				offset += sizeof(headerDX10);
+				if (headerDX10.resourceDimension != DDS_DIMENSION_TEXTURE2D || headerDX10.arraySize > 1 || (headerDX10.miscFlags & DDS_MISC_TEXTURECUBE) != 0)
+				{
+					supported = false;
+					break;
+				}
+
+				switch (headerDX10.dxgiFormat)
+				{
+					case DXGI_FORMAT_BC1_UNORM_SRGB: layout.sRGB = true; [[fallthrough]];
+					case DXGI_FORMAT_BC1_UNORM: layout.format = Format::BC1; break;
+					case DXGI_FORMAT_BC3_UNORM_SRGB: layout.sRGB = true; [[fallthrough]];
+					case DXGI_FORMAT_BC3_UNORM: layout.format = Format::BC3; break;
+					case DXGI_FORMAT_BC5_UNORM: layout.format = Format::BC5; break;
+					case DXGI_FORMAT_BC7_UNORM_SRGB: layout.sRGB = true; [[fallthrough]];
+					case DXGI_FORMAT_BC7_UNORM: layout.format = Format::BC7; break;
+					default: supported = false; break;
+				}
+
+				break;
+			}
+			default: supported = false; break;
+		}
+
+		if (!supported)
+		{
+			Logger::getInstance().logErrorToConsole("Compressed image " + name + " has unsupported format, only 2D BC1, BC3, BC5 and BC7 images are!");
+			return false;
+		}
+
+		if (header.width == 0 || header.height == 0 || header.width > DDS_MAX_DIMENSION || header.height > DDS_MAX_DIMENSION)
+		{
+			Logger::getInstance().logErrorToConsole("Compressed image " + name + " has invalid dimensions!");
+			return false;
+		}
+
+		layout.dimensions = glm::ivec2((int)header.width, (int)header.height);
+		layout.levelOffsets.clear();
+		layout.levelSizes.clear();
+
+		// Chains longer than down to a single texel are cut, levels past it would have no size
+		uint32_t fullMipmapCount = 1;
+		while ((std::max(header.width, header.height) >> fullMipmapCount) != 0)
+			++fullMipmapCount;
+
+		const uint32_t mipmapCount = (header.flags & DDS_FLAG_MIPMAP_COUNT) != 0 ? std::clamp(header.mipmapCount, 1U, fullMipmapCount) : 1U;
+		for (uint32_t level = 0; level < mipmapCount; ++level)
+		{
+			const glm::ivec2 dimensions(std::max(layout.dimensions.x >> level, 1), std::max(layout.dimensions.y >> level, 1));
+			const size_t levelSize = getLevelSize(layout.format, dimensions);
+			if (size < offset + levelSize)
+			{
+				Logger::getInstance().logErrorToConsole("Compressed image " + name + " is truncated!");
+				return false;
+			}
+
+			layout.levelOffsets.push_back(offset);
+			layout.levelSizes.push_back(levelSize);
+			offset += levelSize;
+		}
+
+		return true;
+	}
+
+	bool CompressedImage::save(const std::filesystem::path& pathToImage) const
+	{
+		if (mipmaps.empty())
+		{
+			Logger::getInstance().logErrorToConsole("Compressed image without data can't be saved to " + pathToImage.string() + "!");
+			return false;
+		}
+
+		DDSHeader header{};
+		header.size = sizeof(header);
+		header.flags = DDS_FLAGS;
+		header.height = (uint32_t)height;
+		header.width = (uint32_t)width;
+		header.linearSize = (uint32_t)mipmaps[0].size();
+		header.mipmapCount = (uint32_t)mipmaps.size();
+		header.pixelFormat.size = sizeof(header.pixelFormat);
+		header.pixelFormat.flags = DDS_PIXEL_FORMAT_FOURCC;
+		header.pixelFormat.fourCC = DDS_FOURCC_DX10;
+		header.caps[0] = DDS_CAPS;
+
+		DDSHeaderDX10 headerDX10{};
+		headerDX10.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+		headerDX10.arraySize = 1;
+		switch (format)
+		{
+			case Format::BC1: headerDX10.dxgiFormat = sRGB ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM; break;
+			case Format::BC3: headerDX10.dxgiFormat = sRGB ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM; break;
+			case Format::BC5: headerDX10.dxgiFormat = DXGI_FORMAT_BC5_UNORM; break;
+			case Format::BC7: headerDX10.dxgiFormat = sRGB ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM; break;
+		}
+
+		std::ofstream file(pathToImage, std::ios::binary);
+		const uint32_t magic = DDS_MAGIC;
+		file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(&headerDX10), sizeof(headerDX10));
+		for (const std::vector<unsigned char>& level : mipmaps)
+			file.write(reinterpret_cast<const char*>(level.data()), (std::streamsize)level.size());
+
+		if (!file)
+		{
+			Logger::getInstance().logErrorToConsole("Compressed image can't be written to " + pathToImage.string() + "!");
+			return false;
+		}
+
+		return true;
+	}
+
+	void CompressedImage::freeData()
+	{
+		width = 0;
+		height = 0;
+		sRGB = false;
+		mipmaps.clear();
+	}
+
+	glm::ivec2 CompressedImage::getMipmapDimensions(uint32_t level) const
+	{
+		return glm::ivec2(std::max(width >> level, 1), std::max(height >> level, 1));
+	}
+
+	size_t CompressedImage::getLevelSize(Format format, const glm::ivec2& dimensions)
+	{
+		return (size_t)((dimensions.x + 3) / 4) * (size_t)((dimensions.y + 3) / 4) * getBlockSize(format);
+	}
+}
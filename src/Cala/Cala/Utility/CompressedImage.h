@@ -0,0 +1,104 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <glm/vec2.hpp>
+#include <filesystem>
+#include "Image.h"
+
+namespace Cala {
+	/**
+	 * Block compressed image with its mipmaps, encoded from an Image or read from a DDS file
+	 * Texels are stored in 4x4 blocks, BC1 takes 8 bytes per block and other formats 16
+	*/
+	class CompressedImage {
+	public:
+		enum class Format {
+			BC1, // RGB with 1 bit alpha, 4 bits per texel
+			BC3, // RGBA, alpha interpolated separately from color
+			BC5, // Two independent channels, for normal maps with reconstructed z
+			BC7 // RGBA with higher quality than BC1 and BC3
+		};
+
+		// Levels of a DDS file in place, so they can be read from the file mapped to memory
+		struct Layout {
+			Format format = Format::BC7;
+			bool sRGB = false;
+			glm::ivec2 dimensions{ 0 };
+			std::vector<size_t> levelOffsets;
+			std::vector<size_t> levelSizes;
+		};
+
+		CompressedImage() = default;
+		CompressedImage(const std::filesystem::path& pathToImage);
+		CompressedImage(const CompressedImage&) = delete;
+		CompressedImage(CompressedImage&& other) = default;
+		CompressedImage& operator=(const CompressedImage&) = delete;
+		CompressedImage& operator=(CompressedImage&& other) = default;
+		~CompressedImage() = default;
+
+		/**
+		 * Encodes the image with all of its mipmaps, blocks are encoded in parallel on the thread pool
+		 * Edges of levels not divisible by 4 are repeated to fill their blocks, sRGB only marks color as sRGB encoded
+		*/
+		void encode(const Image& image, Format _format, bool _sRGB);
+		// Reads DDS files with DX10 header or legacy DXT1, DXT5 and ATI2 ones, returns false on failure
+		bool load(const std::filesystem::path& pathToImage);
+		// Writes DDS file with DX10 header
+		bool save(const std::filesystem::path& pathToImage) const;
+		void freeData();
+
+		Format getFormat() const { return format; }
+		bool isSRGB() const { return sRGB; }
+		glm::ivec2 getDimensions() const { return glm::ivec2(width, height); }
+		uint32_t getMipmapCount() const { return (uint32_t)mipmaps.size(); }
+		glm::ivec2 getMipmapDimensions(uint32_t level) const;
+		const unsigned char* getMipmapData(uint32_t level) const { return mipmaps[level].data(); }
+		size_t getMipmapSize(uint32_t level) const { return mipmaps[level].size(); }
+		const std::string& getPath() const { return path; }
+
+		static uint32_t getBlockSize(Format format) { return format == Format::BC1 ? 8 : 16; }
+		// Reads headers of DDS file contents, name is used only in errors
+		static bool readLayout(const unsigned char* bytes, size_t size, const std::string& name, Layout& layout);
+
+	private:
+		struct DDSPixelFormat {
+			uint32_t size;
+			uint32_t flags;
+			uint32_t fourCC;
+			uint32_t bitCount;
+			uint32_t bitMasks[4];
+		};
+
+		struct DDSHeader {
+			uint32_t size;
+			uint32_t flags;
+			uint32_t height;
+			uint32_t width;
+			uint32_t linearSize;
+			uint32_t depth;
+			uint32_t mipmapCount;
+			uint32_t reserved[11];
+			DDSPixelFormat pixelFormat;
+			uint32_t caps[4];
+			uint32_t reserved2;
+		};
+
+		struct DDSHeaderDX10 {
+			uint32_t dxgiFormat;
+			uint32_t resourceDimension;
+			uint32_t miscFlags;
+			uint32_t arraySize;
+			uint32_t miscFlags2;
+		};
+
+		static size_t getLevelSize(Format format, const glm::ivec2& dimensions);
+
+		int width = 0;
+		int height = 0;
+		Format format = Format::BC7;
+		bool sRGB = false;
+		std::vector<std::vector<unsigned char>> mipmaps;
+		std::string path;
+	};
+}
@@ -1,7 +1,20 @@
 #include "Image.h"
+#include <cmath>
+#include <array>
+#include <algorithm>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 #include "Logger.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "SIMD.h"
+
+// Rows filtered by a thread at once
+#define MIPMAP_BAND_ROW_COUNT 16U
+
+// Kaiser window reaches this many destination texels to each side, alpha sets its falloff
+#define KAISER_RADIUS 3.f
+#define KAISER_ALPHA 4.f
 
 namespace Cala {
 	Image::Image(const std::filesystem::path& pathToImage)
@@ -21,6 +34,7 @@ namespace Cala {
 		channelCount = other.channelCount;
 		data = other.data;
 		other.data = nullptr;
+		mipmaps = std::move(other.mipmaps);
 		path = std::move(other.path);
 		return *this;
     }
@@ -36,28 +50,287 @@ namespace Cala {
 		if (data != nullptr)
 			freeData();
 
+		if (!checkPath(pathToImage))
+			return;
+
+		// Decoding from the mapped file avoids copying it through stdio buffers
+		MappedFile file(pathToImage);
+		if (!file.isOpen())
+		{
+			Logger::getInstance().logErrorToConsole("File " + pathToImage.string() + " couldn't be read!");
+			return;
+		}
+
+		loadFromMemory(file.getData(), file.getSize(), pathToImage.string());
+	}
+
+	void Image::loadFromMemory(const unsigned char* bytes, size_t size, const std::string& pathToImage)
+	{
+		if (data != nullptr)
+			freeData();
+
+		path = pathToImage;
+		data = stbi_load_from_memory(bytes, (int)size, &width, &height, &channelCount, 0);
+
+		if (data == nullptr)
+			Logger::getInstance().logErrorToConsole("Image " + path + " not loaded properly.");
+	}
+
+	std::vector<Image> Image::loadBatch(const std::vector<std::filesystem::path>& pathsToImages)
+	{
+		// Each image is a separate chunk, so large images don't hold up the small ones
+		std::vector<Image> images(pathsToImages.size());
+		ThreadPool::getInstance().parallelFor((uint32_t)pathsToImages.size(), 1, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+				images[i].load(pathsToImages[i]);
+		});
+
+		return images;
+	}
+
+	bool Image::checkPath(const std::filesystem::path& pathToImage)
+	{
 		if (!std::filesystem::exists(pathToImage))
 		{
 			Logger::getInstance().logErrorToConsole("Path " + pathToImage.string() + " not valid!");
-			return;
+			return false;
 		}
 
 		if (!pathToImage.extension().compare("jpg") || !pathToImage.extension().compare("png") || !pathToImage.extension().compare("jpeg"))
 		{
 			Logger::getInstance().logErrorToConsole("Path " + pathToImage.string() + " has invalid file extension!");
-			return;
+			return false;
 		}
 
-		path = pathToImage.string();
-		data = stbi_load(path.c_str(), &width, &height, &channelCount, 0);
-
-		if (data == nullptr)
-			Logger::getInstance().logErrorToConsole("Image not loaded properly.");
+		return true;
 	}
 
 	void Image::freeData()
 	{
 		stbi_image_free(data);
 		data = nullptr;
+		mipmaps.clear();
+	}
+
+	glm::ivec2 Image::getMipmapDimensions(uint32_t level) const
+	{
+		return glm::ivec2(std::max(width >> level, 1), std::max(height >> level, 1));
+	}
+
+	void Image::generateMipmaps(MipmapFilter filter, bool sRGB)
+	{
+		if (data == nullptr)
+		{
+			Logger::getInstance().logErrorToConsole("Mipmaps of image without data can't be generated!");
+			return;
+		}
+
+		// Color is the first channel of grey images and the first three of others, the rest is alpha
+		static const std::array<float, 256> sRGBToLinear = []()
+		{
+			std::array<float, 256> table;
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				const float value = (float)i / 255.f;
+				table[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+			}
+
+			return table;
+		}();
+
+		const int colorChannelCount = channelCount >= 3 ? 3 : 1;
+		auto isColor = [sRGB, colorChannelCount](int channel) { return sRGB && channel < colorChannelCount; };
+
+		// Texels are kept as 4 floats, unused channels are zero
+		glm::ivec2 sourceSize(width, height);
+		std::vector<float> source((size_t)width * height * 4, 0.f);
+		for (size_t i = 0; i < (size_t)width * height; ++i)
+		{
+			for (int channel = 0; channel < channelCount; ++channel)
+			{
+				const unsigned char value = data[i * channelCount + channel];
+				source[i * 4 + channel] = isColor(channel) ? sRGBToLinear[value] : (float)value / 255.f;
+			}
+		}
+
+		mipmaps.clear();
+		std::vector<float> filteredRows;
+		std::vector<float> destination;
+		std::vector<Tap> horizontalTaps;
+		std::vector<Tap> verticalTaps;
+		std::vector<uint32_t> horizontalOffsets;
+		std::vector<uint32_t> verticalOffsets;
+		while (sourceSize.x > 1 || sourceSize.y > 1)
+		{
+			const glm::ivec2 size(std::max(sourceSize.x / 2, 1), std::max(sourceSize.y / 2, 1));
+			computeMipmapTaps(sourceSize.x, size.x, filter, horizontalTaps, horizontalOffsets);
+			computeMipmapTaps(sourceSize.y, size.y, filter, verticalTaps, verticalOffsets);
+
+			// Filter is separable, source rows are filtered horizontally first
+			filteredRows.resize((size_t)sourceSize.y * size.x * 4);
+			ThreadPool::getInstance().parallelFor((uint32_t)sourceSize.y, MIPMAP_BAND_ROW_COUNT, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t y = begin; y < end; ++y)
+				{
+					const float* in = source.data() + (size_t)y * sourceSize.x * 4;
+					float* out = filteredRows.data() + (size_t)y * size.x * 4;
+					for (int x = 0; x < size.x; ++x)
+					{
+					#if defined (CALA_SIMD_SSE2)
+						__m128 sum = _mm_setzero_ps();
+						for (uint32_t i = horizontalOffsets[x]; i < horizontalOffsets[x + 1]; ++i)
+							sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(horizontalTaps[i].weight), _mm_loadu_ps(in + horizontalTaps[i].index * 4)));
+
+						_mm_storeu_ps(out + x * 4, sum);
+					#else
+						float sum[4] = {};
+						for (uint32_t i = horizontalOffsets[x]; i < horizontalOffsets[x + 1]; ++i)
+						{
+							for (int channel = 0; channel < 4; ++channel)
+								sum[channel] += horizontalTaps[i].weight * in[horizontalTaps[i].index * 4 + channel];
+						}
+
+						std::copy(sum, sum + 4, out + x * 4);
+					#endif
+					}
+				}
+			});
+
+			// Rows of the level are weighted sums of filtered rows, summed as flat arrays
+			destination.resize((size_t)size.x * size.y * 4);
+			const size_t rowLength = (size_t)size.x * 4;
+			ThreadPool::getInstance().parallelFor((uint32_t)size.y, MIPMAP_BAND_ROW_COUNT, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t y = begin; y < end; ++y)
+				{
+					float* out = destination.data() + y * rowLength;
+					size_t i = 0;
+
+				#if defined (CALA_SIMD_AVX)
+					for (; i + 8 <= rowLength; i += 8)
+					{
+						__m256 sum = _mm256_setzero_ps();
+						for (uint32_t j = verticalOffsets[y]; j < verticalOffsets[y + 1]; ++j)
+						{
+							const __m256 texels = _mm256_loadu_ps(filteredRows.data() + verticalTaps[j].index * rowLength + i);
+							sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(verticalTaps[j].weight), texels));
+						}
+
+						// Negative lobes of the Kaiser filter may overshoot
+						_mm256_storeu_ps(out + i, _mm256_min_ps(_mm256_max_ps(sum, _mm256_setzero_ps()), _mm256_set1_ps(1.f)));
+					}
+				#elif defined (CALA_SIMD_SSE2)
+					for (; i + 4 <= rowLength; i += 4)
+					{
+						__m128 sum = _mm_setzero_ps();
+						for (uint32_t j = verticalOffsets[y]; j < verticalOffsets[y + 1]; ++j)
+						{
+							const __m128 texels = _mm_loadu_ps(filteredRows.data() + verticalTaps[j].index * rowLength + i);
+							sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(verticalTaps[j].weight), texels));
+						}
+
+						_mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(sum, _mm_setzero_ps()), _mm_set1_ps(1.f)));
+					}
+				#endif
+
+					for (; i < rowLength; ++i)
+					{
+						float sum = 0.f;
+						for (uint32_t j = verticalOffsets[y]; j < verticalOffsets[y + 1]; ++j)
+							sum += verticalTaps[j].weight * filteredRows[verticalTaps[j].index * rowLength + i];
+
+						out[i] = std::clamp(sum, 0.f, 1.f);
+					}
+				}
+			});
+
+			// Stored level is rounded, the next one is filtered from exact values
+			std::vector<unsigned char> level((size_t)size.x * size.y * channelCount);
+			for (size_t i = 0; i < (size_t)size.x * size.y; ++i)
+			{
+				for (int channel = 0; channel < channelCount; ++channel)
+				{
+					float value = destination[i * 4 + channel];
+					if (isColor(channel))
+						value = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+
+					level[i * channelCount + channel] = (unsigned char)std::lround(value * 255.f);
+				}
+			}
+
+			mipmaps.push_back(std::move(level));
+			std::swap(source, destination);
+			sourceSize = size;
+		}
+	}
+
+	void Image::computeMipmapTaps(int sourceSize, int size, MipmapFilter filter, std::vector<Tap>& taps, std::vector<uint32_t>& offsets)
+	{
+		taps.clear();
+		offsets.clear();
+		const float ratio = (float)sourceSize / (float)size;
+		for (int i = 0; i < size; ++i)
+		{
+			offsets.push_back((uint32_t)taps.size());
+			const size_t firstTap = taps.size();
+			float weightSum = 0.f;
+			if (filter == MipmapFilter::Box || ratio <= 1.f)
+			{
+				// Weights are the parts of source texels covered by the destination texel, odd sizes split texels between two
+				const float begin = (float)i * ratio;
+				const float end = begin + ratio;
+				for (int j = (int)begin; j < sourceSize && (float)j < end; ++j)
+				{
+					const float coverage = std::min(end, (float)j + 1.f) - std::max(begin, (float)j);
+					if (coverage > 0.f)
+						taps.push_back({ j, coverage });
+				}
+			}
+			else
+			{
+				// Kernel is stretched over source texels by the ratio, texels outside are clamped to the edge
+				auto besselI0 = [](float x)
+				{
+					float sum = 1.f;
+					float term = 1.f;
+					for (int k = 1; k < 16; ++k)
+					{
+						term *= (x * x) / (4.f * (float)(k * k));
+						sum += term;
+					}
+
+					return sum;
+				};
+
+				const float center = ((float)i + 0.5f) * ratio;
+				const float reach = KAISER_RADIUS * ratio;
+				for (int j = (int)std::floor(center - reach); j <= (int)std::ceil(center + reach); ++j)
+				{
+					const float distance = ((float)j + 0.5f - center) / ratio;
+					if (std::abs(distance) >= KAISER_RADIUS)
+						continue;
+
+					const float x = 3.14159265f * distance;
+					const float sinc = distance == 0.f ? 1.f : std::sin(x) / x;
+					const float window = besselI0(KAISER_ALPHA * std::sqrt(1.f - (distance * distance) / (KAISER_RADIUS * KAISER_RADIUS))) / besselI0(KAISER_ALPHA);
+					const int index = std::clamp(j, 0, sourceSize - 1);
+
+					// Clamped texels merge with the edge one
+					if (taps.size() > firstTap && taps.back().index == index)
+						taps.back().weight += sinc * window;
+					else
+						taps.push_back({ index, sinc * window });
+				}
+			}
+
+			for (size_t j = firstTap; j < taps.size(); ++j)
+				weightSum += taps[j].weight;
+
+			for (size_t j = firstTap; j < taps.size(); ++j)
+				taps[j].weight /= weightSum;
+		}
+
+		offsets.push_back((uint32_t)taps.size());
 	}
 }
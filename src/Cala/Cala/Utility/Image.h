@@ -1,11 +1,17 @@
 #pragma once
 #include <string>
+#include <vector>
 #include <glm/vec2.hpp>
 #include <filesystem>
 
 namespace Cala {
 	class Image {
 	public:
+		enum class MipmapFilter {
+			Box, // Average of the covered texels
+			Kaiser // Kaiser windowed sinc, keeps distant textures sharper but may ring around hard edges
+		};
+
 		Image() = default;
 		Image(const std::filesystem::path& pathToImage);
 		Image(const Image&) = delete;
@@ -14,17 +20,49 @@ namespace Cala {
 		Image& operator=(Image&& other);
 		~Image();
 		void load(const std::filesystem::path& pathToImage);
+		// Decodes encoded file contents, path is kept only for reference
+		void loadFromMemory(const unsigned char* bytes, size_t size, const std::string& pathToImage = "");
 		void freeData();
+
+		/**
+		 * Decodes images in parallel on the thread pool, each from its file mapped to memory
+		 * Images are in order of paths, those which failed to load have no data
+		*/
+		static std::vector<Image> loadBatch(const std::vector<std::filesystem::path>& pathsToImages);
+
+		/**
+		 * Generates all smaller levels down to 1x1, each level halves the previous one rounded down
+		 * Levels are filtered in linear floating point from the previous one, color of sRGB images is converted to linear space
+		 * and back, alpha is always linear. Rows are filtered in parallel on the thread pool
+		*/
+		void generateMipmaps(MipmapFilter filter = MipmapFilter::Box, bool sRGB = true);
+		// Level 0 is the image itself
+		uint32_t getMipmapCount() const { return data != nullptr ? (uint32_t)mipmaps.size() + 1 : 0; }
+		glm::ivec2 getMipmapDimensions(uint32_t level) const;
+		const unsigned char* getMipmapData(uint32_t level) const { return level == 0 ? data : mipmaps[level - 1].data(); }
+
 		glm::ivec2 getDimensions() const { return glm::ivec2(width, height); }
 		int getChannelCount() const { return channelCount; }
 		const unsigned char* getData() const { return data; }
 		const std::string& getPath() const { return path; }
 
 	private:
+		static bool checkPath(const std::filesystem::path& pathToImage);
+
+		// Source texel with its weight in a filtered texel
+		struct Tap {
+			int index;
+			float weight;
+		};
+
+		// Taps of each destination texel along one axis, starting at the offsets, the last offset is the total tap count
+		static void computeMipmapTaps(int sourceSize, int size, MipmapFilter filter, std::vector<Tap>& taps, std::vector<uint32_t>& offsets);
+
 		int height = 0;
 		int width = 0;
 		int channelCount = 0;
 		unsigned char* data = nullptr;
+		std::vector<std::vector<unsigned char>> mipmaps;
 		std::string path;
 	};
 }
@@ -0,0 +1,102 @@
+#include "MappedFile.h"
+#ifdef CALA_PLATFORM_WINDOWS
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+namespace Cala {
+	MappedFile::MappedFile(const std::filesystem::path& path)
+	{
+		open(path);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+#ifdef CALA_PLATFORM_WINDOWS
+	bool MappedFile::open(const std::filesystem::path& path)
+	{
+		close();
+		HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		HANDLE mapping = nullptr;
+		if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+			mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		const void* view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (view == nullptr)
+		{
+			if (mapping != nullptr)
+				CloseHandle(mapping);
+
+			CloseHandle(file);
+			return false;
+		}
+
+		fileHandle = file;
+		mappingHandle = mapping;
+		data = (const unsigned char*)view;
+		size = (size_t)fileSize.QuadPart;
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (data == nullptr)
+			return;
+
+		UnmapViewOfFile(data);
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		data = nullptr;
+		size = 0;
+		fileHandle = nullptr;
+		mappingHandle = nullptr;
+	}
+#else
+	bool MappedFile::open(const std::filesystem::path& path)
+	{
+		close();
+		const int file = ::open(path.c_str(), O_RDONLY);
+		if (file < 0)
+			return false;
+
+		// Mapping stays valid after the descriptor is closed
+		struct stat fileStatus;
+		void* view = MAP_FAILED;
+		if (fstat(file, &fileStatus) == 0 && fileStatus.st_size > 0)
+			view = mmap(nullptr, (size_t)fileStatus.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+		::close(file);
+		if (view == MAP_FAILED)
+			return false;
+
+		// Decoders read files from start to end
+		madvise(view, (size_t)fileStatus.st_size, MADV_SEQUENTIAL);
+		data = (const unsigned char*)view;
+		size = (size_t)fileStatus.st_size;
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (data == nullptr)
+			return;
+
+		munmap((void*)data, size);
+		data = nullptr;
+		size = 0;
+	}
+#endif
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <filesystem>
+#include <stddef.h>
+#include "Platform.h"
+
+namespace Cala {
+	/**
+	 * Read only file mapped to memory, its pages are read by the system as they're first accessed
+	 * Contents are shared with the page cache, so nothing is copied into a buffer of the process
+	*/
+	class MappedFile {
+	public:
+		MappedFile() = default;
+		MappedFile(const std::filesystem::path& path);
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		~MappedFile();
+
+		// Returns false if the file can't be mapped, empty files can't
+		bool open(const std::filesystem::path& path);
+		void close();
+
+		bool isOpen() const { return data != nullptr; }
+		const unsigned char* getData() const { return data; }
+		size_t getSize() const { return size; }
+
+	private:
+		const unsigned char* data = nullptr;
+		size_t size = 0;
+	#ifdef CALA_PLATFORM_WINDOWS
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+	#endif
+	};
+}
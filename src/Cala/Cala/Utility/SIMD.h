@@ -0,0 +1,18 @@
+#pragma once
+
+// Instruction sets available to CPU side kernels, AVX2 paths are enabled with CALA_ENABLE_AVX2 CMake option
+#if defined (__AVX2__)
+	#define CALA_SIMD_AVX2
+#endif
+
+#if defined (__AVX__)
+	#define CALA_SIMD_AVX
+#endif
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CALA_SIMD_SSE2
+#endif
+
+#if defined (CALA_SIMD_SSE2) || defined (CALA_SIMD_AVX)
+	#include <immintrin.h>
+#endif
@@ -0,0 +1,113 @@
+#include "ThreadPool.h"
+#include <atomic>
+#include <algorithm>
+
+namespace Cala {
+	ThreadPool::ThreadPool(uint32_t threadCount)
+	{
+		workers.reserve(threadCount);
+		for (uint32_t i = 0; i < threadCount; ++i)
+			workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(tasksMutex);
+			stopping = true;
+		}
+
+		tasksCondition.notify_all();
+		for (auto& worker : workers)
+			worker.join();
+	}
+
+	ThreadPool& ThreadPool::getInstance()
+	{
+		// Calling thread takes part in parallelFor, so one hardware thread is left for it
+		static ThreadPool instance(std::max(1U, std::thread::hardware_concurrency()) - 1U);
+		return instance;
+	}
+
+	void ThreadPool::enqueue(std::function<void()>&& task)
+	{
+		if (workers.empty())
+		{
+			task();
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(tasksMutex);
+			tasks.push(std::move(task));
+		}
+
+		tasksCondition.notify_one();
+	}
+
+	void ThreadPool::workerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(tasksMutex);
+				tasksCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+				if (stopping && tasks.empty())
+					return;
+
+				task = std::move(tasks.front());
+				tasks.pop();
+			}
+
+			task();
+		}
+	}
+
+	void ThreadPool::parallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t begin, uint32_t end)>& function)
+	{
+		if (count == 0)
+			return;
+
+		chunkSize = std::max(chunkSize, 1U);
+		const uint32_t chunkCount = (count + chunkSize - 1) / chunkSize;
+		if (chunkCount == 1 || workers.empty())
+		{
+			function(0, count);
+			return;
+		}
+
+		// Shared state outlives the call since helper tasks may start after all chunks are already done
+		struct SharedState {
+			std::atomic<uint32_t> nextChunk{ 0 };
+			std::atomic<uint32_t> finishedChunks{ 0 };
+			std::mutex mutex;
+			std::condition_variable finished;
+		};
+
+		auto state = std::make_shared<SharedState>();
+		auto processChunks = [state, count, chunkSize, chunkCount, function]()
+		{
+			uint32_t chunk;
+			while ((chunk = state->nextChunk.fetch_add(1)) < chunkCount)
+			{
+				const uint32_t begin = chunk * chunkSize;
+				function(begin, std::min(begin + chunkSize, count));
+				if (state->finishedChunks.fetch_add(1) + 1 == chunkCount)
+				{
+					std::lock_guard<std::mutex> lock(state->mutex);
+					state->finished.notify_all();
+				}
+			}
+		};
+
+		const uint32_t helperCount = std::min(chunkCount - 1, (uint32_t)workers.size());
+		for (uint32_t i = 0; i < helperCount; ++i)
+			enqueue(processChunks);
+
+		processChunks();
+
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->finished.wait(lock, [&state, chunkCount]() { return state->finishedChunks.load() == chunkCount; });
+	}
+}
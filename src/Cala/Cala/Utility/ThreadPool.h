@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+namespace Cala {
+	class ThreadPool {
+	public:
+		~ThreadPool();
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		static ThreadPool& getInstance();
+
+		template<typename Function>
+		std::future<std::invoke_result_t<Function>> submit(Function&& function);
+
+		/**
+		 * Splits [0, count) into chunks of chunkSize and processes them on worker threads and the calling thread
+		 * Blocks until all chunks are processed, safe to call from worker threads
+		*/
+		void parallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t begin, uint32_t end)>& function);
+		uint32_t getThreadCount() const { return (uint32_t)workers.size(); }
+
+	private:
+		ThreadPool(uint32_t threadCount);
+		void enqueue(std::function<void()>&& task);
+		void workerLoop();
+
+		std::vector<std::thread> workers;
+		std::queue<std::function<void()>> tasks;
+		std::mutex tasksMutex;
+		std::condition_variable tasksCondition;
+		bool stopping = false;
+	};
+
+	template<typename Function>
+	std::future<std::invoke_result_t<Function>> ThreadPool::submit(Function&& function)
+	{
+		using ReturnType = std::invoke_result_t<Function>;
+		auto task = std::make_shared<std::packaged_task<ReturnType()>>(std::forward<Function>(function));
+		std::future<ReturnType> result = task->get_future();
+		enqueue([task]() { (*task)(); });
+		return result;
+	}
+}
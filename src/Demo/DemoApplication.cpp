@@ -1,5 +1,7 @@
 #include "DemoApplication.h"
 #include <glm/gtc/random.hpp>
+#include "Cala/Utility/Logger.h"
+#include "Cala/Rendering/Renderers/RenderProxies.h"
 
 #define LIGHT_MOVE 10.f * time.deltaTime
 
@@ -10,15 +12,14 @@ sphereMesh(Model().loadSphere(5, 10)), cubeMesh(Model().loadCube())
 	camera.setProjectionFarPlane(100.f);
 	camera.setPosition(glm::vec3(0.f, 40.f, 25.f));
 
-	// Reserves are VERY important for memory consistency (references!!!)
+	// Scene geometry doesn't change, so it's registered once instead of pushed every frame
 	const uint32_t CUBES_COUNT = 30;
-	cubeRenderables.reserve(CUBES_COUNT);
 	for (int i = 0; i < CUBES_COUNT; ++i) {
 		Transformation transformation;
 		glm::vec2 diskRand = glm::diskRand(19.f);
 		transformation.scale(glm::linearRand(0.5f, 2.f)).translate(glm::vec3(diskRand.x, glm::linearRand(4.f, 8.f), diskRand.y));
 
-		cubeRenderables.push_back(LightRenderer::Renderable(
+		lightRenderer.addRenderable(LightRenderer::Renderable(
 			cubeMesh, transformation, glm::vec4((glm::ballRand(1.f) + 1.f) * 0.5f, 1.f),
 			nullptr, nullptr, nullptr, 0.05f, 0.3f, 0.8f, 40.f
 		));
@@ -30,17 +31,27 @@ sphereMesh(Model().loadSphere(5, 10)), cubeMesh(Model().loadCube())
 	wallTransforms[2].translate(glm::vec3(-20.f, 10.f, 0.f)).scale(glm::vec3(40.f, 20.f, 0.5f)).rotate(90.f, glm::vec3(0.f, 1.f, 0.f)); // Left wall
 	wallTransforms[4].scale(glm::vec3(40.f, 1.f, 40.f)); // Left wall
 
+	// Walls are solid boxes, so they hide cubes behind them
+	for (const auto& w : wallTransforms)
+	{
+		LightRenderer::Renderable wall(
+			cubeMesh, w, glm::vec4(0.7f, 0.3f, 0.1f, 1.f), nullptr, nullptr,
+			nullptr, 0.04f, 0.9f, 0.2f, 5.f
+		);
+		wall.occluder = true;
+		lightRenderer.addRenderable(wall);
+	}
+
 	glm::vec2 rand = glm::diskRand(10.f);
 	lightTransformation.translate(glm::vec3(rand.x, 20.f, rand.y)).scale(0.2f);
 
 	api->setBufferClearingColor(glm::vec4(glm::vec3(0.1f), 1.f));
+	lightRenderer.depthPrePassMode = LightRenderer::DepthPrePassMode::Automatic;
+	lightRenderer.occlusionCulling = true;
 }
 
 void DemoApplication::loop()
 {
-	api->activateFramebuffer(nullptr);
-	api->clearFramebuffer();
-
 	lightRenderer.pushLight(
 		LightRenderer::Light(
 			LightRenderer::Light::Type::Point, lightTransformation, 1.f, glm::vec3(1.f, 1.f, 1.f), 45.f, true
@@ -53,27 +64,83 @@ void DemoApplication::loop()
 		)
 	);
 
-	for (const auto& w : wallTransforms)
-	{
-		lightRenderer.pushRenderable(
-			LightRenderer::Renderable(
-				cubeMesh, w, glm::vec4(0.7f, 0.3f, 0.1f, 1.f), nullptr, nullptr,
-				nullptr, 0.04f, 0.9f, 0.2f, 5.f
-			)
-		);
-	}
-
-	for (const auto& cubeRenderable : cubeRenderables)
-		lightRenderer.pushRenderable(cubeRenderable);
-
 	simpleRenderer.setupCamera(camera);
 	lightRenderer.setupCamera(camera);
-	simpleRenderer.render(api.get(), nullptr);
-	lightRenderer.render(api.get(), nullptr);
+
+	// With effects, scene is rendered into transient targets of the frame graph, which post-processing reads
+	struct SceneTargets {
+		RenderGraph::ResourceHandle color;
+		RenderGraph::ResourceHandle depth;
+	};
+
+	const RenderGraph::ResourceHandle screen = frameGraph.importFramebuffer("Screen", nullptr, api->getCurrentViewport());
+	const bool postProcessing = postProcessingRenderer.hasEffects();
+	const glm::uvec2 sceneSize = postProcessing ? postProcessingRenderer.beginPasses(frameGraph, screen) : glm::uvec2(1U);
+	const SceneTargets scene = frameGraph.addPass<SceneTargets>("Simple",
+		[&](RenderGraph::PassBuilder& builder, SceneTargets& data) {
+			data = { screen, screen };
+			if (postProcessing)
+			{
+				data.color = builder.createTexture("SceneColor", { sceneSize, ITexture::Format::RGBA });
+				data.depth = builder.createTexture("SceneDepth", { sceneSize, ITexture::Format::DEPTH24_STENCIL8 });
+			}
+
+			builder.writeColor(data.color, true);
+			builder.writeDepth(data.depth, true);
+		},
+		[this](const SceneTargets&, GraphicsAPI* api, const RenderGraph::PassResources& resources) {
+			simpleRenderer.render(api, resources.getPassFramebuffer());
+		});
+
+	lightRenderer.addPasses(frameGraph, scene.color, scene.depth);
+	if (postProcessing)
+		postProcessingRenderer.addPasses(frameGraph, scene.color, screen);
+
+	frameGraph.execute(api.get());
+
+	// Culling statistics are reported once per second
+	if ((uint32_t)time.getRunningTime() != lastStatisticsSecond)
+	{
+		lastStatisticsSecond = (uint32_t)time.getRunningTime();
+		const auto& statistics = lightRenderer.getCullingStatistics();
+		Logger::getInstance().logInfoToConsole("Frustum culling: " + std::to_string(statistics.visibleCount) + " visible, " 
+			+ std::to_string(statistics.culledCount) + " culled");
+
+		const auto& queueStatistics = lightRenderer.getQueueStatistics();
+		Logger::getInstance().logInfoToConsole("Render queue: " + std::to_string(queueStatistics.drawCount) + " draws in " 
+			+ std::to_string(queueStatistics.batchCount) + " batches, " 
+			+ std::to_string(queueStatistics.avoidedStateChanges) + " state changes avoided, sorted in " 
+			+ std::to_string(queueStatistics.sortTime) + " ms");
+
+		// Rest of the statistics is reported only after F3 turns it on
+		if (detailedStatistics)
+		{
+			const auto& occlusionStatistics = lightRenderer.getOcclusionStatistics();
+			Logger::getInstance().logInfoToConsole("Occlusion culling: " + std::to_string(occlusionStatistics.occludedCount) + " occluded by " 
+				+ std::to_string(occlusionStatistics.occluderCount) + " occluders, rasterized in " 
+				+ std::to_string(occlusionStatistics.rasterizationTime) + " ms");
+
+			const auto& proxyStatistics = lightRenderer.getRenderProxies().getStatistics();
+			Logger::getInstance().logInfoToConsole("Render proxies: " + std::to_string(proxyStatistics.registeredCount) + " registered, " 
+				+ std::to_string(proxyStatistics.uploadedCount) + " uploaded, " 
+				+ std::to_string(lightRenderer.getRenderProxies().getMaterials().getCount()) + " materials");
+
+			Logger::getInstance().logInfoToConsole("Depth pre-pass: " + std::string(lightRenderer.isDepthPrePassActive() ? "on" : "off")
+				+ ", measured overdraw " + std::to_string(lightRenderer.getMeasuredOverdraw()));
+
+			const auto& graphStatistics = frameGraph.getStatistics();
+			Logger::getInstance().logInfoToConsole("Frame graph: " + std::to_string(graphStatistics.passCount) + " passes, " 
+				+ std::to_string(graphStatistics.physicalTextureCount) + " textures backing " 
+				+ std::to_string(graphStatistics.transientTextureCount) + " transient ones");
+		}
+	}
 
 	const IIOSystem& io = window->getIO();
 	const float moveFactor = 10.f;
 
+	if (io.isKeyTapped(IIOSystem::KeyCode::KEY_F3))
+		detailedStatistics = !detailedStatistics;
+
 	if (io.isKeyPressed(IIOSystem::KeyCode::KEY_LEFT)) 
 		lightTransformation.translate(glm::vec3(-time.getDeltaTime() * moveFactor, 0.f, 0.f));
 
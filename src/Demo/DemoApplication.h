@@ -2,6 +2,8 @@
 #include "Cala/Utility/BaseApplication.h"
 #include "Cala/Rendering/Renderers/LightRenderer.h"
 #include "Cala/Rendering/Renderers/SimpleRenderer.h"
+#include "Cala/Rendering/Renderers/PostProcessingRenderer.h"
+#include "Cala/Rendering/RenderGraph.h"
 
 using namespace Cala;
 
@@ -17,6 +19,10 @@ private:
 	std::array<Transformation, 5> wallTransforms;
 	SimpleRenderer simpleRenderer;
 	LightRenderer lightRenderer;
-	std::vector<LightRenderer::Renderable> cubeRenderables;
+	PostProcessingRenderer postProcessingRenderer;
+	RenderGraph frameGraph;
 	Transformation lightTransformation;
+	uint32_t lastStatisticsSecond = 0;
+	// Occlusion, proxy, pre-pass and frame graph statistics, toggled by F3
+	bool detailedStatistics = false;
 };
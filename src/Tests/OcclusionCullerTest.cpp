@@ -0,0 +1,111 @@
+#include <string>
+#include <vector>
+#include <Cala/Rendering/OcclusionCuller.h>
+#include <Cala/Utility/Logger.h>
+
+using namespace Cala;
+
+// Identity view projection, so world coordinates are normalized device coordinates and depth is z / 2 + 1 / 2
+#define WIDTH 64U
+#define HEIGHT 32U
+#define WALL_DEPTH 0.45f
+
+static int failedCount = 0;
+
+static void check(bool condition, const std::string& description)
+{
+	if (!condition)
+	{
+		Logger::getInstance().logErrorToConsole("Failed: " + description);
+		++failedCount;
+	}
+}
+
+// Wall covering middle half of the screen in both dimensions, its near face at z = -0.1
+static void pushScene(OcclusionCuller& culler, bool reversed)
+{
+	std::vector<glm::vec3> boxes = {
+		glm::vec3(-0.5f, -0.5f, -0.1f), glm::vec3(0.5f, 0.5f, 0.f),
+		glm::vec3(-0.3f, -0.3f, 0.2f), glm::vec3(0.3f, 0.3f, 0.4f), // Hidden behind the wall, mustn't change any pixel
+		glm::vec3(0.6f, -0.9f, 0.5f), glm::vec3(0.9f, -0.6f, 0.6f)
+	};
+
+	culler.begin(glm::mat4(1.f));
+	for (size_t i = 0; i < boxes.size(); i += 2)
+	{
+		const size_t box = reversed ? boxes.size() - 2 - i : i;
+		culler.pushOccluderBox(boxes[box], boxes[box + 1], glm::mat4(1.f));
+	}
+
+	culler.rasterize();
+}
+
+static void testDepthBuffer(const OcclusionCuller& culler)
+{
+	const std::vector<float>& depth = culler.getDepthBuffer();
+	check(culler.getResolution() == glm::uvec2(WIDTH, HEIGHT), "resolution");
+
+	// Pixel centers inside [-0.5, 0.5] are columns 16 to 47 and rows 8 to 23
+	uint32_t wallCount = 0;
+	for (uint32_t y = 8; y < 24; ++y)
+	{
+		for (uint32_t x = 16; x < 48; ++x)
+			wallCount += glm::abs(depth[y * WIDTH + x] - WALL_DEPTH) < 1e-5f ? 1 : 0;
+	}
+
+	check(wallCount == 32 * 16, "wall covers all pixels inside it at its near depth");
+	check(depth[7 * WIDTH + 32] == 1.f && depth[24 * WIDTH + 32] == 1.f, "rows around the wall are cleared");
+	check(depth[16 * WIDTH + 15] == 1.f && depth[16 * WIDTH + 48] == 1.f, "columns around the wall are cleared");
+	check(glm::abs(depth[2 * WIDTH + 56] - 0.75f) < 1e-5f, "small box in the corner is rasterized at its depth");
+	check(depth[0] == 1.f && depth[WIDTH * HEIGHT - 1] == 1.f, "screen corners are cleared");
+}
+
+static void testHierarchy(const OcclusionCuller& culler)
+{
+	check(culler.getLevelCount() == 7, "hierarchy goes down from 64x32 to 1x1 in 7 levels");
+	check(culler.getLevelSize(1) == glm::uvec2(32, 16) && culler.getLevelSize(6) == glm::uvec2(1, 1), "level sizes halve");
+
+	// Texels of level 3 cover 8x8 pixels, the wall covers texels 2 to 5 horizontally and 1 to 2 vertically
+	const std::vector<float>& level = culler.getDepthLevel(3);
+	const glm::uvec2 size = culler.getLevelSize(3);
+	check(glm::abs(level[1 * size.x + 2] - WALL_DEPTH) < 1e-5f && glm::abs(level[2 * size.x + 5] - WALL_DEPTH) < 1e-5f,
+		"texels inside the wall keep its depth");
+	check(level[1 * size.x + 1] == 1.f && level[0] == 1.f, "texels partly outside the wall keep the farthest depth");
+	check(culler.getDepthLevel(6)[0] == 1.f, "last level keeps the farthest depth of the screen");
+}
+
+static void testVisibility(OcclusionCuller& culler)
+{
+	const glm::mat4 identity(1.f);
+	check(!culler.testBoundingBox(glm::vec3(-0.1f, -0.1f, 0.5f), glm::vec3(0.1f, 0.1f, 0.6f), identity), "box behind the wall is occluded");
+	check(culler.testBoundingBox(glm::vec3(-0.1f, -0.1f, -0.5f), glm::vec3(0.1f, 0.1f, -0.4f), identity), "box in front of the wall is visible");
+	check(culler.testBoundingBox(glm::vec3(0.7f, 0.6f, 0.5f), glm::vec3(0.8f, 0.8f, 0.6f), identity), "box beside the wall is visible");
+	check(culler.testBoundingBox(glm::vec3(0.3f, -0.1f, 0.5f), glm::vec3(0.8f, 0.1f, 0.6f), identity), "box partly behind the wall is visible");
+	check(culler.testBoundingBox(glm::vec3(-0.1f, -0.1f, -1.5f), glm::vec3(0.1f, 0.1f, 0.6f), identity), "box crossing near plane is visible");
+	check(culler.getStatistics().testedCount == 5 && culler.getStatistics().occludedCount == 1, "statistics count tests");
+}
+
+int main()
+{
+	OcclusionCuller culler(WIDTH, HEIGHT);
+	pushScene(culler, false);
+	testDepthBuffer(culler);
+	testHierarchy(culler);
+	testVisibility(culler);
+
+	// Pixels keep the nearest depth whatever order bands and triangles come in, so results are bitwise equal
+	OcclusionCuller reversedCuller(WIDTH, HEIGHT);
+	pushScene(reversedCuller, true);
+	check(reversedCuller.getDepthBuffer() == culler.getDepthBuffer(), "depth buffer doesn't depend on occluder order");
+	for (uint32_t run = 0; run < 8; ++run)
+	{
+		pushScene(reversedCuller, run % 2 == 0);
+		check(reversedCuller.getDepthLevel(3) == culler.getDepthLevel(3), "hierarchy is the same in repeated runs");
+	}
+
+	if (failedCount != 0)
+		return 1;
+
+	Logger::getInstance().logInfoToConsole("Occlusion culler tests passed");
+	return 0;
+}
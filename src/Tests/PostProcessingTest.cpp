@@ -0,0 +1,184 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <Cala/Utility/GLFWWindow.h>
+#include <Cala/Utility/Logger.h>
+#include <Cala/Rendering/GraphicsAPI.h>
+#include <Cala/Rendering/RenderGraph.h>
+#include <Cala/Rendering/CPUPostProcessor.h>
+
+using namespace Cala;
+using Effect = PostProcessingRenderer::PostProcessingEffect;
+
+// Large enough for a bloom chain of several mips, which ends before mips get smaller than 4 texels
+#define WIDTH 128U
+#define HEIGHT 96U
+
+// Return code CTest reports as a skipped test, used when there is no OpenGL context to render with
+#define SKIP_RETURN_CODE 77
+
+static int failedCount = 0;
+
+/**
+ * Effects rendered by PostProcessingRenderer are read back and compared with CPUPostProcessor results of the same input
+ * Tolerances are the largest per channel difference allowed, in units of the [0, 1] range, alpha isn't compared
+ * GPU bilinear filtering has limited precision and bloom mips are half floats, so filtering effects get more than per pixel ones
+*/
+struct TestCase {
+	std::string name;
+	std::vector<std::pair<Effect, float>> effects;
+	bool computeBlur = false;
+	float tolerance = 1.f / 255.f;
+};
+
+static const std::vector<TestCase> testCases = {
+	{ "HDR", { { Effect::HDR, 1.5f } }, false, 1.f / 255.f },
+	{ "Negative", { { Effect::Negative, 0.f } }, false, 1.f / 255.f },
+	{ "Box blur", { { Effect::BoxBlur, 700.f } }, false, 2.f / 255.f },
+	{ "Gaussian blur", { { Effect::GaussianBlur, 700.f } }, false, 2.f / 255.f },
+	{ "Separable box blur", { { Effect::BoxBlur, 700.f } }, true, 2.f / 255.f },
+	{ "Separable Gaussian blur", { { Effect::GaussianBlur, 700.f } }, true, 2.f / 255.f },
+	{ "Edge detection", { { Effect::EdgeDetection, 200.f } }, false, 2.f / 255.f },
+	{ "Bloom", { { Effect::Bloom, 4.f } }, false, 4.f / 255.f },
+	{ "Fused HDR and negative", { { Effect::HDR, 1.5f }, { Effect::Negative, 0.f } }, false, 1.f / 255.f },
+	{ "Blur fused with HDR", { { Effect::GaussianBlur, 700.f }, { Effect::HDR, 2.f } }, false, 2.f / 255.f }
+};
+
+// Gradients with hard edged blocks and a bright square for bloom to spread, all within [0, 1]
+static std::vector<float> createInputImage()
+{
+	std::vector<float> pixels((size_t)WIDTH * HEIGHT * 4);
+	for (uint32_t y = 0; y < HEIGHT; ++y)
+	{
+		for (uint32_t x = 0; x < WIDTH; ++x)
+		{
+			float* pixel = &pixels[((size_t)y * WIDTH + x) * 4];
+			const bool block = ((x / 8) + (y / 8)) % 2 == 0;
+			const bool bright = x >= 40 && x < 56 && y >= 40 && y < 56;
+			pixel[0] = bright ? 1.f : (float)x / (WIDTH - 1);
+			pixel[1] = bright ? 1.f : block ? 0.8f : 0.15f;
+			pixel[2] = bright ? 1.f : 0.5f + 0.4f * glm::sin((float)(x + 2 * y) * 0.1f);
+			pixel[3] = 1.f;
+		}
+	}
+
+	return pixels;
+}
+
+template<typename Pixel>
+static std::vector<float> toFloats(const std::vector<Pixel>& pixels)
+{
+	const float scale = sizeof(Pixel) == 1 ? 1.f / 255.f : 1.f;
+	std::vector<float> floats(pixels.size());
+	for (size_t i = 0; i < pixels.size(); ++i)
+		floats[i] = (float)pixels[i] * scale;
+
+	return floats;
+}
+
+static void compare(const std::vector<float>& gpu, const std::vector<float>& cpu, const TestCase& testCase, const std::string& precision)
+{
+	float maxDifference = 0.f;
+	size_t maxDifferenceIndex = 0;
+	for (size_t i = 0; i < gpu.size(); ++i)
+	{
+		if (i % 4 == 3)
+			continue;
+
+		const float difference = glm::abs(gpu[i] - cpu[i]);
+		if (difference > maxDifference)
+		{
+			maxDifference = difference;
+			maxDifferenceIndex = i;
+		}
+	}
+
+	if (maxDifference <= testCase.tolerance)
+		return;
+
+	const size_t pixel = maxDifferenceIndex / 4;
+	Logger::getInstance().logErrorToConsole("Failed: " + testCase.name + " (" + precision + ") differs by " + std::to_string(maxDifference * 255.f)
+		+ " / 255 at pixel " + std::to_string(pixel % WIDTH) + ", " + std::to_string(pixel / WIDTH) + ", allowed "
+		+ std::to_string(testCase.tolerance * 255.f) + " / 255");
+	++failedCount;
+}
+
+template<typename Pixel>
+static void testPrecision(GraphicsAPI* api, PostProcessingRenderer& renderer, ITexture::Format format, const std::string& precision)
+{
+	std::vector<Pixel> input;
+	const std::vector<float> image = createInputImage();
+	for (float value : image)
+		input.push_back(sizeof(Pixel) == 1 ? (Pixel)glm::round(value * 255.f) : (Pixel)value);
+
+	// Effects sample outside of the image near its edges, CPU effects clamp to the edge texels
+	Texture::Specification specification(WIDTH, HEIGHT, format, Texture::Dimensionality::TwoDimensional);
+	specification.renderingStyle.sDimensionWrap = Texture::WrappingMethod::ClampToEdge;
+	specification.renderingStyle.tDimensionWrap = Texture::WrappingMethod::ClampToEdge;
+	Texture inputTexture;
+	inputTexture.load(specification, input.data());
+
+	Texture* outputTexture = new Texture;
+	outputTexture->load(specification, nullptr);
+	Framebuffer output;
+	output.addColorTarget(outputTexture, true);
+	output.load();
+
+	RenderGraph graph;
+	for (const TestCase& testCase : testCases)
+	{
+		renderer.computeBlur = testCase.computeBlur;
+		const RenderGraph::ResourceHandle target = graph.importFramebuffer("Output", &output, { 0, 0, (int)WIDTH, (int)HEIGHT });
+		const RenderGraph::ResourceHandle scene = graph.importTexture("Input", inputTexture);
+		renderer.beginPasses(graph, target);
+		for (const auto& [effect, value] : testCase.effects)
+			renderer.pushEffect(effect, value);
+
+		renderer.addPasses(graph, scene, target);
+		graph.execute(api);
+
+		std::vector<Pixel> gpu(input.size());
+		outputTexture->readPixels(gpu.data());
+
+		CPUPostProcessor processor;
+		processor.computeBlur = testCase.computeBlur;
+		for (const auto& [effect, value] : testCase.effects)
+			processor.pushEffect(effect, value);
+
+		std::vector<Pixel> cpu = input;
+		processor.process(cpu.data(), WIDTH, HEIGHT);
+		compare(toFloats(gpu), toFloats(cpu), testCase, precision);
+	}
+}
+
+int main()
+{
+	// Context of a hidden window, hints set after initialization are kept by window creation
+	if (!glfwInit())
+		return SKIP_RETURN_CODE;
+
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWWindow window(IWindow::Specification("CalaPostProcessingTest", WIDTH, HEIGHT, 0));
+	if (glfwGetCurrentContext() == nullptr || !GLAD_GL_VERSION_4_4)
+	{
+		Logger::getInstance().logInfoToConsole("No OpenGL 4.4 context, post-processing tests skipped");
+		return SKIP_RETURN_CODE;
+	}
+
+	{
+		// Fused programs are ready right away, so effects are always fused as they are on the CPU
+		Shader::setCompilationMode(Shader::CompilationMode::Synchronous);
+		std::unique_ptr<GraphicsAPI> api(GraphicsAPI::construct());
+		PostProcessingRenderer renderer;
+		testPrecision<uint8_t>(api.get(), renderer, ITexture::Format::RGBA, "8 bit");
+		testPrecision<float>(api.get(), renderer, ITexture::Format::FLOAT_RGBA, "float");
+	}
+
+	if (failedCount != 0)
+		return 1;
+
+	Logger::getInstance().logInfoToConsole("Post-processing tests passed");
+	return 0;
+}
@@ -0,0 +1,117 @@
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <Cala/Utility/Image.h>
+#include <Cala/Utility/CompressedImage.h>
+#include <Cala/Utility/Logger.h>
+#include <Cala/Utility/ThreadPool.h>
+
+using namespace Cala;
+
+static void printUsage()
+{
+	Logger::getInstance().logInfoToConsole(
+		"Usage: CalaTextureCompressor [--format bc1|bc3|bc5|bc7] [--linear] [--kaiser] [--output directory] images...\n"
+		"Each image is written with its mipmaps to a DDS file of the same name, next to it or to the output directory\n"
+		"  --format   BC7 by default, BC5 is meant for normal maps\n"
+		"  --linear   Color isn't sRGB, for normal, roughness and other data maps\n"
+		"  --kaiser   Mipmaps are filtered by Kaiser window instead of box filter");
+}
+
+int main(int argc, char** argv)
+{
+	CompressedImage::Format format = CompressedImage::Format::BC7;
+	bool sRGB = true;
+	Image::MipmapFilter filter = Image::MipmapFilter::Box;
+	std::filesystem::path outputDirectory;
+	std::vector<std::filesystem::path> paths;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string argument = argv[i];
+		if (argument == "--format" && i + 1 < argc)
+		{
+			const std::string name = argv[++i];
+			if (name == "bc1")
+				format = CompressedImage::Format::BC1;
+			else if (name == "bc3")
+				format = CompressedImage::Format::BC3;
+			else if (name == "bc5")
+				format = CompressedImage::Format::BC5;
+			else if (name == "bc7")
+				format = CompressedImage::Format::BC7;
+			else
+			{
+				printUsage();
+				return 1;
+			}
+		}
+		else if (argument == "--linear")
+			sRGB = false;
+		else if (argument == "--kaiser")
+			filter = Image::MipmapFilter::Kaiser;
+		else if (argument == "--output" && i + 1 < argc)
+			outputDirectory = argv[++i];
+		else if (argument.rfind("--", 0) == 0)
+		{
+			printUsage();
+			return 1;
+		}
+		else
+			paths.emplace_back(argument);
+	}
+
+	if (paths.empty())
+	{
+		printUsage();
+		return 1;
+	}
+
+	// Two channel normal maps hold no color
+	if (format == CompressedImage::Format::BC5)
+		sRGB = false;
+
+	// Decoding, filtering and encoding all run on the thread pool, images are decoded in batches of one per thread to keep memory low
+	const auto start = std::chrono::steady_clock::now();
+	const size_t batchSize = (size_t)ThreadPool::getInstance().getThreadCount() + 1;
+	int failedCount = 0;
+	for (size_t first = 0; first < paths.size(); first += batchSize)
+	{
+		const std::vector<std::filesystem::path> batchPaths(paths.begin() + first, paths.begin() + std::min(first + batchSize, paths.size()));
+		std::vector<Image> images = Image::loadBatch(batchPaths);
+		for (size_t i = 0; i < images.size(); ++i)
+		{
+			if (images[i].getData() == nullptr)
+			{
+				++failedCount;
+				continue;
+			}
+
+			images[i].generateMipmaps(filter, sRGB);
+			CompressedImage compressed;
+			compressed.encode(images[i], format, sRGB);
+			images[i].freeData();
+
+			std::filesystem::path outputPath = batchPaths[i];
+			outputPath.replace_extension(".dds");
+			if (!outputDirectory.empty())
+				outputPath = outputDirectory / outputPath.filename();
+
+			if (!compressed.save(outputPath))
+			{
+				++failedCount;
+				continue;
+			}
+
+			Logger::getInstance().logInfoToConsole(batchPaths[i].string() + " -> " + outputPath.string() + " (" +
+				std::to_string(compressed.getDimensions().x) + "x" + std::to_string(compressed.getDimensions().y) + ", " +
+				std::to_string(compressed.getMipmapCount()) + " levels)");
+		}
+	}
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	Logger::getInstance().logInfoToConsole("Compressed " + std::to_string(paths.size() - failedCount) + " of " +
+		std::to_string(paths.size()) + " images in " + std::to_string(seconds) + " s");
+	return failedCount == 0 ? 0 : 1;
+}